@@ -21,16 +21,33 @@
 
 var common = require('../common.js');
 
-var bench = common.createBenchmark(main, {});
+var bench = common.createBenchmark(main, {
+  encoding: ['base64', 'hex'],
+  op: ['encode', 'decode'],
+  len: [64, 1024, 1024 * 1024, 64 * 1024 * 1024]
+});
 
+// Encodes or decodes up to 2 GB, reports GB/s of binary data. Small sizes
+// do fewer bytes, they're bounded by the per call overhead.
 function main(conf) {
-  var N = 64 * 1024 * 1024;
-  var b = Buffer(N);
+  var encoding = conf.encoding;
+  var len = +conf.len;
+  var n = Math.min((2 * 1024 * 1024 * 1024) / len, 1e6);
+  var gb = n * len / (1024 * 1024 * 1024);
+
+  var b = Buffer(len);
   var s = '';
   for (var i = 0; i < 256; ++i) s += String.fromCharCode(i);
+  for (var i = 0; i < len; i += 256) b.write(s, i, 256, 'ascii');
 
-  bench.start();
-  for (var i = 0; i < N; i += 256) b.write(s, i, 256, 'ascii');
-  for (var i = 0; i < 32; ++i) b.toString('base64');
-  bench.end(64);
+  if (conf.op === 'encode') {
+    bench.start();
+    for (var i = 0; i < n; ++i) b.toString(encoding);
+    bench.end(gb);
+  } else {
+    var str = b.toString(encoding);
+    bench.start();
+    for (var i = 0; i < n; ++i) new Buffer(str, encoding);
+    bench.end(gb);
+  }
 }
@@ -9,7 +9,7 @@ var bench = common.createBenchmark(main, {
   type: ['asc', 'utf', 'buf'],
   out: ['hex', 'binary', 'buffer'],
   len: [2, 1024, 102400, 1024 * 1024],
-  api: ['legacy', 'stream']
+  api: ['legacy', 'stream', 'oneshot']
 });
 
 function main(conf) {
@@ -42,7 +42,11 @@ function main(conf) {
       throw new Error('unknown message type: ' + conf.type);
   }
 
-  var fn = api === 'stream' ? streamWrite : legacyWrite;
+  var fn = legacyWrite;
+  if (api === 'stream')
+    fn = streamWrite;
+  else if (api === 'oneshot')
+    fn = oneShot;
 
   bench.start();
   fn(conf.algo, message, encoding, conf.writes, conf.len, conf.out);
@@ -84,3 +88,14 @@ function streamWrite(algo, message, encoding, writes, len, outEnc) {
 
   bench.end(gbits);
 }
+
+function oneShot(algo, message, encoding, writes, len, outEnc) {
+  var written = writes * len;
+  var bits = written * 8;
+  var gbits = bits / (1024 * 1024 * 1024);
+
+  while (writes-- > 0)
+    crypto.hash(algo, message, encoding, outEnc);
+
+  bench.end(gbits);
+}
@@ -8,7 +8,7 @@ var bench = common.createBenchmark(main, {
   algo: [ 'sha256', 'md5' ],
   type: ['asc', 'utf', 'buf'],
   len: [2, 1024, 102400, 1024 * 1024],
-  api: ['legacy', 'stream']
+  api: ['legacy', 'stream', 'async']
 });
 
 function main(conf) {
@@ -41,7 +41,11 @@ function main(conf) {
       throw new Error('unknown message type: ' + conf.type);
   }
 
-  var fn = api === 'stream' ? streamWrite : legacyWrite;
+  var fn = legacyWrite;
+  if (api === 'stream')
+    fn = streamWrite;
+  else if (api === 'async')
+    fn = asyncWrite;
 
   bench.start();
   fn(conf.algo, message, encoding, conf.writes, conf.len);
@@ -75,3 +79,27 @@ function streamWrite(algo, message, encoding, writes, len) {
 
   bench.end(gbits);
 }
+
+// Chunks from crypto.ASYNC_THRESHOLD up are hashed on the thread pool,
+// the writes wait for 'drain' like they would in a pipe.
+function asyncWrite(algo, message, encoding, writes, len) {
+  var written = writes * len;
+  var bits = written * 8;
+  var gbits = bits / (1024 * 1024 * 1024);
+  var h = crypto.createHash(algo, { async: true });
+
+  h.on('readable', function() {
+    h.read();
+    bench.end(gbits);
+  });
+
+  write();
+
+  function write() {
+    while (writes-- > 0) {
+      if (!h.write(message, encoding))
+        return h.once('drain', write);
+    }
+    h.end();
+  }
+}
@@ -0,0 +1,59 @@
+// Measure the tail latency of crypto.pbkdf2() while the thread pool is kept
+// busy with file system reads. Reports the 99th percentile in ms.
+
+var path = require('path');
+var common = require('../common.js');
+var crypto = require('crypto');
+var fs = require('fs');
+var filename = path.resolve(__dirname, '.removeme-benchmark-garbage');
+
+var bench = common.createBenchmark(main, {
+  dur: [5],
+  fs: [0, 16, 64],
+  iterations: [1000, 10000]
+});
+
+function main(conf) {
+  var latencies = [];
+  var running = true;
+
+  try { fs.unlinkSync(filename); } catch (e) {}
+  var data = new Buffer(64 * 1024);
+  data.fill('x');
+  fs.writeFileSync(filename, data);
+  data = null;
+
+  bench.start();
+  setTimeout(function() {
+    running = false;
+    try { fs.unlinkSync(filename); } catch (e) {}
+    latencies.sort(function(a, b) { return a - b; });
+    bench.report(latencies[Math.floor(latencies.length * 0.99)] || 0);
+  }, +conf.dur * 1000);
+
+  function read() {
+    fs.readFile(filename, function(er) {
+      if (er && running)
+        throw er;
+      if (running)
+        read();
+    });
+  }
+
+  function hash() {
+    var start = process.hrtime();
+    crypto.pbkdf2('password', 'salt', +conf.iterations, 64, function(er) {
+      if (er)
+        throw er;
+      var elapsed = process.hrtime(start);
+      latencies.push(elapsed[0] * 1e3 + elapsed[1] / 1e6);
+      if (running)
+        hash();
+    });
+  }
+
+  var n = +conf.fs;
+  while (n--) read();
+
+  hash();
+}
@@ -0,0 +1,51 @@
+// Measure the tail latency of fs.stat() while the thread pool is kept
+// busy with CPU bound crypto work. Reports the 99th percentile in ms.
+
+var common = require('../common.js');
+var crypto = require('crypto');
+var fs = require('fs');
+
+var bench = common.createBenchmark(main, {
+  dur: [5],
+  cpu: [0, 4, 16],
+  concurrent: [1, 10]
+});
+
+function main(conf) {
+  var latencies = [];
+  var running = true;
+
+  bench.start();
+  setTimeout(function() {
+    running = false;
+    latencies.sort(function(a, b) { return a - b; });
+    bench.report(latencies[Math.floor(latencies.length * 0.99)] || 0);
+  }, +conf.dur * 1000);
+
+  function cpu() {
+    crypto.pbkdf2('password', 'salt', 10000, 64, function(er) {
+      if (er)
+        throw er;
+      if (running)
+        cpu();
+    });
+  }
+
+  function stat() {
+    var start = process.hrtime();
+    fs.stat(__filename, function(er) {
+      if (er)
+        throw er;
+      var elapsed = process.hrtime(start);
+      latencies.push(elapsed[0] * 1e3 + elapsed[1] / 1e6);
+      if (running)
+        stat();
+    });
+  }
+
+  var n = +conf.cpu;
+  while (n--) cpu();
+
+  n = +conf.concurrent;
+  while (n--) stat();
+}
@@ -0,0 +1,39 @@
+// Parse requests that arrive in fragments of `frag` bytes, like from a
+// client on a slow link, straight through the parser binding.
+
+var common = require('../common.js');
+
+var bench = common.createBenchmark(main, {
+  headers: [8, 48],
+  frag: [1, 16, 256, 4096],
+  n: [1e4]
+});
+
+var HTTPParser = process.binding('http_parser').HTTPParser;
+
+function main(conf) {
+  var n = +conf.n;
+  var frag = +conf.frag;
+
+  var lines = ['GET /some/path/to/a/resource?with=query&string=1 HTTP/1.1'];
+  for (var i = 0; i < +conf.headers; i++)
+    lines.push('X-Header-' + i + ': some value that is not too short ' + i);
+  var buf = new Buffer(lines.join('\r\n') + '\r\n\r\n');
+
+  // Slice up front so the loop is only the parser.
+  var chunks = [];
+  for (var off = 0; off < buf.length; off += frag)
+    chunks.push(buf.slice(off, Math.min(off + frag, buf.length)));
+
+  var parser = new HTTPParser(HTTPParser.REQUEST, true);
+  parser.onHeaders = function() {};
+  parser.onHeadersComplete = function() {};
+  parser.onMessageComplete = function() {};
+
+  bench.start();
+  for (var i = 0; i < n; i++) {
+    for (var j = 0; j < chunks.length; j++)
+      parser.execute(chunks[j], 0, chunks[j].length);
+  }
+  bench.end(n);
+}
@@ -0,0 +1,68 @@
+// Keep-alive clients that pipeline `pipeline` requests per write, the
+// way some load balancers multiplex their upstream connections. Reports
+// requests per second.
+
+var common = require('../common.js');
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  pipeline: [1, 8, 64],
+  c: [10],
+  dur: [5]
+});
+
+var http = require('http');
+var net = require('net');
+
+function main(conf) {
+  var pipeline = +conf.pipeline;
+  var dur = +conf.dur;
+  var requests = 0;
+  var running = true;
+
+  var server = http.createServer(function(req, res) {
+    requests++;
+    res.end('ok');
+  });
+
+  var request = 'GET / HTTP/1.1\r\n' +
+                'Host: 127.0.0.1\r\n' +
+                'User-Agent: bench\r\n' +
+                'Accept: */*\r\n\r\n';
+  var batch = new Buffer(new Array(pipeline + 1).join(request));
+
+  server.listen(PORT, function() {
+    for (var i = 0; i < +conf.c; i++)
+      client();
+
+    bench.start();
+    setTimeout(function() {
+      running = false;
+      bench.end(requests);
+      process.exit(0);
+    }, dur * 1000);
+  });
+
+  function client() {
+    var socket = net.connect(PORT);
+    var pending = pipeline;
+    var tail = '';
+
+    socket.setEncoding('ascii');
+    socket.on('data', function(chunk) {
+      // Count status lines, one may be split between chunks.
+      var data = tail + chunk;
+      var i = -1;
+      while ((i = data.indexOf('HTTP/1.1 ', i + 1)) !== -1)
+        pending--;
+      tail = data.slice(-8);
+
+      if (pending === 0 && running) {
+        pending = pipeline;
+        socket.write(batch);
+      }
+    });
+
+    socket.write(batch);
+  }
+}
@@ -5,9 +5,23 @@ var bench = common.createBenchmark(main, {
   // unicode confuses ab on os x.
   type: ['bytes', 'buffer'],
   length: [4, 1024, 102400],
+  headers: ['none', 'browser'],
   c: [50, 500]
 });
 
+// What a browser sends along with a page request, give or take. The
+// more of them there are, the more the parser's header handling shows.
+var browserHeaders = [
+  'Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8',
+  'Accept-Encoding: gzip,deflate,sdch',
+  'Accept-Language: en-US,en;q=0.8',
+  'Cache-Control: max-age=0',
+  'Cookie: sid=0123456789abcdef; theme=dark',
+  'Referer: http://127.0.0.1/',
+  'User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36',
+  'X-Requested-With: XMLHttpRequest'
+];
+
 function main(conf) {
   process.env.PORT = PORT;
   var spawn = require('child_process').spawn;
@@ -16,6 +30,12 @@ function main(conf) {
     var path = '/' + conf.type + '/' + conf.length; //+ '/' + conf.chunks;
     var args = ['-r', 5000, '-t', 8, '-c', conf.c];
 
+    if (conf.headers === 'browser') {
+      browserHeaders.forEach(function(header) {
+        args.push('-H', header);
+      });
+    }
+
     bench.http(path, args, function() {
       server.close();
     });
@@ -0,0 +1,86 @@
+// test UDP send/recv packet rate with batched sends and receives
+
+var common = require('../common.js');
+var PORT = common.PORT;
+
+// `num` is the number of datagrams to queue up each time, `batch` the
+// number of datagrams per sendMany() call and per receive batch. A `batch`
+// of 1 uses send() and plain receives.
+var bench = common.createBenchmark(main, {
+  len: [64, 1024],
+  num: [256],
+  batch: [1, 32],
+  type: ['send', 'recv'],
+  dur: [5]
+});
+
+var dur;
+var len;
+var num;
+var batch;
+var type;
+var chunk;
+var chunks;
+
+function main(conf) {
+  dur = +conf.dur;
+  len = +conf.len;
+  num = +conf.num;
+  batch = +conf.batch;
+  type = conf.type;
+
+  chunk = new Buffer(len);
+  chunks = [];
+  for (var i = 0; i < batch; i++)
+    chunks.push(chunk);
+
+  server();
+}
+
+var dgram = require('dgram');
+
+function server() {
+  var sent = 0;
+  var received = 0;
+  var socket = dgram.createSocket('udp4');
+
+  function onsend() {
+    if (sent++ % num == 0)
+      for (var i = 0; i < num; i++)
+        socket.send(chunk, 0, chunk.length, PORT, '127.0.0.1', onsend);
+  }
+
+  function onsendmany(err, n) {
+    sent += n;
+    if (sent % num == 0)
+      for (var i = 0; i < num; i += batch)
+        socket.sendMany(chunks, PORT, '127.0.0.1', onsendmany);
+  }
+
+  socket.on('listening', function() {
+    bench.start();
+
+    if (batch > 1)
+      onsendmany(null, 0);
+    else
+      onsend();
+
+    setTimeout(function() {
+      var packets = type === 'send' ? sent : received;
+      bench.end(packets);
+    }, dur * 1000);
+  });
+
+  if (batch > 1) {
+    socket.setRecvBatch(batch, len);
+    socket.on('messages', function(buf, offsets, rinfos) {
+      received += rinfos.length;
+    });
+  } else {
+    socket.on('message', function(buf, rinfo) {
+      received++;
+    });
+  }
+
+  socket.bind(PORT);
+}
@@ -0,0 +1,73 @@
+// Resident memory of a server with many mostly idle clients, after the
+// model of benchmark/idle_clients.js. Every client trickles in a small
+// message now and then, the server holds on to the last chunk it got from
+// each of them, like a parser that waits for the rest of a request would.
+// Reports the resident set size in MB, lower is better.
+
+var common = require('../common.js');
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  clients: [1000, 5000],
+  rounds: [10],
+  len: [16, 1024]
+});
+
+var net = require('net');
+
+function main(conf) {
+  var clients = +conf.clients;
+  var rounds = +conf.rounds;
+  var message = new Buffer(+conf.len);
+  message.fill('x');
+
+  var held = [];
+  var received = 0;
+  var sockets = [];
+
+  var server = net.createServer(function(socket) {
+    var id = held.length;
+    held.push(null);
+    socket.on('data', function(chunk) {
+      held[id] = chunk;
+      if (++received === clients)
+        setImmediate(round);
+    });
+  });
+
+  server.listen(PORT, function() {
+    var pending = clients;
+    for (var i = 0; i < clients; i++) {
+      sockets.push(net.connect(PORT, function() {
+        if (--pending === 0)
+          round();
+      }));
+    }
+  });
+
+  function round() {
+    received = 0;
+
+    if (rounds-- === 0)
+      return done();
+
+    sockets.forEach(function(socket) {
+      socket.write(message);
+    });
+  }
+
+  function done() {
+    if (typeof gc === 'function')
+      gc();
+
+    bench.report(process.memoryUsage().rss / (1024 * 1024));
+
+    var stats = process.binding('buffer').getPoolStats();
+    console.error('read buffer pool: %j', stats);
+
+    sockets.forEach(function(socket) {
+      socket.destroy();
+    });
+    server.close();
+  }
+}
@@ -0,0 +1,55 @@
+// test the speed of a proxy that forwards with .pipe() or .splice()
+
+var common = require('../common.js');
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  method: ['pipe', 'splice'],
+  len: [65536],
+  dur: [5]
+});
+
+var net = require('net');
+
+function main(conf) {
+  var dur = +conf.dur;
+  var len = +conf.len;
+  var method = conf.method;
+  var received = 0;
+
+  var chunk = new Buffer(len);
+  chunk.fill('x');
+
+  var sink = net.createServer(function(socket) {
+    socket.on('data', function(data) {
+      received += data.length;
+    });
+  });
+
+  var proxy = net.createServer(function(socket) {
+    var upstream = net.connect(PORT + 1);
+    if (method === 'splice')
+      socket.splice(upstream);
+    else
+      socket.pipe(upstream);
+  });
+
+  sink.listen(PORT + 1, function() {
+    proxy.listen(PORT, function() {
+      var socket = net.connect(PORT, function() {
+        bench.start();
+        write();
+
+        setTimeout(function() {
+          var gbits = (received * 8) / (1024 * 1024 * 1024);
+          bench.end(gbits);
+        }, dur * 1000);
+      });
+
+      function write() {
+        while (socket.write(chunk));
+        socket.once('drain', write);
+      }
+    });
+  });
+}
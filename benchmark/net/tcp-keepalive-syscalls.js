@@ -0,0 +1,102 @@
+// Count the event loop's system calls per request with many idle and a
+// number of active keep-alive connections. Active connections ping-pong
+// small messages so they keep toggling between readable and writable.
+// Needs strace(1) and permission to attach to this process.
+
+var common = require('../common.js');
+var PORT = common.PORT;
+
+var bench = common.createBenchmark(main, {
+  idle: [0, 1000, 10000],
+  active: [10, 100],
+  dur: [5]
+});
+
+var net = require('net');
+var spawn = require('child_process').spawn;
+
+var message = new Buffer('ping');
+
+function main(conf) {
+  var idle = +conf.idle;
+  var active = +conf.active;
+  var dur = +conf.dur;
+  var requests = 0;
+  var sockets = [];
+
+  var server = net.createServer(function(socket) {
+    socket.on('data', function(chunk) {
+      requests++;
+      socket.write(chunk);
+    });
+  });
+
+  server.listen(PORT, function() {
+    connect(idle, function() {}, function() {
+      connect(active, pingPong, measure);
+    });
+  });
+
+  function connect(n, onconnect, cb) {
+    var pending = n;
+    if (pending === 0)
+      return cb();
+
+    for (var i = 0; i < n; i++) {
+      var socket = net.connect(PORT, function() {
+        onconnect(this);
+        if (--pending === 0)
+          cb();
+      });
+      sockets.push(socket);
+    }
+  }
+
+  function pingPong(socket) {
+    socket.on('data', function() {
+      socket.write(message);
+    });
+  }
+
+  function measure() {
+    var args = ['-c', '-q', '-p', process.pid];
+    var strace = spawn('strace', args);
+    var summary = '';
+
+    strace.stderr.setEncoding('utf8');
+    strace.stderr.on('data', function(chunk) {
+      summary += chunk;
+    });
+
+    strace.on('close', function() {
+      var calls = total(summary);
+      if (calls === -1)
+        throw new Error('could not parse strace summary:\n' + summary);
+
+      bench.report(calls / requests);
+    });
+
+    // Give strace a moment to attach before the clock starts.
+    setTimeout(function() {
+      requests = 0;
+
+      sockets.slice(idle).forEach(function(socket) {
+        socket.write(message);
+      });
+
+      setTimeout(function() {
+        strace.kill('SIGINT');
+      }, dur * 1000);
+    }, 500);
+  }
+}
+
+// The summary ends with a line like this, the errors column is optional:
+// 100.00    0.123456                  4567       123 total
+function total(summary) {
+  var lines = summary.trim().split('\n');
+  var fields = lines[lines.length - 1].trim().split(/\s+/);
+  if (fields[fields.length - 1] !== 'total')
+    return -1;
+  return +fields[2];
+}
@@ -0,0 +1,24 @@
+// Client side of the handshake benchmarks. Runs in its own process so that
+// its half of each handshake doesn't count against the server's event loop.
+// Usage: node _handshake-client.js <port> <concurrency>
+
+var tls = require('tls');
+
+var port = +process.argv[2];
+var concurrency = +process.argv[3];
+
+function connect() {
+  var conn = tls.connect({ port: port, rejectUnauthorized: false }, function() {
+    conn.end();
+  });
+  conn.on('close', connect);
+  conn.on('error', function() {});
+}
+
+for (var i = 0; i < concurrency; i++)
+  connect();
+
+// The benchmark is over once the parent is.
+process.on('disconnect', function() {
+  process.exit(0);
+});
@@ -0,0 +1,49 @@
+// 99th percentile of the event loop's lag in milliseconds while the server
+// is busy with a burst of handshakes. A 1 ms timer measures how late it
+// fires; the clients run in a separate process.
+
+var common = require('../common.js');
+var bench = common.createBenchmark(main, {
+  offload: [0, 1],
+  concurrency: [10, 100],
+  dur: [5]
+});
+
+var fork = require('child_process').fork;
+var fs = require('fs');
+var path = require('path');
+var tls = require('tls');
+
+function main(conf) {
+  var dur = +conf.dur;
+  var lags = [];
+
+  var cert_dir = path.resolve(__dirname, '../../test/fixtures');
+  var options = { key: fs.readFileSync(cert_dir + '/test_key.pem'),
+                  cert: fs.readFileSync(cert_dir + '/test_cert.pem'),
+                  offloadHandshake: !!+conf.offload };
+
+  var server = tls.createServer(options, function(conn) {
+    conn.end();
+  });
+
+  server.listen(common.PORT, function() {
+    var client = fork(path.join(__dirname, '_handshake-client.js'),
+                      [common.PORT, conf.concurrency]);
+
+    var last = process.hrtime();
+    var timer = setInterval(function() {
+      var elapsed = process.hrtime(last);
+      lags.push(Math.max(0, elapsed[0] * 1e3 + elapsed[1] / 1e6 - 1));
+      last = process.hrtime();
+    }, 1);
+
+    setTimeout(function() {
+      clearInterval(timer);
+      client.kill();
+
+      lags.sort(function(a, b) { return a - b; });
+      bench.report(lags[Math.floor(lags.length * 0.99)] || 0);
+    }, dur * 1000);
+  });
+}
@@ -0,0 +1,40 @@
+// Server handshakes per second, on the event loop or on the thread pool.
+// The clients run in a separate process.
+
+var common = require('../common.js');
+var bench = common.createBenchmark(main, {
+  offload: [0, 1],
+  concurrency: [10, 100],
+  dur: [5]
+});
+
+var fork = require('child_process').fork;
+var fs = require('fs');
+var path = require('path');
+var tls = require('tls');
+
+function main(conf) {
+  var dur = +conf.dur;
+  var handshakes = 0;
+
+  var cert_dir = path.resolve(__dirname, '../../test/fixtures');
+  var options = { key: fs.readFileSync(cert_dir + '/test_key.pem'),
+                  cert: fs.readFileSync(cert_dir + '/test_cert.pem'),
+                  offloadHandshake: !!+conf.offload };
+
+  var server = tls.createServer(options, function(conn) {
+    handshakes++;
+    conn.end();
+  });
+
+  server.listen(common.PORT, function() {
+    var client = fork(path.join(__dirname, '_handshake-client.js'),
+                      [common.PORT, conf.concurrency]);
+
+    bench.start();
+    setTimeout(function() {
+      client.kill();
+      bench.end(handshakes);
+    }, dur * 1000);
+  });
+}
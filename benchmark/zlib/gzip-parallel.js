@@ -0,0 +1,44 @@
+// Throughput of one large gzip stream, compressed serially by Gzip or
+// split across the thread pool by ParallelGzip.
+var common = require('../common.js');
+var zlib = require('zlib');
+
+var bench = common.createBenchmark(main, {
+  type: ['gzip', 'parallel'],
+  parallel: [2, 4],
+  blockSize: [128 * 1024],
+  size: [64]  // MB
+});
+
+function main(conf) {
+  var size = conf.size * 1024 * 1024;
+  var chunk = new Buffer(64 * 1024);
+  for (var i = 0; i < chunk.length; i++)
+    chunk[i] = i % 1000 < 500 ? 97 + (i * 7919) % 26 : chunk[i - 700];
+
+  var gzip;
+  if (conf.type === 'parallel') {
+    gzip = zlib.createParallelGzip({ parallel: +conf.parallel,
+                                     blockSize: +conf.blockSize });
+  } else {
+    gzip = zlib.createGzip();
+  }
+
+  gzip.on('data', function() {});
+  gzip.on('end', function() {
+    bench.end(size / (1024 * 1024));
+  });
+
+  var written = 0;
+  bench.start();
+  write();
+
+  function write() {
+    while (written < size) {
+      written += chunk.length;
+      if (!gzip.write(chunk))
+        return gzip.once('drain', write);
+    }
+    gzip.end();
+  }
+}
@@ -0,0 +1,53 @@
+// Compress one response-sized payload at a time, the way an HTTP server
+// gzips its responses. inline=0 forces every write through the thread
+// pool, inline=1 uses the default threshold.
+var common = require('../common.js');
+var zlib = require('zlib');
+
+var bench = common.createBenchmark(main, {
+  len: [256, 1024, 4096, 16384, 65536],
+  inline: [0, 1],
+  api: ['buffer', 'stream'],
+  n: [5000]
+});
+
+function main(conf) {
+  var len = +conf.len;
+  var n = +conf.n;
+  var opts = {};
+  if (+conf.inline === 0)
+    opts.inlineThreshold = 0;
+
+  // JSON-ish text that compresses about as well as a real response.
+  var payload = new Buffer(len);
+  var words = '{"id":12345,"name":"node","tags":["a","b"],"ok":true},';
+  for (var i = 0; i < len; i++)
+    payload[i] = words.charCodeAt(i % words.length) ^ (i % 7 === 0 ? 1 : 0);
+
+  var fn = conf.api === 'stream' ? gzipStream : gzipBuffer;
+  var done = 0;
+
+  bench.start();
+  next();
+
+  function next() {
+    if (done++ === n)
+      return bench.end(n);
+    fn(payload, opts, next);
+  }
+}
+
+function gzipBuffer(payload, opts, cb) {
+  zlib.gzip(payload, opts, function(err) {
+    if (err)
+      throw err;
+    cb();
+  });
+}
+
+function gzipStream(payload, opts, cb) {
+  var gzip = zlib.createGzip(opts);
+  gzip.on('data', function() {});
+  gzip.on('end', cb);
+  gzip.end(payload);
+}
@@ -0,0 +1,56 @@
+// Throughput of gzip and gunzip on a large buffer, at zlib's fastest,
+// default and best compression levels.
+var common = require('../common.js');
+var zlib = require('zlib');
+
+var bench = common.createBenchmark(main, {
+  op: ['gzip', 'gunzip'],
+  level: [1, 6, 9],
+  type: ['text', 'random'],
+  size: [4]  // MB
+});
+
+function main(conf) {
+  var size = conf.size * 1024 * 1024;
+  var input = new Buffer(size);
+  var i;
+
+  if (conf.type === 'text') {
+    // node's own sources compress about as well as an HTML page.
+    var fs = require('fs');
+    var path = require('path');
+    var dir = path.resolve(__dirname, '../../lib');
+    var text = fs.readdirSync(dir).map(function(name) {
+      return fs.readFileSync(path.join(dir, name));
+    });
+    text = Buffer.concat(text);
+    for (i = 0; i < size; i += text.length)
+      text.copy(input, i, 0, Math.min(text.length, size - i));
+  } else {
+    for (i = 0; i < size; i++)
+      input[i] = Math.random() * 256;
+  }
+
+  var opts = { level: +conf.level };
+  zlib.gzip(input, opts, function(err, compressed) {
+    if (err)
+      throw err;
+
+    var n = 0;
+    var fn = conf.op === 'gzip' ? zlib.gzip : zlib.gunzip;
+    var data = conf.op === 'gzip' ? input : compressed;
+
+    bench.start();
+    next();
+
+    function next() {
+      fn(data, opts, function(err) {
+        if (err)
+          throw err;
+        if (++n === 10)
+          return bench.end(n * conf.size);
+        next();
+      });
+    }
+  });
+}
@@ -116,6 +116,23 @@ do {                                                                 \
 #define CALLBACK_DATA_NOADVANCE(FOR)                                 \
     CALLBACK_DATA_(FOR, p - FOR##_mark, p - data)
 
+/* Step over the bytes after p that `scan` says the state machine can skip,
+ * counting them towards the header size limit. Stops short of the limit so
+ * that the byte that crosses it still fails with HPE_HEADER_OVERFLOW.
+ */
+#define SKIP_AHEAD(scan)                                             \
+do {                                                                 \
+  const char *scan_end = data + len;                                 \
+  size_t scan_max = HTTP_MAX_HEADER_SIZE - parser->nread;            \
+  size_t skip;                                                       \
+  if ((size_t) (scan_end - (p + 1)) > scan_max)                      \
+    scan_end = p + 1 + scan_max;                                     \
+  skip = scan(p + 1, scan_end);                                      \
+  parser->nread += skip;                                             \
+  p += skip;                                                         \
+} while (0)
+
+
 /* Set the mark FOR; non-destructive if mark is already set */
 #define MARK(FOR)                                                    \
 do {                                                                 \
@@ -406,6 +423,223 @@ do {                                                                 \
 #endif
 
 
+/* Fast-forward loops for the states that most bytes of a request go through
+ * without the parser doing anything: the request path and query string,
+ * and header values. Each one returns the number of bytes at the start of
+ * [p, end) that the state machine would step over without changing state.
+ * They may return fewer, so the vector versions only need to stop at the
+ * first byte that might matter. The switch in http_parser_execute() deals
+ * with that byte as usual.
+ *
+ * SSE2 is used on x86 where the compiler has it, SSE4.2 if the CPU has it
+ * at run time. Define HTTP_PARSER_SIMD=0 to build without either.
+ */
+#ifndef HTTP_PARSER_SIMD
+# define HTTP_PARSER_SIMD 1
+#endif
+
+#if HTTP_PARSER_SIMD && defined(__GNUC__) && \
+    (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+# define HTTP_PARSER_SSE2 1
+# include <emmintrin.h>
+/* clang claims to be gcc 4.2, ask it for __builtin_cpu_supports instead. */
+# if defined(__clang__)
+#  if defined(__has_builtin)
+#   if __has_builtin(__builtin_cpu_supports)
+#    define HTTP_PARSER_SSE42 1
+#   endif
+#  endif
+# elif __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#  define HTTP_PARSER_SSE42 1
+# endif
+# if HTTP_PARSER_SSE42
+#  include <nmmintrin.h>
+# endif
+#endif
+
+typedef size_t (*scan_cb) (const char *p, const char *end);
+
+
+static size_t
+scan_header_value_c (const char *p, const char *end)
+{
+  const char *s;
+
+  for (s = p; s != end && *s != CR && *s != LF; s++);
+
+  return s - p;
+}
+
+
+/* Bytes that keep s_req_path in s_req_path. '?' and '#' are not among
+ * them, so this works for s_req_query_string as well: it stops at a '?'
+ * that the state machine would have skipped. */
+static size_t
+scan_url_c (const char *p, const char *end)
+{
+  const char *s;
+
+  for (s = p; s != end && IS_URL_CHAR(*s); s++);
+
+  return s - p;
+}
+
+
+#if HTTP_PARSER_SSE2
+static size_t
+scan_header_value_sse2 (const char *p, const char *end)
+{
+  const __m128i cr = _mm_set1_epi8(CR);
+  const __m128i lf = _mm_set1_epi8(LF);
+  const char *s;
+  __m128i v;
+  int mask;
+
+  for (s = p; end - s >= 16; s += 16) {
+    v = _mm_loadu_si128((const __m128i *) s);
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                                          _mm_cmpeq_epi8(v, lf)));
+    if (mask != 0) {
+      return (s - p) + __builtin_ctz(mask);
+    }
+  }
+
+  return (s - p) + scan_header_value_c(s, end);
+}
+
+
+/* Stops at control characters and space, DEL, '#' and '?', and in strict
+ * mode at anything over 0x7f. Tab and form feed are URL characters in
+ * non-strict mode; the state machine takes care of those. */
+static size_t
+scan_url_sse2 (const char *p, const char *end)
+{
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i del = _mm_set1_epi8(0x7f);
+  const __m128i hash = _mm_set1_epi8('#');
+  const __m128i question = _mm_set1_epi8('?');
+  const char *s;
+  __m128i v;
+  __m128i stop;
+  int mask;
+
+  for (s = p; end - s >= 16; s += 16) {
+    v = _mm_loadu_si128((const __m128i *) s);
+    stop = _mm_cmpeq_epi8(_mm_min_epu8(v, space), v);
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, del));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, hash));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, question));
+    mask = _mm_movemask_epi8(stop);
+#if HTTP_PARSER_STRICT
+    mask |= _mm_movemask_epi8(v);
+#endif
+    if (mask != 0) {
+      return (s - p) + __builtin_ctz(mask);
+    }
+  }
+
+  return (s - p) + scan_url_c(s, end);
+}
+#endif  /* HTTP_PARSER_SSE2 */
+
+
+#if HTTP_PARSER_SSE42
+#define SCAN_SSE42_MODE                                              \
+  (_SIDD_UBYTE_OPS | _SIDD_LEAST_SIGNIFICANT)
+
+__attribute__((target("sse4.2")))
+static size_t
+scan_header_value_sse42 (const char *p, const char *end)
+{
+  const __m128i set = _mm_setr_epi8(CR, LF, 0, 0, 0, 0, 0, 0,
+                                    0, 0, 0, 0, 0, 0, 0, 0);
+  const char *s;
+  int i;
+
+  for (s = p; end - s >= 16; s += 16) {
+    i = _mm_cmpestri(set, 2, _mm_loadu_si128((const __m128i *) s), 16,
+                     SCAN_SSE42_MODE | _SIDD_CMP_EQUAL_ANY);
+    if (i != 16) {
+      return (s - p) + i;
+    }
+  }
+
+  return (s - p) + scan_header_value_c(s, end);
+}
+
+
+/* Same stop set as scan_url_sse2(), as ranges. */
+__attribute__((target("sse4.2")))
+static size_t
+scan_url_sse42 (const char *p, const char *end)
+{
+  const __m128i ranges = _mm_setr_epi8(0x00, ' ', '#', '#', '?', '?',
+                                       0x7f, 0x7f, (char) 0x80, (char) 0xff,
+                                       0, 0, 0, 0, 0, 0);
+  const char *s;
+  int i;
+
+  for (s = p; end - s >= 16; s += 16) {
+    i = _mm_cmpestri(ranges, HTTP_PARSER_STRICT ? 10 : 8,
+                     _mm_loadu_si128((const __m128i *) s), 16,
+                     SCAN_SSE42_MODE | _SIDD_CMP_RANGES);
+    if (i != 16) {
+      return (s - p) + i;
+    }
+  }
+
+  return (s - p) + scan_url_c(s, end);
+}
+
+#undef SCAN_SSE42_MODE
+#endif  /* HTTP_PARSER_SSE42 */
+
+
+static size_t scan_header_value_init (const char *p, const char *end);
+static size_t scan_url_init (const char *p, const char *end);
+
+/* Point at the *_init() functions until the first call, which picks the
+ * implementation. Every thread that gets there first picks the same one. */
+static scan_cb scan_header_value = scan_header_value_init;
+static scan_cb scan_url = scan_url_init;
+
+
+static void
+scan_init (void)
+{
+#if HTTP_PARSER_SSE42
+  if (__builtin_cpu_supports("sse4.2")) {
+    scan_header_value = scan_header_value_sse42;
+    scan_url = scan_url_sse42;
+    return;
+  }
+#endif
+#if HTTP_PARSER_SSE2
+  scan_header_value = scan_header_value_sse2;
+  scan_url = scan_url_sse2;
+#else
+  scan_header_value = scan_header_value_c;
+  scan_url = scan_url_c;
+#endif
+}
+
+
+static size_t
+scan_header_value_init (const char *p, const char *end)
+{
+  scan_init();
+  return scan_header_value(p, end);
+}
+
+
+static size_t
+scan_url_init (const char *p, const char *end)
+{
+  scan_init();
+  return scan_url(p, end);
+}
+
+
 /* Map errno values to strings for human-readable output */
 #define HTTP_STRERROR_GEN(n, s) { "HPE_" #n, s },
 static struct {
@@ -1052,6 +1286,11 @@ size_t http_parser_execute (http_parser *parser,
               SET_ERRNO(HPE_INVALID_URL);
               goto error;
             }
+
+            if (parser->state == s_req_path ||
+                parser->state == s_req_query_string) {
+              SKIP_AHEAD(scan_url);
+            }
         }
         break;
       }
@@ -1440,6 +1679,11 @@ size_t http_parser_execute (http_parser *parser,
           goto reexecute_byte;
         }
 
+        if (parser->header_state == h_general) {
+          SKIP_AHEAD(scan_header_value);
+          break;
+        }
+
         c = LOWER(ch);
 
         switch (parser->header_state) {
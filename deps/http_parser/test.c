@@ -896,6 +896,32 @@ const struct message requests[] =
   ,.body= ""
   }
 
+#define LONG_URL_AND_HEADER_VALUES 34
+, {.name= "long url and header values"
+  ,.type= HTTP_REQUEST
+  ,.raw= "GET /some-rather-long-path-segment-0/some-rather-long-path-segment-1/some-rather-long-path-segment-2/some-rather-long-path-segment-3/some-rather-long-path-segment-4?a=1&b=two&c=%20three&d=?four&e=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx#frag HTTP/1.1\r\n"
+         "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/29.0.1547.57 Safari/537.36\r\n"
+         "Cookie: sessionid=0123456789abcdef0123456789abcdef; csrftoken=fedcba9876543210fedcba9876543210; a=b\r\n"
+         "X-Empty: \r\n"
+         "\r\n"
+  ,.should_keep_alive= TRUE
+  ,.message_complete_on_eof= FALSE
+  ,.http_major= 1
+  ,.http_minor= 1
+  ,.method= HTTP_GET
+  ,.query_string= "a=1&b=two&c=%20three&d=?four&e=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+  ,.fragment= "frag"
+  ,.request_path= "/some-rather-long-path-segment-0/some-rather-long-path-segment-1/some-rather-long-path-segment-2/some-rather-long-path-segment-3/some-rather-long-path-segment-4"
+  ,.request_url= "/some-rather-long-path-segment-0/some-rather-long-path-segment-1/some-rather-long-path-segment-2/some-rather-long-path-segment-3/some-rather-long-path-segment-4?a=1&b=two&c=%20three&d=?four&e=xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx#frag"
+  ,.num_headers= 3
+  ,.headers=
+    { { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/29.0.1547.57 Safari/537.36" }
+    , { "Cookie", "sessionid=0123456789abcdef0123456789abcdef; csrftoken=fedcba9876543210fedcba9876543210; a=b" }
+    , { "X-Empty", "" }
+    }
+  ,.body= ""
+  }
+
 
 , {.name= NULL } /* sentinel */
 };
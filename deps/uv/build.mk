@@ -122,6 +122,9 @@ TESTS= \
 	test/test-tcp-flags.o \
 	test/test-tcp-open.o \
 	test/test-tcp-read-stop.o \
+	test/test-tcp-read-stop-start.o \
+	test/test-tcp-splice.o \
+	test/test-tcp-splice-file.o \
 	test/test-tcp-shutdown-after-write.o \
 	test/test-tcp-unexpected-read.o \
 	test/test-tcp-writealot.o \
@@ -129,11 +132,13 @@ TESTS= \
 	test/test-thread.o \
 	test/test-threadpool.o \
 	test/test-threadpool-cancel.o \
+	test/test-threadpool-lanes.o \
 	test/test-timer-again.o \
 	test/test-timer.o \
 	test/test-tty.o \
 	test/test-udp-dgram-too-big.o \
 	test/test-udp-ipv6.o \
+	test/test-udp-mmsg.o \
 	test/test-udp-multicast-join.o \
 	test/test-udp-multicast-ttl.o \
 	test/test-udp-open.o \
@@ -101,6 +101,7 @@ LDFLAGS+=-ldl -lrt
 RUNNER_CFLAGS += -D_GNU_SOURCE
 OBJS += src/unix/linux-core.o \
         src/unix/linux-inotify.o \
+        src/unix/linux-iouring.o \
         src/unix/linux-syscalls.o \
         src/unix/proctitle.o
 endif
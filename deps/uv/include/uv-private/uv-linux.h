@@ -22,10 +22,16 @@
 #ifndef UV_LINUX_H
 #define UV_LINUX_H
 
+#define UV_IO_PRIVATE_PLATFORM_FIELDS                                         \
+  int edge_triggered;                                                         \
+  unsigned int missed_events;                                                 \
+
 #define UV_PLATFORM_LOOP_FIELDS                                               \
   uv__io_t inotify_read_watcher;                                              \
   void* inotify_watchers;                                                     \
   int inotify_fd;                                                             \
+  void* iou_ring;                                                             \
+  int iou_disabled;                                                           \
 
 #define UV_PLATFORM_FS_EVENT_FIELDS                                           \
   void* watchers[2];                                                          \
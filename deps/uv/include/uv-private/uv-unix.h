@@ -92,6 +92,10 @@ struct uv__work {
   void (*work)(struct uv__work *w);
   void (*done)(struct uv__work *w, int status);
   struct uv_loop_s* loop;
+  struct uv__worker* worker;
+  uint64_t submit_time;
+  uint64_t start_time;
+  uint64_t end_time;
   void* wq[2];
 };
 
@@ -207,6 +211,14 @@ typedef struct {
 
 #define UV_SHUTDOWN_PRIVATE_FIELDS /* empty */
 
+#define UV_SPLICE_PRIVATE_FIELDS                                              \
+  int pipefd[2];                                                              \
+  size_t buffered;                                                            \
+  unsigned int splice_flags;                                                  \
+  uv_file file;                                                               \
+  int64_t file_offset;                                                        \
+  uint64_t file_remaining;                                                    \
+
 #define UV_UDP_SEND_PRIVATE_FIELDS                                            \
   void* queue[2];                                                             \
   struct sockaddr_in6 addr;                                                   \
@@ -229,6 +241,8 @@ typedef struct {
   uv_connection_cb connection_cb;                                             \
   int delayed_error;                                                          \
   int accepted_fd;                                                            \
+  uv_splice_t* splice_in;                                                     \
+  uv_splice_t* splice_out;                                                    \
   UV_STREAM_PRIVATE_PLATFORM_FIELDS                                           \
 
 #define UV_TCP_PRIVATE_FIELDS /* empty */
@@ -239,6 +253,8 @@ typedef struct {
   uv__io_t io_watcher;                                                        \
   void* write_queue[2];                                                       \
   void* write_completed_queue[2];                                             \
+  unsigned int recv_batch;                                                    \
+  size_t recv_batch_size;                                                     \
 
 #define UV_PIPE_PRIVATE_FIELDS                                                \
   const char* pipe_fname; /* strdup'ed */
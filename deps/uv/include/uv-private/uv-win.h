@@ -338,6 +338,9 @@ RB_HEAD(uv_timer_tree_s, uv_timer_s);
 #define UV_SHUTDOWN_PRIVATE_FIELDS                                            \
   /* empty */
 
+#define UV_SPLICE_PRIVATE_FIELDS                                              \
+  /* empty */
+
 #define UV_UDP_SEND_PRIVATE_FIELDS                                            \
   /* empty */
 
@@ -161,6 +161,7 @@ typedef enum {
   XX(FS, fs)                                                                  \
   XX(WORK, work)                                                              \
   XX(GETADDRINFO, getaddrinfo)                                                \
+  XX(SPLICE, splice)                                                          \
 
 typedef enum {
   UV_UNKNOWN_HANDLE = 0,
@@ -210,6 +211,7 @@ typedef struct uv_connect_s uv_connect_t;
 typedef struct uv_udp_send_s uv_udp_send_t;
 typedef struct uv_fs_s uv_fs_t;
 typedef struct uv_work_s uv_work_t;
+typedef struct uv_splice_s uv_splice_t;
 
 /* None of the above. */
 typedef struct uv_cpu_info_s uv_cpu_info_t;
@@ -363,6 +365,7 @@ typedef void (*uv_read2_cb)(uv_pipe_t* pipe, ssize_t nread, uv_buf_t buf,
 typedef void (*uv_write_cb)(uv_write_t* req, int status);
 typedef void (*uv_connect_cb)(uv_connect_t* req, int status);
 typedef void (*uv_shutdown_cb)(uv_shutdown_t* req, int status);
+typedef void (*uv_splice_cb)(uv_splice_t* req, int status);
 typedef void (*uv_connection_cb)(uv_stream_t* server, int status);
 typedef void (*uv_close_cb)(uv_handle_t* handle);
 typedef void (*uv_poll_cb)(uv_poll_t* handle, int status, int events);
@@ -666,6 +669,59 @@ struct uv_write_s {
 };
 
 
+/*
+ * uv_splice_t is a subclass of uv_req_t
+ *
+ * Moves everything that's read from `src` to `dst` without copying it to
+ * user space. Data goes through a kernel pipe with splice(2). Reading from
+ * `src` pauses while `dst` can't keep up, so at most one pipe's worth of
+ * data is in flight.
+ *
+ * `src` must not be reading and `dst` must not have pending writes.
+ * uv_read_start() on `src` and uv_write(), uv_write2() and uv_shutdown() on
+ * `dst` fail with UV_EBUSY until the request is done. The same stream can
+ * be the source of one request and the destination of another, which is
+ * how a bidirectional proxy is built.
+ *
+ * `cb` is called with status 0 once `src` has reached EOF, or the request
+ * has been stopped, and everything that was read has been written. It's
+ * called with status -1 when reading or writing failed, and with
+ * UV_ECANCELED when either stream is closed. `nread` and `nwritten` count
+ * the bytes moved so far.
+ *
+ * Only implemented on Linux. Other platforms return -1 with UV_ENOSYS.
+ */
+UV_EXTERN int uv_splice_start(uv_splice_t* req, uv_stream_t* src,
+    uv_stream_t* dst, uv_splice_cb cb);
+
+/*
+ * Like uv_splice_start() but sends `length` bytes of the file `fd` starting
+ * at `offset` to `dst` with sendfile(2). Stops early at the end of the file
+ * and `length` may be -1 to send everything up to there. `req->src` is NULL.
+ *
+ * sendfile() runs on the loop thread. It doesn't wait for the socket but it
+ * does read the file, so it's best for files that are in the page cache.
+ */
+UV_EXTERN int uv_splice_file(uv_splice_t* req, uv_file fd, int64_t offset,
+    int64_t length, uv_stream_t* dst, uv_splice_cb cb);
+
+/*
+ * Stops reading from `src`. The request completes once the data that was
+ * already read has been written to `dst`.
+ */
+UV_EXTERN int uv_splice_stop(uv_splice_t* req);
+
+struct uv_splice_s {
+  UV_REQ_FIELDS
+  uv_stream_t* src;
+  uv_stream_t* dst;
+  uv_splice_cb cb;
+  uint64_t nread;
+  uint64_t nwritten;
+  UV_SPLICE_PRIVATE_FIELDS
+};
+
+
 /*
  * Used to determine whether a stream is readable or writable.
  */
@@ -761,7 +817,18 @@ enum uv_udp_flags {
    * Indicates message was truncated because read buffer was too small. The
    * remainder was discarded by the OS. Used in uv_udp_recv_cb.
    */
-  UV_UDP_PARTIAL = 2
+  UV_UDP_PARTIAL = 2,
+  /*
+   * Indicates that the datagram is one of a batch received with a single
+   * system call, see uv_udp_set_recv_batch(). The read buffer is shared with
+   * the other datagrams of the batch, don't free it. Used in uv_udp_recv_cb.
+   */
+  UV_UDP_MMSG_CHUNK = 4,
+  /*
+   * Indicates that a batch of datagrams has been delivered and that the
+   * read buffer can be released now. Used in uv_udp_recv_cb.
+   */
+  UV_UDP_MMSG_FREE = 8
 };
 
 /*
@@ -781,8 +848,8 @@ typedef void (*uv_udp_send_cb)(uv_udp_send_t* req, int status);
  *  buf     uv_buf_t with the received data.
  *  addr    struct sockaddr_in or struct sockaddr_in6.
  *          Valid for the duration of the callback only.
- *  flags   One or more OR'ed UV_UDP_* constants.
- *          Right now only UV_UDP_PARTIAL is used.
+ *  flags   One or more OR'ed UV_UDP_* constants: UV_UDP_PARTIAL,
+ *          UV_UDP_MMSG_CHUNK or UV_UDP_MMSG_FREE.
  */
 typedef void (*uv_udp_recv_cb)(uv_udp_t* handle, ssize_t nread, uv_buf_t buf,
     struct sockaddr* addr, unsigned flags);
@@ -923,6 +990,10 @@ UV_EXTERN int uv_udp_set_ttl(uv_udp_t* handle, int ttl);
  * or `uv_udp_bind6`, it is bound to 0.0.0.0 (the "all interfaces" address)
  * and a random port number.
  *
+ * Datagrams are queued and written out when the socket polls writable. All
+ * queued datagrams go out with a single system call when the platform
+ * supports it (sendmmsg() on Linux).
+ *
  * Arguments:
  *  req       UDP request handle. Need not be initialized.
  *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
@@ -984,6 +1055,29 @@ UV_EXTERN int uv_udp_recv_start(uv_udp_t* handle, uv_alloc_cb alloc_cb,
  */
 UV_EXTERN int uv_udp_recv_stop(uv_udp_t* handle);
 
+/*
+ * Receive up to `count` datagrams with a single system call when the
+ * platform supports it (recvmmsg() on Linux), otherwise this is a no-op.
+ *
+ * The buffer returned by alloc_cb is carved up into slots of `size` bytes,
+ * one per datagram. Longer datagrams are truncated and reported with the
+ * UV_UDP_PARTIAL flag. Every datagram of a batch is passed to recv_cb with the
+ * UV_UDP_MMSG_CHUNK flag set. Afterwards recv_cb is called once more with
+ * nread == 0, addr == NULL and the UV_UDP_MMSG_FREE flag set; buf.len is then
+ * the number of bytes in use by the batch. That last call happens even when
+ * the handle is stopped or closed from one of the chunk callbacks.
+ *
+ * Arguments:
+ *  handle    UDP handle. Should have been initialized with `uv_udp_init`.
+ *  count     Maximum number of datagrams per batch, 0 or 1 turns batching off.
+ *  size      Slot size in bytes, the largest datagram expected.
+ *
+ * Returns:
+ *  0 on success, -1 on error.
+ */
+UV_EXTERN int uv_udp_set_recv_batch(uv_udp_t* handle, unsigned int count,
+    size_t size);
+
 
 /*
  * uv_tty_t is a subclass of uv_stream_t
@@ -1453,17 +1547,59 @@ struct uv_work_s {
   UV_WORK_PRIVATE_FIELDS
 };
 
+/*
+ * The thread pool is split into lanes, each with its own set of threads, so
+ * that long running, CPU bound work cannot starve short blocking I/O.
+ *
+ * uv_fs_* and uv_getaddrinfo requests run in the UV_THREADPOOL_IO lane.
+ * uv_queue_work requests run in the UV_THREADPOOL_CPU lane.
+ *
+ * The initial size of the I/O lane is taken from the UV_THREADPOOL_SIZE
+ * environment variable, the size of the CPU lane from UV_THREADPOOL_CPU_SIZE.
+ * Both default to 4 threads.
+ */
+typedef enum {
+  UV_THREADPOOL_IO = 0,
+  UV_THREADPOOL_CPU,
+  UV_THREADPOOL_LANE_MAX
+} uv_threadpool_lane_t;
+
 /* Queues a work request to execute asynchronously on the thread pool. */
 UV_EXTERN int uv_queue_work(uv_loop_t* loop, uv_work_t* req,
     uv_work_cb work_cb, uv_after_work_cb after_work_cb);
 
+/* Like uv_queue_work() but lets the caller pick the lane. Use it for work
+ * that spends most of its time blocked in system calls.
+ */
+UV_EXTERN int uv_queue_work_lane(uv_loop_t* loop, uv_work_t* req,
+    uv_threadpool_lane_t lane, uv_work_cb work_cb,
+    uv_after_work_cb after_work_cb);
+
+/* Grows or shrinks a thread pool lane to `nthreads` threads. Safe to call
+ * at any time from any thread.
+ *
+ * Threads that are removed finish the requests already queued to them before
+ * they exit; this function does not wait for that to happen.
+ *
+ * Returns UV_EINVAL if `nthreads` is zero or larger than 128.
+ *
+ * This function is currently only implemented on UNIX platforms. On Windows,
+ * it always returns UV_ENOSYS.
+ */
+UV_EXTERN uv_err_t uv_threadpool_resize(uv_threadpool_lane_t lane,
+                                        unsigned int nthreads);
+
+/* Returns the number of threads in a thread pool lane. */
+UV_EXTERN unsigned int uv_threadpool_size(uv_threadpool_lane_t lane);
+
 /* Cancel a pending request. Fails if the request is executing or has finished
  * executing.
  *
  * Returns 0 on success, -1 on error. The loop error code is not touched.
  *
  * Only cancellation of uv_fs_t, uv_getaddrinfo_t and uv_work_t requests is
- * currently supported.
+ * currently supported. uv_fs_t requests that were handed off to io_uring can't
+ * be cancelled.
  *
  * Cancelled requests have their callbacks invoked some time in the future.
  * It's _not_ safe to free the memory associated with the request until your
@@ -1481,6 +1617,34 @@ UV_EXTERN int uv_queue_work(uv_loop_t* loop, uv_work_t* req,
  */
 UV_EXTERN int uv_cancel(uv_req_t* req);
 
+/*
+ * Thread pool timestamps of a request, in nanoseconds as returned by
+ * uv_hrtime().
+ */
+typedef struct {
+  uint64_t submitted;
+  uint64_t started;   /* Zero if the request was cancelled. */
+  uint64_t finished;  /* Zero if the request was cancelled. */
+} uv_work_times_t;
+
+/* Retrieves the thread pool timestamps of a uv_fs_t, uv_getaddrinfo_t or
+ * uv_work_t request. The timestamps are only meaningful inside the request's
+ * callback and only for requests that were dispatched to the thread pool,
+ * i.e. not for synchronous uv_fs_* calls.
+ *
+ * The difference between `started` and `submitted` is the time the request
+ * spent waiting for a thread, the difference between `finished` and `started`
+ * is the time the thread spent working on it. For uv_fs_t requests that were
+ * executed by io_uring, `started` is the time the request was submitted to the
+ * kernel.
+ *
+ * Returns 0 on success, -1 if the request type is not supported.
+ *
+ * This function is currently only implemented on UNIX platforms. On Windows,
+ * it always returns -1.
+ */
+UV_EXTERN int uv_work_times(const uv_req_t* req, uv_work_times_t* times);
+
 
 struct uv_cpu_info_s {
   char* model;
@@ -1538,6 +1702,11 @@ UV_EXTERN void uv_free_interface_addresses(uv_interface_address_t* addresses,
  * call will be called synchronously. req should be a pointer to an
  * uninitialized uv_fs_t object.
  *
+ * On Linux, open, close, read, write, stat, lstat, fstat, fsync, fdatasync,
+ * mkdir, rmdir, rename and unlink requests are executed with io_uring instead
+ * of the thread pool when the kernel supports it (5.17 and newer). Set the
+ * UV_USE_IO_URING environment variable to 0 to disable that.
+ *
  * uv_fs_req_cleanup() must be called after completion of the uv_fs_
  * function to free any internal memory allocations associated with the
  * request.
@@ -642,6 +642,11 @@ void uv__io_init(uv__io_t* w, uv__io_cb cb, int fd) {
   w->rcount = 0;
   w->wcount = 0;
 #endif /* defined(UV_HAVE_KQUEUE) */
+
+#if defined(__linux__)
+  w->edge_triggered = 0;
+  w->missed_events = 0;
+#endif /* defined(__linux__) */
 }
 
 
@@ -659,7 +664,7 @@ void uv__io_start(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
    * every tick of the event loop but the other backends allow us to
    * short-circuit here if the event mask is unchanged.
    */
-  if (w->events == w->pevents) {
+  if (w->events == w->pevents && !uv__io_missed(w, events)) {
     if (w->events == 0 && !QUEUE_EMPTY(&w->watcher_queue)) {
       QUEUE_REMOVE(&w->watcher_queue);
       QUEUE_INIT(&w->watcher_queue);
@@ -691,6 +696,14 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
   if ((unsigned) w->fd >= loop->nwatchers)
     return;
 
+#if defined(__linux__)
+  /* An edge-triggered watcher that stops before it hits EAGAIN won't be told
+   * again that the file descriptor is ready. Re-arm it when it's restarted.
+   */
+  if (w->edge_triggered)
+    w->missed_events |= events & w->pevents;
+#endif /* defined(__linux__) */
+
   w->pevents &= ~events;
 
   if (w->pevents == 0) {
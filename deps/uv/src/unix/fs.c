@@ -85,7 +85,13 @@
 #define POST                                                                  \
   do {                                                                        \
     if ((cb) != NULL) {                                                       \
-      uv__work_submit((loop), &(req)->work_req, uv__fs_work, uv__fs_done);    \
+      if (uv__iou_fs_submit((loop), (req), uv__fs_work, uv__fs_done))         \
+        return 0;                                                             \
+      uv__work_submit((loop),                                                 \
+                      &(req)->work_req,                                       \
+                      UV_THREADPOOL_IO,                                       \
+                      uv__fs_work,                                            \
+                      uv__fs_done);                                           \
       return 0;                                                               \
     }                                                                         \
     else {                                                                    \
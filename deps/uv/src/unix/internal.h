@@ -72,6 +72,7 @@
 # define UV__POLLOUT  UV__EPOLLOUT
 # define UV__POLLERR  UV__EPOLLERR
 # define UV__POLLHUP  UV__EPOLLHUP
+# define UV__POLLRDHUP UV__EPOLLRDHUP
 #endif
 
 #if defined(__sun)
@@ -97,6 +98,10 @@
 # define UV__POLLHUP  8
 #endif
 
+#ifndef UV__POLLRDHUP
+# define UV__POLLRDHUP 0  /* Only reported by edge-triggered backends. */
+#endif
+
 /* handle flags */
 enum {
   UV_CLOSING          = 0x01,   /* uv_close() called but not finished. */
@@ -127,6 +132,17 @@ void uv__io_feed(uv_loop_t* loop, uv__io_t* w);
 int uv__io_active(const uv__io_t* w, unsigned int events);
 void uv__io_poll(uv_loop_t* loop, int timeout); /* in milliseconds or -1 */
 
+#if defined(__linux__)
+void uv__io_rearm(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+void uv__io_eagain(uv__io_t* w, unsigned int events);
+# define uv__io_missed(w, ev) ((w)->missed_events & (ev))
+#else
+/* Level-triggered backends report readiness until it's consumed. */
+# define uv__io_rearm(loop, w, events) do {} while (0)
+# define uv__io_eagain(w, events) do {} while (0)
+# define uv__io_missed(w, ev) 0
+#endif
+
 /* async */
 void uv__async_send(struct uv__async* wa);
 void uv__async_init(struct uv__async* wa);
@@ -175,10 +191,23 @@ void uv__signal_loop_cleanup(uv_loop_t* loop);
 /* thread pool */
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work *w,
+                     uv_threadpool_lane_t lane,
                      void (*work)(struct uv__work *w),
                      void (*done)(struct uv__work *w, int status));
 void uv__work_done(uv_async_t* handle, int status);
 
+/* io_uring */
+#if defined(__linux__)
+int uv__iou_fs_submit(uv_loop_t* loop,
+                      uv_fs_t* req,
+                      void (*work)(struct uv__work* w),
+                      void (*done)(struct uv__work* w, int status));
+void uv__iou_flush(uv_loop_t* loop);
+void uv__iou_delete(uv_loop_t* loop);
+#else
+# define uv__iou_fs_submit(loop, req, work, done) 0
+#endif
+
 /* platform specific */
 uint64_t uv__hrtime(void);
 int uv__kqueue_init(uv_loop_t* loop);
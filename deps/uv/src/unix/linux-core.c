@@ -81,6 +81,8 @@ int uv__platform_loop_init(uv_loop_t* loop, int default_loop) {
   loop->backend_fd = fd;
   loop->inotify_fd = -1;
   loop->inotify_watchers = NULL;
+  loop->iou_ring = NULL;
+  loop->iou_disabled = 0;
 
   if (fd == -1)
     return -1;
@@ -90,6 +92,7 @@ int uv__platform_loop_init(uv_loop_t* loop, int default_loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_delete(loop);
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, UV__POLLIN);
   close(loop->inotify_fd);
@@ -105,6 +108,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   uv__io_t* w;
   uint64_t base;
   uint64_t diff;
+  unsigned int unwanted;
+  unsigned int revents;
   int nevents;
   int count;
   int nfds;
@@ -127,7 +132,20 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     assert(w->fd >= 0);
     assert(w->fd < (int) loop->nwatchers);
 
-    e.events = w->pevents;
+    /* Stopping events is done lazily: when the kernel already watches for
+     * a superset of the events that we're interested in, leave it at that and
+     * squelch the extra events after epoll_wait(). Interest is often restored
+     * before the kernel has anything to report, e.g. POLLOUT on streams.
+     */
+    if (w->events != 0 && (w->pevents & ~w->events) == 0)
+      if ((w->missed_events & w->pevents) == 0)
+        continue;
+
+    /* Edge-triggered watchers are registered for everything upfront. */
+    if (w->edge_triggered)
+      e.events = UV__POLLIN | UV__POLLOUT | UV__POLLRDHUP | UV__EPOLLET;
+    else
+      e.events = w->pevents;
     e.data = w->fd;
 
     if (w->events == 0)
@@ -135,9 +153,6 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     else
       op = UV__EPOLL_CTL_MOD;
 
-    /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
-     * events, skip the syscall and squelch the events after epoll_wait().
-     */
     if (uv__epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
       if (errno != EEXIST)
         abort();
@@ -149,7 +164,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         abort();
     }
 
-    w->events = w->pevents;
+    /* Adding or modifying the registration makes the kernel report the
+     * current state of the file descriptor, missed edges included.
+     */
+    w->events = e.events & (UV__POLLIN | UV__POLLOUT);
+    w->missed_events = 0;
   }
 
   assert(timeout >= -1);
@@ -157,6 +176,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   count = 48; /* Benchmarks suggest this gives the best throughput. */
 
   for (;;) {
+    /* Submit the file system requests that were queued since the last poll,
+     * including any that were queued by callbacks in the previous iteration.
+     */
+    uv__iou_flush(loop);
+
     nfds = uv__epoll_wait(loop->backend_fd,
                           events,
                           ARRAY_SIZE(events),
@@ -208,7 +232,41 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
       }
 
-      w->cb(loop, w, pe->events);
+      /* Errors and hangups are always reported, they imply that a read or
+       * write won't block. A peer shutdown is a kind of POLLIN.
+       */
+      revents = pe->events & (w->pevents | UV__POLLERR | UV__POLLHUP);
+      if (w->pevents & UV__POLLIN)
+        revents |= pe->events & UV__POLLRDHUP;
+
+      unwanted = pe->events;
+      if (unwanted & (UV__POLLERR | UV__POLLHUP))
+        unwanted |= UV__POLLIN | UV__POLLOUT;
+      if (unwanted & UV__POLLRDHUP)
+        unwanted |= UV__POLLIN;
+      unwanted &= (UV__POLLIN | UV__POLLOUT) & ~w->pevents;
+
+      if (unwanted != 0) {
+        if (w->edge_triggered) {
+          /* We won't hear about it again until the next edge. */
+          w->missed_events |= unwanted;
+        }
+        else if (pe->events & ~w->pevents & (UV__POLLIN | UV__POLLOUT)) {
+          /* Level-triggered, the kernel keeps reporting the events that we
+           * squelch. Now is the time to stop watching them for real.
+           */
+          e.events = w->pevents;
+          e.data = fd;
+          if (uv__epoll_ctl(loop->backend_fd, UV__EPOLL_CTL_MOD, fd, &e))
+            abort();
+          w->events = w->pevents;
+        }
+      }
+
+      if (revents == 0)
+        continue;
+
+      w->cb(loop, w, revents);
       nevents++;
     }
 
@@ -239,6 +297,29 @@ update_timeout:
 }
 
 
+/* Called by the owner of an edge-triggered watcher that stopped consuming
+ * events before it got EAGAIN, e.g. to avoid starving other handles.
+ * Makes the next uv__io_poll() re-arm the file descriptor.
+ */
+void uv__io_rearm(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  if (!w->edge_triggered)
+    return;
+
+  w->missed_events |= events;
+
+  if (QUEUE_EMPTY(&w->watcher_queue))
+    QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+}
+
+
+/* Called by the owner of an edge-triggered watcher after EAGAIN. The kernel
+ * reports the next edge so there is no need to re-arm the file descriptor.
+ */
+void uv__io_eagain(uv__io_t* w, unsigned int events) {
+  w->missed_events &= ~events;
+}
+
+
 uint64_t uv__hrtime(void) {
   struct timespec ts;
   clock_gettime(CLOCK_MONOTONIC, &ts);
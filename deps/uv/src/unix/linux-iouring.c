@@ -0,0 +1,527 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/* io_uring backend for the file system operations in fs.c.
+ *
+ * Requests are written to the submission queue from the loop thread and
+ * submitted in one batch right before the loop blocks for I/O. Completions
+ * are reaped when the ring file descriptor polls readable. Anything the ring
+ * can't handle falls back to the thread pool.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define UV__IOU_ENTRIES 256
+
+/* NODROP and RW_CUR_POS are hard requirements. CQE_SKIP is only used as
+ * a kernel version check: it's the first feature flag that appeared after
+ * all the opcodes that we use (MKDIRAT being the most recent one) landed.
+ */
+#define UV__IOU_FEATURES                                                      \
+  (UV__IORING_FEAT_SINGLE_MMAP |                                              \
+   UV__IORING_FEAT_NODROP |                                                   \
+   UV__IORING_FEAT_RW_CUR_POS |                                               \
+   UV__IORING_FEAT_CQE_SKIP)
+
+struct uv__iou {
+  uv__io_t io_watcher;
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t sqmask;
+  uint32_t sqentries;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  uint32_t cqentries;
+  struct uv__io_uring_sqe* sqe;
+  struct uv__io_uring_cqe* cqe;
+  void* ring;
+  size_t ringlen;
+  size_t sqelen;
+  unsigned int unsubmitted;
+  unsigned int in_flight;
+};
+
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+
+
+static struct uv__iou* uv__iou_new(void) {
+  struct uv__io_uring_params params;
+  struct uv__iou* iou;
+  const char* val;
+  uint32_t* sqarray;
+  size_t sqlen;
+  size_t cqlen;
+  char* ring;
+  void* sqe;
+  uint32_t i;
+  int fd;
+
+  val = getenv("UV_USE_IO_URING");
+  if (val != NULL && atoi(val) == 0)
+    return NULL;
+
+  memset(&params, 0, sizeof(params));
+
+  /* The file descriptor is created with O_CLOEXEC. */
+  fd = uv__io_uring_setup(UV__IOU_ENTRIES, &params);
+  if (fd == -1)
+    return NULL;
+
+  if ((params.features & UV__IOU_FEATURES) != UV__IOU_FEATURES)
+    goto fail_fd;
+
+  /* With IORING_FEAT_SINGLE_MMAP the submission and completion queue rings
+   * share one mapping that is large enough for either of them.
+   */
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen = params.cq_off.cqes +
+          params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  if (cqlen > sqlen)
+    sqlen = cqlen;
+
+  ring = mmap(NULL,
+              sqlen,
+              PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE,
+              fd,
+              UV__IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED)
+    goto fail_fd;
+
+  cqlen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+  sqe = mmap(NULL,
+             cqlen,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             fd,
+             UV__IORING_OFF_SQES);
+  if (sqe == MAP_FAILED)
+    goto fail_ring;
+
+  iou = malloc(sizeof(*iou));
+  if (iou == NULL)
+    goto fail_sqe;
+
+  iou->sqhead = (uint32_t*) (ring + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (ring + params.sq_off.tail);
+  iou->sqmask = *(uint32_t*) (ring + params.sq_off.ring_mask);
+  iou->sqentries = params.sq_entries;
+  iou->cqhead = (uint32_t*) (ring + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (ring + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (ring + params.cq_off.ring_mask);
+  iou->cqentries = params.cq_entries;
+  iou->sqe = sqe;
+  iou->cqe = (struct uv__io_uring_cqe*) (ring + params.cq_off.cqes);
+  iou->ring = ring;
+  iou->ringlen = sqlen;
+  iou->sqelen = cqlen;
+  iou->unsubmitted = 0;
+  iou->in_flight = 0;
+
+  /* Slots in the submission queue map 1:1 to entries in the sqe array. */
+  sqarray = (uint32_t*) (ring + params.sq_off.array);
+  for (i = 0; i < params.sq_entries; i++)
+    sqarray[i] = i;
+
+  uv__io_init(&iou->io_watcher, uv__iou_io, fd);
+
+  return iou;
+
+fail_sqe:
+  munmap(sqe, cqlen);
+fail_ring:
+  munmap(ring, sqlen);
+fail_fd:
+  close(fd);
+  return NULL;
+}
+
+
+static struct uv__iou* uv__iou_get(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  if (loop->iou_ring != NULL)
+    return loop->iou_ring;
+
+  if (loop->iou_disabled)
+    return NULL;
+
+  iou = uv__iou_new();
+  if (iou == NULL) {
+    loop->iou_disabled = 1;
+    return NULL;
+  }
+
+  uv__io_start(loop, &iou->io_watcher, UV__POLLIN);
+  loop->iou_ring = iou;
+
+  return iou;
+}
+
+
+void uv__iou_delete(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = loop->iou_ring;
+  if (iou == NULL)
+    return;
+
+  uv__io_close(loop, &iou->io_watcher);
+  munmap(iou->sqe, iou->sqelen);
+  munmap(iou->ring, iou->ringlen);
+  close(iou->io_watcher.fd);
+  free(iou);
+
+  loop->iou_ring = NULL;
+}
+
+
+int uv__iou_fs_submit(uv_loop_t* loop,
+                      uv_fs_t* req,
+                      void (*work)(struct uv__work* w),
+                      void (*done)(struct uv__work* w, int status)) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+  uint32_t head;
+  uint32_t tail;
+
+  switch (req->fs_type) {
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->len > (uint32_t) -1)
+      return 0;
+    break;
+
+  case UV_FS_CLOSE:
+  case UV_FS_FDATASYNC:
+  case UV_FS_FSTAT:
+  case UV_FS_FSYNC:
+  case UV_FS_LSTAT:
+  case UV_FS_MKDIR:
+  case UV_FS_OPEN:
+  case UV_FS_RENAME:
+  case UV_FS_RMDIR:
+  case UV_FS_STAT:
+  case UV_FS_UNLINK:
+    break;
+
+  default:
+    return 0;
+  }
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return 0;
+
+  /* Never put more requests in flight than the completion queue can hold. */
+  if (iou->in_flight >= iou->cqentries)
+    return 0;
+
+  tail = *iou->sqtail;
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+
+  if (tail - head >= iou->sqentries) {
+    /* May hand the queued requests to the thread pool and rewind the tail. */
+    uv__iou_flush(loop);
+    tail = *iou->sqtail;
+    head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+    if (tail - head >= iou->sqentries)
+      return 0;
+  }
+
+  sqe = iou->sqe + (tail & iou->sqmask);
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uintptr_t) req;
+
+  switch (req->fs_type) {
+  case UV_FS_CLOSE:
+    sqe->opcode = UV__IORING_OP_CLOSE;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_FDATASYNC:
+    sqe->rw_flags = UV__IORING_FSYNC_DATASYNC;
+    /* Fall through. */
+  case UV_FS_FSYNC:
+    sqe->opcode = UV__IORING_OP_FSYNC;
+    sqe->fd = req->file;
+    break;
+
+  case UV_FS_FSTAT:
+  case UV_FS_LSTAT:
+  case UV_FS_STAT:
+    /* req->buf is not used by the stat functions, borrow it. */
+    req->buf = malloc(sizeof(struct uv__statx));
+    if (req->buf == NULL)
+      return 0;
+
+    sqe->opcode = UV__IORING_OP_STATX;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = UV__STATX_BASIC_STATS;
+    sqe->off = (uintptr_t) req->buf;
+
+    if (req->fs_type == UV_FS_FSTAT) {
+      sqe->fd = req->file;
+      sqe->addr = (uintptr_t) "";
+      sqe->rw_flags = UV__AT_EMPTY_PATH;
+    }
+    else if (req->fs_type == UV_FS_LSTAT) {
+      sqe->rw_flags = UV__AT_SYMLINK_NOFOLLOW;
+    }
+    break;
+
+  case UV_FS_MKDIR:
+    sqe->opcode = UV__IORING_OP_MKDIRAT;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = req->mode;
+    break;
+
+  case UV_FS_OPEN:
+    sqe->opcode = UV__IORING_OP_OPENAT;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = req->mode;
+    sqe->rw_flags = req->flags;
+    break;
+
+  case UV_FS_READ:
+  case UV_FS_WRITE:
+    if (req->fs_type == UV_FS_READ)
+      sqe->opcode = UV__IORING_OP_READ;
+    else
+      sqe->opcode = UV__IORING_OP_WRITE;
+    sqe->fd = req->file;
+    sqe->addr = (uintptr_t) req->buf;
+    sqe->len = req->len;
+    /* An offset of -1 means "use and update the file position", just like
+     * read() and write().
+     */
+    sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+    break;
+
+  case UV_FS_RENAME:
+    sqe->opcode = UV__IORING_OP_RENAMEAT;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    sqe->len = UV__AT_FDCWD;
+    sqe->off = (uintptr_t) req->new_path;
+    break;
+
+  case UV_FS_RMDIR:
+  case UV_FS_UNLINK:
+    sqe->opcode = UV__IORING_OP_UNLINKAT;
+    sqe->fd = UV__AT_FDCWD;
+    sqe->addr = (uintptr_t) req->path;
+    if (req->fs_type == UV_FS_RMDIR)
+      sqe->rw_flags = UV__AT_REMOVEDIR;
+    break;
+
+  default:
+    UNREACHABLE();
+  }
+
+  req->work_req.loop = loop;
+  req->work_req.work = work;
+  req->work_req.done = done;
+  req->work_req.worker = NULL;
+  req->work_req.submit_time = uv__hrtime();
+  req->work_req.start_time = 0;
+  req->work_req.end_time = 0;
+
+  __atomic_store_n(iou->sqtail, tail + 1, __ATOMIC_RELEASE);
+  iou->unsubmitted++;
+  iou->in_flight++;
+
+  return 1;
+}
+
+
+/* The kernel is out of resources and took none of the unsubmitted entries.
+ * Nothing would wake the loop up for them, take them back out of the ring
+ * and run them on the thread pool instead, like interrupted operations.
+ */
+static void uv__iou_fallback(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__work* w;
+  uv_fs_t* req;
+  uint32_t tail;
+
+  tail = *iou->sqtail - iou->unsubmitted;
+  __atomic_store_n(iou->sqtail, tail, __ATOMIC_RELEASE);
+
+  for (; iou->unsubmitted > 0; iou->unsubmitted--) {
+    sqe = iou->sqe + (tail++ & iou->sqmask);
+    req = (uv_fs_t*) (uintptr_t) sqe->user_data;
+    iou->in_flight--;
+
+    /* The statx buffer that uv__iou_fs_submit() borrowed req->buf for. */
+    if (req->fs_type == UV_FS_STAT ||
+        req->fs_type == UV_FS_FSTAT ||
+        req->fs_type == UV_FS_LSTAT) {
+      free(req->buf);
+      req->buf = NULL;
+    }
+
+    w = &req->work_req;
+    uv__work_submit(loop, w, UV_THREADPOOL_IO, w->work, w->done);
+  }
+}
+
+
+void uv__iou_flush(uv_loop_t* loop) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+  uv_fs_t* req;
+  uint64_t now;
+  uint32_t tail;
+  int n;
+
+  iou = loop->iou_ring;
+  if (iou == NULL || iou->unsubmitted == 0)
+    return;
+
+  do
+    n = uv__io_uring_enter(iou->io_watcher.fd, iou->unsubmitted, 0, 0);
+  while (n == -1 && errno == EINTR);
+
+  if (n == -1) {
+    if (errno == EAGAIN || errno == EBUSY) {
+      uv__iou_fallback(loop, iou);
+      return;
+    }
+    abort();
+  }
+
+  /* The kernel consumes entries in order, starting with the oldest one. */
+  now = uv__hrtime();
+  tail = *iou->sqtail - iou->unsubmitted;
+  iou->unsubmitted -= n;
+
+  while (n-- > 0) {
+    sqe = iou->sqe + (tail++ & iou->sqmask);
+    req = (uv_fs_t*) (uintptr_t) sqe->user_data;
+    req->work_req.start_time = now;
+  }
+}
+
+
+static void uv__iou_to_stat(const struct uv__statx* src, uv_stat_t* dst) {
+  dst->st_dev = makedev(src->stx_dev_major, src->stx_dev_minor);
+  dst->st_mode = src->stx_mode;
+  dst->st_nlink = src->stx_nlink;
+  dst->st_uid = src->stx_uid;
+  dst->st_gid = src->stx_gid;
+  dst->st_rdev = makedev(src->stx_rdev_major, src->stx_rdev_minor);
+  dst->st_ino = src->stx_ino;
+  dst->st_size = src->stx_size;
+  dst->st_blksize = src->stx_blksize;
+  dst->st_blocks = src->stx_blocks;
+  dst->st_atim.tv_sec = src->stx_atime.tv_sec;
+  dst->st_atim.tv_nsec = src->stx_atime.tv_nsec;
+  dst->st_mtim.tv_sec = src->stx_mtime.tv_sec;
+  dst->st_mtim.tv_nsec = src->stx_mtime.tv_nsec;
+  dst->st_ctim.tv_sec = src->stx_ctime.tv_sec;
+  dst->st_ctim.tv_nsec = src->stx_ctime.tv_nsec;
+}
+
+
+static void uv__iou_fs_complete(uv_loop_t* loop, uv_fs_t* req, int res) {
+  struct uv__work* w;
+  int is_stat;
+
+  w = &req->work_req;
+  w->end_time = uv__hrtime();
+
+  is_stat = req->fs_type == UV_FS_STAT ||
+            req->fs_type == UV_FS_FSTAT ||
+            req->fs_type == UV_FS_LSTAT;
+
+  if (is_stat && res == 0)
+    uv__iou_to_stat(req->buf, &req->statbuf);
+
+  if (is_stat) {
+    free(req->buf);
+    req->buf = NULL;
+  }
+
+  /* Let the thread pool retry interrupted operations, like uv__fs_work()
+   * does. Except close(), see the comment there.
+   */
+  if (res == -EINTR && req->fs_type != UV_FS_CLOSE) {
+    uv__work_submit(loop, w, UV_THREADPOOL_IO, w->work, w->done);
+    return;
+  }
+
+  if (res < 0) {
+    req->errorno = -res;
+    req->result = -1;
+  }
+  else {
+    req->errorno = 0;
+    req->result = res;
+    if (is_stat)
+      req->ptr = &req->statbuf;
+  }
+
+  w->done(w, 0);
+}
+
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou* iou;
+  uv_fs_t* req;
+  uint32_t head;
+  uint32_t tail;
+  int res;
+
+  iou = container_of(w, struct uv__iou, io_watcher);
+  head = *iou->cqhead;
+  tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    cqe = iou->cqe + (head & iou->cqmask);
+    req = (uv_fs_t*) (uintptr_t) cqe->user_data;
+    res = cqe->res;
+
+    /* Release the slot before running the callback, it may submit more. */
+    __atomic_store_n(iou->cqhead, ++head, __ATOMIC_RELEASE);
+    iou->in_flight--;
+
+    uv__iou_fs_complete(loop, req, res);
+  }
+}
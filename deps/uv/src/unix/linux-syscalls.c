@@ -159,6 +159,22 @@
 # endif
 #endif /* __NR_inotify_rm_watch */
 
+#ifndef __NR_io_uring_setup
+# if defined(__x86_64__) || defined(__i386__)
+#  define __NR_io_uring_setup 425
+# elif defined(__arm__)
+#  define __NR_io_uring_setup (UV_SYSCALL_BASE + 425)
+# endif
+#endif /* __NR_io_uring_setup */
+
+#ifndef __NR_io_uring_enter
+# if defined(__x86_64__) || defined(__i386__)
+#  define __NR_io_uring_enter 426
+# elif defined(__arm__)
+#  define __NR_io_uring_enter (UV_SYSCALL_BASE + 426)
+# endif
+#endif /* __NR_io_uring_enter */
+
 #ifndef __NR_pipe2
 # if defined(__x86_64__)
 #  define __NR_pipe2 293
@@ -189,6 +205,16 @@
 # endif
 #endif /* __NR_sendmmsg */
 
+#ifndef __NR_splice
+# if defined(__x86_64__)
+#  define __NR_splice 275
+# elif defined(__i386__)
+#  define __NR_splice 313
+# elif defined(__arm__)
+#  define __NR_splice (UV_SYSCALL_BASE + 340)
+# endif
+#endif /* __NR_splice */
+
 #ifndef __NR_utimensat
 # if defined(__x86_64__)
 #  define __NR_utimensat 280
@@ -341,6 +367,35 @@ int uv__inotify_rm_watch(int fd, int32_t wd) {
 }
 
 
+int uv__io_uring_setup(unsigned int entries,
+                       struct uv__io_uring_params* params) {
+#if defined(__NR_io_uring_setup)
+  return syscall(__NR_io_uring_setup, entries, params);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags) {
+  /* The last two arguments are the (unused) sigmask and its size. */
+#if defined(__NR_io_uring_enter)
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 NULL,
+                 0L);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
 int uv__pipe2(int pipefd[2], int flags) {
 #if defined(__NR_pipe2)
   return syscall(__NR_pipe2, pipefd, flags);
@@ -375,6 +430,20 @@ int uv__recvmmsg(int fd,
 }
 
 
+ssize_t uv__splice(int fd_in,
+                   int64_t* off_in,
+                   int fd_out,
+                   int64_t* off_out,
+                   size_t len,
+                   unsigned int flags) {
+#if defined(__NR_splice)
+  return syscall(__NR_splice, fd_in, off_in, fd_out, off_out, len, flags);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
 int uv__utimesat(int dirfd,
                  const char* path,
                  const struct timespec times[2],
@@ -71,9 +71,14 @@
 #define UV__EPOLLOUT          4
 #define UV__EPOLLERR          8
 #define UV__EPOLLHUP          16
+#define UV__EPOLLRDHUP        0x2000
 #define UV__EPOLLONESHOT      0x40000000
 #define UV__EPOLLET           0x80000000
 
+/* splice flags */
+#define UV__SPLICE_F_MOVE     1
+#define UV__SPLICE_F_NONBLOCK 2
+
 /* inotify flags */
 #define UV__IN_ACCESS         0x001
 #define UV__IN_MODIFY         0x002
@@ -113,6 +118,129 @@ struct uv__mmsghdr {
   unsigned int msg_len;
 };
 
+/* io_uring opcodes */
+#define UV__IORING_OP_FSYNC       3
+#define UV__IORING_OP_OPENAT      18
+#define UV__IORING_OP_CLOSE       19
+#define UV__IORING_OP_STATX       21
+#define UV__IORING_OP_READ        22
+#define UV__IORING_OP_WRITE       23
+#define UV__IORING_OP_RENAMEAT    35
+#define UV__IORING_OP_UNLINKAT    36
+#define UV__IORING_OP_MKDIRAT     37
+
+/* io_uring flags */
+#define UV__IORING_FSYNC_DATASYNC 1
+#define UV__IORING_ENTER_GETEVENTS 1
+#define UV__IORING_SQ_CQ_OVERFLOW 2
+
+#define UV__IORING_FEAT_SINGLE_MMAP 0x001
+#define UV__IORING_FEAT_NODROP      0x002
+#define UV__IORING_FEAT_RW_CUR_POS  0x008
+#define UV__IORING_FEAT_CQE_SKIP    0x800
+
+#define UV__IORING_OFF_SQ_RING    0x0
+#define UV__IORING_OFF_SQES       0x10000000
+
+/* statx flags */
+#define UV__AT_FDCWD              -100
+#define UV__AT_SYMLINK_NOFOLLOW   0x100
+#define UV__AT_REMOVEDIR          0x200
+#define UV__AT_EMPTY_PATH         0x1000
+#define UV__STATX_BASIC_STATS     0x7ff
+
+/* Unions in the kernel's struct io_uring_sqe are flattened to the name of the
+ * first member; see the comments for the aliases that we use.
+ */
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;       /* addr2 */
+  uint64_t addr;
+  uint32_t len;
+  uint32_t rw_flags;  /* fsync_flags, open_flags, statx_flags, etc. */
+  uint64_t user_data;
+  uint16_t buf_index;
+  uint16_t personality;
+  int32_t splice_fd_in;
+  uint64_t pad[2];
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t reserved[3];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+struct uv__statx_timestamp {
+  int64_t tv_sec;
+  uint32_t tv_nsec;
+  int32_t reserved;
+};
+
+struct uv__statx {
+  uint32_t stx_mask;
+  uint32_t stx_blksize;
+  uint64_t stx_attributes;
+  uint32_t stx_nlink;
+  uint32_t stx_uid;
+  uint32_t stx_gid;
+  uint16_t stx_mode;
+  uint16_t reserved0;
+  uint64_t stx_ino;
+  uint64_t stx_size;
+  uint64_t stx_blocks;
+  uint64_t stx_attributes_mask;
+  struct uv__statx_timestamp stx_atime;
+  struct uv__statx_timestamp stx_btime;
+  struct uv__statx_timestamp stx_ctime;
+  struct uv__statx_timestamp stx_mtime;
+  uint32_t stx_rdev_major;
+  uint32_t stx_rdev_minor;
+  uint32_t stx_dev_major;
+  uint32_t stx_dev_minor;
+  uint64_t reserved1[14];
+};
+
 int uv__accept4(int fd, struct sockaddr* addr, socklen_t* addrlen, int flags);
 int uv__eventfd(unsigned int count);
 int uv__epoll_create(int size);
@@ -132,6 +260,12 @@ int uv__inotify_init(void);
 int uv__inotify_init1(int flags);
 int uv__inotify_add_watch(int fd, const char* path, uint32_t mask);
 int uv__inotify_rm_watch(int fd, int32_t wd);
+int uv__io_uring_setup(unsigned int entries,
+                       struct uv__io_uring_params* params);
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags);
 int uv__pipe2(int pipefd[2], int flags);
 int uv__recvmmsg(int fd,
                  struct uv__mmsghdr* mmsg,
@@ -142,6 +276,12 @@ int uv__sendmmsg(int fd,
                  struct uv__mmsghdr* mmsg,
                  unsigned int vlen,
                  unsigned int flags);
+ssize_t uv__splice(int fd_in,
+                   int64_t* off_in,
+                   int fd_out,
+                   int64_t* off_out,
+                   size_t len,
+                   unsigned int flags);
 int uv__utimesat(int dirfd,
                  const char* path,
                  const struct timespec times[2],
@@ -56,6 +56,34 @@ struct uv__stream_select_s {
 };
 #endif /* defined(__APPLE__) */
 
+#if defined(__linux__)
+# include <sys/ioctl.h> /* FIONREAD */
+# include <sys/sendfile.h>
+
+/* Most a single splice() call moves, the size of a default pipe. */
+# define UV__SPLICE_MAX (64 * 1024)
+
+/* Most a single sendfile() call sends. Reading the file may block, so the
+ * loop sends one such chunk per POLLOUT event rather than looping until
+ * dst would block; that bounds how long it's stalled on page cache misses.
+ */
+# define UV__SENDFILE_MAX (256 * 1024)
+
+enum {
+  UV__SPLICE_EOF = 1,          /* Done reading from src. */
+  UV__SPLICE_SRC_EMPTY = 2,    /* Waiting for src to become readable. */
+  UV__SPLICE_PIPE_FULL = 4,    /* Waiting for dst to empty the pipe. */
+  UV__SPLICE_DST_BLOCKED = 8,  /* Waiting for dst to become writable. */
+  UV__SPLICE_CANCELED = 16     /* One of the streams is being closed. */
+};
+
+static void uv__stream_splice_io(uv_stream_t* stream, unsigned int events);
+static void uv__splice_run(uv_splice_t* req);
+static void uv__splice_file_run(uv_splice_t* req);
+static void uv__splice_cancel(uv_splice_t* req);
+static void uv__splice_finish(uv_splice_t* req, int status);
+#endif /* defined(__linux__) */
+
 static void uv__stream_connect(uv_stream_t*);
 static void uv__write(uv_stream_t* stream);
 static void uv__read(uv_stream_t* stream);
@@ -111,6 +139,8 @@ void uv__stream_init(uv_loop_t* loop,
   stream->shutdown_req = NULL;
   stream->accepted_fd = -1;
   stream->delayed_error = 0;
+  stream->splice_in = NULL;
+  stream->splice_out = NULL;
   QUEUE_INIT(&stream->write_queue);
   QUEUE_INIT(&stream->write_completed_queue);
   stream->write_queue_size = 0;
@@ -373,6 +403,16 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
 
   stream->io_watcher.fd = fd;
 
+#if defined(__linux__)
+  /* uv__read() and uv__write() keep going until EAGAIN or tell the poller
+   * when they don't. That saves an epoll_ctl() call every time a stream
+   * toggles between writable and backed up. Not for pipes, a UNIX socket
+   * read stops short at every message that carries a file descriptor.
+   */
+  if (stream->type == UV_TCP)
+    stream->io_watcher.edge_triggered = 1;
+#endif /* defined(__linux__) */
+
   return 0;
 }
 
@@ -391,6 +431,18 @@ void uv__stream_destroy(uv_stream_t* stream) {
     stream->connect_req = NULL;
   }
 
+#if defined(__linux__)
+  if (stream->splice_out) {
+    uv__set_artificial_error(stream->loop, UV_ECANCELED);
+    uv__splice_finish(stream->splice_out, -1);
+  }
+
+  if (stream->splice_in) {
+    uv__set_artificial_error(stream->loop, UV_ECANCELED);
+    uv__splice_finish(stream->splice_in, -1);
+  }
+#endif
+
   while (!QUEUE_EMPTY(&stream->write_queue)) {
     q = QUEUE_HEAD(&stream->write_queue);
     QUEUE_REMOVE(q);
@@ -702,6 +754,7 @@ static void uv__write(uv_stream_t* stream) {
   QUEUE* q;
   uv_write_t* req;
   int iovcnt;
+  int iovmax;
   ssize_t n;
 
 start:
@@ -724,7 +777,8 @@ start:
   iovcnt = req->bufcnt - req->write_index;
 
   /* Limit iov count to avoid EINVALs from writev() */
-  if (iovcnt > IOV_MAX)
+  iovmax = (iovcnt > IOV_MAX);
+  if (iovmax)
     iovcnt = IOV_MAX;
 
   /*
@@ -843,7 +897,14 @@ start:
   /* Only non-blocking streams should use the write_watcher. */
   assert(!(stream->flags & UV_STREAM_BLOCKING));
 
-  /* We're not done. */
+  /* We're not done. Unless writev() was cut short by IOV_MAX, the send buffer
+   * is full and the next edge tells us when there is room again.
+   */
+  if (n == -1 || !iovmax)
+    uv__io_eagain(&stream->io_watcher, UV__POLLOUT);
+  else
+    uv__io_rearm(stream->loop, &stream->io_watcher, UV__POLLOUT);
+
   uv__io_start(stream->loop, &stream->io_watcher, UV__POLLOUT);
 }
 
@@ -924,7 +985,7 @@ static void uv__read(uv_stream_t* stream) {
   int count;
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Edge-triggered watchers are re-armed below.
    */
   count = 32;
 
@@ -978,6 +1039,7 @@ static void uv__read(uv_stream_t* stream) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
         /* Wait for the next one. */
         if (stream->flags & UV_STREAM_READING) {
+          uv__io_eagain(&stream->io_watcher, UV__POLLIN);
           uv__io_start(stream->loop, &stream->io_watcher, UV__POLLIN);
         }
         uv__set_sys_error(stream->loop, EAGAIN);
@@ -1051,6 +1113,10 @@ static void uv__read(uv_stream_t* stream) {
       }
     }
   }
+
+  /* Ran out of iterations, there may be more data in the receive buffer. */
+  if (count < 0 && uv__stream_fd(stream) != -1)
+    uv__io_rearm(stream->loop, &stream->io_watcher, UV__POLLIN);
 }
 
 
@@ -1067,6 +1133,9 @@ int uv_shutdown(uv_shutdown_t* req, uv_stream_t* stream, uv_shutdown_cb cb) {
     return -1;
   }
 
+  if (stream->splice_in)
+    return uv__set_artificial_error(stream->loop, UV_EBUSY);
+
   /* Initialize request */
   uv__req_init(stream->loop, req, UV_SHUTDOWN);
   req->handle = stream;
@@ -1092,16 +1161,39 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   if (stream->connect_req) {
     uv__stream_connect(stream);
+
+    /* Data that came in together with the connection isn't reported again
+     * by an edge-triggered watcher.
+     */
+    if (uv__stream_fd(stream) != -1 &&
+        (events & (UV__POLLIN | UV__POLLHUP | UV__POLLRDHUP)) &&
+        uv__io_active(&stream->io_watcher, UV__POLLIN)) {
+      uv__io_rearm(loop, &stream->io_watcher, UV__POLLIN);
+    }
     return;
   }
 
-  if (events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP)) {
+#if defined(__linux__)
+  if (stream->splice_out || stream->splice_in) {
+    uv__stream_splice_io(stream, events);
+    return;
+  }
+#endif
+
+  if (events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP | UV__POLLRDHUP)) {
     assert(uv__stream_fd(stream) >= 0);
 
     uv__read(stream);
 
     if (uv__stream_fd(stream) == -1)
       return; /* read_cb closed stream. */
+
+    /* uv__read() stops after a short read but that doesn't mean that it has
+     * seen the EOF. Edge-triggered watchers aren't told about it again.
+     */
+    if (events & (UV__POLLHUP | UV__POLLRDHUP))
+      if (uv__io_active(&stream->io_watcher, UV__POLLIN))
+        uv__io_rearm(loop, &stream->io_watcher, UV__POLLIN);
   }
 
   if (events & UV__POLLOUT) {
@@ -1173,6 +1265,9 @@ int uv_write2(uv_write_t* req,
   if (uv__stream_fd(stream) < 0)
     return uv__set_artificial_error(stream->loop, UV_EBADF);
 
+  if (stream->splice_in)
+    return uv__set_artificial_error(stream->loop, UV_EBUSY);
+
   if (send_handle) {
     if (stream->type != UV_NAMED_PIPE || !((uv_pipe_t*)stream)->ipc)
       return uv__set_artificial_error(stream->loop, UV_EINVAL);
@@ -1259,6 +1354,9 @@ static int uv__read_start_common(uv_stream_t* stream,
   if (stream->flags & UV_CLOSING)
     return uv__set_sys_error(stream->loop, EINVAL);
 
+  if (stream->splice_out)
+    return uv__set_artificial_error(stream->loop, UV_EBUSY);
+
   /* The UV_STREAM_READING flag is irrelevant of the state of the tcp - it just
    * expresses the desired state of the user.
    */
@@ -1309,9 +1407,14 @@ int uv_read_stop(uv_stream_t* stream) {
          !QUEUE_EMPTY(&stream->write_completed_queue) ||
          !QUEUE_EMPTY(&stream->write_queue) ||
          stream->shutdown_req != NULL ||
-         stream->connect_req != NULL);
+         stream->connect_req != NULL ||
+         stream->splice_in != NULL);
 
   stream->flags &= ~UV_STREAM_READING;
+
+  /* The watcher belongs to the splice request now. */
+  if (stream->splice_out)
+    return 0;
   uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLIN);
   if (!uv__io_active(&stream->io_watcher, UV__POLLOUT))
     uv__handle_stop(stream);
@@ -1378,6 +1481,14 @@ void uv__stream_close(uv_stream_t* handle) {
   }
 #endif /* defined(__APPLE__) */
 
+#if defined(__linux__)
+  if (handle->splice_out)
+    uv__splice_cancel(handle->splice_out);
+
+  if (handle->splice_in)
+    uv__splice_cancel(handle->splice_in);
+#endif
+
   uv_read_stop(handle);
   uv__io_close(handle->loop, &handle->io_watcher);
 
@@ -1391,3 +1502,372 @@ void uv__stream_close(uv_stream_t* handle) {
 
   assert(!uv__io_active(&handle->io_watcher, UV__POLLIN | UV__POLLOUT));
 }
+
+
+#if defined(__linux__)
+static void uv__stream_splice_io(uv_stream_t* stream, unsigned int events) {
+  uv_splice_t* req;
+
+  if (events & (UV__POLLIN | UV__POLLERR | UV__POLLHUP | UV__POLLRDHUP)) {
+    req = stream->splice_out;
+    if (req) {
+      req->splice_flags &= ~UV__SPLICE_SRC_EMPTY;
+      uv__splice_run(req);
+    } else {
+      uv__read(stream);
+    }
+
+    if (uv__stream_fd(stream) == -1)
+      return; /* Callback closed the stream. */
+  }
+
+  if (events & (UV__POLLOUT | UV__POLLERR | UV__POLLHUP)) {
+    req = stream->splice_in;
+    if (req) {
+      if (req->splice_flags & UV__SPLICE_DST_BLOCKED) {
+        req->splice_flags &= ~UV__SPLICE_DST_BLOCKED;
+        uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLOUT);
+        uv__splice_run(req);
+      }
+    } else if (events & UV__POLLOUT) {
+      uv__write(stream);
+      uv__write_callbacks(stream);
+    }
+  }
+}
+
+
+/* Moves data from src to the pipe and from the pipe to dst until neither
+ * makes progress. Draining the pipe goes first so there's room for more.
+ */
+static void uv__splice_run(uv_splice_t* req) {
+  uv_stream_t* src;
+  uv_stream_t* dst;
+  uv_loop_t* loop;
+  ssize_t n;
+  int progress;
+  int avail;
+
+  if (req->splice_flags & UV__SPLICE_CANCELED)
+    return;
+
+  if (req->src == NULL) {
+    uv__splice_file_run(req);
+    return;
+  }
+
+  src = req->src;
+  dst = req->dst;
+  loop = src->loop;
+
+  do {
+    progress = 0;
+
+    if (req->buffered > 0 && !(req->splice_flags & UV__SPLICE_DST_BLOCKED)) {
+      do
+        n = uv__splice(req->pipefd[0],
+                       NULL,
+                       uv__stream_fd(dst),
+                       NULL,
+                       req->buffered,
+                       UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+      while (n == -1 && errno == EINTR);
+
+      if (n > 0) {
+        req->buffered -= n;
+        req->nwritten += n;
+        req->splice_flags &= ~UV__SPLICE_PIPE_FULL;
+        progress = 1;
+      } else if (n == -1 && errno == EAGAIN) {
+        req->splice_flags |= UV__SPLICE_DST_BLOCKED;
+        uv__io_eagain(&dst->io_watcher, UV__POLLOUT);
+        uv__io_start(loop, &dst->io_watcher, UV__POLLOUT);
+      } else {
+        uv__set_sys_error(loop, n == -1 ? errno : EPIPE);
+        uv__splice_finish(req, -1);
+        return;
+      }
+    }
+
+    if (!(req->splice_flags & (UV__SPLICE_EOF |
+                               UV__SPLICE_SRC_EMPTY |
+                               UV__SPLICE_PIPE_FULL))) {
+      do
+        n = uv__splice(uv__stream_fd(src),
+                       NULL,
+                       req->pipefd[1],
+                       NULL,
+                       UV__SPLICE_MAX,
+                       UV__SPLICE_F_MOVE | UV__SPLICE_F_NONBLOCK);
+      while (n == -1 && errno == EINTR);
+
+      if (n > 0) {
+        req->buffered += n;
+        req->nread += n;
+        progress = 1;
+      } else if (n == 0) {
+        req->splice_flags |= UV__SPLICE_EOF;
+        uv__io_stop(loop, &src->io_watcher, UV__POLLIN);
+      } else if (errno == EAGAIN) {
+        /* Either src has nothing to read or the pipe is full. */
+        if (ioctl(uv__stream_fd(src), FIONREAD, &avail) == 0 && avail > 0) {
+          req->splice_flags |= UV__SPLICE_PIPE_FULL;
+          uv__io_stop(loop, &src->io_watcher, UV__POLLIN);
+        } else {
+          req->splice_flags |= UV__SPLICE_SRC_EMPTY;
+          uv__io_eagain(&src->io_watcher, UV__POLLIN);
+          uv__io_start(loop, &src->io_watcher, UV__POLLIN);
+        }
+      } else {
+        uv__set_sys_error(loop, errno);
+        uv__splice_finish(req, -1);
+        return;
+      }
+    }
+  } while (progress);
+
+  if ((req->splice_flags & UV__SPLICE_EOF) && req->buffered == 0)
+    uv__splice_finish(req, 0);
+}
+
+
+/* Sends the next chunk of the file to dst. There's no pipe in between,
+ * sendfile() writes straight to the socket. The rest is sent when dst is
+ * writable again, other handles get their turn in between.
+ */
+static void uv__splice_file_run(uv_splice_t* req) {
+  uv_stream_t* dst;
+  uv_loop_t* loop;
+  off_t off;
+  size_t len;
+  ssize_t n;
+
+  dst = req->dst;
+  loop = dst->loop;
+
+  /* All sent, or uv_splice_stop() was called. */
+  if (req->file_remaining == 0 || (req->splice_flags & UV__SPLICE_EOF)) {
+    uv__splice_finish(req, 0);
+    return;
+  }
+
+  len = UV__SENDFILE_MAX;
+  if (req->file_remaining < len)
+    len = req->file_remaining;
+
+  off = req->file_offset;
+  do
+    n = sendfile(uv__stream_fd(dst), req->file, &off, len);
+  while (n == -1 && errno == EINTR);
+
+  if (n == 0) {
+    uv__splice_finish(req, 0);  /* End of file. */
+    return;
+  }
+
+  if (n == -1 && errno != EAGAIN) {
+    uv__set_sys_error(loop, errno);
+    uv__splice_finish(req, -1);
+    return;
+  }
+
+  if (n > 0) {
+    req->file_offset += n;
+    req->file_remaining -= n;
+    req->nread += n;
+    req->nwritten += n;
+
+    if (req->file_remaining == 0) {
+      uv__splice_finish(req, 0);
+      return;
+    }
+
+    /* dst didn't block, so an edge-triggered watcher has to be re-armed to
+     * hear that it's still writable.
+     */
+    uv__io_rearm(loop, &dst->io_watcher, UV__POLLOUT);
+  } else {
+    uv__io_eagain(&dst->io_watcher, UV__POLLOUT);
+  }
+
+  /* uv__stream_splice_io() runs this again on the next POLLOUT. */
+  req->splice_flags |= UV__SPLICE_DST_BLOCKED;
+  uv__io_start(loop, &dst->io_watcher, UV__POLLOUT);
+}
+
+
+/* One of the streams is being closed. The request is finished when the
+ * stream is destroyed, until then it mustn't touch either file descriptor.
+ */
+static void uv__splice_cancel(uv_splice_t* req) {
+  req->splice_flags |= UV__SPLICE_CANCELED;
+  if (req->src)
+    uv__io_stop(req->src->loop, &req->src->io_watcher, UV__POLLIN);
+  uv__io_stop(req->dst->loop, &req->dst->io_watcher, UV__POLLOUT);
+}
+
+
+static void uv__splice_finish(uv_splice_t* req, int status) {
+  uv_stream_t* src;
+  uv_stream_t* dst;
+
+  src = req->src;
+  dst = req->dst;
+
+  dst->splice_in = NULL;
+
+  /* src wasn't reading and dst can't have pending writes, both are refused
+   * while splicing. The other direction may still be busy though.
+   */
+  if (src) {
+    src->splice_out = NULL;
+    uv__io_stop(src->loop, &src->io_watcher, UV__POLLIN);
+    if (!uv__io_active(&src->io_watcher, UV__POLLOUT) && !src->splice_in)
+      uv__handle_stop(src);
+  }
+
+  uv__io_stop(dst->loop, &dst->io_watcher, UV__POLLOUT);
+  if (!uv__io_active(&dst->io_watcher, UV__POLLIN) && !dst->splice_out)
+    uv__handle_stop(dst);
+
+  if (req->pipefd[0] != -1) {
+    close(req->pipefd[0]);
+    close(req->pipefd[1]);
+  }
+
+  uv__req_unregister(dst->loop, req);
+
+  if (req->cb)
+    req->cb(req, status);
+}
+#endif /* defined(__linux__) */
+
+
+int uv_splice_start(uv_splice_t* req,
+                    uv_stream_t* src,
+                    uv_stream_t* dst,
+                    uv_splice_cb cb) {
+#if defined(__linux__)
+  if ((src->type != UV_TCP && src->type != UV_NAMED_PIPE) ||
+      (dst->type != UV_TCP && dst->type != UV_NAMED_PIPE) ||
+      src == dst ||
+      !(src->flags & UV_STREAM_READABLE) ||
+      !(dst->flags & UV_STREAM_WRITABLE)) {
+    return uv__set_artificial_error(src->loop, UV_EINVAL);
+  }
+
+  if (uv__stream_fd(src) < 0 || uv__stream_fd(dst) < 0)
+    return uv__set_artificial_error(src->loop, UV_EBADF);
+
+  if (src->splice_out ||
+      dst->splice_in ||
+      (src->flags & UV_STREAM_READING) ||
+      !QUEUE_EMPTY(&dst->write_queue) ||
+      dst->shutdown_req) {
+    return uv__set_artificial_error(src->loop, UV_EBUSY);
+  }
+
+  if (uv__make_pipe(req->pipefd, UV__F_NONBLOCK))
+    return uv__set_sys_error(src->loop, errno);
+
+  uv__req_init(src->loop, req, UV_SPLICE);
+  req->src = src;
+  req->dst = dst;
+  req->cb = cb;
+  req->nread = 0;
+  req->nwritten = 0;
+  req->buffered = 0;
+  req->splice_flags = UV__SPLICE_SRC_EMPTY;
+
+  src->splice_out = req;
+  dst->splice_in = req;
+
+  /* Data may be waiting already, an edge-triggered watcher won't say so. */
+  uv__io_start(src->loop, &src->io_watcher, UV__POLLIN);
+  uv__io_rearm(src->loop, &src->io_watcher, UV__POLLIN);
+  uv__handle_start(src);
+  uv__handle_start(dst);
+
+  return 0;
+#else
+  return uv__set_artificial_error(src->loop, UV_ENOSYS);
+#endif
+}
+
+
+int uv_splice_file(uv_splice_t* req,
+                   uv_file fd,
+                   int64_t offset,
+                   int64_t length,
+                   uv_stream_t* dst,
+                   uv_splice_cb cb) {
+#if defined(__linux__)
+  if ((dst->type != UV_TCP && dst->type != UV_NAMED_PIPE) ||
+      !(dst->flags & UV_STREAM_WRITABLE) ||
+      offset < 0) {
+    return uv__set_artificial_error(dst->loop, UV_EINVAL);
+  }
+
+  if (fd < 0 || uv__stream_fd(dst) < 0)
+    return uv__set_artificial_error(dst->loop, UV_EBADF);
+
+  if (dst->splice_in ||
+      !QUEUE_EMPTY(&dst->write_queue) ||
+      dst->shutdown_req) {
+    return uv__set_artificial_error(dst->loop, UV_EBUSY);
+  }
+
+  uv__req_init(dst->loop, req, UV_SPLICE);
+  req->src = NULL;
+  req->dst = dst;
+  req->cb = cb;
+  req->nread = 0;
+  req->nwritten = 0;
+  req->pipefd[0] = -1;
+  req->pipefd[1] = -1;
+  req->buffered = 0;
+  req->file = fd;
+  req->file_offset = offset;
+  req->file_remaining = length < 0 ? (uint64_t) -1 : (uint64_t) length;
+
+  /* Always complete from the loop, even when there's nothing to send. */
+  req->splice_flags = UV__SPLICE_DST_BLOCKED;
+  dst->splice_in = req;
+
+  uv__io_start(dst->loop, &dst->io_watcher, UV__POLLOUT);
+  uv__io_rearm(dst->loop, &dst->io_watcher, UV__POLLOUT);
+  uv__handle_start(dst);
+
+  return 0;
+#else
+  return uv__set_artificial_error(dst->loop, UV_ENOSYS);
+#endif
+}
+
+
+int uv_splice_stop(uv_splice_t* req) {
+#if defined(__linux__)
+  uv_stream_t* dst;
+
+  if (req->splice_flags & (UV__SPLICE_EOF | UV__SPLICE_CANCELED))
+    return 0;
+
+  req->splice_flags |= UV__SPLICE_EOF;
+  if (req->src)
+    uv__io_stop(req->src->loop, &req->src->io_watcher, UV__POLLIN);
+
+  /* Finish from the event loop, after the pipe is drained. */
+  dst = req->dst;
+  if (!(req->splice_flags & UV__SPLICE_DST_BLOCKED)) {
+    req->splice_flags |= UV__SPLICE_DST_BLOCKED;
+    uv__io_start(dst->loop, &dst->io_watcher, UV__POLLOUT);
+    uv__io_rearm(dst->loop, &dst->io_watcher, UV__POLLOUT);
+  }
+
+  return 0;
+#else
+  /* uv_splice_start() never succeeds, there's nothing to stop. */
+  (void) req;
+  return 0;
+#endif
+}
@@ -23,15 +23,38 @@
 #include <stdlib.h>
 
 #define MAX_THREADPOOL_SIZE 128
+#define DEFAULT_THREADPOOL_SIZE 4
+
+/* Every worker owns a queue of pending requests. Submitters hand requests to
+ * an idle worker if they can find one and round-robin over the lane's workers
+ * if they can't. A worker whose own queue runs dry steals from its siblings
+ * before it goes to sleep, and again when a submitter wakes it because the
+ * request went to a busy sibling.
+ */
+struct uv__worker {
+  uv_thread_t thread;
+  uv_mutex_t mutex;  /* Guards wq, idle, wakeup, exiting and exited. */
+  uv_cond_t cond;
+  QUEUE wq;
+  QUEUE retired_queue;
+  struct uv__lane* lane;
+  unsigned int steal_hint;
+  volatile int idle;
+  int wakeup;  /* A sibling has a request it isn't getting to, go steal it. */
+  int exiting;
+  int exited;
+};
+
+struct uv__lane {
+  struct uv__worker** workers;
+  unsigned int nworkers;
+  unsigned int next;  /* Updated without locking, it's only a hint. */
+};
 
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
-static uv_mutex_t mutex;
-static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
+static uv_rwlock_t lock;  /* Guards the lanes' worker lists and `retired`. */
+static struct uv__lane lanes[UV_THREADPOOL_LANE_MAX];
+static QUEUE retired;
 static volatile int initialized;
 
 
@@ -40,38 +63,108 @@ static void uv__cancelled(struct uv__work* w) {
 }
 
 
+/* Takes the oldest request off a worker's queue. Must be called with
+ * worker->mutex held.
+ */
+static QUEUE* uv__worker_pop(struct uv__worker* worker) {
+  struct uv__work* w;
+  QUEUE* q;
+
+  if (QUEUE_EMPTY(&worker->wq))
+    return NULL;
+
+  q = QUEUE_HEAD(&worker->wq);
+  QUEUE_REMOVE(q);
+  QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+
+  w = QUEUE_DATA(q, struct uv__work, wq);
+  w->worker = NULL;
+
+  return q;
+}
+
+
+/* Victims lose their oldest request rather than their newest, that keeps
+ * requests starting in roughly the order they were submitted in.
+ */
+static QUEUE* uv__worker_steal(struct uv__worker* self) {
+  struct uv__worker* victim;
+  struct uv__lane* lane;
+  unsigned int n;
+  unsigned int i;
+  QUEUE* q;
+
+  q = NULL;
+  lane = self->lane;
+
+  uv_rwlock_rdlock(&lock);
+
+  n = lane->nworkers;
+  for (i = 0; i < n && q == NULL; i++) {
+    victim = lane->workers[(self->steal_hint + i) % n];
+    if (victim == self)
+      continue;
+
+    uv_mutex_lock(&victim->mutex);
+    q = uv__worker_pop(victim);
+    uv_mutex_unlock(&victim->mutex);
+
+    if (q != NULL)
+      self->steal_hint += i;
+  }
+
+  uv_rwlock_rdunlock(&lock);
+
+  return q;
+}
+
+
 /* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
+ * never holds a worker mutex and the loop-local mutex at the same time.
  */
-static void worker(void* arg) {
+static void worker_main(void* arg) {
+  struct uv__worker* self;
   struct uv__work* w;
   QUEUE* q;
+  int exiting;
 
-  (void) arg;
+  self = arg;
 
   for (;;) {
-    uv_mutex_lock(&mutex);
+    uv_mutex_lock(&self->mutex);
+    q = uv__worker_pop(self);
+    exiting = self->exiting;
+    uv_mutex_unlock(&self->mutex);
 
-    while (QUEUE_EMPTY(&wq))
-      uv_cond_wait(&cond, &mutex);
+    if (q == NULL && !exiting)
+      q = uv__worker_steal(self);
 
-    q = QUEUE_HEAD(&wq);
+    if (q == NULL) {
+      uv_mutex_lock(&self->mutex);
 
-    if (q == &exit_message)
-      uv_cond_signal(&cond);
-    else {
-      QUEUE_REMOVE(q);
-      QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is
-                             executing. */
-    }
+      while (QUEUE_EMPTY(&self->wq) && !self->exiting && !self->wakeup) {
+        self->idle = 1;
+        uv_cond_wait(&self->cond, &self->mutex);
+        self->idle = 0;
+      }
+      self->wakeup = 0;
+
+      /* A retired worker finishes its own queue before it exits. */
+      exiting = self->exiting && QUEUE_EMPTY(&self->wq);
+      self->exited = exiting;
 
-    uv_mutex_unlock(&mutex);
+      uv_mutex_unlock(&self->mutex);
 
-    if (q == &exit_message)
-      break;
+      if (exiting)
+        break;
+
+      continue;
+    }
 
     w = QUEUE_DATA(q, struct uv__work, wq);
+    w->start_time = uv__hrtime();
     w->work(w);
+    w->end_time = uv__hrtime();
 
     uv_mutex_lock(&w->loop->wq_mutex);
     w->work = NULL;  /* Signal uv_cancel() that the work req is done
@@ -83,20 +176,149 @@ static void worker(void* arg) {
 }
 
 
-static void post(QUEUE* q) {
-  uv_mutex_lock(&mutex);
-  QUEUE_INSERT_TAIL(&wq, q);
-  uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+static void post(struct uv__work* w, uv_threadpool_lane_t lane_id) {
+  struct uv__worker* target;
+  struct uv__worker* worker;
+  struct uv__lane* lane;
+  unsigned int n;
+  unsigned int i;
+  int signalled;
+
+  lane = lanes + lane_id;
+
+  uv_rwlock_rdlock(&lock);
+
+  /* `idle` is peeked at without the workers' locks, it only picks the
+   * target. Whether the target really is idle is decided below.
+   */
+  n = lane->nworkers;
+  target = lane->workers[lane->next++ % n];
+  for (i = 0; i < n && !target->idle; i++)
+    if (lane->workers[i]->idle)
+      target = lane->workers[i];
+
+  uv_mutex_lock(&target->mutex);
+  QUEUE_INSERT_TAIL(&target->wq, &w->wq);
+  w->worker = target;
+  signalled = target->idle;
+  if (signalled)
+    uv_cond_signal(&target->cond);
+  uv_mutex_unlock(&target->mutex);
+
+  /* The target is busy, so the request would wait for whatever it's doing.
+   * Wake one sleeping sibling to steal it. Siblings that aren't asleep get
+   * `wakeup` too: one of them may have just failed to steal and be on its
+   * way to sleep, it has to look again first.
+   */
+  for (i = 0; i < n && !signalled; i++) {
+    worker = lane->workers[i];
+    if (worker == target)
+      continue;
+
+    uv_mutex_lock(&worker->mutex);
+    worker->wakeup = 1;
+    if (worker->idle) {
+      uv_cond_signal(&worker->cond);
+      signalled = 1;
+    }
+    uv_mutex_unlock(&worker->mutex);
+  }
+
+  uv_rwlock_rdunlock(&lock);
+}
+
+
+/* Must be called with `lock` held for writing. */
+static int uv__lane_resize(struct uv__lane* lane, unsigned int nthreads) {
+  struct uv__worker** workers;
+  struct uv__worker* worker;
+
+  if (nthreads > lane->nworkers) {
+    workers = realloc(lane->workers, nthreads * sizeof(workers[0]));
+    if (workers == NULL)
+      return -1;
+
+    lane->workers = workers;
+  }
+
+  while (lane->nworkers < nthreads) {
+    worker = calloc(1, sizeof(*worker));
+    if (worker == NULL)
+      return -1;
+
+    if (uv_mutex_init(&worker->mutex))
+      abort();
+
+    if (uv_cond_init(&worker->cond))
+      abort();
+
+    QUEUE_INIT(&worker->wq);
+    worker->lane = lane;
+    worker->steal_hint = lane->nworkers + 1;
+
+    if (uv_thread_create(&worker->thread, worker_main, worker)) {
+      uv_cond_destroy(&worker->cond);
+      uv_mutex_destroy(&worker->mutex);
+      free(worker);
+      return -1;
+    }
+
+    lane->workers[lane->nworkers++] = worker;
+  }
+
+  while (lane->nworkers > nthreads) {
+    worker = lane->workers[--lane->nworkers];
+
+    uv_mutex_lock(&worker->mutex);
+    worker->exiting = 1;
+    uv_cond_signal(&worker->cond);
+    uv_mutex_unlock(&worker->mutex);
+
+    QUEUE_INSERT_TAIL(&retired, &worker->retired_queue);
+  }
+
+  return 0;
 }
 
 
-static void init_once(void) {
-  unsigned int i;
+/* Joins retired workers. Must be called with `lock` held for writing unless
+ * `wait` is non-zero, in which case it must not be held at all; a retired
+ * worker may still be trying to steal and that takes the lock.
+ */
+static void uv__lane_reap(int wait) {
+  struct uv__worker* worker;
+  QUEUE* q;
+  QUEUE* next;
+  int exited;
+
+  for (q = QUEUE_HEAD(&retired); q != &retired; q = next) {
+    next = QUEUE_NEXT(q);
+    worker = QUEUE_DATA(q, struct uv__worker, retired_queue);
+
+    uv_mutex_lock(&worker->mutex);
+    exited = worker->exited;
+    uv_mutex_unlock(&worker->mutex);
+
+    if (!exited && !wait)
+      continue;
+
+    if (uv_thread_join(&worker->thread))
+      abort();
+
+    QUEUE_REMOVE(q);
+    uv_cond_destroy(&worker->cond);
+    uv_mutex_destroy(&worker->mutex);
+    free(worker);
+  }
+}
+
+
+static unsigned int uv__lane_size_from_env(const char* name) {
+  unsigned int nthreads;
   const char* val;
 
-  nthreads = ARRAY_SIZE(default_threads);
-  val = getenv("UV_THREADPOOL_SIZE");
+  nthreads = DEFAULT_THREADPOOL_SIZE;
+  val = getenv(name);
   if (val != NULL)
     nthreads = atoi(val);
   if (nthreads == 0)
@@ -104,26 +326,27 @@ static void init_once(void) {
   if (nthreads > MAX_THREADPOOL_SIZE)
     nthreads = MAX_THREADPOOL_SIZE;
 
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = malloc(nthreads * sizeof(threads[0]));
-    if (threads == NULL) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
-    }
-  }
+  return nthreads;
+}
 
-  if (uv_cond_init(&cond))
-    abort();
 
-  if (uv_mutex_init(&mutex))
+static void init_once(void) {
+  unsigned int io_threads;
+  unsigned int cpu_threads;
+
+  io_threads = uv__lane_size_from_env("UV_THREADPOOL_SIZE");
+  cpu_threads = uv__lane_size_from_env("UV_THREADPOOL_CPU_SIZE");
+
+  if (uv_rwlock_init(&lock))
     abort();
 
-  QUEUE_INIT(&wq);
+  QUEUE_INIT(&retired);
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, NULL))
-      abort();
+  if (uv__lane_resize(lanes + UV_THREADPOOL_IO, io_threads))
+    abort();
+
+  if (uv__lane_resize(lanes + UV_THREADPOOL_CPU, cpu_threads))
+    abort();
 
   initialized = 1;
 }
@@ -137,20 +360,20 @@ static void cleanup(void) {
   if (initialized == 0)
     return;
 
-  post(&exit_message);
+  uv_rwlock_wrlock(&lock);
+  for (i = 0; i < ARRAY_SIZE(lanes); i++)
+    uv__lane_resize(lanes + i, 0);
+  uv_rwlock_wrunlock(&lock);
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
-      abort();
+  uv__lane_reap(1);
 
-  if (threads != default_threads)
-    free(threads);
+  for (i = 0; i < ARRAY_SIZE(lanes); i++) {
+    free(lanes[i].workers);
+    lanes[i].workers = NULL;
+  }
 
-  uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
+  uv_rwlock_destroy(&lock);
 
-  threads = NULL;
-  nthreads = 0;
   initialized = 0;
 }
 #endif
@@ -158,28 +381,45 @@ static void cleanup(void) {
 
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work* w,
+                     uv_threadpool_lane_t lane,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
   uv_once(&once, init_once);
   w->loop = loop;
   w->work = work;
   w->done = done;
-  post(&w->wq);
+  w->submit_time = uv__hrtime();
+  w->start_time = 0;
+  w->end_time = 0;
+  post(w, lane);
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  struct uv__worker* worker;
   int cancelled;
 
-  uv_mutex_lock(&mutex);
-  uv_mutex_lock(&w->loop->wq_mutex);
+  cancelled = 0;
+
+  /* Holding the lock keeps a retired worker from being freed under us. */
+  uv_rwlock_rdlock(&lock);
+
+  worker = w->worker;
+  if (worker != NULL) {
+    uv_mutex_lock(&worker->mutex);
+    uv_mutex_lock(&w->loop->wq_mutex);
 
-  cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
-  if (cancelled)
-    QUEUE_REMOVE(&w->wq);
+    cancelled = !QUEUE_EMPTY(&w->wq) && w->work != NULL;
+    if (cancelled) {
+      QUEUE_REMOVE(&w->wq);
+      w->worker = NULL;
+    }
+
+    uv_mutex_unlock(&w->loop->wq_mutex);
+    uv_mutex_unlock(&worker->mutex);
+  }
 
-  uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
+  uv_rwlock_rdunlock(&lock);
 
   if (!cancelled)
     return -1;
@@ -194,6 +434,46 @@ static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
 }
 
 
+uv_err_t uv_threadpool_resize(uv_threadpool_lane_t lane,
+                              unsigned int nthreads) {
+  int r;
+
+  if (lane >= UV_THREADPOOL_LANE_MAX)
+    return uv__new_artificial_error(UV_EINVAL);
+
+  if (nthreads == 0 || nthreads > MAX_THREADPOOL_SIZE)
+    return uv__new_artificial_error(UV_EINVAL);
+
+  uv_once(&once, init_once);
+
+  uv_rwlock_wrlock(&lock);
+  uv__lane_reap(0);
+  r = uv__lane_resize(lanes + lane, nthreads);
+  uv_rwlock_wrunlock(&lock);
+
+  if (r)
+    return uv__new_artificial_error(UV_ENOMEM);
+
+  return uv_ok_;
+}
+
+
+unsigned int uv_threadpool_size(uv_threadpool_lane_t lane) {
+  unsigned int nthreads;
+
+  if (lane >= UV_THREADPOOL_LANE_MAX)
+    return 0;
+
+  uv_once(&once, init_once);
+
+  uv_rwlock_rdlock(&lock);
+  nthreads = lanes[lane].nworkers;
+  uv_rwlock_rdunlock(&lock);
+
+  return nthreads;
+}
+
+
 void uv__work_done(uv_async_t* handle, int status) {
   struct uv__work* w;
   uv_loop_t* loop;
@@ -249,38 +529,70 @@ int uv_queue_work(uv_loop_t* loop,
                   uv_work_t* req,
                   uv_work_cb work_cb,
                   uv_after_work_cb after_work_cb) {
-  if (work_cb == NULL)
+  return uv_queue_work_lane(loop,
+                            req,
+                            UV_THREADPOOL_CPU,
+                            work_cb,
+                            after_work_cb);
+}
+
+
+int uv_queue_work_lane(uv_loop_t* loop,
+                       uv_work_t* req,
+                       uv_threadpool_lane_t lane,
+                       uv_work_cb work_cb,
+                       uv_after_work_cb after_work_cb) {
+  if (work_cb == NULL || lane >= UV_THREADPOOL_LANE_MAX)
     return uv__set_artificial_error(loop, UV_EINVAL);
 
   uv__req_init(loop, req, UV_WORK);
   req->loop = loop;
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
-  uv__work_submit(loop, &req->work_req, uv__queue_work, uv__queue_done);
+  uv__work_submit(loop,
+                  &req->work_req,
+                  lane,
+                  uv__queue_work,
+                  uv__queue_done);
   return 0;
 }
 
 
-int uv_cancel(uv_req_t* req) {
-  struct uv__work* wreq;
-  uv_loop_t* loop;
-
+static struct uv__work* uv__req_work(const uv_req_t* req) {
   switch (req->type) {
   case UV_FS:
-    loop =  ((uv_fs_t*) req)->loop;
-    wreq = &((uv_fs_t*) req)->work_req;
-    break;
+    return &((uv_fs_t*) req)->work_req;
   case UV_GETADDRINFO:
-    loop =  ((uv_getaddrinfo_t*) req)->loop;
-    wreq = &((uv_getaddrinfo_t*) req)->work_req;
-    break;
+    return &((uv_getaddrinfo_t*) req)->work_req;
   case UV_WORK:
-    loop =  ((uv_work_t*) req)->loop;
-    wreq = &((uv_work_t*) req)->work_req;
-    break;
+    return &((uv_work_t*) req)->work_req;
   default:
-    return -1;
+    return NULL;
   }
+}
+
+
+int uv_cancel(uv_req_t* req) {
+  struct uv__work* wreq;
+
+  wreq = uv__req_work(req);
+  if (wreq == NULL)
+    return -1;
 
-  return uv__work_cancel(loop, req, wreq);
+  return uv__work_cancel(wreq->loop, req, wreq);
+}
+
+
+int uv_work_times(const uv_req_t* req, uv_work_times_t* times) {
+  const struct uv__work* wreq;
+
+  wreq = uv__req_work(req);
+  if (wreq == NULL)
+    return -1;
+
+  times->submitted = wreq->submit_time;
+  times->started = wreq->start_time;
+  times->finished = wreq->end_time;
+
+  return 0;
 }
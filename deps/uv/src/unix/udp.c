@@ -28,6 +28,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+/* Upper bound for the number of datagrams per recvmmsg() or sendmmsg() call,
+ * the message headers live on the stack.
+ */
+#define UV__UDP_MMSG_MAX 64
+
+#if defined(__linux__)
+static int no_recvmmsg;
+static int no_sendmmsg;
+#endif
+
 
 static void uv__udp_run_completed(uv_udp_t* handle);
 static void uv__udp_run_pending(uv_udp_t* handle);
@@ -85,12 +95,88 @@ void uv__udp_finish_close(uv_udp_t* handle) {
 }
 
 
+#if defined(__linux__)
+static void uv__udp_sendmmsg_pending(uv_udp_t* handle) {
+  struct uv__mmsghdr h[UV__UDP_MMSG_MAX];
+  struct msghdr* m;
+  uv_udp_send_t* req;
+  QUEUE* q;
+  int npkts;
+  int i;
+
+  while (!QUEUE_EMPTY(&handle->write_queue)) {
+    npkts = 0;
+    QUEUE_FOREACH(q, &handle->write_queue) {
+      if (npkts == UV__UDP_MMSG_MAX)
+        break;
+
+      req = QUEUE_DATA(q, uv_udp_send_t, queue);
+
+      m = &h[npkts++].msg_hdr;
+      memset(m, 0, sizeof(*m));
+      m->msg_name = &req->addr;
+      m->msg_namelen = (req->addr.sin6_family == AF_INET6 ?
+        sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+      m->msg_iov = (struct iovec*) req->bufs;
+      m->msg_iovlen = req->bufcnt;
+    }
+
+    do {
+      npkts = uv__sendmmsg(handle->io_watcher.fd, h, npkts, 0);
+    }
+    while (npkts == -1 && errno == EINTR);
+
+    if (npkts == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+
+      if (errno == ENOSYS) {
+        no_sendmmsg = 1;
+        return;
+      }
+
+      /* The error is for the first datagram, sendmsg() would have reported
+       * it the same way. Try the next one on the next iteration.
+       */
+      q = QUEUE_HEAD(&handle->write_queue);
+      req = QUEUE_DATA(q, uv_udp_send_t, queue);
+      req->status = -errno;
+      QUEUE_REMOVE(&req->queue);
+      QUEUE_INSERT_TAIL(&handle->write_completed_queue, &req->queue);
+      continue;
+    }
+
+    /* Datagrams are sent atomically, see uv__udp_run_pending(). */
+    for (i = 0; i < npkts; i++) {
+      q = QUEUE_HEAD(&handle->write_queue);
+      req = QUEUE_DATA(q, uv_udp_send_t, queue);
+      req->status = h[i].msg_len;
+      QUEUE_REMOVE(&req->queue);
+      QUEUE_INSERT_TAIL(&handle->write_completed_queue, &req->queue);
+    }
+  }
+}
+#endif /* defined(__linux__) */
+
+
 static void uv__udp_run_pending(uv_udp_t* handle) {
   uv_udp_send_t* req;
   QUEUE* q;
   struct msghdr h;
   ssize_t size;
 
+#if defined(__linux__)
+  /* sendmmsg() either empties the queue or stops at EAGAIN, the rest waits
+   * for the socket to become writable. Falls through to sendmsg() only when
+   * the kernel doesn't have sendmmsg().
+   */
+  if (no_sendmmsg == 0) {
+    uv__udp_sendmmsg_pending(handle);
+    if (no_sendmmsg == 0)
+      return;
+  }
+#endif /* defined(__linux__) */
+
   while (!QUEUE_EMPTY(&handle->write_queue)) {
     q = QUEUE_HEAD(&handle->write_queue);
     assert(q != NULL);
@@ -183,6 +269,83 @@ static void uv__udp_io(uv_loop_t* loop, uv__io_t* w, unsigned int revents) {
 }
 
 
+#if defined(__linux__)
+/* Returns -1 and leaves errno set to ENOSYS without touching the buffer if
+ * the kernel doesn't have recvmmsg(). Reports everything else to recv_cb.
+ */
+static ssize_t uv__udp_recvmmsg(uv_udp_t* handle, uv_buf_t buf) {
+  struct sockaddr_storage peers[UV__UDP_MMSG_MAX];
+  struct uv__mmsghdr h[UV__UDP_MMSG_MAX];
+  struct iovec iov[UV__UDP_MMSG_MAX];
+  uv_udp_recv_cb recv_cb;
+  struct msghdr* m;
+  ssize_t nread;
+  size_t size;
+  size_t used;
+  int nslots;
+  int flags;
+  int i;
+
+  size = handle->recv_batch_size;
+  nslots = buf.len / size;
+  if (nslots > UV__UDP_MMSG_MAX)
+    nslots = UV__UDP_MMSG_MAX;
+
+  for (i = 0; i < nslots; i++) {
+    iov[i].iov_base = buf.base + i * size;
+    iov[i].iov_len = size;
+
+    m = &h[i].msg_hdr;
+    memset(m, 0, sizeof(*m));
+    m->msg_name = &peers[i];
+    m->msg_namelen = sizeof(peers[i]);
+    m->msg_iov = &iov[i];
+    m->msg_iovlen = 1;
+  }
+
+  do {
+    nread = uv__recvmmsg(handle->io_watcher.fd, h, nslots, 0, NULL);
+  }
+  while (nread == -1 && errno == EINTR);
+
+  if (nread == -1) {
+    if (errno == ENOSYS)
+      return -1;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      uv__set_sys_error(handle->loop, EAGAIN);
+      handle->recv_cb(handle, 0, buf, NULL, 0);
+    }
+    else {
+      uv__set_sys_error(handle->loop, errno);
+      handle->recv_cb(handle, -1, buf, NULL, 0);
+    }
+    return -1;
+  }
+
+  /* recv_cb may stop or close the handle, the batch still has to be freed. */
+  recv_cb = handle->recv_cb;
+  used = 0;
+
+  for (i = 0; i < nread && handle->recv_cb != NULL; i++) {
+    flags = UV_UDP_MMSG_CHUNK;
+    if (h[i].msg_hdr.msg_flags & MSG_TRUNC)
+      flags |= UV_UDP_PARTIAL;
+
+    used = i * size + h[i].msg_len;
+    handle->recv_cb(handle,
+                    h[i].msg_len,
+                    uv_buf_init(iov[i].iov_base, h[i].msg_len),
+                    (struct sockaddr*) &peers[i],
+                    flags);
+  }
+
+  recv_cb(handle, 0, uv_buf_init(buf.base, used), NULL, UV_UDP_MMSG_FREE);
+  return nread;
+}
+#endif /* defined(__linux__) */
+
+
 static void uv__udp_recvmsg(uv_loop_t* loop,
                             uv__io_t* w,
                             unsigned int revents) {
@@ -190,6 +353,7 @@ static void uv__udp_recvmsg(uv_loop_t* loop,
   struct msghdr h;
   uv_udp_t* handle;
   ssize_t nread;
+  size_t suggested_size;
   uv_buf_t buf;
   int flags;
   int count;
@@ -210,10 +374,27 @@ static void uv__udp_recvmsg(uv_loop_t* loop,
   h.msg_name = &peer;
 
   do {
-    buf = handle->alloc_cb((uv_handle_t*)handle, 64 * 1024);
+    suggested_size = 64 * 1024;
+#if defined(__linux__)
+    if (handle->recv_batch > 1 && no_recvmmsg == 0)
+      suggested_size = handle->recv_batch * handle->recv_batch_size;
+#endif /* defined(__linux__) */
+
+    buf = handle->alloc_cb((uv_handle_t*)handle, suggested_size);
     assert(buf.len > 0);
     assert(buf.base != NULL);
 
+#if defined(__linux__)
+    if (handle->recv_batch > 1 &&
+        buf.len >= 2 * handle->recv_batch_size &&
+        no_recvmmsg == 0) {
+      nread = uv__udp_recvmmsg(handle, buf);
+      if (nread != -1 || errno != ENOSYS)
+        continue;
+      no_recvmmsg = 1;
+    }
+#endif /* defined(__linux__) */
+
     h.msg_namelen = sizeof(peer);
     h.msg_iov = (void*) &buf;
     h.msg_iovlen = 1;
@@ -442,6 +623,8 @@ int uv_udp_init(uv_loop_t* loop, uv_udp_t* handle) {
   uv__io_init(&handle->io_watcher, uv__udp_io, -1);
   QUEUE_INIT(&handle->write_queue);
   QUEUE_INIT(&handle->write_completed_queue);
+  handle->recv_batch = 0;
+  handle->recv_batch_size = 0;
   return 0;
 }
 
@@ -660,6 +843,19 @@ int uv__udp_recv_start(uv_udp_t* handle,
 }
 
 
+int uv_udp_set_recv_batch(uv_udp_t* handle, unsigned int count, size_t size) {
+  if (count > 1 && size == 0)
+    return uv__set_artificial_error(handle->loop, UV_EINVAL);
+
+  if (count > UV__UDP_MMSG_MAX)
+    count = UV__UDP_MMSG_MAX;
+
+  handle->recv_batch = count;
+  handle->recv_batch_size = size;
+  return 0;
+}
+
+
 int uv__udp_recv_stop(uv_udp_t* handle) {
   uv__io_stop(handle->loop, &handle->io_watcher, UV__POLLIN);
 
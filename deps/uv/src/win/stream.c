@@ -196,3 +196,21 @@ int uv_is_readable(const uv_stream_t* handle) {
 int uv_is_writable(const uv_stream_t* handle) {
   return !!(handle->flags & UV_HANDLE_WRITABLE);
 }
+
+
+int uv_splice_start(uv_splice_t* req, uv_stream_t* src, uv_stream_t* dst,
+    uv_splice_cb cb) {
+  return uv__set_artificial_error(src->loop, UV_ENOSYS);
+}
+
+
+int uv_splice_file(uv_splice_t* req, uv_file fd, int64_t offset,
+    int64_t length, uv_stream_t* dst, uv_splice_cb cb) {
+  return uv__set_artificial_error(dst->loop, UV_ENOSYS);
+}
+
+
+int uv_splice_stop(uv_splice_t* req) {
+  /* uv_splice_start() never succeeds, there's nothing to stop. */
+  return 0;
+}
@@ -55,7 +55,21 @@ static DWORD WINAPI uv_work_thread_proc(void* parameter) {
 
 int uv_queue_work(uv_loop_t* loop, uv_work_t* req, uv_work_cb work_cb,
     uv_after_work_cb after_work_cb) {
-  if (work_cb == NULL)
+  return uv_queue_work_lane(loop,
+                            req,
+                            UV_THREADPOOL_CPU,
+                            work_cb,
+                            after_work_cb);
+}
+
+
+/* The system thread pool has no notion of lanes, the lane is only checked
+ * for validity.
+ */
+int uv_queue_work_lane(uv_loop_t* loop, uv_work_t* req,
+    uv_threadpool_lane_t lane, uv_work_cb work_cb,
+    uv_after_work_cb after_work_cb) {
+  if (work_cb == NULL || lane >= UV_THREADPOOL_LANE_MAX)
     return uv__set_artificial_error(loop, UV_EINVAL);
 
   uv_work_req_init(loop, req, work_cb, after_work_cb);
@@ -75,6 +89,22 @@ int uv_cancel(uv_req_t* req) {
 }
 
 
+int uv_work_times(const uv_req_t* req, uv_work_times_t* times) {
+  return -1;
+}
+
+
+uv_err_t uv_threadpool_resize(uv_threadpool_lane_t lane,
+                              unsigned int nthreads) {
+  return uv__new_artificial_error(UV_ENOSYS);
+}
+
+
+unsigned int uv_threadpool_size(uv_threadpool_lane_t lane) {
+  return 0;
+}
+
+
 void uv_process_work_req(uv_loop_t* loop, uv_work_t* req) {
   uv__req_unregister(loop, req);
   if(req->after_work_cb)
@@ -382,6 +382,17 @@ int uv__udp_recv_stop(uv_udp_t* handle) {
 }
 
 
+int uv_udp_set_recv_batch(uv_udp_t* handle, unsigned int count, size_t size) {
+  /* No batched receive on Windows, datagrams are read one at a time. */
+  if (count > 1 && size == 0) {
+    uv__set_artificial_error(handle->loop, UV_EINVAL);
+    return -1;
+  }
+
+  return 0;
+}
+
+
 static int uv__send(uv_udp_send_t* req, uv_udp_t* handle, uv_buf_t bufs[],
     int bufcnt, struct sockaddr* addr, int addr_len, uv_udp_send_cb cb) {
   uv_loop_t* loop = handle->loop;
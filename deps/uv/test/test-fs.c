@@ -1931,3 +1931,111 @@ TEST_IMPL(fs_read_file_eof) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+#define BATCH_REQS 64
+
+static uv_fs_t batch_reqs[BATCH_REQS];
+static char batch_bufs[BATCH_REQS][8];
+static int batch_cb_count;
+
+
+static void batch_write_cb(uv_fs_t* req) {
+  ASSERT(req->fs_type == UV_FS_WRITE);
+  ASSERT(req->result == sizeof(batch_bufs[0]));
+  batch_cb_count++;
+  uv_fs_req_cleanup(req);
+}
+
+
+static void batch_read_cb(uv_fs_t* req) {
+  char expected[sizeof(batch_bufs[0])];
+  int i;
+
+  i = req - batch_reqs;
+  memset(expected, 'a' + i % 26, sizeof(expected));
+
+  ASSERT(req->fs_type == UV_FS_READ);
+  ASSERT(req->result == sizeof(batch_bufs[0]));
+  ASSERT(memcmp(batch_bufs[i], expected, sizeof(expected)) == 0);
+  batch_cb_count++;
+  uv_fs_req_cleanup(req);
+}
+
+
+static void batch_fstat_cb(uv_fs_t* req) {
+  ASSERT(req->fs_type == UV_FS_FSTAT);
+  ASSERT(req->result == 0);
+  ASSERT(req->ptr == &req->statbuf);
+  fstat_cb_count++;
+  uv_fs_req_cleanup(req);
+}
+
+
+TEST_IMPL(fs_read_write_batch) {
+  uv_fs_t fstat_req;
+  uv_file file;
+  uv_stat_t s;
+  int r;
+  int i;
+
+  /* Setup. */
+  unlink("test_file");
+
+  loop = uv_default_loop();
+
+  r = uv_fs_open(loop, &open_req1, "test_file", O_RDWR | O_CREAT,
+      S_IWRITE | S_IREAD, NULL);
+  ASSERT(r != -1);
+  file = open_req1.result;
+  uv_fs_req_cleanup(&open_req1);
+
+  /* Queue all writes in the same tick so they're submitted in one batch. */
+  for (i = 0; i < BATCH_REQS; i++) {
+    memset(batch_bufs[i], 'a' + i % 26, sizeof(batch_bufs[i]));
+    r = uv_fs_write(loop, batch_reqs + i, file, batch_bufs[i],
+        sizeof(batch_bufs[i]), i * sizeof(batch_bufs[i]), batch_write_cb);
+    ASSERT(r == 0);
+  }
+
+  uv_run(loop, UV_RUN_DEFAULT);
+  ASSERT(batch_cb_count == BATCH_REQS);
+
+  memset(batch_bufs, 0, sizeof(batch_bufs));
+  for (i = 0; i < BATCH_REQS; i++) {
+    r = uv_fs_read(loop, batch_reqs + i, file, batch_bufs[i],
+        sizeof(batch_bufs[i]), i * sizeof(batch_bufs[i]), batch_read_cb);
+    ASSERT(r == 0);
+  }
+
+  r = uv_fs_fstat(loop, &fstat_req, file, NULL);
+  ASSERT(r == 0);
+  s = fstat_req.statbuf;
+  uv_fs_req_cleanup(&fstat_req);
+
+  r = uv_fs_fstat(loop, &fstat_req, file, batch_fstat_cb);
+  ASSERT(r == 0);
+
+  uv_run(loop, UV_RUN_DEFAULT);
+  ASSERT(batch_cb_count == 2 * BATCH_REQS);
+  ASSERT(fstat_cb_count == 1);
+
+  /* Async and sync stats may take different paths, they must agree. */
+  ASSERT(s.st_size == BATCH_REQS * sizeof(batch_bufs[0]));
+  ASSERT(fstat_req.statbuf.st_size == s.st_size);
+  ASSERT(fstat_req.statbuf.st_dev == s.st_dev);
+  ASSERT(fstat_req.statbuf.st_ino == s.st_ino);
+  ASSERT(fstat_req.statbuf.st_mode == s.st_mode);
+  ASSERT(fstat_req.statbuf.st_mtim.tv_sec == s.st_mtim.tv_sec);
+  ASSERT(fstat_req.statbuf.st_mtim.tv_nsec == s.st_mtim.tv_nsec);
+
+  r = uv_fs_close(loop, &close_req, file, NULL);
+  ASSERT(r == 0);
+  uv_fs_req_cleanup(&close_req);
+
+  /* Cleanup */
+  unlink("test_file");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
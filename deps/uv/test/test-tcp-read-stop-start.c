@@ -0,0 +1,109 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+static uv_timer_t timer_handle;
+static uv_tcp_t tcp_handle;
+static uv_write_t write_req;
+static char recv_buf[64];
+static int read_cb_called;
+static int write_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(recv_buf, sizeof(recv_buf));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf);
+
+
+static void timer_cb(uv_timer_t* handle, int status) {
+  /* The echo came in while we weren't reading. The poller must report it
+   * when we start reading again.
+   */
+  ASSERT(0 == uv_read_start((uv_stream_t*) &tcp_handle, alloc_cb, read_cb));
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(0 == status);
+  write_cb_called++;
+}
+
+
+static void write_ping(void) {
+  uv_buf_t buf = uv_buf_init("PING", 4);
+  ASSERT(0 == uv_write(&write_req,
+                       (uv_stream_t*) &tcp_handle,
+                       &buf,
+                       1,
+                       write_cb));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == 4);
+  ASSERT(0 == memcmp(buf.base, "PING", 4));
+  read_cb_called++;
+
+  ASSERT(0 == uv_read_stop(stream));
+
+  if (read_cb_called == 1) {
+    write_ping();
+    ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 50, 0));
+  } else {
+    uv_close((uv_handle_t*) &timer_handle, NULL);
+    uv_close((uv_handle_t*) &tcp_handle, NULL);
+  }
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(0 == status);
+  ASSERT(0 == uv_read_start((uv_stream_t*) &tcp_handle, alloc_cb, read_cb));
+  write_ping();
+}
+
+
+TEST_IMPL(tcp_read_stop_start) {
+  uv_connect_t connect_req;
+  struct sockaddr_in addr;
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  ASSERT(0 == uv_timer_init(uv_default_loop(), &timer_handle));
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), &tcp_handle));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &tcp_handle, addr, connect_cb));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT(read_cb_called == 2);
+  ASSERT(write_cb_called == 2);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
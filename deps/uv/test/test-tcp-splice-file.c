@@ -0,0 +1,182 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+# include <unistd.h> /* unlink */
+#else
+# include <io.h>
+# define unlink _unlink
+#endif
+
+#define FILE_NAME "test_file"
+#define FILE_SIZE (4 * 1024 * 1024)
+#define RANGE_START 1000
+#define RANGE_LENGTH (FILE_SIZE - 2000)
+
+/* sendfile() moves at most this much per loop iteration. */
+#define SENDFILE_CHUNK (256 * 1024)
+
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t conn;
+static uv_connect_t connect_req;
+static uv_splice_t splice_req;
+static uv_check_t check_handle;
+static uv_fs_t fs_req;
+static uv_file file;
+static char* file_data;
+static char recv_buf[65536];
+static size_t bytes_received;
+static int splice_cb_called;
+static int client_eof;
+static int check_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(recv_buf, sizeof(recv_buf));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread == -1) {
+    ASSERT(uv_last_error(uv_default_loop()).code == UV_EOF);
+    client_eof = 1;
+    uv_close((uv_handle_t*) &client, NULL);
+    uv_close((uv_handle_t*) &server, NULL);
+    return;
+  }
+
+  ASSERT(bytes_received + nread <= RANGE_LENGTH);
+  ASSERT(0 == memcmp(buf.base,
+                     file_data + RANGE_START + bytes_received,
+                     nread));
+  bytes_received += nread;
+}
+
+
+static void check_cb(uv_check_t* handle, int status) {
+  check_cb_called++;
+}
+
+
+static void splice_cb(uv_splice_t* req, int status) {
+  ASSERT(req == &splice_req);
+  ASSERT(req->src == NULL);
+  ASSERT(0 == status);
+  ASSERT(req->nwritten == RANGE_LENGTH);
+  splice_cb_called++;
+
+  /* The loop got to run in between chunks. */
+  ASSERT(check_cb_called >= RANGE_LENGTH / SENDFILE_CHUNK);
+  uv_close((uv_handle_t*) &check_handle, NULL);
+
+  uv_close((uv_handle_t*) &conn, NULL);
+}
+
+
+static void connection_cb(uv_stream_t* handle, int status) {
+  int r;
+
+  ASSERT(0 == status);
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), &conn));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &conn));
+
+  r = uv_splice_file(&splice_req,
+                     file,
+                     RANGE_START,
+                     RANGE_LENGTH,
+                     (uv_stream_t*) &conn,
+                     splice_cb);
+
+  if (r == -1 && uv_last_error(uv_default_loop()).code == UV_ENOSYS) {
+    uv_close((uv_handle_t*) &conn, NULL);
+    return;
+  }
+  ASSERT(0 == r);
+  ASSERT(splice_cb_called == 0);
+
+  ASSERT(0 == uv_check_init(uv_default_loop(), &check_handle));
+  ASSERT(0 == uv_check_start(&check_handle, check_cb));
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(0 == status);
+  ASSERT(0 == uv_read_start((uv_stream_t*) &client, alloc_cb, read_cb));
+}
+
+
+TEST_IMPL(tcp_splice_file) {
+  struct sockaddr_in addr;
+  uv_loop_t* loop;
+  size_t i;
+  int r;
+
+  loop = uv_default_loop();
+
+  file_data = malloc(FILE_SIZE);
+  ASSERT(file_data != NULL);
+  for (i = 0; i < FILE_SIZE; i++)
+    file_data[i] = (char) (i * 7 + i / 251);
+
+  unlink(FILE_NAME);
+  r = uv_fs_open(loop, &fs_req, FILE_NAME, O_RDWR | O_CREAT,
+      S_IWUSR | S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  file = r;
+  uv_fs_req_cleanup(&fs_req);
+
+  r = uv_fs_write(loop, &fs_req, file, file_data, FILE_SIZE, 0, NULL);
+  ASSERT(r == FILE_SIZE);
+  uv_fs_req_cleanup(&fs_req);
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(loop, &client));
+  ASSERT(0 == uv_tcp_connect(&connect_req, &client, addr, connect_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+#if defined(__linux__)
+  ASSERT(splice_cb_called == 1);
+  ASSERT(bytes_received == RANGE_LENGTH);
+  ASSERT(client_eof == 1);
+#endif
+
+  uv_fs_close(loop, &fs_req, file, NULL);
+  uv_fs_req_cleanup(&fs_req);
+  unlink(FILE_NAME);
+  free(file_data);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
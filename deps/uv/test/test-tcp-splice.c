@@ -0,0 +1,229 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Much more than a pipe holds. Reading from the source has to pause when
+ * the sink isn't reading and the socket buffers are full.
+ */
+#define TOTAL_BYTES (16 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+
+static uv_tcp_t server;
+static uv_tcp_t source;     /* client that sends */
+static uv_tcp_t sink;       /* client that receives */
+static uv_tcp_t incoming;   /* server side of source */
+static uv_tcp_t outgoing;   /* server side of sink */
+static uv_timer_t timer;
+static uv_connect_t source_connect_req;
+static uv_connect_t sink_connect_req;
+static uv_shutdown_t source_shutdown_req;
+static uv_shutdown_t outgoing_shutdown_req;
+static uv_splice_t splice_req;
+static uv_write_t write_reqs[TOTAL_BYTES / CHUNK_SIZE];
+static char* send_data;
+static char recv_buf[CHUNK_SIZE];
+static size_t bytes_received;
+static int connections;
+static int splice_cb_called;
+static int sink_eof;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  return uv_buf_init(recv_buf, sizeof(recv_buf));
+}
+
+
+static void close_all(void) {
+  uv_close((uv_handle_t*) &sink, NULL);
+  uv_close((uv_handle_t*) &outgoing, NULL);
+  uv_close((uv_handle_t*) &incoming, NULL);
+  uv_close((uv_handle_t*) &source, NULL);
+  uv_close((uv_handle_t*) &server, NULL);
+}
+
+
+static void sink_read_cb(uv_stream_t* stream, ssize_t nread, uv_buf_t buf) {
+  if (nread == -1) {
+    ASSERT(uv_last_error(uv_default_loop()).code == UV_EOF);
+    sink_eof = 1;
+    close_all();
+    return;
+  }
+
+  ASSERT(0 == memcmp(buf.base, send_data + bytes_received, nread));
+  bytes_received += nread;
+}
+
+
+static void timer_cb(uv_timer_t* handle, int status) {
+  /* No more than a pipe's worth of data is in flight. */
+  ASSERT(splice_req.nwritten <= splice_req.nread);
+  ASSERT(splice_req.nread - splice_req.nwritten <= 1024 * 1024);
+
+  ASSERT(0 == uv_read_start((uv_stream_t*) &sink, alloc_cb, sink_read_cb));
+  uv_close((uv_handle_t*) &timer, NULL);
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(0 == status);
+}
+
+
+static void splice_cb(uv_splice_t* req, int status) {
+  ASSERT(req == &splice_req);
+  ASSERT(0 == status);
+  ASSERT(req->nread == TOTAL_BYTES);
+  ASSERT(req->nwritten == TOTAL_BYTES);
+  splice_cb_called++;
+
+  /* The streams are regular streams again. */
+  ASSERT(0 == uv_shutdown(&outgoing_shutdown_req,
+                          (uv_stream_t*) &outgoing,
+                          shutdown_cb));
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(0 == status);
+}
+
+
+static void start_splice(void) {
+  uv_write_t write_req;
+  uv_buf_t buf;
+  int r;
+
+  r = uv_splice_start(&splice_req,
+                      (uv_stream_t*) &incoming,
+                      (uv_stream_t*) &outgoing,
+                      splice_cb);
+
+  if (r == -1 && uv_last_error(uv_default_loop()).code == UV_ENOSYS) {
+    close_all();
+    return;
+  }
+  ASSERT(0 == r);
+
+  /* Both streams are taken while the data is moving. */
+  ASSERT(-1 == uv_splice_start(&splice_req,
+                               (uv_stream_t*) &incoming,
+                               (uv_stream_t*) &outgoing,
+                               splice_cb));
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EBUSY);
+
+  ASSERT(-1 == uv_read_start((uv_stream_t*) &incoming,
+                             alloc_cb,
+                             sink_read_cb));
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EBUSY);
+
+  buf = uv_buf_init("x", 1);
+  ASSERT(-1 == uv_write(&write_req, (uv_stream_t*) &outgoing, &buf, 1, NULL));
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EBUSY);
+
+  ASSERT(0 == uv_timer_init(uv_default_loop(), &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 100, 0));
+}
+
+
+static void connection_cb(uv_stream_t* handle, int status) {
+  uv_tcp_t* conn;
+
+  ASSERT(0 == status);
+
+  conn = connections++ == 0 ? &incoming : &outgoing;
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), conn));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) conn));
+
+  if (connections == 2)
+    start_splice();
+}
+
+
+static void sink_connect_cb(uv_connect_t* req, int status) {
+  ASSERT(0 == status);
+}
+
+
+static void source_connect_cb(uv_connect_t* req, int status) {
+  struct sockaddr_in addr;
+  uv_buf_t buf;
+  size_t i;
+
+  ASSERT(0 == status);
+
+  for (i = 0; i < ARRAY_SIZE(write_reqs); i++) {
+    buf = uv_buf_init(send_data + i * CHUNK_SIZE, CHUNK_SIZE);
+    ASSERT(0 == uv_write(&write_reqs[i],
+                         (uv_stream_t*) &source,
+                         &buf,
+                         1,
+                         write_cb));
+  }
+
+  ASSERT(0 == uv_shutdown(&source_shutdown_req,
+                          (uv_stream_t*) &source,
+                          shutdown_cb));
+
+  /* Connect the sink only now so the server accepts the source first. */
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), &sink));
+  ASSERT(0 == uv_tcp_connect(&sink_connect_req, &sink, addr, sink_connect_cb));
+}
+
+
+TEST_IMPL(tcp_splice) {
+  struct sockaddr_in addr;
+  size_t i;
+
+  send_data = malloc(TOTAL_BYTES);
+  ASSERT(send_data != NULL);
+  for (i = 0; i < TOTAL_BYTES; i++)
+    send_data[i] = (char) (i * 7 + i / 251);
+
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), &server));
+  ASSERT(0 == uv_tcp_bind(&server, addr));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_init(uv_default_loop(), &source));
+  ASSERT(0 == uv_tcp_connect(&source_connect_req,
+                             &source,
+                             addr,
+                             source_connect_cb));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+#if defined(__linux__)
+  ASSERT(splice_cb_called == 1);
+  ASSERT(bytes_received == TOTAL_BYTES);
+  ASSERT(sink_eof == 1);
+#endif
+
+  free(send_data);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
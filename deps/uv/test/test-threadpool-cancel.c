@@ -67,33 +67,46 @@ static void done_cb(uv_work_t* req, int status) {
 }
 
 
-static void saturate_threadpool(void) {
+static void saturate_lane(uv_threadpool_lane_t lane) {
   uv_work_t* req;
 
-  ASSERT(0 == uv_cond_init(&signal_cond));
-  ASSERT(0 == uv_mutex_init(&signal_mutex));
-  ASSERT(0 == uv_mutex_init(&wait_mutex));
-
-  uv_mutex_lock(&signal_mutex);
-  uv_mutex_lock(&wait_mutex);
-
-  for (num_threads = 0; /* empty */; num_threads++) {
+  for (;;) {
     req = malloc(sizeof(*req));
     ASSERT(req != NULL);
-    ASSERT(0 == uv_queue_work(uv_default_loop(), req, work_cb, done_cb));
+    ASSERT(0 == uv_queue_work_lane(uv_default_loop(),
+                                   req,
+                                   lane,
+                                   work_cb,
+                                   done_cb));
 
     /* Expect to get signalled within 350 ms, otherwise assume that
-     * the thread pool is saturated. As with any timing dependent test,
+     * the lane is saturated. As with any timing dependent test,
      * this is obviously not ideal.
      */
     if (uv_cond_timedwait(&signal_cond, &signal_mutex, 350 * 1e6)) {
       ASSERT(0 == uv_cancel((uv_req_t*) req));
       break;
     }
+
+    num_threads++;
   }
 }
 
 
+static void saturate_threadpool(void) {
+  ASSERT(0 == uv_cond_init(&signal_cond));
+  ASSERT(0 == uv_mutex_init(&signal_mutex));
+  ASSERT(0 == uv_mutex_init(&wait_mutex));
+
+  uv_mutex_lock(&signal_mutex);
+  uv_mutex_lock(&wait_mutex);
+
+  num_threads = 0;
+  saturate_lane(UV_THREADPOOL_IO);
+  saturate_lane(UV_THREADPOOL_CPU);
+}
+
+
 static void unblock_threadpool(void) {
   uv_mutex_unlock(&signal_mutex);
   uv_mutex_unlock(&wait_mutex);
@@ -101,7 +114,8 @@ static void unblock_threadpool(void) {
 
 
 static void cleanup_threadpool(void) {
-  ASSERT(done_cb_called == num_threads + 1);  /* +1 == cancelled work req. */
+  /* +UV_THREADPOOL_LANE_MAX == one cancelled work req per lane. */
+  ASSERT(done_cb_called == num_threads + UV_THREADPOOL_LANE_MAX);
   ASSERT(work_cb_called == num_threads);
 
   uv_cond_destroy(&signal_cond);
@@ -234,6 +248,11 @@ TEST_IMPL(threadpool_cancel_fs) {
   uv_loop_t* loop;
   unsigned n;
 
+#if defined(__linux__)
+  /* io_uring requests can't be cancelled, force the thread pool. */
+  ASSERT(0 == setenv("UV_USE_IO_URING", "0", 1));
+#endif
+
   INIT_CANCEL_INFO(&ci, reqs);
   loop = uv_default_loop();
   saturate_threadpool();
@@ -0,0 +1,174 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+static uv_sem_t started_sem;
+static uv_mutex_t wait_mutex;
+static unsigned int blocked_work_cb_called;
+static unsigned int blocked_done_cb_called;
+static unsigned int counter_work_cb_called;
+static unsigned int counter_done_cb_called;
+static unsigned int stat_cb_called;
+static uv_mutex_t counter_mutex;
+
+
+static void blocked_work_cb(uv_work_t* req) {
+  uv_sem_post(&started_sem);
+  uv_mutex_lock(&wait_mutex);
+  uv_mutex_unlock(&wait_mutex);
+  blocked_work_cb_called++;
+}
+
+
+static void blocked_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  blocked_done_cb_called++;
+  free(req);
+}
+
+
+static void counter_work_cb(uv_work_t* req) {
+  uv_mutex_lock(&counter_mutex);
+  counter_work_cb_called++;
+  uv_mutex_unlock(&counter_mutex);
+}
+
+
+static void counter_done_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  counter_done_cb_called++;
+}
+
+
+static void stat_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+  stat_cb_called++;
+
+  /* The CPU lane is still blocked at this point. */
+  ASSERT(blocked_work_cb_called == 0);
+  uv_mutex_unlock(&wait_mutex);
+}
+
+
+static void queue_counter_work(uv_threadpool_lane_t lane) {
+  uv_work_t reqs[64];
+  unsigned int i;
+
+  counter_work_cb_called = 0;
+  counter_done_cb_called = 0;
+
+  for (i = 0; i < ARRAY_SIZE(reqs); i++)
+    ASSERT(0 == uv_queue_work_lane(uv_default_loop(),
+                                   reqs + i,
+                                   lane,
+                                   counter_work_cb,
+                                   counter_done_cb));
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(counter_work_cb_called == ARRAY_SIZE(reqs));
+  ASSERT(counter_done_cb_called == ARRAY_SIZE(reqs));
+}
+
+
+TEST_IMPL(threadpool_resize) {
+  unsigned int nthreads;
+  uv_err_t err;
+
+  ASSERT(0 == uv_mutex_init(&counter_mutex));
+
+  nthreads = uv_threadpool_size(UV_THREADPOOL_CPU);
+  ASSERT(nthreads > 0);
+
+  err = uv_threadpool_resize(UV_THREADPOOL_CPU, 0);
+  ASSERT(err.code == UV_EINVAL);
+  err = uv_threadpool_resize(UV_THREADPOOL_CPU, 129);
+  ASSERT(err.code == UV_EINVAL);
+  err = uv_threadpool_resize(UV_THREADPOOL_LANE_MAX, 1);
+  ASSERT(err.code == UV_EINVAL);
+  ASSERT(uv_threadpool_size(UV_THREADPOOL_CPU) == nthreads);
+
+  err = uv_threadpool_resize(UV_THREADPOOL_CPU, 8);
+  ASSERT(err.code == UV_OK);
+  ASSERT(uv_threadpool_size(UV_THREADPOOL_CPU) == 8);
+  queue_counter_work(UV_THREADPOOL_CPU);
+
+  err = uv_threadpool_resize(UV_THREADPOOL_CPU, 1);
+  ASSERT(err.code == UV_OK);
+  ASSERT(uv_threadpool_size(UV_THREADPOOL_CPU) == 1);
+  queue_counter_work(UV_THREADPOOL_CPU);
+
+  err = uv_threadpool_resize(UV_THREADPOOL_IO, 3);
+  ASSERT(err.code == UV_OK);
+  ASSERT(uv_threadpool_size(UV_THREADPOOL_IO) == 3);
+  queue_counter_work(UV_THREADPOOL_IO);
+
+  err = uv_threadpool_resize(UV_THREADPOOL_CPU, nthreads);
+  ASSERT(err.code == UV_OK);
+  queue_counter_work(UV_THREADPOOL_CPU);
+
+  uv_mutex_destroy(&counter_mutex);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(threadpool_lanes) {
+  unsigned int nthreads;
+  unsigned int i;
+  uv_work_t* req;
+  uv_fs_t stat_req;
+
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
+  ASSERT(0 == uv_mutex_init(&wait_mutex));
+  uv_mutex_lock(&wait_mutex);
+
+  /* Tie up every thread in the CPU lane. */
+  nthreads = uv_threadpool_size(UV_THREADPOOL_CPU);
+  for (i = 0; i < nthreads; i++) {
+    req = malloc(sizeof(*req));
+    ASSERT(req != NULL);
+    ASSERT(0 == uv_queue_work(uv_default_loop(),
+                              req,
+                              blocked_work_cb,
+                              blocked_done_cb));
+  }
+
+  for (i = 0; i < nthreads; i++)
+    uv_sem_wait(&started_sem);
+
+  /* File system requests should still make progress. */
+  ASSERT(0 == uv_fs_stat(uv_default_loop(), &stat_req, ".", stat_cb));
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT(stat_cb_called == 1);
+  ASSERT(blocked_work_cb_called == nthreads);
+  ASSERT(blocked_done_cb_called == nthreads);
+
+  uv_mutex_destroy(&wait_mutex);
+  uv_sem_destroy(&started_sem);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
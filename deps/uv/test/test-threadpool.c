@@ -75,3 +75,43 @@ TEST_IMPL(threadpool_queue_work_einval) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static void timed_work_cb(uv_work_t* req) {
+  uv_sleep(10);
+}
+
+
+static void timed_after_work_cb(uv_work_t* req, int status) {
+  uv_work_times_t times;
+
+  ASSERT(status == 0);
+  ASSERT(0 == uv_work_times((uv_req_t*) req, &times));
+  ASSERT(times.submitted > 0);
+  ASSERT(times.started >= times.submitted);
+  ASSERT(times.finished >= times.started + 10 * 1000000);
+  ASSERT(uv_hrtime() >= times.finished);
+  after_work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_work_times) {
+  uv_work_times_t times;
+  uv_req_t other_req;
+  int r;
+
+  after_work_cb_count = 0;
+  r = uv_queue_work(uv_default_loop(),
+                    &work_req,
+                    timed_work_cb,
+                    timed_after_work_cb);
+  ASSERT(r == 0);
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+  ASSERT(after_work_cb_count == 1);
+
+  other_req.type = UV_WRITE;
+  ASSERT(-1 == uv_work_times(&other_req, &times));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
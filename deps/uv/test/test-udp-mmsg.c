@@ -0,0 +1,163 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#define NUM_DGRAMS 32
+#define SLOT_SIZE 64
+#define BATCH_SIZE 16
+
+static uv_udp_t server;
+static uv_udp_t client;
+static uv_udp_send_t send_reqs[NUM_DGRAMS];
+static char payloads[NUM_DGRAMS][SLOT_SIZE * 2];
+static char slab[SLOT_SIZE * BATCH_SIZE];
+
+static int send_cb_called;
+static int recv_cb_called;
+static int chunk_cb_called;
+static int free_cb_called;
+static int partial_cb_called;
+static int close_cb_called;
+
+
+static uv_buf_t alloc_cb(uv_handle_t* handle, size_t suggested_size) {
+  ASSERT(handle == (uv_handle_t*) &server);
+#if defined(__linux__)
+  ASSERT(suggested_size == sizeof(slab));
+#endif
+  return uv_buf_init(slab, sizeof(slab));
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void send_cb(uv_udp_send_t* req, int status) {
+  ASSERT(status == 0);
+  send_cb_called++;
+}
+
+
+static void recv_cb(uv_udp_t* handle,
+                    ssize_t nread,
+                    uv_buf_t buf,
+                    struct sockaddr* addr,
+                    unsigned flags) {
+  ASSERT(handle == &server);
+  ASSERT(nread >= 0);
+
+  if (flags & UV_UDP_MMSG_FREE) {
+    ASSERT(nread == 0);
+    ASSERT(addr == NULL);
+    ASSERT(buf.base == slab);
+    ASSERT(buf.len > 0 && buf.len <= sizeof(slab));
+    free_cb_called++;
+    return;
+  }
+
+  if (nread == 0) {
+    ASSERT(addr == NULL);
+    return;
+  }
+
+  ASSERT(addr != NULL);
+  ASSERT(buf.base[0] == 'P');
+  recv_cb_called++;
+
+  if (flags & UV_UDP_MMSG_CHUNK) {
+    /* Every datagram starts at a slot boundary of the shared buffer. */
+    ASSERT((buf.base - slab) % SLOT_SIZE == 0);
+    ASSERT(nread <= SLOT_SIZE);
+    chunk_cb_called++;
+  }
+
+  if (flags & UV_UDP_PARTIAL)
+    partial_cb_called++;
+
+  if (recv_cb_called == NUM_DGRAMS) {
+    uv_close((uv_handle_t*) &server, close_cb);
+    uv_close((uv_handle_t*) &client, close_cb);
+  }
+}
+
+
+TEST_IMPL(udp_mmsg) {
+  struct sockaddr_in addr;
+  uv_buf_t buf;
+  int i;
+
+  addr = uv_ip4_addr("0.0.0.0", TEST_PORT);
+  ASSERT(0 == uv_udp_init(uv_default_loop(), &server));
+  ASSERT(0 == uv_udp_bind(&server, addr, 0));
+  ASSERT(0 == uv_udp_set_recv_batch(&server, BATCH_SIZE, SLOT_SIZE));
+  ASSERT(0 == uv_udp_recv_start(&server, alloc_cb, recv_cb));
+
+  /* All datagrams are queued before the loop runs, they go out together. */
+  addr = uv_ip4_addr("127.0.0.1", TEST_PORT);
+  ASSERT(0 == uv_udp_init(uv_default_loop(), &client));
+
+  for (i = 0; i < NUM_DGRAMS; i++) {
+    memset(payloads[i], 'P', sizeof(payloads[i]));
+    /* The last one doesn't fit in a slot. */
+    buf = uv_buf_init(payloads[i], i == NUM_DGRAMS - 1 ? SLOT_SIZE * 2 : 4);
+    ASSERT(0 == uv_udp_send(&send_reqs[i], &client, &buf, 1, addr, send_cb));
+  }
+
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+
+  ASSERT(send_cb_called == NUM_DGRAMS);
+  ASSERT(recv_cb_called == NUM_DGRAMS);
+  ASSERT(close_cb_called == 2);
+
+#if defined(__linux__)
+  ASSERT(chunk_cb_called == NUM_DGRAMS);
+  ASSERT(partial_cb_called == 1);
+  ASSERT(free_cb_called >= NUM_DGRAMS / BATCH_SIZE);
+#else
+  ASSERT(chunk_cb_called == 0);
+  ASSERT(free_cb_called == 0);
+#endif
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(udp_mmsg_einval) {
+  uv_udp_t handle;
+
+  ASSERT(0 == uv_udp_init(uv_default_loop(), &handle));
+  ASSERT(-1 == uv_udp_set_recv_batch(&handle, BATCH_SIZE, 0));
+  ASSERT(uv_last_error(uv_default_loop()).code == UV_EINVAL);
+  ASSERT(0 == uv_udp_set_recv_batch(&handle, 0, 0));
+
+  uv_close((uv_handle_t*) &handle, NULL);
+  uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
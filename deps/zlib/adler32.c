@@ -7,6 +7,7 @@
 
 #define ZLIB_INTERNAL
 #include "zlib.h"
+#include "simd.h"       /* Node */
 
 #define BASE 65521UL    /* largest prime smaller than 65536 */
 #define NMAX 5552
@@ -81,6 +82,12 @@ uLong ZEXPORT adler32(adler, buf, len)
     if (buf == Z_NULL)
         return 1L;
 
+#ifdef Z_SIMD_X86
+    /* Node: 32 bytes at a time with SSSE3 */
+    if (len >= Z_ADLER32_SIMD_MIN && (_zsimd_features() & Z_SIMD_SSSE3))
+        return _adler32_ssse3(adler | (sum2 << 16), buf, len);
+#endif /* Z_SIMD_X86 */
+
     /* in case short lengths are provided, keep it somewhat fast */
     if (len < 16) {
         while (len--) {
@@ -27,6 +27,7 @@
 #endif /* MAKECRCH */
 
 #include "zutil.h"      /* for STDC and FAR definitions */
+#include "simd.h"       /* Node */
 
 #define local static
 
@@ -228,6 +229,17 @@ unsigned long ZEXPORT crc32(crc, buf, len)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef Z_SIMD_X86
+    /* Node: fold whole blocks of 16 with PCLMULQDQ, the tables do the rest */
+    if (len >= Z_CRC32_SIMD_MIN && (_zsimd_features() & Z_SIMD_PCLMUL)) {
+        unsigned chunk = len & ~15U;
+        crc = _crc32_pclmul(crc, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+        if (len == 0) return crc;
+    }
+#endif /* Z_SIMD_X86 */
+
 #ifdef BYFOUR
     if (sizeof(void *) == sizeof(ptrdiff_t)) {
         u4 endian;
@@ -93,6 +93,16 @@ local uInt longest_match  OF((deflate_state *s, IPos cur_match));
 #endif
 local uInt longest_match_fast OF((deflate_state *s, IPos cur_match));
 
+/* Node: where unaligned 64 bit loads are cheap, extend matches 8 bytes at a
+ * time and find the first differing byte from the xor of the two words.
+ */
+#if defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)) && \
+    defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define MATCH_WORDS
+local Bytef *match_end OF((Bytef *scan, Bytef *match, Bytef *strend));
+#endif
+
 #ifdef DEBUG
 local  void check_match OF((deflate_state *s, IPos start, IPos match,
                             int length));
@@ -1132,6 +1142,9 @@ local uInt longest_match(s, cur_match)
         scan += 2, match++;
         Assert(*scan == *match, "match[2]?");
 
+#ifdef MATCH_WORDS
+        scan = match_end(scan, match, strend);
+#else
         /* We check for insufficient lookahead only every 8th comparison;
          * the 256th check will be made at strstart+258.
          */
@@ -1141,6 +1154,7 @@ local uInt longest_match(s, cur_match)
                  *++scan == *++match && *++scan == *++match &&
                  *++scan == *++match && *++scan == *++match &&
                  scan < strend);
+#endif
 
         Assert(scan <= s->window+(unsigned)(s->window_size-1), "wild scan");
 
@@ -1205,6 +1219,9 @@ local uInt longest_match_fast(s, cur_match)
     scan += 2, match += 2;
     Assert(*scan == *match, "match[2]?");
 
+#ifdef MATCH_WORDS
+    scan = match_end(scan, match, strend);
+#else
     /* We check for insufficient lookahead only every 8th comparison;
      * the 256th check will be made at strstart+258.
      */
@@ -1214,6 +1231,7 @@ local uInt longest_match_fast(s, cur_match)
              *++scan == *++match && *++scan == *++match &&
              *++scan == *++match && *++scan == *++match &&
              scan < strend);
+#endif
 
     Assert(scan <= s->window+(unsigned)(s->window_size-1), "wild scan");
 
@@ -1225,6 +1243,34 @@ local uInt longest_match_fast(s, cur_match)
     return (uInt)len <= s->lookahead ? (uInt)len : s->lookahead;
 }
 
+#ifdef MATCH_WORDS
+/* ---------------------------------------------------------------------------
+ * Return the first position at or after scan where scan and match differ,
+ * or strend if they don't. scan starts at strstart+2, so the last word read
+ * ends at strstart+257 and never goes past strend.
+ */
+local Bytef *match_end(scan, match, strend)
+    Bytef *scan;
+    Bytef *match;
+    Bytef *strend;
+{
+    unsigned long long sv, mv, diff;
+
+    while (scan < strend) {
+        __builtin_memcpy(&sv, scan, sizeof(sv));
+        __builtin_memcpy(&mv, match, sizeof(mv));
+        diff = sv ^ mv;
+        if (diff != 0) {
+            scan += __builtin_ctzll(diff) >> 3;
+            return scan < strend ? scan : strend;
+        }
+        scan += sizeof(sv);
+        match += sizeof(mv);
+    }
+    return strend;
+}
+#endif /* MATCH_WORDS */
+
 #ifdef DEBUG
 /* ===========================================================================
  * Check that the match at match_start is indeed a match.
@@ -0,0 +1,248 @@
+/* simd.c -- SSE versions of crc32() and adler32(), picked at run time
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * Node: not part of the zlib distribution.
+ *
+ * The CRC-32 folds 64 bytes at a time with carry-less multiplication, as
+ * described in "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+ * Instruction" by Gopal, Ozturk, Guilford et al., Intel, 2009.  The constants
+ * are the bit-reflected ones for the gzip polynomial given at the end of the
+ * paper.  Note that the SSE4.2 crc32 instruction is of no use here, it
+ * computes the Castagnoli CRC and not the one gzip uses.
+ *
+ * The Adler-32 sums 32 bytes at a time: psadbw adds up the bytes for s1,
+ * pmaddubsw weighs them by their distance from the end of the block for s2.
+ */
+
+#include "zutil.h"
+#include "simd.h"
+
+#ifdef Z_SIMD_X86
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define BASE 65521UL    /* largest prime smaller than 65536 */
+#define NMAX 5552
+
+#define TARGET_PCLMUL __attribute__((target("sse2,pclmul")))
+#define TARGET_SSSE3  __attribute__((target("ssse3")))
+
+/* ========================================================================= */
+local int detect_features()
+{
+    unsigned eax, ebx, ecx, edx;
+    int features = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+    if (ecx & (1 << 1))
+        features |= Z_SIMD_PCLMUL;
+    if (ecx & (1 << 9))
+        features |= Z_SIMD_SSSE3;
+    return features;
+}
+
+/* Worst case two threads race to store the same value. */
+int _zsimd_features()
+{
+    static int features = -1;
+    if (features == -1)
+        features = detect_features();
+    return features;
+}
+
+/* ========================================================================= */
+TARGET_PCLMUL
+uLong _crc32_pclmul(crc, buf, len)
+    uLong crc;
+    const Bytef *buf;
+    uInt len;
+{
+    static const unsigned long long k1k2[2] __attribute__((aligned(16))) =
+        { 0x0154442bd4ULL, 0x01c6e41596ULL };
+    static const unsigned long long k3k4[2] __attribute__((aligned(16))) =
+        { 0x01751997d0ULL, 0x00ccaa009eULL };
+    static const unsigned long long k5k0[2] __attribute__((aligned(16))) =
+        { 0x0163cd6124ULL, 0x0000000000ULL };
+    static const unsigned long long poly[2] __attribute__((aligned(16))) =
+        { 0x01db710641ULL, 0x01f7011641ULL };
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    /* at least one block of 64 */
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)(crc ^ 0xffffffffUL)));
+
+    x0 = _mm_load_si128((const __m128i *)k1k2);
+
+    buf += 64;
+    len -= 64;
+
+    /* fold four blocks of 16 in parallel */
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        len -= 64;
+    }
+
+    /* fold the four into one */
+    x0 = _mm_load_si128((const __m128i *)k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* fold in the remaining blocks of 16 one at a time */
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    /* 128 bits down to 64 */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_load_si128((const __m128i *)poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uLong)(unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)) ^
+           0xffffffffUL;
+}
+
+/* ========================================================================= */
+TARGET_SSSE3
+uLong _adler32_ssse3(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    unsigned blocks = len / 32;
+    unsigned n;
+    __m128i tap1, tap2, zero, ones, v_ps, v_s1, v_s2, bytes1, bytes2;
+
+    tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                         24, 23, 22, 21, 20, 19, 18, 17);
+    tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                         8, 7, 6, 5, 4, 3, 2, 1);
+    zero = _mm_setzero_si128();
+    ones = _mm_set1_epi16(1);
+
+    len -= blocks * 32;
+
+    while (blocks) {
+        /* no more than NMAX bytes between reductions modulo BASE */
+        n = NMAX / 32;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+
+        /* v_ps collects s1 as it was before each block, it gets multiplied
+         * by the block size for s2 at the end.
+         */
+        v_ps = _mm_setr_epi32((int)(s1 * n), 0, 0, 0);
+        v_s2 = _mm_setr_epi32((int)s2, 0, 0, 0);
+        v_s1 = _mm_setzero_si128();
+
+        do {
+            bytes1 = _mm_loadu_si128((const __m128i *)buf);
+            bytes2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+
+            buf += 32;
+        } while (--n);
+
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        v_s1 = _mm_add_epi32(v_s1,
+                             _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (unsigned)_mm_cvtsi128_si32(v_s1);
+
+        v_s2 = _mm_add_epi32(v_s2,
+                             _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+        v_s2 = _mm_add_epi32(v_s2,
+                             _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s2 = (unsigned)_mm_cvtsi128_si32(v_s2);
+
+        s1 %= BASE;
+        s2 %= BASE;
+    }
+
+    /* fewer than 32 bytes left */
+    if (len) {
+        while (len--) {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        if (s1 >= BASE)
+            s1 -= BASE;
+        s2 %= BASE;
+    }
+
+    return s1 | (s2 << 16);
+}
+
+#endif /* Z_SIMD_X86 */
@@ -0,0 +1,43 @@
+/* simd.h -- SSE versions of crc32() and adler32(), picked at run time
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * Node: not part of the zlib distribution.
+ */
+
+#ifndef ZSIMD_H
+#define ZSIMD_H
+
+#include "zlib.h"
+
+/* The kernels are compiled with target attributes, so the rest of zlib
+ * doesn't have to be built for a newer CPU than it runs on.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    ((defined(__GNUC__) && !defined(__clang__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || \
+     (defined(__clang__) && \
+      (__clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+#  define Z_SIMD_X86
+#endif
+
+#ifdef Z_SIMD_X86
+
+#define Z_SIMD_PCLMUL 1
+#define Z_SIMD_SSSE3  2
+
+/* Shortest input worth handing to the SIMD code. */
+#define Z_CRC32_SIMD_MIN   64
+#define Z_ADLER32_SIMD_MIN 64
+
+/* Z_SIMD_* bits of the features this CPU has. */
+int _zsimd_features OF((void));
+
+/* crc32() of len bytes, len a multiple of 16 and at least 64. */
+uLong _crc32_pclmul OF((uLong crc, const Bytef *buf, uInt len));
+
+/* adler32() of any number of bytes. */
+uLong _adler32_ssse3 OF((uLong adler, const Bytef *buf, uInt len));
+
+#endif /* Z_SIMD_X86 */
+
+#endif /* ZSIMD_H */
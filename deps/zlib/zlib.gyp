@@ -37,6 +37,8 @@
             'inftrees.c',
             'inftrees.h',
             'mozzconf.h',
+            'simd.c',
+            'simd.h',
             'trees.c',
             'trees.h',
             'uncompr.c',
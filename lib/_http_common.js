@@ -50,7 +50,9 @@ function parserOnHeaders(headers, url) {
 }
 
 // info.headers and info.url are set only if .onHeaders()
-// has not been called for this request.
+// has not been called for this request. Our parsers are created
+// with headersObject set, so info.headers is the finished headers
+// object in that case.
 //
 // info.url is not set for response parsers but that's not
 // applicable here since all our parsers are request parsers.
@@ -75,17 +77,22 @@ function parserOnHeadersComplete(info) {
   parser.incoming.httpVersion = info.versionMajor + '.' + info.versionMinor;
   parser.incoming.url = url;
 
-  var n = headers.length;
+  if (!Array.isArray(headers)) {
+    // Merged and capped at maxHeaderPairs by the parser already.
+    parser.incoming.headers = headers;
+  } else {
+    var n = headers.length;
 
-  // If parser.maxHeaderPairs <= 0 - assume that there're no limit
-  if (parser.maxHeaderPairs > 0) {
-    n = Math.min(n, parser.maxHeaderPairs);
-  }
+    // If parser.maxHeaderPairs <= 0 - assume that there're no limit
+    if (parser.maxHeaderPairs > 0) {
+      n = Math.min(n, parser.maxHeaderPairs);
+    }
 
-  for (var i = 0; i < n; i += 2) {
-    var k = headers[i];
-    var v = headers[i + 1];
-    parser.incoming._addHeaderLine(k, v);
+    for (var i = 0; i < n; i += 2) {
+      var k = headers[i];
+      var v = headers[i + 1];
+      parser.incoming._addHeaderLine(k, v);
+    }
   }
 
 
@@ -167,9 +174,36 @@ function parserOnMessageComplete() {
   }
 }
 
+// Request parsers with an onBatch callback call it once at the end of
+// execute() with everything that happened in between, rather than
+// calling onHeadersComplete, onBody and onMessageComplete for every
+// message. Cuts down on calls into JS for pipelined requests.
+var kOnHeadersComplete = HTTPParser.kOnHeadersComplete;
+var kOnBody = HTTPParser.kOnBody;
+var kOnMessageComplete = HTTPParser.kOnMessageComplete;
+
+function parserOnBatch(b, entries, count) {
+  var i = 0;
+  while (i < count) {
+    switch (entries[i++]) {
+      case kOnHeadersComplete:
+        parserOnHeadersComplete.call(this, entries[i++]);
+        break;
+      case kOnBody:
+        parserOnBody.call(this, b, entries[i], entries[i + 1]);
+        i += 2;
+        break;
+      case kOnMessageComplete:
+        parserOnMessageComplete.call(this);
+        break;
+    }
+  }
+}
+exports.parserOnBatch = parserOnBatch;
+
 
 var parsers = new FreeList('parsers', 1000, function() {
-  var parser = new HTTPParser(HTTPParser.REQUEST);
+  var parser = new HTTPParser(HTTPParser.REQUEST, true);
 
   parser._headers = [];
   parser._url = '';
@@ -200,6 +234,7 @@ function freeParser(parser, req) {
   if (parser) {
     parser._headers = [];
     parser.onIncoming = null;
+    parser.onBatch = null;
     if (parser.socket) {
       parser.socket.onend = null;
       parser.socket.ondata = null;
@@ -30,6 +30,10 @@ var chunkExpression = common.chunkExpression;
 var continueExpression = common.continueExpression;
 var debug = common.debug;
 
+var binding = process.binding('http_parser');
+var writeHeaderBlock = binding.writeHeaderBlock;
+var headerBlockResult = [0];
+
 
 var connectionExpression = /Connection/i;
 var transferEncodingExpression = /Transfer-Encoding/i;
@@ -188,6 +192,30 @@ OutgoingMessage.prototype._buffer = function(data, encoding) {
 OutgoingMessage.prototype._storeHeader = function(firstLine, headers) {
   // firstLine in the case of request is: 'GET /index.html HTTP/1.1\r\n'
   // in the case of response it is: 'HTTP/1.1 200 OK\r\n'
+  var keys = headers ? Object.keys(headers) : [];
+  var isArray = Array.isArray(headers);
+  var sendDate = this.sendDate == true;
+
+  // The native version does the same as the loop below in one go, unless
+  // there's something other than ASCII strings and numbers.
+  var block = writeHeaderBlock(firstLine, headers, keys, isArray, sendDate,
+                               headerBlockResult);
+  if (block !== undefined) {
+    var flags = headerBlockResult[0];
+    if (flags & binding.kSetLast) this._last = true;
+    if (flags & binding.kSetKeepAlive) this.shouldKeepAlive = true;
+    if (flags & binding.kSetChunked) this.chunkedEncoding = true;
+    this._storeHeaderEnd({
+      sentConnectionHeader: !!(flags & binding.kSentConnection),
+      sentContentLengthHeader: !!(flags & binding.kSentContentLength),
+      sentTransferEncodingHeader: !!(flags & binding.kSentTransferEncoding),
+      sentDateHeader: !!(flags & binding.kSentDate),
+      sentExpect: !!(flags & binding.kSentExpect),
+      messageHeader: block
+    });
+    return;
+  }
+
   var state = {
     sentConnectionHeader: false,
     sentContentLengthHeader: false,
@@ -198,13 +226,8 @@ OutgoingMessage.prototype._storeHeader = function(firstLine, headers) {
   };
 
   var field, value;
-  var self = this;
 
   if (headers) {
-    var keys = Object.keys(headers);
-    var isArray = (Array.isArray(headers));
-    var field, value;
-
     for (var i = 0, l = keys.length; i < l; i++) {
       var key = keys[i];
       if (isArray) {
@@ -226,10 +249,14 @@ OutgoingMessage.prototype._storeHeader = function(firstLine, headers) {
   }
 
   // Date header
-  if (this.sendDate == true && state.sentDateHeader == false) {
+  if (sendDate && state.sentDateHeader == false) {
     state.messageHeader += 'Date: ' + utcDate() + CRLF;
   }
 
+  this._storeHeaderEnd(state);
+};
+
+OutgoingMessage.prototype._storeHeaderEnd = function(state) {
   // Force the connection to close when the response is a 204 No Content or
   // a 304 Not Modified and the user has set a "Transfer-Encoding: chunked"
   // header.
@@ -458,6 +485,30 @@ OutgoingMessage.prototype.addTrailers = function(headers) {
 };
 
 
+// Lets fs.ReadStream's pipe() send a file with sendfile. Only works when
+// the body isn't chunked, see net.Socket#_sendFile for the contract.
+OutgoingMessage.prototype._sendFile = function(fd, position, length, cb) {
+  if (!this._header) {
+    this._implicitHeader();
+  }
+
+  if (this.chunkedEncoding || !this._hasBody || this.finished)
+    return false;
+
+  var conn = this.connection;
+  if (!conn || conn._httpMessage !== this || !conn._sendFile)
+    return false;
+
+  // Get the headers and anything that was written out before the file.
+  if (!this._headerSent)
+    this._send('');
+  if (this.output.length > 0)
+    return false;
+
+  return conn._sendFile(fd, position, length, cb);
+};
+
+
 var zero_chunk_buf = new Buffer('\r\n0\r\n');
 var crlf_buf = new Buffer('\r\n');
 
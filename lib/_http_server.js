@@ -31,6 +31,7 @@ var emptyBuffer = new Buffer(0);
 var common = require('_http_common');
 var parsers = common.parsers;
 var freeParser = common.freeParser;
+var parserOnBatch = common.parserOnBatch;
 var debug = common.debug;
 var CRLF = common.CRLF;
 var continueExpression = common.continueExpression;
@@ -326,6 +327,8 @@ function connectionListener(socket) {
   parser.socket = socket;
   socket.parser = parser;
   parser.incoming = null;
+  // Requests that come in together are dispatched together.
+  parser.onBatch = parserOnBatch;
 
   // Propagate headers limit from server instance to parser
   if (typeof this.maxHeadersCount === 'number') {
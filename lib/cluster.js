@@ -228,6 +228,11 @@ function masterInit() {
   // itself so we might end up with an O(n*m) operation. Ergo, FIXME.
   var handles = {};
 
+  // What the TLS servers in the workers share, keyed on the server's
+  // certificate and session id context: the session ticket keys, oldest
+  // first, and the workers that get new sessions and keys.
+  var tlsContexts = {};
+
   var initialized = false;
   cluster.setupMaster = function(options) {
     if (initialized === true) return;
@@ -307,6 +312,9 @@ function masterInit() {
       var handle = handles[key];
       if (handle.remove(worker)) delete handles[key];
     }
+    for (var key in tlsContexts) {
+      delete tlsContexts[key].workers[worker.id];
+    }
     if (Object.keys(handles).length === 0) {
       intercom.emit('disconnect');
     }
@@ -340,6 +348,10 @@ function masterInit() {
       worker.suicide = true;
     else if (message.act === 'close')
       close(worker, message);
+    else if (message.act === 'tlsContext')
+      tlsContext(worker, message);
+    else if (message.act === 'tlsSession')
+      tlsSession(worker, message);
   }
 
   function online(worker) {
@@ -401,6 +413,43 @@ function masterInit() {
     if (handle.remove(worker)) delete handles[key];
   }
 
+  function tlsContext(worker, message) {
+    var key = message.key;
+    var context = tlsContexts[key];
+    if (typeof context === 'undefined') {
+      context = tlsContexts[key] = { keys: [newTicketKey()], workers: {} };
+      if (message.rotation > 0) {
+        var timer = setInterval(rotate, message.rotation);
+        timer.unref();
+      }
+    }
+    context.workers[worker.id] = worker;
+    send(worker, { ack: message.seq, keys: context.keys });
+
+    function rotate() {
+      var ticketKey = newTicketKey();
+      context.keys = [context.keys[context.keys.length - 1], ticketKey];
+      for (var id in context.workers) {
+        send(context.workers[id],
+             { act: 'tlsTicketKeys', key: key, keys: [ticketKey] });
+      }
+    }
+  }
+
+  function newTicketKey() {
+    return require('crypto').randomBytes(48).toString('base64');
+  }
+
+  function tlsSession(worker, message) {
+    var context = tlsContexts[message.key];
+    if (typeof context === 'undefined') return;
+    for (var id in context.workers) {
+      if (context.workers[id] === worker) continue;
+      send(context.workers[id],
+           { act: 'tlsSession', key: message.key, data: message.data });
+    }
+  }
+
   function send(worker, message, handle, cb) {
     sendHelper(worker.process, message, handle, cb);
   }
@@ -410,6 +459,9 @@ function masterInit() {
 function workerInit() {
   var handles = {};
 
+  // SecureContexts of TLS servers, keyed like in the master.
+  var tlsContexts = {};
+
   // Called from src/node.js
   cluster._setupWorker = function() {
     var worker = new Worker;
@@ -425,9 +477,59 @@ function workerInit() {
         onconnection(message, handle);
       else if (message.act === 'disconnect')
         worker.disconnect();
+      else if (message.act === 'tlsSession')
+        addTLSSession(message);
+      else if (message.act === 'tlsTicketKeys')
+        setTLSTicketKeys(message);
     }
   };
 
+  // Called from lib/tls.js. New sessions and ticket keys for `context`
+  // come from the master from now on.
+  cluster._addTLSContext = function(key, context, rotation) {
+    if (typeof tlsContexts[key] === 'undefined') tlsContexts[key] = [];
+    tlsContexts[key].push(context);
+
+    var message = { act: 'tlsContext', key: key, rotation: rotation };
+    send(message, function(reply) {
+      reply.keys.forEach(function(ticketKey) {
+        context.setTicketKeys(new Buffer(ticketKey, 'base64'));
+      });
+    });
+  };
+
+  cluster._removeTLSContext = function(key, context) {
+    var contexts = tlsContexts[key];
+    if (typeof contexts === 'undefined') return;
+    var index = contexts.indexOf(context);
+    if (index !== -1) contexts.splice(index, 1);
+    if (contexts.length === 0) delete tlsContexts[key];
+  };
+
+  cluster._shareTLSSession = function(key, data) {
+    send({ act: 'tlsSession', key: key, data: data.toString('base64') });
+  };
+
+  function addTLSSession(message) {
+    var contexts = tlsContexts[message.key];
+    if (typeof contexts === 'undefined') return;
+    var data = new Buffer(message.data, 'base64');
+    contexts.forEach(function(context) {
+      context.addSession(data);
+    });
+  }
+
+  function setTLSTicketKeys(message) {
+    var contexts = tlsContexts[message.key];
+    if (typeof contexts === 'undefined') return;
+    message.keys.forEach(function(ticketKey) {
+      var buf = new Buffer(ticketKey, 'base64');
+      contexts.forEach(function(context) {
+        context.setTicketKeys(buf);
+      });
+    });
+  }
+
   // obj is a net#Server or a dgram#Socket object.
   cluster._getServer = function(obj, address, port, addressType, fd, cb) {
     var message = {
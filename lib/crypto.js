@@ -181,6 +181,67 @@ util.inherits(LazyTransform, stream.Transform);
 });
 
 
+// With the `async` option, chunks of at least this many bytes that are
+// written to the streams of Hash, Hmac, Cipher and Sign are processed on
+// the thread pool. Once one is, the rest of the stream goes there too so
+// that the order is kept.
+exports.ASYNC_THRESHOLD = 64 * 1024;
+
+// How many chunks a Transform may have on the thread pool before it stops
+// taking more.
+var ASYNC_QUEUE_LIMIT = 4;
+
+
+function AsyncState(limit) {
+  this.limit = limit;
+  this.pending = 0;
+  this.waiting = null;
+}
+
+
+function useAsync(self, chunk, limit) {
+  if (self._asyncState)
+    return true;
+  if (!self._options || !self._options.async)
+    return false;
+  if (chunk.length < exports.ASYNC_THRESHOLD)
+    return false;
+  self._asyncState = new AsyncState(limit);
+  return true;
+}
+
+
+// Queues `chunk` on the thread pool. `callback` runs right away while
+// fewer than `limit` chunks are pending, or else once one of them is done.
+// `onoutput` gets what the update produced, if anything.
+function updateAsync(self, chunk, encoding, callback, onoutput) {
+  var state = self._asyncState;
+
+  if (typeof chunk === 'string')
+    chunk = toBuf(chunk, encoding);
+
+  state.pending++;
+  self._binding.updateAsync(chunk, function(err, out) {
+    state.pending--;
+
+    if (!err && out && onoutput)
+      onoutput.call(self, out);
+
+    var cb = state.waiting;
+    state.waiting = null;
+    if (cb)
+      cb(err);
+    else if (err)
+      self.emit('error', err);
+  });
+
+  if (state.pending < state.limit)
+    callback();
+  else
+    state.waiting = callback;
+}
+
+
 exports.createHash = exports.Hash = Hash;
 function Hash(algorithm, options) {
   if (!(this instanceof Hash))
@@ -192,14 +253,30 @@ function Hash(algorithm, options) {
 util.inherits(Hash, LazyTransform);
 
 Hash.prototype._transform = function(chunk, encoding, callback) {
+  if (useAsync(this, chunk, ASYNC_QUEUE_LIMIT))
+    return updateAsync(this, chunk, encoding, callback, null);
+
   this._binding.update(chunk, encoding);
   callback();
 };
 
 Hash.prototype._flush = function(callback) {
   var encoding = this._readableState.encoding || 'buffer';
-  this.push(this._binding.digest(encoding), encoding);
-  callback();
+
+  if (!this._asyncState) {
+    this.push(this._binding.digest(encoding), encoding);
+    return callback();
+  }
+
+  var self = this;
+  this._binding.digestAsync(function(err, digest) {
+    if (err)
+      return callback(err);
+    if (encoding !== 'buffer')
+      digest = digest.toString(encoding);
+    self.push(digest, encoding);
+    callback();
+  });
 };
 
 Hash.prototype.update = function(data, encoding) {
@@ -235,6 +312,27 @@ Hmac.prototype._flush = Hash.prototype._flush;
 Hmac.prototype._transform = Hash.prototype._transform;
 
 
+// One-shot versions of createHash(algorithm).update(data).digest() and
+// the same for Hmac, without the objects for small inputs.
+exports.hash = function(algorithm, data, inputEncoding, outputEncoding) {
+  inputEncoding = inputEncoding || exports.DEFAULT_ENCODING;
+  if (inputEncoding === 'buffer' && typeof data === 'string')
+    inputEncoding = 'binary';
+  outputEncoding = outputEncoding || exports.DEFAULT_ENCODING;
+  return binding.hash(algorithm, data, inputEncoding, outputEncoding);
+};
+
+
+exports.hmac = function(algorithm, key, data, inputEncoding, outputEncoding) {
+  inputEncoding = inputEncoding || exports.DEFAULT_ENCODING;
+  if (inputEncoding === 'buffer' && typeof data === 'string')
+    inputEncoding = 'binary';
+  outputEncoding = outputEncoding || exports.DEFAULT_ENCODING;
+  return binding.hmac(algorithm, toBuf(key), data, inputEncoding,
+                      outputEncoding);
+};
+
+
 function getDecoder(decoder, encoding) {
   decoder = decoder || new StringDecoder(encoding);
   assert(decoder.encoding === encoding, 'Cannot change encoding');
@@ -257,13 +355,26 @@ function Cipher(cipher, password, options) {
 util.inherits(Cipher, LazyTransform);
 
 Cipher.prototype._transform = function(chunk, encoding, callback) {
+  if (useAsync(this, chunk, ASYNC_QUEUE_LIMIT))
+    return updateAsync(this, chunk, encoding, callback, this.push);
+
   this.push(this._binding.update(chunk, encoding));
   callback();
 };
 
 Cipher.prototype._flush = function(callback) {
-  this.push(this._binding.final());
-  callback();
+  if (!this._asyncState) {
+    this.push(this._binding.final());
+    return callback();
+  }
+
+  var self = this;
+  this._binding.finalAsync(function(err, out) {
+    if (err)
+      return callback(err);
+    self.push(out);
+    callback();
+  });
 };
 
 Cipher.prototype.update = function(data, inputEncoding, outputEncoding) {
@@ -374,6 +485,7 @@ function Sign(algorithm, options) {
     return new Sign(algorithm, options);
   this._binding = new binding.Sign();
   this._binding.init(algorithm);
+  this._options = options;
 
   stream.Writable.call(this, options);
 }
@@ -381,20 +493,41 @@ function Sign(algorithm, options) {
 util.inherits(Sign, stream.Writable);
 
 Sign.prototype._write = function(chunk, encoding, callback) {
+  // One chunk at a time, sign() can follow 'finish' right away then.
+  if (this instanceof Sign && useAsync(this, chunk, 1))
+    return updateAsync(this, chunk, encoding, callback, null);
+
   this._binding.update(chunk, encoding);
   callback();
 };
 
 Sign.prototype.update = Hash.prototype.update;
 
-Sign.prototype.sign = function(key, encoding) {
+Sign.prototype.sign = function(key, encoding, callback) {
+  if (typeof encoding === 'function') {
+    callback = encoding;
+    encoding = null;
+  }
   encoding = encoding || exports.DEFAULT_ENCODING;
-  var ret = this._binding.sign(toBuf(key));
 
-  if (encoding && encoding !== 'buffer')
-    ret = ret.toString(encoding);
+  if (typeof callback !== 'function') {
+    var ret = this._binding.sign(toBuf(key));
 
-  return ret;
+    if (encoding && encoding !== 'buffer')
+      ret = ret.toString(encoding);
+
+    return ret;
+  }
+
+  this._binding.signAsync(toBuf(key), function(err, ret) {
+    if (err)
+      return callback(err);
+
+    if (encoding && encoding !== 'buffer')
+      ret = ret.toString(encoding);
+
+    callback(null, ret);
+  });
 };
 
 
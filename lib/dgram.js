@@ -29,6 +29,9 @@ var BIND_STATE_UNBOUND = 0;
 var BIND_STATE_BINDING = 1;
 var BIND_STATE_BOUND = 2;
 
+// Slot size for batched receives when the user doesn't specify one.
+var RECV_BATCH_SIZE = 2048;
+
 // lazily loaded
 var cluster = null;
 var dns = null;
@@ -78,6 +81,7 @@ function newHandle(type) {
     handle.lookup = lookup6;
     handle.bind = handle.bind6;
     handle.send = handle.send6;
+    handle.sendMany = handle.sendMany6;
     return handle;
   }
 
@@ -114,6 +118,7 @@ function Socket(type, listener) {
 
   this._handle = handle;
   this._receiving = false;
+  this._recvBatch = null;
   this._bindState = BIND_STATE_UNBOUND;
   this.type = type;
   this.fd = null; // compatibility hack
@@ -132,6 +137,7 @@ exports.createSocket = function(type, listener) {
 
 function startListening(socket) {
   socket._handle.onmessage = onMessage;
+  socket._handle.onmessages = onMessages;
   // Todo: handle errors
   socket._handle.recvStart();
   socket._receiving = true;
@@ -147,8 +153,12 @@ function replaceHandle(self, newHandle) {
   newHandle.lookup = self._handle.lookup;
   newHandle.bind = self._handle.bind;
   newHandle.send = self._handle.send;
+  newHandle.sendMany = self._handle.sendMany;
   newHandle.owner = self;
 
+  if (self._recvBatch)
+    newHandle.setRecvBatch(self._recvBatch[0], self._recvBatch[1]);
+
   // Replace the existing handle by the handle we got from master.
   self._handle.close();
   self._handle = newHandle;
@@ -260,18 +270,8 @@ Socket.prototype.send = function(buffer,
   // If the socket hasn't been bound yet, push the outbound packet onto the
   // send queue and send after binding is complete.
   if (self._bindState != BIND_STATE_BOUND) {
-    // If the send queue hasn't been initialized yet, do it, and install an
-    // event handler that flushes the send queue after binding is done.
-    if (!self._sendQueue) {
-      self._sendQueue = [];
-      self.once('listening', function() {
-        // Flush the send queue.
-        for (var i = 0; i < self._sendQueue.length; i++)
-          self.send.apply(self, self._sendQueue[i]);
-        self._sendQueue = undefined;
-      });
-    }
-    self._sendQueue.push([buffer, offset, length, port, address, callback]);
+    enqueueSend(self, self.send,
+                [buffer, offset, length, port, address, callback]);
     return;
   }
 
@@ -306,6 +306,79 @@ function afterSend(status, handle, req, buffer) {
 }
 
 
+// Send every buffer as a datagram of its own. The datagrams go out together,
+// with a single system call where the platform supports it.
+Socket.prototype.sendMany = function(buffers, port, address, callback) {
+  var self = this;
+
+  if (!Array.isArray(buffers) || buffers.length === 0)
+    throw new TypeError('First argument must be a non-empty array.');
+
+  for (var i = 0; i < buffers.length; i++) {
+    if (!Buffer.isBuffer(buffers[i]))
+      throw new TypeError('First argument must be an array of buffers.');
+  }
+
+  callback = callback || noop;
+
+  self._healthCheck();
+
+  if (self._bindState == BIND_STATE_UNBOUND)
+    self.bind(0, null);
+
+  if (self._bindState != BIND_STATE_BOUND) {
+    enqueueSend(self, self.sendMany, [buffers, port, address, callback]);
+    return;
+  }
+
+  self._handle.lookup(address, function(err, ip) {
+    if (err) {
+      callback(err);
+      self.emit('error', err);
+    }
+    else if (self._handle) {
+      var req = self._handle.sendMany(buffers, port, ip);
+      if (req) {
+        req.oncomplete = afterSendMany;
+        req.cb = callback;
+      }
+      else {
+        var err = errnoException(process._errno, 'send');
+        process.nextTick(function() {
+          callback(err);
+        });
+      }
+    }
+  });
+};
+
+
+function afterSendMany(status, handle, req, buffers) {
+  if (status < 0)
+    req.cb(errnoException(process._errno, 'send'));
+  else
+    req.cb(null, buffers.length);
+}
+
+
+// Push an outbound request onto the send queue and send it after binding is
+// complete.
+function enqueueSend(self, fn, args) {
+  // If the send queue hasn't been initialized yet, do it, and install an
+  // event handler that flushes the send queue after binding is done.
+  if (!self._sendQueue) {
+    self._sendQueue = [];
+    self.once('listening', function() {
+      // Flush the send queue.
+      for (var i = 0; i < self._sendQueue.length; i++)
+        self._sendQueue[i][0].apply(self, self._sendQueue[i][1]);
+      self._sendQueue = undefined;
+    });
+  }
+  self._sendQueue.push([fn, args]);
+}
+
+
 Socket.prototype.close = function() {
   this._healthCheck();
   this._stopReceiving();
@@ -326,6 +399,26 @@ Socket.prototype.address = function() {
 };
 
 
+Socket.prototype.setRecvBatch = function(count, size) {
+  this._healthCheck();
+
+  if (typeof count !== 'number') {
+    throw new TypeError('Argument must be a number');
+  }
+
+  if (size === undefined)
+    size = RECV_BATCH_SIZE;
+  else if (typeof size !== 'number' || size <= 0)
+    throw new TypeError('Size must be a positive number');
+
+  if (this._handle.setRecvBatch(count, size)) {
+    throw errnoException(process._errno, 'setRecvBatch');
+  }
+
+  this._recvBatch = count > 1 ? [count, size] : null;
+};
+
+
 Socket.prototype.setBroadcast = function(arg) {
   if (this._handle.setBroadcast((arg) ? 1 : 0)) {
     throw errnoException(process._errno, 'setBroadcast');
@@ -424,6 +517,39 @@ function onMessage(handle, slab, start, len, rinfo) {
 }
 
 
+// A batch of datagrams from a single recvmmsg() call. offsets holds a start
+// and a length for every datagram.
+function onMessages(handle, slab, offsets, rinfos) {
+  var self = handle.owner;
+  var i;
+
+  for (i = 0; i < rinfos.length; i++)
+    rinfos[i].size = offsets[i * 2 + 1]; // compatibility
+
+  if (events.EventEmitter.listenerCount(self, 'messages') > 0) {
+    var first = offsets[0];
+    var last = offsets.length - 2;
+    var end = offsets[last] + offsets[last + 1];
+
+    for (i = 0; i < offsets.length; i += 2)
+      offsets[i] -= first;
+
+    self.emit('messages', slab.slice(first, end), offsets, rinfos);
+    return;
+  }
+
+  for (i = 0; i < rinfos.length; i++) {
+    // 'message' listener closed the socket.
+    if (self._handle !== handle)
+      break;
+
+    var start = offsets[i * 2];
+    var len = offsets[i * 2 + 1];
+    self.emit('message', slab.slice(start, start + len), rinfos[i]);
+  }
+}
+
+
 Socket.prototype.ref = function() {
   if (this._handle)
     this._handle.ref();
@@ -1447,6 +1447,9 @@ function ReadStream(path, options) {
   this.autoClose = options.hasOwnProperty('autoClose') ?
       options.autoClose : true;
   this.pos = undefined;
+  this._ownFd = typeof this.fd !== 'number';
+  this._didRead = false;
+  this._sendingFile = false;
 
   if (this.start !== undefined) {
     if ('number' !== typeof this.start) {
@@ -1501,9 +1504,11 @@ ReadStream.prototype._read = function(n) {
       this._read(n);
     });
 
-  if (this.destroyed)
+  if (this.destroyed || this._sendingFile)
     return;
 
+  this._didRead = true;
+
   if (!pool || pool.length - pool.used < kMinPoolSpace) {
     // discard the old pool.
     pool = null;
@@ -1551,6 +1556,90 @@ ReadStream.prototype._read = function(n) {
 };
 
 
+// Files that are piped to sockets, or HTTP responses, that haven't been
+// read from yet are sent with sendfile and never enter JS land. `dest`
+// tells with _sendFile() if it can take a file, see net.Socket#_sendFile.
+ReadStream.prototype.pipe = function(dest, options) {
+  var state = this._readableState;
+
+  if (typeof dest._sendFile !== 'function' ||
+      this._didRead ||
+      this._sendingFile ||
+      state.pipesCount > 0 ||
+      state.length > 0 ||
+      state.ended ||
+      state.decoder ||
+      // Where a file that was passed in is at isn't known.
+      (!this._ownFd && this.pos === undefined))
+    return Readable.prototype.pipe.call(this, dest, options);
+
+  var self = this;
+  this._sendingFile = true;
+
+  dest.emit('pipe', this);
+
+  if (typeof this.fd !== 'number')
+    this.once('open', send);
+  else
+    send();
+
+  return dest;
+
+  function send() {
+    if (self.destroyed)
+      return;
+
+    var position = self.pos === undefined ? 0 : self.pos;
+    var length = self.end === undefined || self.end === Infinity ?
+        -1 : self.end - position + 1;
+
+    var ok = dest._sendFile(self.fd, position, length, function(er, bytes) {
+      self._sendingFile = false;
+
+      if (er && bytes === 0 && (er.code === 'ENOSYS' || er.code === 'EINVAL'))
+        return fallback();
+
+      if (er) {
+        // Almost always the other end going away, which is the
+        // destination's error, as with a failed write in pipe().
+        if (self.autoClose)
+          self.destroy();
+        // Nothing to report if it's gone already.
+        dest.emit('unpipe', self);
+        var socket = dest.connection || dest;
+        if (!socket.destroyed && typeof socket.destroy === 'function')
+          socket.destroy(er);
+        return;
+      }
+
+      if (self.pos !== undefined)
+        self.pos += bytes;
+
+      if (!options || options.end !== false)
+        dest.end();
+
+      // Same as running into the end of the file.
+      self.push(null);
+      self.read(0);
+    });
+
+    if (!ok) {
+      self._sendingFile = false;
+      fallback();
+    }
+  }
+
+  function fallback() {
+    // pipe() says 'pipe' again.
+    dest.emit('unpipe', self);
+    // _read() did nothing while the file was going to be sent.
+    self._readableState.reading = false;
+    Readable.prototype.pipe.call(self, dest, options);
+    self.read(0);
+  }
+};
+
+
 ReadStream.prototype.destroy = function() {
   if (this.destroyed)
     return;
@@ -118,6 +118,9 @@ function initSocketHandle(self) {
     self._handle.owner = self;
     self._handle.onread = onread;
 
+    if (self._readBuffer && self._handle.setReadBuffer)
+      self._handle.setReadBuffer(self._readBuffer);
+
     // If handle doesn't support writev - neither do we
     if (!self._handle.writev)
       self._writev = null;
@@ -154,6 +157,12 @@ function Socket(options) {
   }
 
   this.onend = null;
+  this._readBuffer = null;
+  this._onReadBuffer = null;
+  this._splicing = false;
+  this._unsplicing = false;
+  this._spliceSource = null;
+  this._finishAfterSplice = false;
 
   // shut down the socket when we're finished with it.
   this.on('finish', onSocketFinish);
@@ -191,11 +200,19 @@ function onSocketFinish() {
   }
 
   debug('onSocketFinish');
-  if (!this.readable || this._readableState.ended) {
+  if (!this._spliceSource &&
+      (!this.readable || this._readableState.ended)) {
     debug('oSF: ended, destroy', this._readableState);
     return this.destroy();
   }
 
+  // Wait until data that is being spliced in has been written.
+  if (this._spliceSource) {
+    debug('oSF: splice in progress');
+    this._finishAfterSplice = true;
+    return;
+  }
+
   debug('oSF: not ended, call shutdown()');
 
   // otherwise, just shutdown, or destroy() if not possible
@@ -371,7 +388,7 @@ Socket.prototype._read = function(n) {
   if (this._connecting || !this._handle) {
     debug('_read wait for connection');
     this.once('connect', this._read.bind(this, n));
-  } else if (!this._handle.reading) {
+  } else if (!this._handle.reading && !this._splicing) {
     // not already reading, start the flow
     debug('Socket._read readStart');
     this._handle.reading = true;
@@ -382,6 +399,237 @@ Socket.prototype._read = function(n) {
 };
 
 
+// Read straight into `buffer` instead of into a new Buffer per read. The
+// buffer is used as a ring and `callback(offset, length)` is called for
+// every read in place of 'data' events. Returning false from the callback
+// stops reading until the next socket.read(0). Pass null to go back.
+Socket.prototype.setReadBuffer = function(buffer, callback) {
+  if (buffer !== null && !Buffer.isBuffer(buffer))
+    throw new TypeError('buffer must be a Buffer or null');
+  if (buffer !== null && typeof callback !== 'function')
+    throw new TypeError('callback must be a function');
+
+  this._readBuffer = buffer;
+  this._onReadBuffer = buffer === null ? null : callback;
+
+  if (this._handle && this._handle.setReadBuffer)
+    this._handle.setReadBuffer(buffer);
+
+  return this;
+};
+
+
+// Move everything that's read from this socket to `dest` without it going
+// through JavaScript. On Linux the data is spliced between the two file
+// descriptors in the kernel, elsewhere this is the same as pipe(). Like
+// pipe(), `dest` is ended when this socket ends. `callback(err, bytes)`
+// is called once all data has been written to `dest`.
+Socket.prototype.splice = function(dest, callback) {
+  if (!(dest instanceof Socket))
+    throw new TypeError('dest must be a net.Socket');
+  if (callback !== undefined && typeof callback !== 'function')
+    throw new TypeError('callback must be a function');
+
+  var self = this;
+
+  if (this._connecting)
+    return this.once('connect', this.splice.bind(this, dest, callback));
+  if (dest._connecting)
+    return dest.once('connect', this.splice.bind(this, dest, callback));
+
+  if (!this._handle || !this._handle.splice || !dest._handle)
+    return pipeInstead(this, dest, callback);
+
+  // Stop reading into JS land and hand over what was read already.
+  this._splicing = true;
+  if (this._handle.reading) {
+    this._handle.reading = false;
+    this._handle.readStop();
+  }
+
+  var chunk;
+  while (null !== (chunk = this.read()))
+    dest.write(chunk);
+
+  // uv_splice_start() wants the destination's write queue to be empty.
+  if (dest._writableState.length > 0) {
+    dest._writableState.needDrain = true;
+    dest.once('drain', start);
+  } else {
+    start();
+  }
+
+  function start() {
+    if (self.destroyed || dest.destroyed) {
+      self._splicing = false;
+      return;
+    }
+
+    if (self._readableState.ended) {
+      self._splicing = false;
+      dest.end();
+      if (callback) callback(null, 0);
+      return;
+    }
+
+    var req = self._handle.splice(dest._handle);
+
+    if (!req) {
+      self._splicing = false;
+      if (process._errno === 'ENOSYS' || process._errno === 'EINVAL')
+        return pipeInstead(self, dest, callback);
+
+      var err = errnoException(process._errno, 'splice');
+      if (callback) callback(err);
+      return self._destroy(err);
+    }
+
+    req.oncomplete = afterSplice;
+    req.dest = dest;
+    req.callback = callback;
+    dest._spliceSource = self;
+  }
+};
+
+
+// Stops a splice() that's in progress. Data that was read already is
+// still written to the destination, then reading resumes as usual.
+Socket.prototype.unsplice = function() {
+  if (this._splicing && this._handle) {
+    this._unsplicing = true;
+    this._handle.spliceStop();
+  }
+  return this;
+};
+
+
+function pipeInstead(self, dest, callback) {
+  var start = self.bytesRead;
+  self.pipe(dest);
+  if (callback) {
+    dest.once('finish', function() {
+      callback(null, self.bytesRead - start);
+    });
+  }
+}
+
+
+// Sends `length` bytes of the file `fd` from `position` on, or everything
+// up to the end of the file when `length` is -1. Used by fs.ReadStream's
+// pipe(). Returns false when the socket can't do this and the caller has
+// to write the data itself, `callback(err, bytes)` is called otherwise.
+// ENOSYS and EINVAL errors with nothing sent mean the same.
+Socket.prototype._sendFile = function(fd, position, length, callback) {
+  var self = this;
+
+  if (!this._handle || !this._handle.sendFile)
+    return false;
+
+  if (this._connecting) {
+    this.once('connect', function() {
+      if (!this._sendFile(fd, position, length, callback))
+        callback(errnoException('ENOSYS', 'sendfile'), 0);
+    });
+    return true;
+  }
+
+  // uv_splice_file() wants the write queue to be empty.
+  if (this._spliceSource) {
+    this.once('_spliceEnd', send);
+  } else if (this._writableState.length > 0) {
+    this._writableState.needDrain = true;
+    this.once('drain', send);
+  } else {
+    send();
+  }
+  return true;
+
+  function send() {
+    if (self.destroyed || !self._handle)
+      return callback(new Error('This socket is closed.'), 0);
+
+    var req = self._handle.sendFile(fd, position, length);
+    if (!req)
+      return callback(errnoException(process._errno, 'sendfile'), 0);
+
+    req.oncomplete = afterSendFile;
+    req.callback = callback;
+    self._spliceSource = req;
+  }
+};
+
+
+function afterSendFile(status, handle, req) {
+  var self = handle.owner;
+
+  debug('afterSendFile', status, req.bytes);
+
+  spliceEnd(self, req.bytes);
+
+  if (status)
+    req.callback(errnoException(process._errno, 'sendfile'), req.bytes);
+  else
+    req.callback(null, req.bytes);
+}
+
+
+// Nothing is spliced into `dest` anymore, let queued writes and the
+// shutdown that were waiting for that go ahead.
+function spliceEnd(dest, bytes) {
+  dest._bytesDispatched += bytes;
+  dest._spliceSource = null;
+  dest.emit('_spliceEnd');
+
+  if (dest._finishAfterSplice) {
+    dest._finishAfterSplice = false;
+    if (!dest.destroyed)
+      onSocketFinish.call(dest);
+  }
+}
+
+
+function afterSplice(status, handle, req) {
+  var self = handle.owner;
+  var dest = req.dest;
+  var unsplicing = self._unsplicing;
+
+  self._splicing = false;
+  self._unsplicing = false;
+  self.bytesRead += req.bytes;
+  spliceEnd(dest, req.bytes);
+
+  debug('afterSplice', status, req.bytes);
+
+  if (status) {
+    // ECANCELED means one of the sockets was closed.
+    var err = errnoException(process._errno, 'splice');
+    if (req.callback) req.callback(err);
+    if (!self.destroyed && process._errno !== 'ECANCELED')
+      self._destroy(err);
+    return;
+  }
+
+  if (req.callback) req.callback(null, req.bytes);
+
+  if (unsplicing) {
+    // The read() calls in splice() left `reading` set, _read() did nothing
+    // while _splicing was.
+    self._readableState.reading = false;
+    self.read(0);
+    return;
+  }
+
+  // The source is at EOF, same as the EOF branch of onread.
+  if (self._readableState.length === 0)
+    self.readable = false;
+  if (self.onend) self.once('end', self.onend);
+  self.push(null);
+  self.emit('_socketEnd');
+
+  dest.end();
+}
+
+
 Socket.prototype.end = function(data, encoding) {
   stream.Duplex.prototype.end.call(this, data, encoding);
   this.writable = false;
@@ -498,11 +746,17 @@ function onread(buffer, offset, length) {
 
     // Optimization: emit the original buffer with end points
     var ret = true;
-    if (self.ondata) self.ondata(buffer, offset, end);
+    if (buffer === self._readBuffer)
+      ret = self._onReadBuffer(offset, length) !== false;
+    else if (self.ondata) self.ondata(buffer, offset, end);
     else ret = self.push(buffer.slice(offset, end));
 
     if (handle.reading && !ret) {
       handle.reading = false;
+      // Nothing was pushed, so the stream still thinks a _read() is under
+      // way. Let the next read(0) call _read() to start reading again.
+      if (buffer === self._readBuffer)
+        self._readableState.reading = false;
       debug('readStop');
       var r = handle.readStop();
       if (r)
@@ -603,6 +857,14 @@ Socket.prototype._writeGeneric = function(writev, data, encoding, cb) {
   this._pendingData = null;
   this._pendingEncoding = '';
 
+  // Data is being spliced into the socket, write once that's done.
+  if (this._spliceSource) {
+    this.once('_spliceEnd', function() {
+      this._writeGeneric(writev, data, encoding, cb);
+    });
+    return;
+  }
+
   timers._unrefActive(this);
 
   if (!this._handle) {
@@ -22,6 +22,7 @@
 var crypto = require('crypto');
 var util = require('util');
 var net = require('net');
+var cluster = require('cluster');
 var url = require('url');
 var events = require('events');
 var stream = require('stream');
@@ -42,6 +43,10 @@ exports.CLIENT_RENEG_WINDOW = 600;
 
 exports.SLAB_BUFFER_SIZE = 10 * 1024 * 1024;
 
+// Number of sessions that a server keeps for resumption unless told
+// otherwise with the sessionCacheSize option. Same as OpenSSL's default.
+exports.DEFAULT_SESSION_CACHE_SIZE = 20480;
+
 exports.getCiphers = function() {
   var names = process.binding('crypto').getSSLCiphers();
   // Drop all-caps names in favor of their lowercase aliases,
@@ -57,8 +62,10 @@ exports.getCiphers = function() {
 var debug = util.debuglog('tls');
 
 var Connection = null;
+var tls_wrap = null;
 try {
   Connection = process.binding('crypto').Connection;
+  tls_wrap = process.binding('tls_wrap');
 } catch (e) {
   throw new Error('node.js not compiled with openssl crypto support.');
 }
@@ -570,15 +577,22 @@ function parseCertString(s) {
 }
 
 
+function getPeerCertificate(ssl) {
+  var c = ssl.getPeerCertificate();
+
+  if (c) {
+    if (c.issuer) c.issuer = parseCertString(c.issuer);
+    if (c.subject) c.subject = parseCertString(c.subject);
+    return c;
+  }
+
+  return null;
+}
+
+
 CryptoStream.prototype.getPeerCertificate = function() {
   if (this.pair.ssl) {
-    var c = this.pair.ssl.getPeerCertificate();
-
-    if (c) {
-      if (c.issuer) c.issuer = parseCertString(c.issuer);
-      if (c.subject) c.subject = parseCertString(c.subject);
-      return c;
-    }
+    return getPeerCertificate(this.pair.ssl);
   }
 
   return null;
@@ -801,7 +815,7 @@ function onhandshakestart() {
     // callback to destroy the connection right now, it would crash and burn.
     setImmediate(function() {
       var err = new Error('TLS session renegotiation attack detected.');
-      if (self.cleartext) self.cleartext.emit('error', err);
+      self._renegotiationError(err);
     });
   }
 }
@@ -842,6 +856,8 @@ function onclienthello(hello) {
 
 function onnewsession(key, session) {
   if (!this.server) return;
+  if (this.server._sessionShareKey)
+    cluster._shareTLSSession(this.server._sessionShareKey, session);
   this.server.emit('newSession', key, session);
 }
 
@@ -968,6 +984,11 @@ SecurePair.prototype.maybeInitFinished = function() {
 };
 
 
+SecurePair.prototype._renegotiationError = function(err) {
+  if (this.cleartext) this.cleartext.emit('error', err);
+};
+
+
 SecurePair.prototype.destroy = function() {
   if (this._destroying) return;
 
@@ -1013,6 +1034,173 @@ SecurePair.prototype.error = function(returnOnly) {
   return err;
 };
 
+/**
+ * A net.Socket with TLS done in C++ on top of its handle. The encrypted
+ * data never reaches JS, reads and writes on the socket are cleartext.
+ *
+ * `socket` is a connected net.Socket whose handle is taken over, or null
+ * when the TLSSocket is connected later on like any net.Socket. Options:
+ * credentials, isServer, requestCert, rejectUnauthorized, NPNProtocols,
+ * SNICallback (servers) and servername, session (clients).
+ */
+
+function TLSSocket(socket, options) {
+  this._tlsOptions = options;
+  this._secureEstablished = false;
+  this._controlReleased = false;
+  this.ssl = null;
+  this.servername = null;
+  this.npnProtocol = null;
+  this.authorized = false;
+  this.authorizationError = null;
+
+  // CleartextStream users reach the TCP socket through this.
+  this.socket = this;
+
+  // Reading starts once TLS is in place.
+  net.Socket.call(this, {
+    handle: socket && socket._handle,
+    allowHalfOpen: socket ? socket.allowHalfOpen : options.allowHalfOpen,
+    readable: false
+  });
+
+  this.on('_socketEnd', onTLSSocketEnd);
+
+  if (socket) {
+    // The raw socket is done with, the server counts this one now.
+    socket._handle = null;
+    this.server = socket.server;
+    socket.server = null;
+    this.readable = this.writable = true;
+    this._init();
+  } else {
+    // Runs before the writes that are waiting for the connection.
+    this.once('connect', this._init);
+  }
+}
+
+util.inherits(TLSSocket, net.Socket);
+exports.TLSSocket = TLSSocket;
+
+
+TLSSocket.prototype._init = function() {
+  var options = this._tlsOptions;
+  var ssl = tls_wrap.wrap(this._handle,
+                          options.credentials.context,
+                          options.isServer ? true : false);
+
+  this.ssl = ssl;
+  ssl.lastHandshakeTime = 0;
+  ssl.handshakes = 0;
+  ssl.onhandshakestart = options.isServer ? onhandshakestart.bind(this) :
+                                            function() {};
+  ssl.onhandshakedone = this._finishInit.bind(this);
+  ssl.onnewsession = onnewsession.bind(this);
+  ssl.onerror = this._tlsError.bind(this);
+
+  if (options.isServer) {
+    ssl.setVerifyMode(options.requestCert ? true : false,
+                      options.rejectUnauthorized ? true : false);
+    if (process.features.tls_sni && options.SNICallback)
+      ssl.setSNICallback(options.SNICallback);
+  } else {
+    if (process.features.tls_sni && options.servername)
+      ssl.setServername(options.servername);
+    if (options.session)
+      ssl.setSession(options.session);
+  }
+
+  if (process.features.tls_npn && options.NPNProtocols)
+    ssl.setNPNProtocols(options.NPNProtocols);
+
+  ssl.start();
+
+  // Clients start reading when the connection is made.
+  if (options.isServer)
+    this.read(0);
+};
+
+
+TLSSocket.prototype._finishInit = function() {
+  // Renegotiations end up here too.
+  if (this._secureEstablished) return;
+
+  if (process.features.tls_npn) {
+    this.npnProtocol = this.ssl.getNegotiatedProtocol();
+  }
+
+  if (process.features.tls_sni) {
+    this.servername = this.ssl.getServername();
+  }
+
+  this._secureEstablished = true;
+  debug('secure established');
+  this.emit('secure');
+};
+
+
+TLSSocket.prototype._tlsError = function(err) {
+  var options = this._tlsOptions;
+
+  if (options.isServer &&
+      options.rejectUnauthorized &&
+      /peer did not return a certificate/.test(err.message)) {
+    // Not really an error.
+    return this.destroy();
+  }
+
+  this.destroy(err);
+};
+
+
+TLSSocket.prototype._renegotiationError = function(err) {
+  this.destroy(err);
+};
+
+
+function onTLSSocketEnd() {
+  if (this._secureEstablished) return;
+
+  var err = new Error('socket hang up');
+  err.code = 'ECONNRESET';
+  this.destroy(err);
+}
+
+
+TLSSocket.prototype.getPeerCertificate = function() {
+  if (this.ssl) {
+    return getPeerCertificate(this.ssl);
+  }
+
+  return null;
+};
+
+TLSSocket.prototype.getSession = function() {
+  if (this.ssl) {
+    return this.ssl.getSession();
+  }
+
+  return null;
+};
+
+TLSSocket.prototype.isSessionReused = function() {
+  if (this.ssl) {
+    return this.ssl.isSessionReused();
+  }
+
+  return null;
+};
+
+TLSSocket.prototype.getCipher = function(err) {
+  if (this.ssl) {
+    return this.ssl.getCurrentCipher();
+  } else {
+    return null;
+  }
+};
+
+
+
 // TODO: support anonymous (nocert) and PSK
 
 
@@ -1063,6 +1251,9 @@ SecurePair.prototype.error = function(returnOnly) {
 // - cert: string.
 // - ca: string or array of strings.
 // - sessionTimeout: integer.
+// - sessionCacheSize: integer, 0 turns the built-in session cache off.
+// - ticketKeyRotation: milliseconds between session ticket key changes.
+// - offloadHandshake: boolean, run handshakes on the thread pool.
 //
 // emit 'secureConnection'
 //   function (cleartextStream, encryptedStream) { }
@@ -1135,10 +1326,34 @@ function Server(/* [options], listener */) {
     sharedCreds.context.setSessionTimeout(self.sessionTimeout);
   }
 
+  if (self.sessionCacheSize > 0) {
+    sharedCreds.context.enableSessionCache(self.sessionCacheSize);
+  }
+
+  if (self.offloadHandshake) {
+    sharedCreds.context.enableHandshakeOffload();
+  }
+
+  if (cluster.isWorker) {
+    shareSessionState(self, sharedCreds.context);
+  } else if (self.ticketKeyRotation > 0) {
+    rotateTicketKeys(self, sharedCreds.context);
+  }
+
+  this._sharedCreds = sharedCreds;
+
   // constructor call
   net.Server.call(this, function(socket) {
     var creds = crypto.createCredentials(null, sharedCreds.context);
 
+    // Resuming sessions from 'resumeSession' needs the ClientHello parser
+    // and custom streams need the pair, everything else goes native.
+    if (!self._cleartext &&
+        !self._encrypted &&
+        self.listeners('resumeSession').length === 0) {
+      return onSecureSocket(self, creds, socket, timeout);
+    }
+
     var pair = new SecurePair(creds,
                               true,
                               self.requestCert,
@@ -1205,6 +1420,92 @@ function Server(/* [options], listener */) {
 
 util.inherits(Server, net.Server);
 exports.Server = Server;
+
+
+// Workers of a cluster resume each other's sessions. New sessions go to
+// the other workers through the master and the master hands out the keys
+// for session tickets, it's the one that rotates them too.
+function shareSessionState(server, context) {
+  // Only servers with the same certificate and session id context can
+  // resume each other's sessions.
+  var key = crypto.createHash('md5')
+                  .update(String(server.cert || server.pfx))
+                  .update(String(server.sessionIdContext))
+                  .digest('hex');
+
+  if (server.sessionCacheSize > 0)
+    server._sessionShareKey = key;
+
+  cluster._addTLSContext(key, context, server.ticketKeyRotation);
+  server.once('close', function() {
+    cluster._removeTLSContext(key, context);
+  });
+}
+
+
+function rotateTicketKeys(server, context) {
+  function rotate() {
+    context.setTicketKeys(crypto.randomBytes(48));
+  }
+
+  rotate();
+  var timer = setInterval(rotate, server.ticketKeyRotation);
+  timer.unref();
+  server.once('close', function() {
+    clearInterval(timer);
+  });
+}
+
+
+Server.prototype.getSessionStats = function() {
+  return this._sharedCreds.context.getSessionStats();
+};
+
+
+function onSecureSocket(server, creds, raw, timeout) {
+  var socket = new TLSSocket(raw, {
+    credentials: creds,
+    isServer: true,
+    requestCert: server.requestCert,
+    rejectUnauthorized: server.rejectUnauthorized,
+    NPNProtocols: server.NPNProtocols,
+    SNICallback: server.SNICallback
+  });
+
+  function listener() {
+    socket.destroy(new Error('TLS handshake timeout'));
+  }
+
+  if (timeout > 0) {
+    socket.setTimeout(timeout, listener);
+  }
+
+  function onerror(err) {
+    server.emit('clientError', err, socket);
+  }
+  socket.on('error', onerror);
+
+  socket.once('secure', function() {
+    socket.setTimeout(0, listener);
+    socket.removeListener('error', onerror);
+
+    if (server.requestCert) {
+      var verifyError = socket.ssl.verifyError();
+      if (verifyError) {
+        socket.authorizationError = verifyError.message;
+
+        if (server.rejectUnauthorized) {
+          return socket.destroy();
+        }
+      } else {
+        socket.authorized = true;
+      }
+    }
+
+    socket._controlReleased = true;
+    server.emit('secureConnection', socket);
+  });
+}
 exports.createServer = function(options, listener) {
   return new Server(options, listener);
 };
@@ -1232,6 +1533,15 @@ Server.prototype.setOptions = function(options) {
   if (options.crl) this.crl = options.crl;
   if (options.ciphers) this.ciphers = options.ciphers;
   if (options.sessionTimeout) this.sessionTimeout = options.sessionTimeout;
+  if (typeof options.sessionCacheSize === 'number') {
+    this.sessionCacheSize = options.sessionCacheSize;
+  } else {
+    this.sessionCacheSize = exports.DEFAULT_SESSION_CACHE_SIZE;
+  }
+  if (options.ticketKeyRotation) {
+    this.ticketKeyRotation = options.ticketKeyRotation;
+  }
+  this.offloadHandshake = !!options.offloadHandshake;
   var secureOptions = options.secureOptions || 0;
   if (options.honorCipherOrder) {
     secureOptions |= constants.SSL_OP_CIPHER_SERVER_PREFERENCE;
@@ -1324,8 +1634,15 @@ exports.connect = function(/* [port, host], options, cb */) {
   var sslcontext = crypto.createCredentials(options);
 
   convertNPNProtocols(options.NPNProtocols, this);
-  var hostname = options.servername || options.host || 'localhost',
-      pair = new SecurePair(sslcontext, false, true,
+  var hostname = options.servername || options.host || 'localhost';
+
+  // Sockets from elsewhere keep working on their own with SecurePair.
+  if (!options.socket && !options.cleartext && !options.encrypted) {
+    return connectSecureSocket(options, cb, hostname, sslcontext,
+                               this.NPNProtocols);
+  }
+
+  var pair = new SecurePair(sslcontext, false, true,
                             options.rejectUnauthorized === true ? true : false,
                             {
                               NPNProtocols: this.NPNProtocols,
@@ -1394,6 +1711,65 @@ exports.connect = function(/* [port, host], options, cb */) {
 };
 
 
+function connectSecureSocket(options, cb, hostname, sslcontext, NPNProtocols) {
+  var session = options.session;
+  if (typeof session === 'string')
+    session = new Buffer(session, 'binary');
+
+  var rejectUnauthorized = options.rejectUnauthorized === true;
+  var socket = new TLSSocket(null, {
+    credentials: sslcontext,
+    isServer: false,
+    rejectUnauthorized: rejectUnauthorized,
+    NPNProtocols: NPNProtocols,
+    servername: hostname,
+    session: session
+  });
+
+  if (cb) {
+    socket.once('secureConnect', cb);
+  }
+
+  var connect_opt = (options.path && !options.port) ? {path: options.path} : {
+    port: options.port,
+    host: options.host,
+    localAddress: options.localAddress
+  };
+  socket.connect(connect_opt);
+
+  socket.once('secure', function() {
+    var verifyError = socket.ssl.verifyError();
+
+    // Verify that server's identity matches it's certificate's names
+    if (!verifyError) {
+      var validCert = checkServerIdentity(hostname,
+                                          socket.getPeerCertificate());
+      if (!validCert) {
+        verifyError = new Error('Hostname/IP doesn\'t match certificate\'s ' +
+                                'altnames');
+      }
+    }
+
+    if (verifyError) {
+      socket.authorized = false;
+      socket.authorizationError = verifyError.message;
+
+      if (rejectUnauthorized) {
+        socket.destroy(verifyError);
+      } else {
+        socket.emit('secureConnect');
+      }
+    } else {
+      socket.authorized = true;
+      socket.emit('secureConnect');
+    }
+  });
+
+  socket._controlReleased = true;
+  return socket;
+}
+
+
 function pipe(pair, socket) {
   pair.encrypted.pipe(socket);
   socket.pipe(pair.encrypted);
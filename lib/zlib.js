@@ -38,6 +38,15 @@ binding.Z_MIN_CHUNK = 64;
 binding.Z_MAX_CHUNK = Infinity;
 binding.Z_DEFAULT_CHUNK = (16 * 1024);
 
+// chunks up to this size are (de)compressed on the main thread rather
+// than in the thread pool, where the handoff costs more than zlib does.
+binding.Z_DEFAULT_INLINE_THRESHOLD = 1024;
+
+// parallel gzip block size.  the previous 32K of input primes the
+// dictionary of each block, so smaller blocks only cost compression.
+binding.Z_MIN_BLOCKSIZE = (32 * 1024);
+binding.Z_DEFAULT_BLOCKSIZE = (128 * 1024);
+
 binding.Z_MIN_MEMLEVEL = 1;
 binding.Z_MAX_MEMLEVEL = 9;
 binding.Z_DEFAULT_MEMLEVEL = 8;
@@ -46,9 +55,9 @@ binding.Z_MIN_LEVEL = -1;
 binding.Z_MAX_LEVEL = 9;
 binding.Z_DEFAULT_LEVEL = binding.Z_DEFAULT_COMPRESSION;
 
-// expose all the zlib constants
+// expose all the zlib constants, and the brotli ones when compiled in.
 Object.keys(binding).forEach(function(k) {
-  if (k.match(/^Z/)) exports[k] = binding[k];
+  if (k.match(/^(Z|BROTLI)_/)) exports[k] = binding[k];
 });
 
 // translation table for return codes.
@@ -75,6 +84,9 @@ exports.Gunzip = Gunzip;
 exports.DeflateRaw = DeflateRaw;
 exports.InflateRaw = InflateRaw;
 exports.Unzip = Unzip;
+exports.ParallelGzip = ParallelGzip;
+exports.BrotliCompress = BrotliCompress;
+exports.BrotliDecompress = BrotliDecompress;
 
 exports.createDeflate = function(o) {
   return new Deflate(o);
@@ -104,6 +116,18 @@ exports.createUnzip = function(o) {
   return new Unzip(o);
 };
 
+exports.createParallelGzip = function(o) {
+  return new ParallelGzip(o);
+};
+
+exports.createBrotliCompress = function(o) {
+  return new BrotliCompress(o);
+};
+
+exports.createBrotliDecompress = function(o) {
+  return new BrotliDecompress(o);
+};
+
 
 // Convenience methods.
 // compress/decompress a string or buffer in one step.
@@ -163,6 +187,22 @@ exports.inflateRaw = function(buffer, opts, callback) {
   zlibBuffer(new InflateRaw(opts), buffer, callback);
 };
 
+exports.brotliCompress = function(buffer, opts, callback) {
+  if (typeof opts === 'function') {
+    callback = opts;
+    opts = {};
+  }
+  zlibBuffer(new BrotliCompress(opts), buffer, callback);
+};
+
+exports.brotliDecompress = function(buffer, opts, callback) {
+  if (typeof opts === 'function') {
+    callback = opts;
+    opts = {};
+  }
+  zlibBuffer(new BrotliDecompress(opts), buffer, callback);
+};
+
 function zlibBuffer(engine, buffer, callback) {
   var buffers = [];
   var nread = 0;
@@ -243,6 +283,27 @@ function Unzip(opts) {
 }
 
 
+// brotli - same stream interface, different format.
+// only available when node was configured with --shared-brotli.
+function BrotliCompress(opts) {
+  if (!(this instanceof BrotliCompress)) return new BrotliCompress(opts);
+  if (binding.BROTLI_ENCODE === undefined)
+    throw new Error('brotli support not compiled in');
+  Zlib.call(this, opts, binding.BROTLI_ENCODE);
+}
+
+function BrotliDecompress(opts) {
+  if (!(this instanceof BrotliDecompress)) return new BrotliDecompress(opts);
+  if (binding.BROTLI_DECODE === undefined)
+    throw new Error('brotli support not compiled in');
+  Zlib.call(this, opts, binding.BROTLI_DECODE);
+}
+
+function isBrotli(mode) {
+  return mode === binding.BROTLI_ENCODE || mode === binding.BROTLI_DECODE;
+}
+
+
 // the Zlib class they all inherit from
 // This thing manages the queue of requests, and returns
 // true or false if there is anything in the queue when
@@ -273,6 +334,15 @@ function Zlib(opts, mode) {
     }
   }
 
+  this._inlineThreshold = exports.Z_DEFAULT_INLINE_THRESHOLD;
+  if (opts.inlineThreshold !== undefined) {
+    if (typeof opts.inlineThreshold !== 'number' ||
+        !(opts.inlineThreshold >= 0)) {
+      throw new Error('Invalid inlineThreshold: ' + opts.inlineThreshold);
+    }
+    this._inlineThreshold = opts.inlineThreshold;
+  }
+
   if (opts.windowBits) {
     if (opts.windowBits < exports.Z_MIN_WINDOWBITS ||
         opts.windowBits > exports.Z_MAX_WINDOWBITS) {
@@ -310,6 +380,31 @@ function Zlib(opts, mode) {
     }
   }
 
+  // Options that only brotli knows, other streams ignore them as usual.
+  if (isBrotli(mode)) {
+    if (opts.quality !== undefined) {
+      if (opts.quality < exports.BROTLI_MIN_QUALITY ||
+          opts.quality > exports.BROTLI_MAX_QUALITY) {
+        throw new Error('Invalid quality: ' + opts.quality);
+      }
+    }
+
+    if (opts.lgwin !== undefined) {
+      if (opts.lgwin < exports.BROTLI_MIN_WINDOW_BITS ||
+          opts.lgwin > exports.BROTLI_MAX_WINDOW_BITS) {
+        throw new Error('Invalid lgwin: ' + opts.lgwin);
+      }
+    }
+
+    if (opts.mode !== undefined) {
+      if (opts.mode !== exports.BROTLI_MODE_GENERIC &&
+          opts.mode !== exports.BROTLI_MODE_TEXT &&
+          opts.mode !== exports.BROTLI_MODE_FONT) {
+        throw new Error('Invalid mode: ' + opts.mode);
+      }
+    }
+  }
+
   this._binding = new binding.Zlib(mode);
 
   var self = this;
@@ -323,18 +418,36 @@ function Zlib(opts, mode) {
     var error = new Error(message);
     error.errno = errno;
     error.code = exports.codes[errno];
-    self.emit('error', error);
+
+    // don't throw at whoever called write() when it was done inline.
+    if (self._writingSync) {
+      process.nextTick(function() {
+        self.emit('error', error);
+      });
+    } else {
+      self.emit('error', error);
+    }
   };
 
-  this._binding.init(opts.windowBits || exports.Z_DEFAULT_WINDOWBITS,
-                     opts.level || exports.Z_DEFAULT_COMPRESSION,
-                     opts.memLevel || exports.Z_DEFAULT_MEMLEVEL,
-                     opts.strategy || exports.Z_DEFAULT_STRATEGY,
-                     opts.dictionary);
+  if (isBrotli(mode)) {
+    this._binding.initBrotli(
+        opts.quality === undefined ? exports.BROTLI_DEFAULT_QUALITY :
+                                     opts.quality,
+        opts.lgwin || exports.BROTLI_DEFAULT_WINDOW,
+        opts.mode || exports.BROTLI_MODE_GENERIC);
+  } else {
+    this._binding.init(opts.windowBits || exports.Z_DEFAULT_WINDOWBITS,
+                       opts.level || exports.Z_DEFAULT_COMPRESSION,
+                       opts.memLevel || exports.Z_DEFAULT_MEMLEVEL,
+                       opts.strategy || exports.Z_DEFAULT_STRATEGY,
+                       opts.dictionary);
+  }
 
   this._buffer = new Buffer(this._chunkSize);
   this._offset = 0;
   this._closed = false;
+  this._writeState = [0, 0];
+  this._writingSync = false;
 
   this.once('end', this.close);
 }
@@ -415,6 +528,29 @@ Zlib.prototype._transform = function(chunk, encoding, cb) {
   var availInBefore = chunk && chunk.length;
   var availOutBefore = this._chunkSize - this._offset;
   var inOff = 0;
+  var self = this;
+
+  // Small chunks are done right here, that's cheaper than a round trip
+  // through the thread pool.
+  if (availInBefore <= this._inlineThreshold) {
+    var state = this._writeState;
+    var ok;
+    do {
+      this._writingSync = true;
+      ok = this._binding.writeSync(flushFlag,
+                                   chunk,
+                                   inOff,
+                                   availInBefore,
+                                   this._buffer,
+                                   this._offset,
+                                   availOutBefore,
+                                   state);
+      this._writingSync = false;
+      if (!ok)
+        return; // onerror has already scheduled the error.
+    } while (consume(state[0], state[1]));
+    return cb();
+  }
 
   var req = this._binding.write(flushFlag,
                                 chunk, // in
@@ -427,11 +563,31 @@ Zlib.prototype._transform = function(chunk, encoding, cb) {
   req.buffer = chunk;
   req.callback = callback;
 
-  var self = this;
   function callback(availInAfter, availOutAfter, buffer) {
     if (self._hadError)
       return;
 
+    if (consume(availInAfter, availOutAfter)) {
+      // Not actually done.  Need to reprocess.
+      var newReq = self._binding.write(flushFlag,
+                                       chunk,
+                                       inOff,
+                                       availInBefore,
+                                       self._buffer,
+                                       self._offset,
+                                       self._chunkSize);
+      newReq.callback = callback; // this same function
+      newReq.buffer = chunk;
+      return;
+    }
+
+    // finished with the chunk.
+    cb();
+  }
+
+  // Pushes the output of the last write.  Returns true if zlib ran out
+  // of room in the output buffer and has to be called again.
+  function consume(availInAfter, availOutAfter) {
     var have = availOutBefore - availOutAfter;
     assert(have >= 0, 'have should not go down');
 
@@ -450,28 +606,221 @@ Zlib.prototype._transform = function(chunk, encoding, cb) {
     }
 
     if (availOutAfter === 0) {
-      // Not actually done.  Need to reprocess.
-      // Also, update the availInBefore to the availInAfter value,
+      // Update the availInBefore to the availInAfter value,
       // so that if we have to hit it a third (fourth, etc.) time,
       // it'll have the correct byte counts.
       inOff += (availInBefore - availInAfter);
       availInBefore = availInAfter;
+      return true;
+    }
 
-      var newReq = self._binding.write(flushFlag,
-                                       chunk,
-                                       inOff,
-                                       availInBefore,
-                                       self._buffer,
-                                       self._offset,
-                                       self._chunkSize);
-      newReq.callback = callback; // this same function
-      newReq.buffer = chunk;
+    return false;
+  }
+};
+
+
+// Parallel gzip
+// Cuts the input into blocks and compresses several of them at once on the
+// thread pool, the way pigz does.  Each block is primed with the last 32K
+// of the one before it and ends on a byte boundary, so the pieces join up
+// into one ordinary gzip member.
+var PARALLEL_WINDOW = 32 * 1024;
+
+function ParallelGzip(opts) {
+  if (!(this instanceof ParallelGzip)) return new ParallelGzip(opts);
+
+  opts = opts || {};
+  Transform.call(this, opts);
+
+  if (opts.blockSize) {
+    if (opts.blockSize < exports.Z_MIN_BLOCKSIZE ||
+        opts.blockSize > exports.Z_MAX_CHUNK) {
+      throw new Error('Invalid block size: ' + opts.blockSize);
+    }
+  }
+
+  if (opts.parallel) {
+    if (opts.parallel < 1) {
+      throw new Error('Invalid parallel: ' + opts.parallel);
+    }
+  }
+
+  if (opts.level) {
+    if (opts.level < exports.Z_MIN_LEVEL ||
+        opts.level > exports.Z_MAX_LEVEL) {
+      throw new Error('Invalid compression level: ' + opts.level);
+    }
+  }
+
+  if (opts.memLevel) {
+    if (opts.memLevel < exports.Z_MIN_MEMLEVEL ||
+        opts.memLevel > exports.Z_MAX_MEMLEVEL) {
+      throw new Error('Invalid memLevel: ' + opts.memLevel);
+    }
+  }
+
+  if (opts.strategy) {
+    if (opts.strategy != exports.Z_FILTERED &&
+        opts.strategy != exports.Z_HUFFMAN_ONLY &&
+        opts.strategy != exports.Z_RLE &&
+        opts.strategy != exports.Z_FIXED &&
+        opts.strategy != exports.Z_DEFAULT_STRATEGY) {
+      throw new Error('Invalid strategy: ' + opts.strategy);
+    }
+  }
+
+  this._blockSize = opts.blockSize || exports.Z_DEFAULT_BLOCKSIZE;
+  this._parallel = opts.parallel || 4;
+  this._level = opts.level || exports.Z_DEFAULT_COMPRESSION;
+  this._memLevel = opts.memLevel || exports.Z_DEFAULT_MEMLEVEL;
+  this._strategy = opts.strategy || exports.Z_DEFAULT_STRATEGY;
+
+  this._pending = [];
+  this._pendingLength = 0;
+  this._prevBlock = null;
+  this._blocks = 0;       // blocks handed to the thread pool
+  this._inFlight = 0;
+  this._done = {};        // finished blocks waiting for their turn
+  this._written = 0;      // blocks pushed so far
+  this._crc = 0;
+  this._inputLength = 0;
+  this._hadError = false;
+  this._transformCallback = null;
+  this._flushCallback = null;
+}
+
+util.inherits(ParallelGzip, Transform);
+
+ParallelGzip.prototype._transform = function(chunk, encoding, cb) {
+  if (!Buffer.isBuffer(chunk))
+    return cb(new Error('invalid input'));
+
+  this._pending.push(chunk);
+  this._pendingLength += chunk.length;
+
+  this._deflateBlocks();
+
+  // hold off on more input until the rest of it is on its way.
+  if (this._inFlight >= this._parallel)
+    this._transformCallback = cb;
+  else
+    cb();
+};
+
+ParallelGzip.prototype._flush = function(callback) {
+  this._flushCallback = callback;
+  this._deflateBlock(this._takeBlock(this._pendingLength), true);
+};
+
+// Sends off whole blocks while fewer than `parallel` are in flight, the
+// rest waits for oncomplete.
+ParallelGzip.prototype._deflateBlocks = function() {
+  while (this._pendingLength >= this._blockSize &&
+         this._inFlight < this._parallel) {
+    this._deflateBlock(this._takeBlock(this._blockSize), false);
+  }
+};
+
+ParallelGzip.prototype._takeBlock = function(size) {
+  var buf = this._pending.length === 1 ?
+      this._pending[0] :
+      Buffer.concat(this._pending, this._pendingLength);
+
+  this._pending = size < buf.length ? [buf.slice(size)] : [];
+  this._pendingLength -= size;
+  return buf.slice(0, size);
+};
+
+ParallelGzip.prototype._deflateBlock = function(block, last) {
+  var self = this;
+  var index = this._blocks++;
+  var prev = this._prevBlock;
+  var dictionary = null;
+
+  if (prev !== null)
+    dictionary = prev.slice(Math.max(0, prev.length - PARALLEL_WINDOW));
+  this._prevBlock = block;
+
+  this._inFlight++;
+  binding.deflateBlock(block,
+                       dictionary,
+                       this._level,
+                       this._memLevel,
+                       this._strategy,
+                       last,
+                       oncomplete);
+
+  function oncomplete(errno, output, crc) {
+    self._inFlight--;
+    if (self._hadError)
+      return;
+
+    if (errno !== null) {
+      self._hadError = true;
+      var error = new Error('Zlib error');
+      error.errno = errno;
+      error.code = exports.codes[errno];
+      self.emit('error', error);
       return;
     }
 
-    // finished with the chunk.
+    self._done[index] = { output: output, crc: crc, length: block.length };
+    self._deflateBlocks();
+    self._writeBlocks();
+  }
+};
+
+// Pushes finished blocks in order, adding the gzip header before the
+// first one and the trailer after the last one.
+ParallelGzip.prototype._writeBlocks = function() {
+  var block;
+  while ((block = this._done[this._written]) !== undefined) {
+    delete this._done[this._written];
+
+    if (this._written === 0)
+      this.push(this._header());
+    this._written++;
+
+    this._crc = binding.crc32Combine(this._crc, block.crc, block.length);
+    this._inputLength += block.length;
+    this.push(block.output);
+  }
+
+  if (this._transformCallback !== null && this._inFlight < this._parallel) {
+    var cb = this._transformCallback;
+    this._transformCallback = null;
     cb();
   }
+
+  if (this._flushCallback !== null && this._written === this._blocks) {
+    var trailer = new Buffer(8);
+    trailer.writeUInt32LE(this._crc, 0);
+    trailer.writeUInt32LE(this._inputLength % 0x100000000, 4);
+    this.push(trailer);
+
+    var callback = this._flushCallback;
+    this._flushCallback = null;
+    callback();
+  }
+};
+
+ParallelGzip.prototype._header = function() {
+  var header = new Buffer(10);
+  header[0] = 0x1f;  // magic
+  header[1] = 0x8b;
+  header[2] = 8;     // deflate
+  header[3] = 0;     // no flags
+  header.writeUInt32LE(0, 4);  // no mtime
+  // extra flags, same as zlib sets them.
+  if (this._level === 9)
+    header[8] = 2;
+  else if ((this._level < 2 && this._level !== -1) ||
+           this._strategy >= binding.Z_HUFFMAN_ONLY)
+    header[8] = 4;
+  else
+    header[8] = 0;
+  header[9] = 3;     // unix
+  return header;
 };
 
 util.inherits(Deflate, Zlib);
@@ -481,3 +830,5 @@ util.inherits(Gunzip, Zlib);
 util.inherits(DeflateRaw, Zlib);
 util.inherits(InflateRaw, Zlib);
 util.inherits(Unzip, Zlib);
+util.inherits(BrotliCompress, Zlib);
+util.inherits(BrotliDecompress, Zlib);
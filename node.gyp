@@ -10,6 +10,7 @@
     'node_has_winsdk%': 'false',
     'node_shared_v8%': 'false',
     'node_shared_zlib%': 'false',
+    'node_shared_brotli%': 'false',
     'node_shared_http_parser%': 'false',
     'node_shared_cares%': 'false',
     'node_shared_libuv%': 'false',
@@ -99,13 +100,15 @@
         'src/node_script.cc',
         'src/node_stat_watcher.cc',
         'src/node_string.cc',
+        'src/node_threadpool.cc',
         'src/node_watchdog.cc',
         'src/node_zlib.cc',
         'src/pipe_wrap.cc',
         'src/signal_wrap.cc',
         'src/string_bytes.cc',
+        'src/string_bytes_simd.cc',
         'src/stream_wrap.cc',
-        'src/slab_allocator.cc',
+        'src/buffer_pool.cc',
         'src/tcp_wrap.cc',
         'src/timer_wrap.cc',
         'src/tty_wrap.cc',
@@ -119,6 +122,7 @@
         'src/node_constants.h',
         'src/node_crypto.h',
         'src/node_crypto_bio.h',
+        'src/node_crypto_session_cache.h',
         'src/node_extensions.h',
         'src/node_file.h',
         'src/node_http_parser.h',
@@ -127,16 +131,19 @@
         'src/node_root_certs.h',
         'src/node_script.h',
         'src/node_string.h',
+        'src/node_threadpool.h',
         'src/node_version.h',
         'src/node_watchdog.h',
         'src/pipe_wrap.h',
         'src/queue.h',
         'src/tty_wrap.h',
         'src/tcp_wrap.h',
+        'src/tls_wrap.h',
         'src/udp_wrap.h',
         'src/req_wrap.h',
-        'src/slab_allocator.h',
+        'src/buffer_pool.h',
         'src/string_bytes.h',
+        'src/string_bytes_simd.h',
         'src/stream_wrap.h',
         'src/tree.h',
         'src/v8_typed_array.h',
@@ -158,7 +165,12 @@
       'conditions': [
         [ 'node_use_openssl=="true"', {
           'defines': [ 'HAVE_OPENSSL=1' ],
-          'sources': [ 'src/node_crypto.cc', 'src/node_crypto_bio.cc' ],
+          'sources': [
+            'src/node_crypto.cc',
+            'src/node_crypto_bio.cc',
+            'src/node_crypto_session_cache.cc',
+            'src/tls_wrap.cc'
+          ],
           'conditions': [
             [ 'node_shared_openssl=="false"', {
               'dependencies': [ './deps/openssl/openssl.gyp:openssl' ],
@@ -243,6 +255,12 @@
           'dependencies': [ 'deps/zlib/zlib.gyp:zlib' ],
         }],
 
+        [ 'node_shared_brotli=="true"', {
+          'defines': [ 'HAVE_BROTLI=1' ],
+        }, {
+          'defines': [ 'HAVE_BROTLI=0' ],
+        }],
+
         [ 'node_shared_http_parser=="false"', {
           'dependencies': [ 'deps/http_parser/http_parser.gyp:http_parser' ],
         }],
@@ -0,0 +1,232 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "buffer_pool.h"
+#include "node.h"
+#include "node_buffer.h"
+#include "node_internals.h"
+#include "v8.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace node {
+
+using v8::Arguments;
+using v8::Handle;
+using v8::HandleScope;
+using v8::Local;
+using v8::Number;
+using v8::Object;
+using v8::String;
+using v8::Value;
+
+
+// Sits in front of the data. Kept at a multiple of 16 bytes so the data is
+// as well aligned as what malloc returns.
+struct BufferPool::Block {
+  Block* next;
+  size_t size;         // usable bytes, not counting the header
+  size_t used;         // bytes of data once handed to JS
+  unsigned int klass;  // index into free_ or kOversized
+};
+
+#define HEADER_SIZE ROUND_UP(sizeof(BufferPool::Block), 16)
+
+
+inline char* BufferPool::DataOf(Block* block) {
+  return reinterpret_cast<char*>(block) + HEADER_SIZE;
+}
+
+
+inline BufferPool::Block* BufferPool::BlockOf(char* data) {
+  return reinterpret_cast<Block*>(data - HEADER_SIZE);
+}
+
+
+BufferPool::BufferPool() {
+  memset(free_, 0, sizeof(free_));
+  memset(free_bytes_, 0, sizeof(free_bytes_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+
+BufferPool* BufferPool::Default() {
+  // Never deleted: Buffers that are collected at any later point, including
+  // during shutdown, still return their blocks to it.
+  static BufferPool* pool = new BufferPool();
+  return pool;
+}
+
+
+unsigned int BufferPool::SizeClass(size_t size) {
+  unsigned int klass = 0;
+  while (klass < kClassCount && ClassSize(klass) < size)
+    klass++;
+  return klass;
+}
+
+
+size_t BufferPool::ClassSize(unsigned int klass) {
+  return static_cast<size_t>(1) << (klass + kMinClassShift);
+}
+
+
+BufferPool::Block* BufferPool::NewBlock(size_t size) {
+  unsigned int klass = SizeClass(size);
+  Block* block;
+
+  if (klass < kClassCount) {
+    block = free_[klass];
+    if (block != NULL) {
+      free_[klass] = block->next;
+      free_bytes_[klass] -= block->size;
+      stats_.retained -= block->size;
+      return block;
+    }
+    size = ClassSize(klass);
+  }
+
+  block = reinterpret_cast<Block*>(new char[HEADER_SIZE + size]);
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  block->klass = klass;
+  stats_.blocks++;
+
+  return block;
+}
+
+
+void BufferPool::Recycle(Block* block) {
+  unsigned int klass = block->klass;
+
+  if (klass < kClassCount &&
+      free_bytes_[klass] + block->size <= kMaxRetainedPerClass) {
+    block->next = free_[klass];
+    free_[klass] = block;
+    free_bytes_[klass] += block->size;
+    stats_.retained += block->size;
+    return;
+  }
+
+  delete[] reinterpret_cast<char*>(block);
+  stats_.blocks--;
+}
+
+
+char* BufferPool::Allocate(size_t size) {
+  if (size == 0) return NULL;
+
+  Block* block = NewBlock(size);
+  stats_.reading += block->size;
+
+  return DataOf(block);
+}
+
+
+void BufferPool::Release(char* ptr) {
+  if (ptr == NULL) return;
+
+  Block* block = BlockOf(ptr);
+  stats_.reading -= block->size;
+  Recycle(block);
+}
+
+
+Local<Object> BufferPool::Shrink(char* ptr, size_t size) {
+  HandleScope scope(node_isolate);
+
+  assert(ptr != NULL);
+
+  if (size == 0) {
+    Release(ptr);
+    return Local<Object>();
+  }
+
+  Block* block = BlockOf(ptr);
+  assert(size <= block->size);
+  stats_.reading -= block->size;
+
+  // Don't let a short read pin a big block, move it to one that fits.
+  if (SizeClass(size) < block->klass) {
+    Block* small = NewBlock(size);
+    memcpy(DataOf(small), ptr, size);
+    stats_.copied += size;
+    Recycle(block);
+    block = small;
+  }
+
+  block->used = size;
+  stats_.pinned += block->size;
+  stats_.waste += block->size - size;
+  node_isolate->AdjustAmountOfExternalAllocatedMemory(
+      static_cast<intptr_t>(block->size));
+
+  Buffer* buffer = Buffer::New(DataOf(block), size, FreeCallback, this);
+  return scope.Close(Local<Object>::New(node_isolate, buffer->handle_));
+}
+
+
+void BufferPool::FreeCallback(char* data, void* hint) {
+  BufferPool* pool = static_cast<BufferPool*>(hint);
+  Block* block = BlockOf(data);
+
+  pool->stats_.pinned -= block->size;
+  pool->stats_.waste -= block->size - block->used;
+  node_isolate->AdjustAmountOfExternalAllocatedMemory(
+      -static_cast<intptr_t>(block->size));
+
+  pool->Recycle(block);
+}
+
+
+void BufferPool::GetStats(Stats* stats) const {
+  *stats = stats_;
+}
+
+
+static Handle<Value> GetPoolStats(const Arguments& args) {
+  HandleScope scope(node_isolate);
+  BufferPool::Stats stats;
+  BufferPool::Default()->GetStats(&stats);
+
+  Local<Object> obj = Object::New();
+#define V(name)                                                               \
+  obj->Set(String::New(#name), Number::New(static_cast<double>(stats.name)));
+  V(blocks)
+  V(retained)
+  V(reading)
+  V(pinned)
+  V(waste)
+  V(copied)
+#undef V
+
+  return scope.Close(obj);
+}
+
+
+void BufferPool::Initialize(Handle<Object> target) {
+  NODE_SET_METHOD(target, "getPoolStats", GetPoolStats);
+}
+
+
+}  // namespace node
@@ -0,0 +1,98 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SRC_BUFFER_POOL_H_
+#define SRC_BUFFER_POOL_H_
+
+#include "v8.h"
+#include <stddef.h>
+
+namespace node {
+
+// Recycles the buffers that stream and UDP handles read into.
+//
+// Every read gets a block of its own, taken from a free list of the smallest
+// size class that fits the suggested size. Once the read completes, the data
+// is handed to JS in a Buffer that owns just that block; small reads are
+// first copied into a block of a smaller class so the big read buffer goes
+// straight back to the free list. A Buffer that JS holds on to never pins
+// memory other than its own block, and a block is recycled as soon as the
+// Buffer is garbage collected.
+//
+// The free lists are capped so that a burst of traffic doesn't leave lots of
+// idle memory behind. Oversized requests bypass the pool altogether.
+class BufferPool {
+ public:
+  struct Stats {
+    size_t blocks;    // blocks allocated from the system
+    size_t retained;  // bytes sitting in the free lists
+    size_t reading;   // bytes lent to pending reads
+    size_t pinned;    // bytes held by Buffers that JS still references
+    size_t waste;     // part of `pinned` that doesn't hold data
+    size_t copied;    // bytes copied into a smaller block, ever
+  };
+
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  // The pool shared by all handles on the main thread.
+  static BufferPool* Default();
+
+  // Returns a block of at least `size` bytes, or NULL if `size` is zero.
+  char* Allocate(size_t size);
+
+  // Gives a block back to the pool without handing its data to JS.
+  void Release(char* ptr);
+
+  // Wraps the first `size` bytes of the block in a Buffer. The data starts
+  // at offset zero of the returned Buffer, `ptr` must not be used after
+  // this. Returns an empty handle and releases the block if `size` is zero.
+  v8::Local<v8::Object> Shrink(char* ptr, size_t size);
+
+  void GetStats(Stats* stats) const;
+
+ private:
+  struct Block;
+
+  static const unsigned int kMinClassShift = 8;   // 256 bytes
+  static const unsigned int kMaxClassShift = 16;  // 64 kB
+  static const unsigned int kClassCount = kMaxClassShift - kMinClassShift + 1;
+  static const unsigned int kOversized = kClassCount;
+  static const size_t kMaxRetainedPerClass = 512 * 1024;
+
+  BufferPool();
+
+  static unsigned int SizeClass(size_t size);
+  static size_t ClassSize(unsigned int klass);
+  static char* DataOf(Block* block);
+  static Block* BlockOf(char* data);
+  static void FreeCallback(char* data, void* hint);
+
+  Block* NewBlock(size_t size);
+  void Recycle(Block* block);
+
+  Block* free_[kClassCount];
+  size_t free_bytes_[kClassCount];
+  Stats stats_;
+};
+
+}  // namespace node
+
+#endif  // SRC_BUFFER_POOL_H_
@@ -27,6 +27,7 @@
 #define CARES_STATICLIB
 #include "ares.h"
 #include "node.h"
+#include "node_threadpool.h"
 #include "req_wrap.h"
 #include "tree.h"
 #include "uv.h"
@@ -787,6 +788,9 @@ static Handle<Value> QueryWithFamily(const Arguments& args) {
 
 
 void AfterGetAddrInfo(uv_getaddrinfo_t* req, int status, struct addrinfo* res) {
+  Threadpool::RecordWork(THREADPOOL_WORK_GETADDRINFO,
+                         reinterpret_cast<uv_req_t*>(req));
+
   HandleScope scope(node_isolate);
 
   GetAddrInfoReqWrap* req_wrap = (GetAddrInfoReqWrap*) req->data;
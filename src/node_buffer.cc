@@ -21,6 +21,7 @@
 
 
 #include "node_buffer.h"
+#include "buffer_pool.h"
 
 #include "node.h"
 #include "string_bytes.h"
@@ -674,6 +675,8 @@ void Buffer::Initialize(Handle<Object> target) {
   target->Set(String::NewSymbol("setFastBufferConstructor"),
               FunctionTemplate::New(SetFastBufferConstructor)->GetFunction());
 
+  BufferPool::Initialize(target);
+
   v8::HeapProfiler* heap_profiler = node_isolate->GetHeapProfiler();
   heap_profiler->SetWrapperClassInfoProvider(BUFFER_CLASS_ID, WrapperInfo);
 }
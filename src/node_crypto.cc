@@ -26,6 +26,7 @@
 
 #include "node.h"
 #include "node_buffer.h"
+#include "node_threadpool.h"
 #include "string_bytes.h"
 #include "node_root_certs.h"
 
@@ -57,6 +58,13 @@
     }                                                         \
   } while (0)
 
+#define ASSERT_NO_PENDING_JOBS(wrap) do {                     \
+    if ((wrap)->HasPendingJobs()) {                           \
+      return ThrowException(Exception::Error(String::New(     \
+              "Asynchronous operation in progress")));        \
+    }                                                         \
+  } while (0)
+
 static const char PUBLIC_KEY_PFX[] =  "-----BEGIN PUBLIC KEY-----";
 static const int PUBLIC_KEY_PFX_LEN = sizeof(PUBLIC_KEY_PFX) - 1;
 static const char PUBRSA_KEY_PFX[] =  "-----BEGIN RSA PUBLIC KEY-----";
@@ -100,6 +108,22 @@ static Persistent<String> sessionid_sym;
 
 static Persistent<FunctionTemplate> secure_context_constructor;
 
+// The contexts that hash() and hmac() reuse, they only run on the main
+// thread. OpenSSL keeps their buffers between digests of the same kind.
+static EVP_MD_CTX oneshot_md_ctx;
+static HMAC_CTX oneshot_hmac_ctx;
+
+// Digests that were looked up by name lately. EVP_get_digestbyname()
+// takes a lock and hashes the name, and Hash, Hmac and hash() name the
+// digest on every call.
+struct DigestCacheEntry {
+  char name_[32];
+  const EVP_MD* md_;
+};
+
+static DigestCacheEntry digest_cache[16];
+static unsigned int digest_cache_next;
+
 static uv_rwlock_t* locks;
 
 
@@ -138,6 +162,29 @@ static void crypto_lock_cb(int mode, int n, const char* file, int line) {
 }
 
 
+// Only call this on the main thread.
+static const EVP_MD* GetDigestByName(const char* name) {
+  size_t len = strlen(name);
+  if (len >= sizeof(digest_cache[0].name_)) return EVP_get_digestbyname(name);
+
+  for (size_t i = 0; i < ARRAY_SIZE(digest_cache); i++) {
+    DigestCacheEntry* entry = &digest_cache[i];
+    if (entry->md_ != NULL && strcmp(entry->name_, name) == 0)
+      return entry->md_;
+  }
+
+  const EVP_MD* md = EVP_get_digestbyname(name);
+  if (md == NULL) return NULL;
+
+  DigestCacheEntry* entry =
+      &digest_cache[digest_cache_next++ % ARRAY_SIZE(digest_cache)];
+  memcpy(entry->name_, name, len + 1);
+  entry->md_ = md;
+
+  return md;
+}
+
+
 Handle<Value> ThrowCryptoErrorHelper(unsigned long err, bool is_type_error) {
   HandleScope scope(node_isolate);
   char errmsg[128];
@@ -180,6 +227,14 @@ void SecureContext::Initialize(Handle<Object> target) {
                                SecureContext::SetSessionTimeout);
   NODE_SET_PROTOTYPE_METHOD(t, "close", SecureContext::Close);
   NODE_SET_PROTOTYPE_METHOD(t, "loadPKCS12", SecureContext::LoadPKCS12);
+  NODE_SET_PROTOTYPE_METHOD(t, "enableSessionCache",
+                               SecureContext::EnableSessionCache);
+  NODE_SET_PROTOTYPE_METHOD(t, "addSession", SecureContext::AddSession);
+  NODE_SET_PROTOTYPE_METHOD(t, "setTicketKeys", SecureContext::SetTicketKeys);
+  NODE_SET_PROTOTYPE_METHOD(t, "getSessionStats",
+                               SecureContext::GetSessionStats);
+  NODE_SET_PROTOTYPE_METHOD(t, "enableHandshakeOffload",
+                               SecureContext::EnableHandshakeOffload);
 
   target->Set(String::NewSymbol("SecureContext"), t->GetFunction());
 }
@@ -253,24 +308,37 @@ Handle<Value> SecureContext::Init(const Arguments& args) {
                                  SSL_SESS_CACHE_NO_AUTO_CLEAR);
   SSL_CTX_sess_set_get_cb(sc->ctx_, GetSessionCallback);
   SSL_CTX_sess_set_new_cb(sc->ctx_, NewSessionCallback);
+  SSL_CTX_sess_set_remove_cb(sc->ctx_, RemoveSessionCallback);
+  SSL_CTX_set_app_data(sc->ctx_, sc);
 
   sc->ca_store_ = NULL;
   return True(node_isolate);
 }
 
 
+SecureContext* SecureContext::FromSSL(SSL* s) {
+  return static_cast<SecureContext*>(SSL_CTX_get_app_data(s->session_ctx));
+}
+
+
 SSL_SESSION* SecureContext::GetSessionCallback(SSL* s,
                                                unsigned char* key,
                                                int len,
                                                int* copy) {
-  HandleScope scope(node_isolate);
-
-  Connection* p = static_cast<Connection*>(SSL_get_app_data(s));
+  // May run on the thread pool, see TLSCallbacks::StartHandshakeWork().
+  SSLWrap* p = static_cast<SSLWrap*>(SSL_get_app_data(s));
 
   *copy = 0;
   SSL_SESSION* sess = p->next_sess_;
   p->next_sess_ = NULL;
 
+  // A session from 'resumeSession' comes first.
+  if (sess == NULL) {
+    SecureContext* sc = FromSSL(s);
+    if (sc != NULL && sc->session_cache_ != NULL)
+      sess = sc->session_cache_->Get(key, len);
+  }
+
   return sess;
 }
 
@@ -281,13 +349,27 @@ void SessionDataFree(char* data, void* hint) {
 
 
 int SecureContext::NewSessionCallback(SSL* s, SSL_SESSION* sess) {
-  HandleScope scope(node_isolate);
+  SSLWrap* p = static_cast<SSLWrap*>(SSL_get_app_data(s));
+
+  if (p->in_threadpool_) {
+    // onnewsession needs V8, RunDeferredCallbacks() takes it from here.
+    if (p->new_sess_ != NULL) SSL_SESSION_free(p->new_sess_);
+    CRYPTO_add(&sess->references, 1, CRYPTO_LOCK_SSL_SESSION);
+    p->new_sess_ = sess;
+    return 0;
+  }
+
+  p->NewSession(sess);
+  return 0;
+}
 
-  Connection* p = static_cast<Connection*>(SSL_get_app_data(s));
+
+void SSLWrap::NewSession(SSL_SESSION* sess) {
+  HandleScope scope(node_isolate);
 
   // Check if session is small enough to be stored
   int size = i2d_SSL_SESSION(sess, NULL);
-  if (size > kMaxSessionSize) return 0;
+  if (size > SecureContext::kMaxSessionSize) return;
 
   // Serialize session
   char* serialized = new char[size];
@@ -295,6 +377,16 @@ int SecureContext::NewSessionCallback(SSL* s, SSL_SESSION* sess) {
   memset(serialized, 0, size);
   i2d_SSL_SESSION(sess, &pserialized);
 
+  SecureContext* sc = SecureContext::FromSSL(ssl_);
+  if (sc != NULL && sc->session_cache_ != NULL) {
+    time_t expires = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+    sc->session_cache_->Add(sess->session_id,
+                            sess->session_id_length,
+                            reinterpret_cast<unsigned char*>(serialized),
+                            size,
+                            expires);
+  }
+
   Handle<Value> argv[2] = {
     Buffer::New(reinterpret_cast<char*>(sess->session_id),
                 sess->session_id_length)->handle_,
@@ -304,8 +396,91 @@ int SecureContext::NewSessionCallback(SSL* s, SSL_SESSION* sess) {
   if (onnewsession_sym.IsEmpty()) {
     onnewsession_sym = NODE_PSYMBOL("onnewsession");
   }
-  MakeCallback(p->handle_, onnewsession_sym, ARRAY_SIZE(argv), argv);
+  MakeCallback(GetObject(), onnewsession_sym, ARRAY_SIZE(argv), argv);
+}
+
+
+void SSLWrap::RunDeferredCallbacks() {
+  assert(!in_threadpool_);
+
+  if (new_sess_ != NULL) {
+    SSL_SESSION* sess = new_sess_;
+    new_sess_ = NULL;
+    NewSession(sess);
+    SSL_SESSION_free(sess);
+  }
+}
+
+
+void SecureContext::RemoveSessionCallback(SSL_CTX* ctx, SSL_SESSION* sess) {
+  SecureContext* sc = static_cast<SecureContext*>(SSL_CTX_get_app_data(ctx));
+  if (sc == NULL || sc->session_cache_ == NULL) return;
+
+  sc->session_cache_->Remove(sess->session_id, sess->session_id_length);
+}
+
+
+int SecureContext::TicketKeyCallback(SSL* s,
+                                     unsigned char* name,
+                                     unsigned char* iv,
+                                     EVP_CIPHER_CTX* ectx,
+                                     HMAC_CTX* hctx,
+                                     int enc) {
+  SecureContext* sc =
+      static_cast<SecureContext*>(SSL_CTX_get_app_data(s->initial_ctx));
+  if (sc == NULL) return -1;
+
+  // setTicketKeys() can run while a handshake is on the thread pool.
+  uv_mutex_lock(&sc->ticket_keys_mutex_);
+  int r = sc->UseTicketKey(name, iv, ectx, hctx, enc);
+  uv_mutex_unlock(&sc->ticket_keys_mutex_);
+
+  return r;
+}
+
+
+int SecureContext::UseTicketKey(unsigned char* name,
+                                unsigned char* iv,
+                                EVP_CIPHER_CTX* ectx,
+                                HMAC_CTX* hctx,
+                                int enc) {
+  if (ticket_key_count_ == 0) return -1;
+
+  if (enc) {
+    TicketKey* key = &ticket_keys_[0];
+    if (RAND_pseudo_bytes(iv, 16) < 0) return -1;
+    memcpy(name, key->name_, sizeof(key->name_));
+    EVP_EncryptInit_ex(ectx, EVP_aes_128_cbc(), NULL, key->aes_key_, iv);
+    HMAC_Init_ex(hctx,
+                 key->hmac_secret_,
+                 sizeof(key->hmac_secret_),
+                 EVP_sha256(),
+                 NULL);
+    return 1;
+  }
+
+  for (int i = 0; i < ticket_key_count_; i++) {
+    TicketKey* key = &ticket_keys_[i];
+    if (memcmp(name, key->name_, sizeof(key->name_)) != 0) continue;
+
+    HMAC_Init_ex(hctx,
+                 key->hmac_secret_,
+                 sizeof(key->hmac_secret_),
+                 EVP_sha256(),
+                 NULL);
+    EVP_DecryptInit_ex(ectx, EVP_aes_128_cbc(), NULL, key->aes_key_, iv);
+
+    // A ticket from the previous key is good, the client gets a new one.
+    if (i == 0) {
+      ticket_stats_.hits++;
+      return 1;
+    }
+    ticket_stats_.renewals++;
+    return 2;
+  }
 
+  // Full handshake and a fresh ticket.
+  ticket_stats_.misses++;
   return 0;
 }
 
@@ -670,6 +845,143 @@ Handle<Value> SecureContext::SetSessionTimeout(const Arguments& args) {
   return True(node_isolate);
 }
 
+// enableSessionCache(size) keeps up to `size` sessions in the context
+// itself. Sessions from 'resumeSession' still take precedence.
+Handle<Value> SecureContext::EnableSessionCache(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args.This());
+
+  if (args.Length() != 1 || !args[0]->IsUint32() ||
+      args[0]->Uint32Value() == 0) {
+    return ThrowTypeError("Bad parameter");
+  }
+
+  delete sc->session_cache_;
+  sc->session_cache_ = new SessionCache(args[0]->Uint32Value());
+
+  return True(node_isolate);
+}
+
+
+// addSession(data) puts a session that another process serialized into
+// the cache, e.g. one from another worker of a cluster.
+Handle<Value> SecureContext::AddSession(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args.This());
+
+  if (args.Length() < 1 || !Buffer::HasInstance(args[0]))
+    return ThrowTypeError("Bad parameter");
+
+  if (sc->session_cache_ == NULL) return False(node_isolate);
+
+  const unsigned char* data =
+      reinterpret_cast<const unsigned char*>(Buffer::Data(args[0]));
+  size_t size = Buffer::Length(args[0]);
+  if (size > static_cast<size_t>(kMaxSessionSize)) return False(node_isolate);
+
+  const unsigned char* p = data;
+  SSL_SESSION* sess = d2i_SSL_SESSION(NULL, &p, size);
+  if (sess == NULL) {
+    ERR_clear_error();
+    return False(node_isolate);
+  }
+
+  time_t expires = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+  sc->session_cache_->Add(sess->session_id,
+                          sess->session_id_length,
+                          data,
+                          size,
+                          expires);
+  SSL_SESSION_free(sess);
+
+  return True(node_isolate);
+}
+
+
+// setTicketKeys(buffer) makes the 48 bytes in `buffer` the key for new
+// session tickets. The key before it keeps working for one more rotation.
+Handle<Value> SecureContext::SetTicketKeys(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args.This());
+
+  if (args.Length() < 1 ||
+      !Buffer::HasInstance(args[0]) ||
+      Buffer::Length(args[0]) != sizeof(TicketKey)) {
+    return ThrowTypeError("Bad parameter");
+  }
+
+  uv_mutex_lock(&sc->ticket_keys_mutex_);
+
+  if (sc->ticket_key_count_ == 0) {
+    SSL_CTX_set_tlsext_ticket_key_cb(sc->ctx_, TicketKeyCallback);
+  } else {
+    sc->ticket_keys_[1] = sc->ticket_keys_[0];
+    sc->ticket_key_count_ = 2;
+  }
+
+  memcpy(&sc->ticket_keys_[0], Buffer::Data(args[0]), sizeof(TicketKey));
+  if (sc->ticket_key_count_ == 0)
+    sc->ticket_key_count_ = 1;
+
+  uv_mutex_unlock(&sc->ticket_keys_mutex_);
+
+  return True(node_isolate);
+}
+
+
+Handle<Value> SecureContext::GetSessionStats(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args.This());
+
+  SessionCache::Stats cache;
+  if (sc->session_cache_ != NULL)
+    cache = sc->session_cache_->stats();
+  else
+    memset(&cache, 0, sizeof(cache));
+
+  uv_mutex_lock(&sc->ticket_keys_mutex_);
+  TicketStats tickets = sc->ticket_stats_;
+  uv_mutex_unlock(&sc->ticket_keys_mutex_);
+
+  Local<Object> info = Object::New();
+  info->Set(String::New("size"),
+            Number::New(static_cast<double>(cache.size)));
+  info->Set(String::New("hits"),
+            Number::New(static_cast<double>(cache.hits)));
+  info->Set(String::New("misses"),
+            Number::New(static_cast<double>(cache.misses)));
+  info->Set(String::New("expired"),
+            Number::New(static_cast<double>(cache.expired)));
+  info->Set(String::New("evicted"),
+            Number::New(static_cast<double>(cache.evicted)));
+  info->Set(String::New("ticketHits"),
+            Number::New(static_cast<double>(tickets.hits)));
+  info->Set(String::New("ticketRenewals"),
+            Number::New(static_cast<double>(tickets.renewals)));
+  info->Set(String::New("ticketMisses"),
+            Number::New(static_cast<double>(tickets.misses)));
+
+  return scope.Close(info);
+}
+
+
+// enableHandshakeOffload() lets native TLS sockets of this server context
+// run their handshakes on the thread pool, the private key operations
+// don't hold up the event loop then.
+Handle<Value> SecureContext::EnableHandshakeOffload(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args.This());
+  sc->offload_handshake_ = true;
+
+  return True(node_isolate);
+}
+
+
 Handle<Value> SecureContext::Close(const Arguments& args) {
   HandleScope scope(node_isolate);
   SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(args.This());
@@ -1033,29 +1345,14 @@ void Connection::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "encOut", Connection::EncOut);
   NODE_SET_PROTOTYPE_METHOD(t, "clearPending", Connection::ClearPending);
   NODE_SET_PROTOTYPE_METHOD(t, "encPending", Connection::EncPending);
-  NODE_SET_PROTOTYPE_METHOD(t, "getPeerCertificate", Connection::GetPeerCertificate);
-  NODE_SET_PROTOTYPE_METHOD(t, "getSession", Connection::GetSession);
-  NODE_SET_PROTOTYPE_METHOD(t, "setSession", Connection::SetSession);
   NODE_SET_PROTOTYPE_METHOD(t, "loadSession", Connection::LoadSession);
-  NODE_SET_PROTOTYPE_METHOD(t, "isSessionReused", Connection::IsSessionReused);
   NODE_SET_PROTOTYPE_METHOD(t, "isInitFinished", Connection::IsInitFinished);
-  NODE_SET_PROTOTYPE_METHOD(t, "verifyError", Connection::VerifyError);
-  NODE_SET_PROTOTYPE_METHOD(t, "getCurrentCipher", Connection::GetCurrentCipher);
   NODE_SET_PROTOTYPE_METHOD(t, "start", Connection::Start);
   NODE_SET_PROTOTYPE_METHOD(t, "shutdown", Connection::Shutdown);
   NODE_SET_PROTOTYPE_METHOD(t, "receivedShutdown", Connection::ReceivedShutdown);
   NODE_SET_PROTOTYPE_METHOD(t, "close", Connection::Close);
 
-#ifdef OPENSSL_NPN_NEGOTIATED
-  NODE_SET_PROTOTYPE_METHOD(t, "getNegotiatedProtocol", Connection::GetNegotiatedProto);
-  NODE_SET_PROTOTYPE_METHOD(t, "setNPNProtocols", Connection::SetNPNProtocols);
-#endif
-
-
-#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-  NODE_SET_PROTOTYPE_METHOD(t, "getServername", Connection::GetServername);
-  NODE_SET_PROTOTYPE_METHOD(t, "setSNICallback",  Connection::SetSNICallback);
-#endif
+  SSLWrap::AddMethods<Connection>(t);
 
   target->Set(String::NewSymbol("Connection"), t->GetFunction());
 }
@@ -1106,32 +1403,124 @@ static int VerifyCallback(int preverify_ok, X509_STORE_CTX *ctx) {
   return 1;
 }
 
+SSLWrap::~SSLWrap() {
+  if (ssl_ != NULL) {
+    SSL_free(ssl_);
+    ssl_ = NULL;
+  }
+
+  if (next_sess_ != NULL) {
+    SSL_SESSION_free(next_sess_);
+    next_sess_ = NULL;
+  }
+
+  if (new_sess_ != NULL) {
+    SSL_SESSION_free(new_sess_);
+    new_sess_ = NULL;
+  }
+
+#ifdef OPENSSL_NPN_NEGOTIATED
+  if (!npnProtos_.IsEmpty()) npnProtos_.Dispose(node_isolate);
+  if (!selectedNPNProto_.IsEmpty()) selectedNPNProto_.Dispose(node_isolate);
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  if (!sniObject_.IsEmpty()) sniObject_.Dispose(node_isolate);
+  if (!sniContext_.IsEmpty()) sniContext_.Dispose(node_isolate);
+  if (!servername_.IsEmpty()) servername_.Dispose(node_isolate);
+#endif
+}
+
+
+void SSLWrap::NewSSL(SecureContext* sc, bool is_server) {
+  ssl_ = SSL_new(sc->ctx_);
+  is_server_ = is_server;
+
+  SSL_set_app_data(ssl_, this);
+
+  if (is_server) SSL_set_info_callback(ssl_, SSLInfoCallback);
+
 #ifdef OPENSSL_NPN_NEGOTIATED
+  if (is_server) {
+    // Server should advertise NPN protocols
+    SSL_CTX_set_next_protos_advertised_cb(sc->ctx_,
+                                          AdvertiseNextProtoCallback_,
+                                          NULL);
+  } else {
+    // Client should select protocol from advertised
+    // If server supports NPN
+    SSL_CTX_set_next_proto_select_cb(sc->ctx_,
+                                     SelectNextProtoCallback_,
+                                     NULL);
+  }
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  if (is_server) {
+    SSL_CTX_set_tlsext_servername_callback(sc->ctx_, SelectSNIContextCallback_);
+  }
+#endif
 
-int Connection::AdvertiseNextProtoCallback_(SSL *s,
+#ifdef SSL_MODE_RELEASE_BUFFERS
+  long mode = SSL_get_mode(ssl_);
+  SSL_set_mode(ssl_, mode | SSL_MODE_RELEASE_BUFFERS);
+#endif
+
+  if (is_server) {
+    SSL_set_accept_state(ssl_);
+  } else {
+    SSL_set_connect_state(ssl_);
+  }
+}
+
+
+void SSLWrap::SetVerifyMode(bool request_cert, bool reject_unauthorized) {
+  int verify_mode;
+  if (is_server_) {
+    if (!request_cert) {
+      // Note reject_unauthorized ignored.
+      verify_mode = SSL_VERIFY_NONE;
+    } else {
+      verify_mode = SSL_VERIFY_PEER;
+      if (reject_unauthorized) verify_mode |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+    }
+  } else {
+    // Note request_cert and reject_unauthorized are ignored for clients.
+    verify_mode = SSL_VERIFY_NONE;
+  }
+
+  // Always allow a connection. We'll reject in javascript.
+  SSL_set_verify(ssl_, verify_mode, VerifyCallback);
+}
+
+
+#ifdef OPENSSL_NPN_NEGOTIATED
+
+int SSLWrap::AdvertiseNextProtoCallback_(SSL *s,
                                             const unsigned char** data,
                                             unsigned int *len,
                                             void *arg) {
 
-  Connection *p = static_cast<Connection*>(SSL_get_app_data(s));
+  SSLWrap* p = static_cast<SSLWrap*>(SSL_get_app_data(s));
 
-  if (p->npnProtos_.IsEmpty()) {
+  // npn_data_ rather than npnProtos_, this may run on the thread pool.
+  if (p->npn_data_ == NULL) {
     // No initialization - no NPN protocols
     *data = reinterpret_cast<const unsigned char*>("");
     *len = 0;
   } else {
-    *data = reinterpret_cast<const unsigned char*>(Buffer::Data(p->npnProtos_));
-    *len = Buffer::Length(p->npnProtos_);
+    *data = p->npn_data_;
+    *len = p->npn_len_;
   }
 
   return SSL_TLSEXT_ERR_OK;
 }
 
-int Connection::SelectNextProtoCallback_(SSL *s,
+int SSLWrap::SelectNextProtoCallback_(SSL *s,
                              unsigned char** out, unsigned char* outlen,
                              const unsigned char* in,
                              unsigned int inlen, void *arg) {
-  Connection *p = static_cast<Connection*> SSL_get_app_data(s);
+  SSLWrap* p = static_cast<SSLWrap*>(SSL_get_app_data(s));
 
   // Release old protocol handler if present
   if (!p->selectedNPNProto_.IsEmpty()) {
@@ -1180,49 +1569,61 @@ int Connection::SelectNextProtoCallback_(SSL *s,
 #endif
 
 #ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-int Connection::SelectSNIContextCallback_(SSL *s, int *ad, void* arg) {
+int SSLWrap::SelectSNIContextCallback_(SSL *s, int *ad, void* arg) {
+  SSLWrap* p = static_cast<SSLWrap*>(SSL_get_app_data(s));
+
+  // On the thread pool, SelectSNIContext() ran before the handshake left.
+  if (!p->in_threadpool_) {
+    const char* servername = SSL_get_servername(s, TLSEXT_NAMETYPE_host_name);
+    if (servername == NULL) return SSL_TLSEXT_ERR_OK;
+    p->SelectSNIContext(servername);
+  }
+
+  if (p->sni_ctx_ != NULL) SSL_set_SSL_CTX(s, p->sni_ctx_);
+  return p->sni_result_;
+}
+
+
+int SSLWrap::SelectSNIContext(const char* servername) {
   HandleScope scope(node_isolate);
 
-  Connection *p = static_cast<Connection*> SSL_get_app_data(s);
+  if (!servername_.IsEmpty()) {
+    servername_.Dispose(node_isolate);
+  }
+  servername_ = Persistent<String>::New(node_isolate,
+                                        String::New(servername));
 
-  const char* servername = SSL_get_servername(s, TLSEXT_NAMETYPE_host_name);
+  sni_ctx_ = NULL;
+  sni_result_ = SSL_TLSEXT_ERR_OK;
 
-  if (servername) {
-    if (!p->servername_.IsEmpty()) {
-      p->servername_.Dispose(node_isolate);
+  // Call the SNI callback and use its return value as context
+  if (!sniObject_.IsEmpty()) {
+    if (!sniContext_.IsEmpty()) {
+      sniContext_.Dispose(node_isolate);
     }
-    p->servername_ = Persistent<String>::New(node_isolate,
-                                             String::New(servername));
 
-    // Call the SNI callback and use its return value as context
-    if (!p->sniObject_.IsEmpty()) {
-      if (!p->sniContext_.IsEmpty()) {
-        p->sniContext_.Dispose(node_isolate);
-      }
-
-      // Get callback init args
-      Local<Value> argv[1] = {*p->servername_};
-
-      // Call it
-      Local<Value> ret = Local<Value>::New(node_isolate,
-                                           MakeCallback(p->sniObject_,
-                                                        "onselect",
-                                                        ARRAY_SIZE(argv),
-                                                        argv));
-
-      // If ret is SecureContext
-      if (secure_context_constructor->HasInstance(ret)) {
-        p->sniContext_ = Persistent<Value>::New(node_isolate, ret);
-        SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(
-                                Local<Object>::Cast(ret));
-        SSL_set_SSL_CTX(s, sc->ctx_);
-      } else {
-        return SSL_TLSEXT_ERR_NOACK;
-      }
+    // Get callback init args
+    Local<Value> argv[1] = {*servername_};
+
+    // Call it
+    Local<Value> ret = Local<Value>::New(node_isolate,
+                                         MakeCallback(sniObject_,
+                                                      "onselect",
+                                                      ARRAY_SIZE(argv),
+                                                      argv));
+
+    // If ret is SecureContext
+    if (secure_context_constructor->HasInstance(ret)) {
+      sniContext_ = Persistent<Value>::New(node_isolate, ret);
+      SecureContext *sc = ObjectWrap::Unwrap<SecureContext>(
+                              Local<Object>::Cast(ret));
+      sni_ctx_ = sc->ctx_;
+    } else {
+      sni_result_ = SSL_TLSEXT_ERR_NOACK;
     }
   }
 
-  return SSL_TLSEXT_ERR_OK;
+  return sni_result_;
 }
 #endif
 
@@ -1241,33 +1642,12 @@ Handle<Value> Connection::New(const Arguments& args) {
 
   bool is_server = args[1]->BooleanValue();
 
-  p->ssl_ = SSL_new(sc->ctx_);
+  p->NewSSL(sc, is_server);
   p->bio_read_ = BIO_new(NodeBIO::GetMethod());
   p->bio_write_ = BIO_new(NodeBIO::GetMethod());
 
-  SSL_set_app_data(p->ssl_, p);
-
-  if (is_server) SSL_set_info_callback(p->ssl_, SSLInfoCallback);
-
-#ifdef OPENSSL_NPN_NEGOTIATED
-  if (is_server) {
-    // Server should advertise NPN protocols
-    SSL_CTX_set_next_protos_advertised_cb(sc->ctx_,
-                                          AdvertiseNextProtoCallback_,
-                                          NULL);
-  } else {
-    // Client should select protocol from advertised
-    // If server supports NPN
-    SSL_CTX_set_next_proto_select_cb(sc->ctx_,
-                                     SelectNextProtoCallback_,
-                                     NULL);
-  }
-#endif
-
 #ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-  if (is_server) {
-    SSL_CTX_set_tlsext_servername_callback(sc->ctx_, SelectSNIContextCallback_);
-  } else {
+  if (!is_server) {
     String::Utf8Value servername(args[2]);
     SSL_set_tlsext_host_name(p->ssl_, *servername);
   }
@@ -1275,62 +1655,41 @@ Handle<Value> Connection::New(const Arguments& args) {
 
   SSL_set_bio(p->ssl_, p->bio_read_, p->bio_write_);
 
-#ifdef SSL_MODE_RELEASE_BUFFERS
-  long mode = SSL_get_mode(p->ssl_);
-  SSL_set_mode(p->ssl_, mode | SSL_MODE_RELEASE_BUFFERS);
-#endif
-
-
-  int verify_mode;
-  if (is_server) {
-    bool request_cert = args[2]->BooleanValue();
-    if (!request_cert) {
-      // Note reject_unauthorized ignored.
-      verify_mode = SSL_VERIFY_NONE;
-    } else {
-      bool reject_unauthorized = args[3]->BooleanValue();
-      verify_mode = SSL_VERIFY_PEER;
-      if (reject_unauthorized) verify_mode |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
-    }
-  } else {
-    // Note request_cert and reject_unauthorized are ignored for clients.
-    verify_mode = SSL_VERIFY_NONE;
-  }
-
-
-  // Always allow a connection. We'll reject in javascript.
-  SSL_set_verify(p->ssl_, verify_mode, VerifyCallback);
-
-  if ((p->is_server_ = is_server)) {
-    SSL_set_accept_state(p->ssl_);
-  } else {
-    SSL_set_connect_state(p->ssl_);
-  }
+  p->SetVerifyMode(args[2]->BooleanValue(), args[3]->BooleanValue());
 
   return args.This();
 }
 
 
-void Connection::SSLInfoCallback(const SSL *ssl_, int where, int ret) {
+void SSLWrap::SSLInfoCallback(const SSL *ssl_, int where, int ret) {
   // Be compatible with older versions of OpenSSL. SSL_get_app_data() wants
   // a non-const SSL* in OpenSSL <= 0.9.7e.
   SSL* ssl = const_cast<SSL*>(ssl_);
+  SSLWrap* c = static_cast<SSLWrap*>(SSL_get_app_data(ssl));
   if (where & SSL_CB_HANDSHAKE_START) {
-    HandleScope scope(node_isolate);
-    Connection* c = static_cast<Connection*>(SSL_get_app_data(ssl));
-    if (onhandshakestart_sym.IsEmpty()) {
-      onhandshakestart_sym = NODE_PSYMBOL("onhandshakestart");
-    }
-    MakeCallback(c->handle_, onhandshakestart_sym, 0, NULL);
+    c->OnHandshakeStart();
   }
   if (where & SSL_CB_HANDSHAKE_DONE) {
-    HandleScope scope(node_isolate);
-    Connection* c = static_cast<Connection*>(SSL_get_app_data(ssl));
-    if (onhandshakedone_sym.IsEmpty()) {
-      onhandshakedone_sym = NODE_PSYMBOL("onhandshakedone");
-    }
-    MakeCallback(c->handle_, onhandshakedone_sym, 0, NULL);
+    c->OnHandshakeDone();
+  }
+}
+
+
+void SSLWrap::OnHandshakeStart() {
+  HandleScope scope(node_isolate);
+  if (onhandshakestart_sym.IsEmpty()) {
+    onhandshakestart_sym = NODE_PSYMBOL("onhandshakestart");
   }
+  MakeCallback(GetObject(), onhandshakestart_sym, 0, NULL);
+}
+
+
+void SSLWrap::OnHandshakeDone() {
+  HandleScope scope(node_isolate);
+  if (onhandshakedone_sym.IsEmpty()) {
+    onhandshakedone_sym = NODE_PSYMBOL("onhandshakedone");
+  }
+  MakeCallback(GetObject(), onhandshakedone_sym, 0, NULL);
 }
 
 
@@ -1541,14 +1900,12 @@ Handle<Value> Connection::ClearIn(const Arguments& args) {
 }
 
 
-Handle<Value> Connection::GetPeerCertificate(const Arguments& args) {
+Handle<Value> SSLWrap::GetPeerCertificate(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->ssl_ == NULL) return Undefined(node_isolate);
+  if (ssl_ == NULL) return Undefined(node_isolate);
   Local<Object> info = Object::New();
-  X509* peer_cert = SSL_get_peer_certificate(ss->ssl_);
+  X509* peer_cert = SSL_get_peer_certificate(ssl_);
   if (peer_cert != NULL) {
     BIO* bio = BIO_new(BIO_s_mem());
     BUF_MEM* mem;
@@ -1660,14 +2017,12 @@ Handle<Value> Connection::GetPeerCertificate(const Arguments& args) {
   return scope.Close(info);
 }
 
-Handle<Value> Connection::GetSession(const Arguments& args) {
+Handle<Value> SSLWrap::GetSession(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->ssl_ == NULL) return Undefined(node_isolate);
+  if (ssl_ == NULL) return Undefined(node_isolate);
 
-  SSL_SESSION* sess = SSL_get_session(ss->ssl_);
+  SSL_SESSION* sess = SSL_get_session(ssl_);
   if (!sess) return Undefined(node_isolate);
 
   int slen = i2d_SSL_SESSION(sess, NULL);
@@ -1685,11 +2040,9 @@ Handle<Value> Connection::GetSession(const Arguments& args) {
   return Null(node_isolate);
 }
 
-Handle<Value> Connection::SetSession(const Arguments& args) {
+Handle<Value> SSLWrap::SetSession(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
   if (args.Length() < 1 ||
       (!args[0]->IsString() && !Buffer::HasInstance(args[0]))) {
     Local<Value> exception = Exception::TypeError(String::New("Bad argument"));
@@ -1717,7 +2070,7 @@ Handle<Value> Connection::SetSession(const Arguments& args) {
   if (!sess)
     return Undefined(node_isolate);
 
-  int r = SSL_set_session(ss->ssl_, sess);
+  int r = SSL_set_session(ssl_, sess);
   SSL_SESSION_free(sess);
 
   if (!r) {
@@ -1752,12 +2105,10 @@ Handle<Value> Connection::LoadSession(const Arguments& args) {
   return True(node_isolate);
 }
 
-Handle<Value> Connection::IsSessionReused(const Arguments& args) {
+Handle<Value> SSLWrap::IsSessionReused(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->ssl_ == NULL || SSL_session_reused(ss->ssl_) == false) {
+  if (ssl_ == NULL || SSL_session_reused(ssl_) == false) {
     return False(node_isolate);
   }
 
@@ -1831,16 +2182,14 @@ Handle<Value> Connection::IsInitFinished(const Arguments& args) {
 }
 
 
-Handle<Value> Connection::VerifyError(const Arguments& args) {
+Handle<Value> SSLWrap::VerifyError(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->ssl_ == NULL) return Null(node_isolate);
+  if (ssl_ == NULL) return Null(node_isolate);
 
 
   // XXX Do this check in JS land?
-  X509* peer_cert = SSL_get_peer_certificate(ss->ssl_);
+  X509* peer_cert = SSL_get_peer_certificate(ssl_);
   if (peer_cert == NULL) {
     // We requested a certificate and they did not send us one.
     // Definitely an error.
@@ -1851,7 +2200,7 @@ Handle<Value> Connection::VerifyError(const Arguments& args) {
   X509_free(peer_cert);
 
 
-  long x509_verify_error = SSL_get_verify_result(ss->ssl_);
+  long x509_verify_error = SSL_get_verify_result(ssl_);
 
   Local<String> s;
 
@@ -1976,15 +2325,13 @@ Handle<Value> Connection::VerifyError(const Arguments& args) {
 }
 
 
-Handle<Value> Connection::GetCurrentCipher(const Arguments& args) {
+Handle<Value> SSLWrap::GetCurrentCipher(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
   OPENSSL_CONST SSL_CIPHER *c;
 
-  if ( ss->ssl_ == NULL ) return Undefined(node_isolate);
-  c = SSL_get_current_cipher(ss->ssl_);
+  if ( ssl_ == NULL ) return Undefined(node_isolate);
+  c = SSL_get_current_cipher(ssl_);
   if ( c == NULL ) return Undefined(node_isolate);
   Local<Object> info = Object::New();
   const char* cipher_name = SSL_CIPHER_get_name(c);
@@ -2007,16 +2354,14 @@ Handle<Value> Connection::Close(const Arguments& args) {
 }
 
 #ifdef OPENSSL_NPN_NEGOTIATED
-Handle<Value> Connection::GetNegotiatedProto(const Arguments& args) {
+Handle<Value> SSLWrap::GetNegotiatedProto(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->is_server_) {
+  if (is_server_) {
     const unsigned char* npn_proto;
     unsigned int npn_proto_len;
 
-    SSL_get0_next_proto_negotiated(ss->ssl_, &npn_proto, &npn_proto_len);
+    SSL_get0_next_proto_negotiated(ssl_, &npn_proto, &npn_proto_len);
 
     if (!npn_proto) {
       return False(node_isolate);
@@ -2025,65 +2370,160 @@ Handle<Value> Connection::GetNegotiatedProto(const Arguments& args) {
     return scope.Close(String::New(reinterpret_cast<const char*>(npn_proto),
                                    npn_proto_len));
   } else {
-    return ss->selectedNPNProto_;
+    return selectedNPNProto_;
   }
 }
 
-Handle<Value> Connection::SetNPNProtocols(const Arguments& args) {
+Handle<Value> SSLWrap::SetNPNProtocols(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
   if (args.Length() < 1 || !Buffer::HasInstance(args[0])) {
     return ThrowException(Exception::Error(String::New(
            "Must give a Buffer as first argument")));
   }
 
   // Release old handle
-  if (!ss->npnProtos_.IsEmpty()) {
-    ss->npnProtos_.Dispose(node_isolate);
+  if (!npnProtos_.IsEmpty()) {
+    npnProtos_.Dispose(node_isolate);
   }
-  ss->npnProtos_ = Persistent<Object>::New(node_isolate, args[0]->ToObject());
+  npnProtos_ = Persistent<Object>::New(node_isolate, args[0]->ToObject());
+  npn_data_ = reinterpret_cast<const unsigned char*>(Buffer::Data(npnProtos_));
+  npn_len_ = Buffer::Length(npnProtos_);
 
   return True(node_isolate);
 };
 #endif
 
 #ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-Handle<Value> Connection::GetServername(const Arguments& args) {
+Handle<Value> SSLWrap::GetServername(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
-  if (ss->is_server_ && !ss->servername_.IsEmpty()) {
-    return ss->servername_;
+  if (is_server_ && !servername_.IsEmpty()) {
+    return servername_;
   } else {
     return False(node_isolate);
   }
 }
 
-Handle<Value> Connection::SetSNICallback(const Arguments& args) {
+Handle<Value> SSLWrap::SetSNICallback(const Arguments& args) {
   HandleScope scope(node_isolate);
 
-  Connection *ss = Connection::Unwrap(args);
-
   if (args.Length() < 1 || !args[0]->IsFunction()) {
     return ThrowException(Exception::Error(String::New(
            "Must give a Function as first argument")));
   }
 
   // Release old handle
-  if (!ss->sniObject_.IsEmpty()) {
-    ss->sniObject_.Dispose(node_isolate);
+  if (!sniObject_.IsEmpty()) {
+    sniObject_.Dispose(node_isolate);
   }
-  ss->sniObject_ = Persistent<Object>::New(node_isolate, Object::New());
-  ss->sniObject_->Set(String::New("onselect"), args[0]);
+  sniObject_ = Persistent<Object>::New(node_isolate, Object::New());
+  sniObject_->Set(String::New("onselect"), args[0]);
 
   return True(node_isolate);
 }
 #endif
 
 
+Handle<Value> AsyncCryptoWrap::QueueJob(const Arguments& args,
+                                        int kind,
+                                        bool with_data) {
+  HandleScope scope(node_isolate);
+
+  AsyncCryptoWrap* wrap = ObjectWrap::Unwrap<AsyncCryptoWrap>(args.This());
+
+  int callback_index = with_data ? 1 : 0;
+  if (with_data) ASSERT_IS_BUFFER(args[0]);
+  if (!args[callback_index]->IsFunction())
+    return ThrowTypeError("Callback must be a function");
+
+  Job* job = new Job();
+  job->wrap_ = wrap;
+  job->kind_ = kind;
+  job->data_ = NULL;
+  job->size_ = 0;
+  job->out_ = NULL;
+  job->out_len_ = 0;
+  job->ok_ = false;
+  job->error_ = 0;
+
+  job->obj_ = Persistent<Object>::New(node_isolate, Object::New());
+  job->obj_->Set(String::New("ondone"), args[callback_index]);
+  if (with_data) {
+    // Keeps the data alive until the job is done.
+    job->obj_->Set(String::New("buffer"), args[0]);
+    job->data_ = Buffer::Data(args[0]);
+    job->size_ = Buffer::Length(args[0]);
+  }
+
+  bool idle = QUEUE_EMPTY(&wrap->jobs_);
+  QUEUE_INSERT_TAIL(&wrap->jobs_, &job->member_);
+  wrap->Ref();
+
+  if (idle) wrap->StartJob();
+
+  return Undefined(node_isolate);
+}
+
+
+void AsyncCryptoWrap::StartJob() {
+  QUEUE* q = static_cast<QUEUE*>(QUEUE_HEAD(&jobs_));
+  Job* job = QUEUE_DATA(q, Job, member_);
+  uv_queue_work(uv_default_loop(), &job->work_req_, JobWork, JobAfter);
+}
+
+
+void AsyncCryptoWrap::JobWork(uv_work_t* work_req) {
+  Job* job = container_of(work_req, Job, work_req_);
+  job->wrap_->RunJob(job);
+  if (!job->ok_) job->error_ = ERR_get_error();
+
+  // The error queue belongs to this thread, the next job starts clean.
+  ERR_clear_error();
+}
+
+
+void AsyncCryptoWrap::JobAfter(uv_work_t* work_req, int status) {
+  assert(status == 0);
+  Threadpool::RecordWork(THREADPOOL_WORK_CRYPTO,
+                         reinterpret_cast<uv_req_t*>(work_req));
+  Job* job = container_of(work_req, Job, work_req_);
+  AsyncCryptoWrap* wrap = job->wrap_;
+  HandleScope scope(node_isolate);
+
+  QUEUE_REMOVE(&job->member_);
+
+  // The next one runs while JS looks at this one's result.
+  if (!QUEUE_EMPTY(&wrap->jobs_)) wrap->StartJob();
+
+  Local<Value> argv[2];
+  if (job->ok_) {
+    argv[0] = Local<Value>::New(node_isolate, Null(node_isolate));
+    if (job->out_ != NULL) {
+      Buffer* buf = Buffer::New(reinterpret_cast<char*>(job->out_),
+                                job->out_len_ > 0 ? job->out_len_ : 0);
+      argv[1] = Local<Object>::New(node_isolate, buf->handle_);
+    } else {
+      argv[1] = Local<Value>::New(node_isolate, Undefined(node_isolate));
+    }
+  } else {
+    char errmsg[256] = "Operation failed";
+    if (job->error_ != 0)
+      ERR_error_string_n(job->error_, errmsg, sizeof errmsg);
+    argv[0] = Exception::Error(String::New(errmsg));
+    argv[1] = Local<Value>::New(node_isolate, Undefined(node_isolate));
+  }
+
+  Persistent<Object> obj = job->obj_;
+  delete[] job->out_;
+  delete job;
+
+  MakeCallback(obj, "ondone", ARRAY_SIZE(argv), argv);
+  obj.Dispose(node_isolate);
+  wrap->Unref();
+}
+
+
 void CipherBase::Initialize(Handle<Object> target) {
   HandleScope scope(node_isolate);
 
@@ -2096,6 +2536,8 @@ void CipherBase::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "update", Update);
   NODE_SET_PROTOTYPE_METHOD(t, "final", Final);
   NODE_SET_PROTOTYPE_METHOD(t, "setAutoPadding", SetAutoPadding);
+  NODE_SET_PROTOTYPE_METHOD(t, "updateAsync", UpdateAsync);
+  NODE_SET_PROTOTYPE_METHOD(t, "finalAsync", FinalAsync);
 
   target->Set(String::NewSymbol("CipherBase"), t->GetFunction());
 }
@@ -2265,6 +2707,7 @@ Handle<Value> CipherBase::Update(const Arguments& args) {
   CipherBase* cipher = ObjectWrap::Unwrap<CipherBase>(args.This());
 
   ASSERT_IS_STRING_OR_BUFFER(args[0]);
+  ASSERT_NO_PENDING_JOBS(cipher);
 
   unsigned char* out = NULL;
   bool r;
@@ -2307,6 +2750,7 @@ Handle<Value> CipherBase::SetAutoPadding(const Arguments& args) {
   HandleScope scope(node_isolate);
 
   CipherBase* cipher = ObjectWrap::Unwrap<CipherBase>(args.This());
+  ASSERT_NO_PENDING_JOBS(cipher);
 
   cipher->SetAutoPadding(args.Length() < 1 || args[0]->BooleanValue());
 
@@ -2330,6 +2774,7 @@ Handle<Value> CipherBase::Final(const Arguments& args) {
   HandleScope scope(node_isolate);
 
   CipherBase* cipher = ObjectWrap::Unwrap<CipherBase>(args.This());
+  ASSERT_NO_PENDING_JOBS(cipher);
 
   unsigned char* out_value = NULL;
   int out_len = -1;
@@ -2350,6 +2795,27 @@ Handle<Value> CipherBase::Final(const Arguments& args) {
 }
 
 
+// updateAsync(buffer, callback), the callback gets the output.
+Handle<Value> CipherBase::UpdateAsync(const Arguments& args) {
+  return QueueJob(args, kUpdateJob, true);
+}
+
+
+// finalAsync(callback), after the updates that were queued before it.
+Handle<Value> CipherBase::FinalAsync(const Arguments& args) {
+  return QueueJob(args, kFinalJob, false);
+}
+
+
+void CipherBase::RunJob(Job* job) {
+  if (job->kind_ == kUpdateJob) {
+    job->ok_ = Update(job->data_, job->size_, &job->out_, &job->out_len_);
+  } else {
+    job->ok_ = Final(&job->out_, &job->out_len_);
+  }
+}
+
+
 void Hmac::Initialize(v8::Handle<v8::Object> target) {
   HandleScope scope(node_isolate);
 
@@ -2360,6 +2826,8 @@ void Hmac::Initialize(v8::Handle<v8::Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "init", HmacInit);
   NODE_SET_PROTOTYPE_METHOD(t, "update", HmacUpdate);
   NODE_SET_PROTOTYPE_METHOD(t, "digest", HmacDigest);
+  NODE_SET_PROTOTYPE_METHOD(t, "updateAsync", HmacUpdateAsync);
+  NODE_SET_PROTOTYPE_METHOD(t, "digestAsync", HmacDigestAsync);
 
   target->Set(String::NewSymbol("Hmac"), t->GetFunction());
 }
@@ -2378,7 +2846,7 @@ Handle<Value> Hmac::HmacInit(char* hashType, char* key, int key_len) {
   HandleScope scope(node_isolate);
 
   assert(md_ == NULL);
-  md_ = EVP_get_digestbyname(hashType);
+  md_ = GetDigestByName(hashType);
   if (md_ == NULL) {
     return ThrowError("Unknown message digest");
   }
@@ -2435,6 +2903,7 @@ Handle<Value> Hmac::HmacUpdate(const Arguments& args) {
   Hmac* hmac = ObjectWrap::Unwrap<Hmac>(args.This());
 
   ASSERT_IS_STRING_OR_BUFFER(args[0]);
+  ASSERT_NO_PENDING_JOBS(hmac);
 
   // Only copy the data if we have to, because it's a string
   bool r;
@@ -2473,6 +2942,7 @@ Handle<Value> Hmac::HmacDigest(const Arguments& args) {
   HandleScope scope(node_isolate);
 
   Hmac* hmac = ObjectWrap::Unwrap<Hmac>(args.This());
+  ASSERT_NO_PENDING_JOBS(hmac);
 
   enum encoding encoding = BUFFER;
   if (args.Length() >= 1) {
@@ -2497,6 +2967,28 @@ Handle<Value> Hmac::HmacDigest(const Arguments& args) {
 }
 
 
+Handle<Value> Hmac::HmacUpdateAsync(const Arguments& args) {
+  return QueueJob(args, kUpdateJob, true);
+}
+
+
+// digestAsync(callback), the callback gets the digest as a Buffer.
+Handle<Value> Hmac::HmacDigestAsync(const Arguments& args) {
+  return QueueJob(args, kDigestJob, false);
+}
+
+
+void Hmac::RunJob(Job* job) {
+  if (job->kind_ == kUpdateJob) {
+    job->ok_ = HmacUpdate(job->data_, job->size_);
+  } else {
+    unsigned int md_len = 0;
+    job->ok_ = HmacDigest(&job->out_, &md_len);
+    job->out_len_ = md_len;
+  }
+}
+
+
 void Hash::Initialize(v8::Handle<v8::Object> target) {
   HandleScope scope(node_isolate);
 
@@ -2506,6 +2998,8 @@ void Hash::Initialize(v8::Handle<v8::Object> target) {
 
   NODE_SET_PROTOTYPE_METHOD(t, "update", HashUpdate);
   NODE_SET_PROTOTYPE_METHOD(t, "digest", HashDigest);
+  NODE_SET_PROTOTYPE_METHOD(t, "updateAsync", HashUpdateAsync);
+  NODE_SET_PROTOTYPE_METHOD(t, "digestAsync", HashDigestAsync);
 
   target->Set(String::NewSymbol("Hash"), t->GetFunction());
 }
@@ -2533,7 +3027,7 @@ Handle<Value> Hash::New(const Arguments& args) {
 
 bool Hash::HashInit(const char* hashType) {
   assert(md_ == NULL);
-  md_ = EVP_get_digestbyname(hashType);
+  md_ = GetDigestByName(hashType);
   if (md_ == NULL) return false;
   EVP_MD_CTX_init(&mdctx_);
   EVP_DigestInit_ex(&mdctx_, md_, NULL);
@@ -2555,6 +3049,7 @@ Handle<Value> Hash::HashUpdate(const Arguments& args) {
   Hash* hash = ObjectWrap::Unwrap<Hash>(args.This());
 
   ASSERT_IS_STRING_OR_BUFFER(args[0]);
+  ASSERT_NO_PENDING_JOBS(hash);
 
   // Only copy the data if we have to, because it's a string
   bool r;
@@ -2583,6 +3078,7 @@ Handle<Value> Hash::HashDigest(const Arguments& args) {
   HandleScope scope(node_isolate);
 
   Hash* hash = ObjectWrap::Unwrap<Hash>(args.This());
+  ASSERT_NO_PENDING_JOBS(hash);
 
   if (!hash->initialised_) {
     return ThrowError("Not initialized");
@@ -2605,6 +3101,36 @@ Handle<Value> Hash::HashDigest(const Arguments& args) {
 }
 
 
+Handle<Value> Hash::HashUpdateAsync(const Arguments& args) {
+  return QueueJob(args, kUpdateJob, true);
+}
+
+
+// digestAsync(callback), the callback gets the digest as a Buffer.
+Handle<Value> Hash::HashDigestAsync(const Arguments& args) {
+  return QueueJob(args, kDigestJob, false);
+}
+
+
+void Hash::RunJob(Job* job) {
+  if (job->kind_ == kUpdateJob) {
+    job->ok_ = HashUpdate(job->data_, job->size_);
+    return;
+  }
+
+  if (!initialised_) return;
+
+  unsigned int md_len;
+  job->out_ = new unsigned char[EVP_MAX_MD_SIZE];
+  EVP_DigestFinal_ex(&mdctx_, job->out_, &md_len);
+  EVP_MD_CTX_cleanup(&mdctx_);
+  initialised_ = false;
+
+  job->out_len_ = md_len;
+  job->ok_ = true;
+}
+
+
 void Sign::Initialize(v8::Handle<v8::Object> target) {
   HandleScope scope(node_isolate);
 
@@ -2615,6 +3141,8 @@ void Sign::Initialize(v8::Handle<v8::Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "init", SignInit);
   NODE_SET_PROTOTYPE_METHOD(t, "update", SignUpdate);
   NODE_SET_PROTOTYPE_METHOD(t, "sign", SignFinal);
+  NODE_SET_PROTOTYPE_METHOD(t, "updateAsync", SignUpdateAsync);
+  NODE_SET_PROTOTYPE_METHOD(t, "signAsync", SignFinalAsync);
 
   target->Set(String::NewSymbol("Sign"), t->GetFunction());
 }
@@ -2679,6 +3207,7 @@ Handle<Value> Sign::SignUpdate(const Arguments& args) {
   Sign* sign = ObjectWrap::Unwrap<Sign>(args.This());
 
   ASSERT_IS_STRING_OR_BUFFER(args[0]);
+  ASSERT_NO_PENDING_JOBS(sign);
 
   // Only copy the data if we have to, because it's a string
   int r;
@@ -2730,6 +3259,7 @@ Handle<Value> Sign::SignFinal(const Arguments& args) {
   HandleScope scope(node_isolate);
 
   Sign* sign = ObjectWrap::Unwrap<Sign>(args.This());
+  ASSERT_NO_PENDING_JOBS(sign);
 
   unsigned char* md_value;
   unsigned int md_len;
@@ -2762,6 +3292,30 @@ Handle<Value> Sign::SignFinal(const Arguments& args) {
 }
 
 
+Handle<Value> Sign::SignUpdateAsync(const Arguments& args) {
+  return QueueJob(args, kUpdateJob, true);
+}
+
+
+// signAsync(key, callback), the callback gets the signature as a Buffer.
+Handle<Value> Sign::SignFinalAsync(const Arguments& args) {
+  return QueueJob(args, kSignJob, true);
+}
+
+
+void Sign::RunJob(Job* job) {
+  if (job->kind_ == kUpdateJob) {
+    job->ok_ = SignUpdate(job->data_, job->size_);
+    return;
+  }
+
+  unsigned int md_len = 8192;  // Maximum key size is 8192 bits
+  job->out_ = new unsigned char[md_len];
+  job->ok_ = SignFinal(&job->out_, &md_len, job->data_, job->size_);
+  job->out_len_ = md_len;
+}
+
+
 void Verify::Initialize(v8::Handle<v8::Object> target) {
   HandleScope scope(node_isolate);
 
@@ -3421,6 +3975,8 @@ void EIO_PBKDF2After(pbkdf2_req* req, Local<Value> argv[2]) {
 
 void EIO_PBKDF2After(uv_work_t* work_req, int status) {
   assert(status == 0);
+  Threadpool::RecordWork(THREADPOOL_WORK_PBKDF2,
+                         reinterpret_cast<uv_req_t*>(work_req));
   pbkdf2_req* req = container_of(work_req, pbkdf2_req, work_req);
   HandleScope scope(node_isolate);
   Local<Value> argv[2];
@@ -3595,6 +4151,8 @@ void RandomBytesCheck(RandomBytesRequest* req, Local<Value> argv[2]) {
 
 void RandomBytesAfter(uv_work_t* work_req, int status) {
   assert(status == 0);
+  Threadpool::RecordWork(THREADPOOL_WORK_RANDOM_BYTES,
+                         reinterpret_cast<uv_req_t*>(work_req));
   RandomBytesRequest* req = container_of(work_req,
                                          RandomBytesRequest,
                                          work_req_);
@@ -3706,6 +4264,109 @@ Handle<Value> GetHashes(const Arguments& args) {
 }
 
 
+// The bytes of a string or Buffer argument. Strings that are short enough
+// are decoded on the stack.
+class InputData {
+ public:
+  InputData(Handle<Value> value, Handle<Value> encoding) : heap_(NULL) {
+    if (Buffer::HasInstance(value)) {
+      data_ = Buffer::Data(value);
+      size_ = Buffer::Length(value);
+      return;
+    }
+
+    enum encoding enc = ParseEncoding(encoding, BINARY);
+    size_t storage = StringBytes::StorageSize(value, enc);
+    data_ = stack_;
+    if (storage > sizeof(stack_))
+      data_ = heap_ = new char[storage];
+    size_ = StringBytes::Write(data_, storage, value, enc);
+  }
+
+  ~InputData() {
+    delete[] heap_;
+  }
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  char stack_[1024];
+  char* heap_;
+  char* data_;
+  size_t size_;
+};
+
+
+// hash(algorithm, data, input_encoding, output_encoding) is
+// createHash(algorithm).update(data).digest() without the objects.
+Handle<Value> OneShotHash(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  if (!args[0]->IsString())
+    return ThrowError("Must give hashtype string as argument");
+  ASSERT_IS_STRING_OR_BUFFER(args[1]);
+
+  String::Utf8Value hash_type(args[0]);
+  const EVP_MD* md = GetDigestByName(*hash_type);
+  if (md == NULL) return ThrowError("Digest method not supported");
+
+  InputData input(args[1], args[2]);
+  unsigned char md_value[EVP_MAX_MD_SIZE];
+  unsigned int md_len;
+
+  if (!EVP_DigestInit_ex(&oneshot_md_ctx, md, NULL))
+    return ThrowError("Digest method not supported");
+  if (!EVP_DigestUpdate(&oneshot_md_ctx, input.data(), input.size()))
+    return ThrowTypeError("HashUpdate fail");
+  if (!EVP_DigestFinal_ex(&oneshot_md_ctx, md_value, &md_len))
+    return ThrowError("Digest failed");
+
+  enum encoding encoding = ParseEncoding(args[3], BUFFER);
+  return scope.Close(StringBytes::Encode(
+        reinterpret_cast<const char*>(md_value), md_len, encoding));
+}
+
+
+// hmac(algorithm, key, data, input_encoding, output_encoding), the key is
+// a Buffer.
+Handle<Value> OneShotHmac(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  if (!args[0]->IsString())
+    return ThrowError("Must give hashtype string as argument");
+  ASSERT_IS_BUFFER(args[1]);
+  ASSERT_IS_STRING_OR_BUFFER(args[2]);
+
+  String::Utf8Value hash_type(args[0]);
+  const EVP_MD* md = GetDigestByName(*hash_type);
+  if (md == NULL) return ThrowError("Unknown message digest");
+
+  // A NULL key would mean the previous call's key.
+  const char* key = Buffer::Data(args[1]);
+  size_t key_len = Buffer::Length(args[1]);
+  if (key_len == 0) key = "";
+
+  InputData input(args[2], args[3]);
+  unsigned char md_value[EVP_MAX_MD_SIZE];
+  unsigned int md_len;
+
+  if (!HMAC_Init_ex(&oneshot_hmac_ctx, key, key_len, md, NULL))
+    return ThrowError("Unknown message digest");
+  if (!HMAC_Update(&oneshot_hmac_ctx,
+                   reinterpret_cast<unsigned char*>(input.data()),
+                   input.size())) {
+    return ThrowTypeError("HmacUpdate fail");
+  }
+  if (!HMAC_Final(&oneshot_hmac_ctx, md_value, &md_len))
+    return ThrowError("Digest failed");
+
+  enum encoding encoding = ParseEncoding(args[4], BUFFER);
+  return scope.Close(StringBytes::Encode(
+        reinterpret_cast<const char*>(md_value), md_len, encoding));
+}
+
+
 void InitCrypto(Handle<Object> target) {
   HandleScope scope(node_isolate);
 
@@ -3719,6 +4380,9 @@ void InitCrypto(Handle<Object> target) {
   CRYPTO_set_locking_callback(crypto_lock_cb);
   CRYPTO_THREADID_set_callback(crypto_threadid_cb);
 
+  EVP_MD_CTX_init(&oneshot_md_ctx);
+  HMAC_CTX_init(&oneshot_hmac_ctx);
+
   // Turn off compression. Saves memory - do it in userland.
 #if !defined(OPENSSL_NO_COMP)
   STACK_OF(SSL_COMP)* comp_methods =
@@ -3747,6 +4411,8 @@ void InitCrypto(Handle<Object> target) {
   NODE_SET_METHOD(target, "getSSLCiphers", GetSSLCiphers);
   NODE_SET_METHOD(target, "getCiphers", GetCiphers);
   NODE_SET_METHOD(target, "getHashes", GetHashes);
+  NODE_SET_METHOD(target, "hash", OneShotHash);
+  NODE_SET_METHOD(target, "hmac", OneShotHmac);
 
   subject_symbol    = NODE_PSYMBOL("subject");
   issuer_symbol     = NODE_PSYMBOL("issuer");
@@ -24,7 +24,10 @@
 
 #include "node.h"
 
+#include "node_crypto_session_cache.h"
 #include "node_object_wrap.h"
+#include "queue.h"
+#include "uv.h"
 #include "v8.h"
 
 #include <openssl/ssl.h>
@@ -36,6 +39,8 @@
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
 #include <openssl/pkcs12.h>
+#include <stdlib.h>  // abort()
+#include <string.h>  // memset()
 
 #ifdef OPENSSL_NPN_NEGOTIATED
 #include "node_buffer.h"
@@ -60,6 +65,8 @@ class SecureContext : ObjectWrap {
   // TODO: ca_store_ should probably be removed, it's not used anywhere.
   X509_STORE *ca_store_;
 
+  inline bool offload_handshake() const { return offload_handshake_; }
+
  protected:
   static const int kMaxSessionSize = 10 * 1024;
 
@@ -76,20 +83,67 @@ class SecureContext : ObjectWrap {
   static v8::Handle<v8::Value> SetSessionTimeout(const v8::Arguments& args);
   static v8::Handle<v8::Value> Close(const v8::Arguments& args);
   static v8::Handle<v8::Value> LoadPKCS12(const v8::Arguments& args);
+  static v8::Handle<v8::Value> EnableSessionCache(const v8::Arguments& args);
+  static v8::Handle<v8::Value> AddSession(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetTicketKeys(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetSessionStats(const v8::Arguments& args);
+  static v8::Handle<v8::Value> EnableHandshakeOffload(
+      const v8::Arguments& args);
+
+  // Looks up the context that the server side session cache and the
+  // ticket keys of `s` belong to, SNI doesn't change that one.
+  static SecureContext* FromSSL(SSL* s);
 
   static SSL_SESSION* GetSessionCallback(SSL* s,
                                          unsigned char* key,
                                          int len,
                                          int* copy);
   static int NewSessionCallback(SSL* s, SSL_SESSION* sess);
+  static void RemoveSessionCallback(SSL_CTX* ctx, SSL_SESSION* sess);
+  static int TicketKeyCallback(SSL* s,
+                               unsigned char* name,
+                               unsigned char* iv,
+                               EVP_CIPHER_CTX* ectx,
+                               HMAC_CTX* hctx,
+                               int enc);
+  int UseTicketKey(unsigned char* name,
+                   unsigned char* iv,
+                   EVP_CIPHER_CTX* ectx,
+                   HMAC_CTX* hctx,
+                   int enc);
+
+  // Key name, HMAC secret and AES key, in the order of the 48 bytes that
+  // setTicketKeys() takes.
+  struct TicketKey {
+    unsigned char name_[16];
+    unsigned char hmac_secret_[16];
+    unsigned char aes_key_[16];
+  };
+
+  struct TicketStats {
+    uint64_t hits;
+    uint64_t renewals;
+    uint64_t misses;
+  };
 
   SecureContext() : ObjectWrap() {
     ctx_ = NULL;
     ca_store_ = NULL;
+    session_cache_ = NULL;
+    ticket_key_count_ = 0;
+    memset(&ticket_stats_, 0, sizeof(ticket_stats_));
+    if (uv_mutex_init(&ticket_keys_mutex_)) abort();
+    offload_handshake_ = false;
   }
 
   void FreeCTXMem() {
+    delete session_cache_;
+    session_cache_ = NULL;
+
     if (ctx_) {
+      // SSL objects can keep ctx_ alive for longer than this.
+      SSL_CTX_set_app_data(ctx_, NULL);
+
       if (ctx_->cert_store == root_cert_store) {
         // SSL_CTX_free() will attempt to free the cert_store as well.
         // Since we want our root_cert_store to stay around forever
@@ -107,11 +161,182 @@ class SecureContext : ObjectWrap {
 
   ~SecureContext() {
     FreeCTXMem();
+    uv_mutex_destroy(&ticket_keys_mutex_);
+  }
+
+  SessionCache* session_cache_;
+
+  // The current key encrypts, the one before it still decrypts so that
+  // tickets survive a rotation.
+  TicketKey ticket_keys_[2];
+  int ticket_key_count_;
+  TicketStats ticket_stats_;
+  uv_mutex_t ticket_keys_mutex_;  // handshakes can run on the thread pool
+
+  // Servers run the handshakes of native TLS sockets on the thread pool.
+  bool offload_handshake_;
+
+ private:
+  friend class SSLWrap;
+};
+
+// What Connection and the TLS stream in tls_wrap.cc have in common: the
+// SSL object, the OpenSSL callbacks and the JS methods that only look at
+// the SSL state. SSL_get_app_data() of the SSL points at the SSLWrap.
+class SSLWrap {
+ public:
+  // The object that the onhandshakestart, onhandshakedone, onnewsession
+  // and SNI callbacks are made on.
+  virtual v8::Handle<v8::Object> GetObject() = 0;
+
+  // Adds the shared methods to the prototype of Base, which must have a
+  // static Base* Unwrap(const v8::Arguments&) that may return NULL.
+  template <class Base>
+  static void AddMethods(v8::Handle<v8::FunctionTemplate> t);
+
+#ifdef OPENSSL_NPN_NEGOTIATED
+  v8::Persistent<v8::Object> npnProtos_;
+  v8::Persistent<v8::Value> selectedNPNProto_;
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  v8::Persistent<v8::Object> sniObject_;
+  v8::Persistent<v8::Value> sniContext_;
+  v8::Persistent<v8::String> servername_;
+#endif
+
+ protected:
+  SSLWrap() : ssl_(NULL),
+              is_server_(false),
+              next_sess_(NULL),
+              in_threadpool_(false),
+              new_sess_(NULL),
+              npn_data_(NULL),
+              npn_len_(0),
+              sni_ctx_(NULL),
+              sni_result_(SSL_TLSEXT_ERR_OK) {
   }
 
+  virtual ~SSLWrap();
+
+  // Creates ssl_ for `sc` and installs the callbacks. The caller still
+  // has to set up the BIOs and the verify mode.
+  void NewSSL(SecureContext* sc, bool is_server);
+
+  // request_cert and reject_unauthorized only matter for servers.
+  void SetVerifyMode(bool request_cert, bool reject_unauthorized);
+
+  // Called from inside OpenSSL, the default calls into JS right away.
+  virtual void OnHandshakeStart();
+  virtual void OnHandshakeDone();
+
+  // Stores a session that OpenSSL created in the context's cache and
+  // hands it to onnewsession.
+  void NewSession(SSL_SESSION* sess);
+
+  // Runs what had to wait while ssl_ was on the thread pool.
+  void RunDeferredCallbacks();
+
+  // Makes the SNI callback pick the context for `servername`, up front
+  // when the handshake is going to run on the thread pool.
+  int SelectSNIContext(const char* servername);
+
+  v8::Handle<v8::Value> GetPeerCertificate(const v8::Arguments& args);
+  v8::Handle<v8::Value> GetSession(const v8::Arguments& args);
+  v8::Handle<v8::Value> SetSession(const v8::Arguments& args);
+  v8::Handle<v8::Value> IsSessionReused(const v8::Arguments& args);
+  v8::Handle<v8::Value> VerifyError(const v8::Arguments& args);
+  v8::Handle<v8::Value> GetCurrentCipher(const v8::Arguments& args);
+
+#ifdef OPENSSL_NPN_NEGOTIATED
+  // NPN
+  v8::Handle<v8::Value> GetNegotiatedProto(const v8::Arguments& args);
+  v8::Handle<v8::Value> SetNPNProtocols(const v8::Arguments& args);
+  static int AdvertiseNextProtoCallback_(SSL *s,
+                                         const unsigned char **data,
+                                         unsigned int *len,
+                                         void *arg);
+  static int SelectNextProtoCallback_(SSL *s,
+                                      unsigned char **out, unsigned char *outlen,
+                                      const unsigned char* in,
+                                      unsigned int inlen, void *arg);
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  // SNI
+  v8::Handle<v8::Value> GetServername(const v8::Arguments& args);
+  v8::Handle<v8::Value> SetSNICallback(const v8::Arguments& args);
+  static int SelectSNIContextCallback_(SSL *s, int *ad, void* arg);
+#endif
+
+  // Installed on servers by NewSSL(), calls OnHandshakeStart/Done.
+  static void SSLInfoCallback(const SSL *ssl, int where, int ret);
+
+  SSL *ssl_;
+  bool is_server_; /* coverity[member_decl] */
+  SSL_SESSION* next_sess_;
+
+  // Set while a thread pool thread has ssl_. Callbacks that need V8 are
+  // deferred then and the JS methods don't touch ssl_.
+  bool in_threadpool_;
+  SSL_SESSION* new_sess_;
+
+  // Copies of npnProtos_ and of what the SNI callback decided that don't
+  // need V8 to look at.
+  const unsigned char* npn_data_;
+  unsigned int npn_len_;
+  SSL_CTX* sni_ctx_;
+  int sni_result_;
+
  private:
+  typedef v8::Handle<v8::Value> (SSLWrap::*Method)(const v8::Arguments&);
+
+  template <class Base, Method method>
+  static v8::Handle<v8::Value> Call(const v8::Arguments& args);
+
+  friend class SecureContext;
 };
 
+
+template <class Base, SSLWrap::Method method>
+v8::Handle<v8::Value> SSLWrap::Call(const v8::Arguments& args) {
+  v8::HandleScope scope(node_isolate);
+  Base* base = Base::Unwrap(args);
+  if (base == NULL || base->in_threadpool_) return v8::Undefined(node_isolate);
+  return scope.Close((base->*method)(args));
+}
+
+
+template <class Base>
+void SSLWrap::AddMethods(v8::Handle<v8::FunctionTemplate> t) {
+  NODE_SET_PROTOTYPE_METHOD(t, "getPeerCertificate",
+                            (Call<Base, &SSLWrap::GetPeerCertificate>));
+  NODE_SET_PROTOTYPE_METHOD(t, "getSession",
+                            (Call<Base, &SSLWrap::GetSession>));
+  NODE_SET_PROTOTYPE_METHOD(t, "setSession",
+                            (Call<Base, &SSLWrap::SetSession>));
+  NODE_SET_PROTOTYPE_METHOD(t, "isSessionReused",
+                            (Call<Base, &SSLWrap::IsSessionReused>));
+  NODE_SET_PROTOTYPE_METHOD(t, "verifyError",
+                            (Call<Base, &SSLWrap::VerifyError>));
+  NODE_SET_PROTOTYPE_METHOD(t, "getCurrentCipher",
+                            (Call<Base, &SSLWrap::GetCurrentCipher>));
+
+#ifdef OPENSSL_NPN_NEGOTIATED
+  NODE_SET_PROTOTYPE_METHOD(t, "getNegotiatedProtocol",
+                            (Call<Base, &SSLWrap::GetNegotiatedProto>));
+  NODE_SET_PROTOTYPE_METHOD(t, "setNPNProtocols",
+                            (Call<Base, &SSLWrap::SetNPNProtocols>));
+#endif
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  NODE_SET_PROTOTYPE_METHOD(t, "getServername",
+                            (Call<Base, &SSLWrap::GetServername>));
+  NODE_SET_PROTOTYPE_METHOD(t, "setSNICallback",
+                            (Call<Base, &SSLWrap::SetSNICallback>));
+#endif
+}
+
 class ClientHelloParser {
  public:
   enum FrameType {
@@ -155,20 +380,11 @@ class ClientHelloParser {
   size_t body_offset_;
 };
 
-class Connection : ObjectWrap {
+class Connection : ObjectWrap, public SSLWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
-#ifdef OPENSSL_NPN_NEGOTIATED
-  v8::Persistent<v8::Object> npnProtos_;
-  v8::Persistent<v8::Value> selectedNPNProto_;
-#endif
-
-#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-  v8::Persistent<v8::Object> sniObject_;
-  v8::Persistent<v8::Value> sniContext_;
-  v8::Persistent<v8::String> servername_;
-#endif
+  v8::Handle<v8::Object> GetObject() { return handle_; }
 
  protected:
   static v8::Handle<v8::Value> New(const v8::Arguments& args);
@@ -178,40 +394,13 @@ class Connection : ObjectWrap {
   static v8::Handle<v8::Value> EncPending(const v8::Arguments& args);
   static v8::Handle<v8::Value> EncOut(const v8::Arguments& args);
   static v8::Handle<v8::Value> ClearIn(const v8::Arguments& args);
-  static v8::Handle<v8::Value> GetPeerCertificate(const v8::Arguments& args);
-  static v8::Handle<v8::Value> GetSession(const v8::Arguments& args);
-  static v8::Handle<v8::Value> SetSession(const v8::Arguments& args);
   static v8::Handle<v8::Value> LoadSession(const v8::Arguments& args);
-  static v8::Handle<v8::Value> IsSessionReused(const v8::Arguments& args);
   static v8::Handle<v8::Value> IsInitFinished(const v8::Arguments& args);
-  static v8::Handle<v8::Value> VerifyError(const v8::Arguments& args);
-  static v8::Handle<v8::Value> GetCurrentCipher(const v8::Arguments& args);
   static v8::Handle<v8::Value> Shutdown(const v8::Arguments& args);
   static v8::Handle<v8::Value> ReceivedShutdown(const v8::Arguments& args);
   static v8::Handle<v8::Value> Start(const v8::Arguments& args);
   static v8::Handle<v8::Value> Close(const v8::Arguments& args);
 
-#ifdef OPENSSL_NPN_NEGOTIATED
-  // NPN
-  static v8::Handle<v8::Value> GetNegotiatedProto(const v8::Arguments& args);
-  static v8::Handle<v8::Value> SetNPNProtocols(const v8::Arguments& args);
-  static int AdvertiseNextProtoCallback_(SSL *s,
-                                         const unsigned char **data,
-                                         unsigned int *len,
-                                         void *arg);
-  static int SelectNextProtoCallback_(SSL *s,
-                                      unsigned char **out, unsigned char *outlen,
-                                      const unsigned char* in,
-                                      unsigned int inlen, void *arg);
-#endif
-
-#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-  // SNI
-  static v8::Handle<v8::Value> GetServername(const v8::Arguments& args);
-  static v8::Handle<v8::Value> SetSNICallback(const v8::Arguments& args);
-  static int SelectSNIContextCallback_(SSL *s, int *ad, void* arg);
-#endif
-
   int HandleBIOError(BIO *bio, const char* func, int rv);
 
   enum ZeroStatus {
@@ -237,50 +426,69 @@ class Connection : ObjectWrap {
 
   Connection() : ObjectWrap(), hello_parser_(this) {
     bio_read_ = bio_write_ = NULL;
-    ssl_ = NULL;
-    next_sess_ = NULL;
   }
 
-  ~Connection() {
-    if (ssl_ != NULL) {
-      SSL_free(ssl_);
-      ssl_ = NULL;
-    }
+ private:
+  BIO *bio_read_;
+  BIO *bio_write_;
 
-    if (next_sess_ != NULL) {
-      SSL_SESSION_free(next_sess_);
-      next_sess_ = NULL;
-    }
+  ClientHelloParser hello_parser_;
 
-#ifdef OPENSSL_NPN_NEGOTIATED
-    if (!npnProtos_.IsEmpty()) npnProtos_.Dispose(node_isolate);
-    if (!selectedNPNProto_.IsEmpty()) selectedNPNProto_.Dispose(node_isolate);
-#endif
+  friend class ClientHelloParser;
+  friend class SSLWrap;
+};
 
-#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
-   if (!sniObject_.IsEmpty()) sniObject_.Dispose(node_isolate);
-   if (!sniContext_.IsEmpty()) sniContext_.Dispose(node_isolate);
-   if (!servername_.IsEmpty()) servername_.Dispose(node_isolate);
-#endif
+// Base of the classes whose updates can also run on the thread pool. The
+// jobs of an object run one at a time in the order they were queued, and
+// the synchronous methods refuse to run while any of them are pending.
+class AsyncCryptoWrap : public ObjectWrap {
+ public:
+  inline bool HasPendingJobs() { return !QUEUE_EMPTY(&jobs_); }
+
+ protected:
+  struct Job {
+    uv_work_t work_req_;
+    AsyncCryptoWrap* wrap_;
+    int kind_;
+    v8::Persistent<v8::Object> obj_;  // ondone and the input buffer
+    char* data_;
+    size_t size_;
+    unsigned char* out_;  // the result, if any, new[]'d
+    int out_len_;
+    bool ok_;
+    unsigned long error_;  // openssl error code or zero
+    QUEUE member_;
+  };
+
+  AsyncCryptoWrap() {
+    QUEUE_INIT(&jobs_);
   }
 
- private:
-  static void SSLInfoCallback(const SSL *ssl, int where, int ret);
+  // A job keeps the object alive, there are none left by now.
+  virtual ~AsyncCryptoWrap() {
+    assert(QUEUE_EMPTY(&jobs_));
+  }
 
-  BIO *bio_read_;
-  BIO *bio_write_;
-  SSL *ssl_;
+  // Queues a job of `kind`. args[0] is the input buffer if `with_data`,
+  // the last argument is called with an error and a Buffer with the
+  // output, if there is any.
+  static v8::Handle<v8::Value> QueueJob(const v8::Arguments& args,
+                                        int kind,
+                                        bool with_data);
 
-  ClientHelloParser hello_parser_;
+  // Runs on the thread pool, sets the job's output and ok_.
+  virtual void RunJob(Job* job) = 0;
 
-  bool is_server_; /* coverity[member_decl] */
-  SSL_SESSION* next_sess_;
+ private:
+  void StartJob();
 
-  friend class ClientHelloParser;
-  friend class SecureContext;
+  static void JobWork(uv_work_t* work_req);
+  static void JobAfter(uv_work_t* work_req, int status);
+
+  QUEUE jobs_;
 };
 
-class CipherBase : public ObjectWrap {
+class CipherBase : public AsyncCryptoWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
@@ -306,6 +514,15 @@ class CipherBase : public ObjectWrap {
   static v8::Handle<v8::Value> Update(const v8::Arguments& args);
   static v8::Handle<v8::Value> Final(const v8::Arguments& args);
   static v8::Handle<v8::Value> SetAutoPadding(const v8::Arguments& args);
+  static v8::Handle<v8::Value> UpdateAsync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> FinalAsync(const v8::Arguments& args);
+
+  enum JobKind {
+    kUpdateJob,
+    kFinalJob
+  };
+
+  void RunJob(Job* job);
 
   CipherBase(CipherKind kind) : cipher_(NULL),
                                 initialised_(false),
@@ -324,7 +541,7 @@ class CipherBase : public ObjectWrap {
   CipherKind kind_;
 };
 
-class Hmac : public ObjectWrap {
+class Hmac : public AsyncCryptoWrap {
  public:
   static void Initialize (v8::Handle<v8::Object> target);
 
@@ -337,6 +554,15 @@ class Hmac : public ObjectWrap {
   static v8::Handle<v8::Value> HmacInit(const v8::Arguments& args);
   static v8::Handle<v8::Value> HmacUpdate(const v8::Arguments& args);
   static v8::Handle<v8::Value> HmacDigest(const v8::Arguments& args);
+  static v8::Handle<v8::Value> HmacUpdateAsync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> HmacDigestAsync(const v8::Arguments& args);
+
+  enum JobKind {
+    kUpdateJob,
+    kDigestJob
+  };
+
+  void RunJob(Job* job);
 
   Hmac() : md_(NULL), initialised_(false) {
   }
@@ -352,7 +578,7 @@ class Hmac : public ObjectWrap {
   bool initialised_;
 };
 
-class Hash : public ObjectWrap {
+class Hash : public AsyncCryptoWrap {
  public:
   static void Initialize (v8::Handle<v8::Object> target);
 
@@ -363,6 +589,15 @@ class Hash : public ObjectWrap {
   static v8::Handle<v8::Value> New(const v8::Arguments& args);
   static v8::Handle<v8::Value> HashUpdate(const v8::Arguments& args);
   static v8::Handle<v8::Value> HashDigest(const v8::Arguments& args);
+  static v8::Handle<v8::Value> HashUpdateAsync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> HashDigestAsync(const v8::Arguments& args);
+
+  enum JobKind {
+    kUpdateJob,
+    kDigestJob
+  };
+
+  void RunJob(Job* job);
 
   Hash() : md_(NULL), initialised_(false) {
   }
@@ -378,7 +613,7 @@ class Hash : public ObjectWrap {
   bool initialised_;
 };
 
-class Sign : public ObjectWrap {
+class Sign : public AsyncCryptoWrap {
  public:
   static void Initialize(v8::Handle<v8::Object> target);
 
@@ -394,6 +629,15 @@ class Sign : public ObjectWrap {
   static v8::Handle<v8::Value> SignInit(const v8::Arguments& args);
   static v8::Handle<v8::Value> SignUpdate(const v8::Arguments& args);
   static v8::Handle<v8::Value> SignFinal(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SignUpdateAsync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SignFinalAsync(const v8::Arguments& args);
+
+  enum JobKind {
+    kUpdateJob,
+    kSignJob
+  };
+
+  void RunJob(Job* job);
 
   Sign() : md_(NULL), initialised_(false) {
   }
@@ -21,6 +21,8 @@
 
 #include "node_crypto_bio.h"
 #include "openssl/bio.h"
+#include "uv.h"
+#include <stdlib.h>  // abort()
 #include <string.h>
 
 namespace node {
@@ -38,6 +40,17 @@ BIO_METHOD NodeBIO::method_ = {
   NULL
 };
 
+NodeBIO::Buffer* NodeBIO::free_list_ = NULL;
+size_t NodeBIO::free_count_ = 0;
+static uv_mutex_t free_list_mutex;
+static uv_once_t free_list_once = UV_ONCE_INIT;
+
+
+static void InitFreeList() {
+  if (uv_mutex_init(&free_list_mutex))
+    abort();
+}
+
 
 int NodeBIO::New(BIO* bio) {
   bio->ptr = new NodeBIO();
@@ -175,78 +188,165 @@ long NodeBIO::Ctrl(BIO* bio, int cmd, long num, void* ptr) {
 }
 
 
+NodeBIO::Buffer* NodeBIO::NewBuffer() {
+  uv_once(&free_list_once, InitFreeList);
+  uv_mutex_lock(&free_list_mutex);
+
+  Buffer* buffer = free_list_;
+  if (buffer != NULL) {
+    free_list_ = buffer->next_;
+    free_count_--;
+  }
+
+  uv_mutex_unlock(&free_list_mutex);
+
+  if (buffer == NULL)
+    return new Buffer();
+
+  buffer->read_pos_ = 0;
+  buffer->write_pos_ = 0;
+  buffer->next_ = NULL;
+  return buffer;
+}
+
+
+void NodeBIO::FreeBuffer(Buffer* buffer) {
+  uv_once(&free_list_once, InitFreeList);
+  uv_mutex_lock(&free_list_mutex);
+
+  bool keep = free_count_ < kMaxFreeBuffers;
+  if (keep) {
+    buffer->next_ = free_list_;
+    free_list_ = buffer;
+    free_count_++;
+  }
+
+  uv_mutex_unlock(&free_list_mutex);
+
+  if (!keep)
+    delete buffer;
+}
+
+
+void NodeBIO::ReleaseBuffers() {
+  Buffer* current = read_head_;
+  while (current != NULL) {
+    Buffer* next = current->next_;
+    FreeBuffer(current);
+    current = next;
+  }
+
+  read_head_ = NULL;
+  write_head_ = NULL;
+}
+
+
 size_t NodeBIO::Read(char* out, size_t size) {
   size_t bytes_read = 0;
   size_t expected = Length() > size ? size : Length();
-  size_t offset = 0;
-  size_t left = size;
 
   while (bytes_read < expected) {
+    assert(read_head_ != NULL);
     assert(read_head_->read_pos_ <= read_head_->write_pos_);
     size_t avail = read_head_->write_pos_ - read_head_->read_pos_;
-    if (avail > left)
-      avail = left;
+    if (avail > expected - bytes_read)
+      avail = expected - bytes_read;
 
     // Copy data
-    if (out != NULL)
-      memcpy(out + offset, read_head_->data_ + read_head_->read_pos_, avail);
+    if (out != NULL) {
+      memcpy(out + bytes_read,
+             read_head_->data_ + read_head_->read_pos_,
+             avail);
+    }
     read_head_->read_pos_ += avail;
-
-    // Move pointers
     bytes_read += avail;
-    offset += avail;
-    left -= avail;
 
-    // Move to next buffer
-    if (read_head_->read_pos_ == read_head_->write_pos_) {
-      read_head_->read_pos_ = 0;
-      read_head_->write_pos_ = 0;
-
-      // But not get beyond write_head_
-      if (bytes_read != expected)
-        read_head_ = read_head_->next_;
+    // Move to next buffer, but not beyond write_head_
+    if (read_head_->read_pos_ == read_head_->write_pos_ &&
+        read_head_ != write_head_) {
+      Buffer* next = read_head_->next_;
+      FreeBuffer(read_head_);
+      read_head_ = next;
     }
   }
   assert(expected == bytes_read);
   length_ -= bytes_read;
 
+  if (length_ == 0)
+    ReleaseBuffers();
+
   return bytes_read;
 }
 
 
+char* NodeBIO::Peek(size_t* size) {
+  if (length_ == 0) {
+    *size = 0;
+    return NULL;
+  }
+
+  *size = read_head_->write_pos_ - read_head_->read_pos_;
+  return read_head_->data_ + read_head_->read_pos_;
+}
+
+
+size_t NodeBIO::PeekMultiple(size_t offset,
+                             char** out,
+                             size_t* size,
+                             size_t* count) {
+  size_t max = *count;
+  size_t total = 0;
+  size_t i = 0;
+
+  for (Buffer* current = read_head_;
+       current != NULL && i < max;
+       current = current->next_) {
+    size_t avail = current->write_pos_ - current->read_pos_;
+    if (offset >= avail) {
+      offset -= avail;
+      continue;
+    }
+
+    out[i] = current->data_ + current->read_pos_ + offset;
+    size[i] = avail - offset;
+    total += size[i];
+    offset = 0;
+    i++;
+  }
+
+  *count = i;
+  return total;
+}
+
+
+void NodeBIO::Skip(size_t size) {
+  Read(NULL, size);
+}
+
+
 size_t NodeBIO::IndexOf(char delim, size_t limit) {
   size_t bytes_read = 0;
   size_t max = Length() > limit ? limit : Length();
-  size_t left = limit;
   Buffer* current = read_head_;
 
   while (bytes_read < max) {
+    assert(current != NULL);
     assert(current->read_pos_ <= current->write_pos_);
     size_t avail = current->write_pos_ - current->read_pos_;
-    if (avail > left)
-      avail = left;
+    if (avail > max - bytes_read)
+      avail = max - bytes_read;
 
     // Walk through data
-    char* tmp = current->data_ + current->read_pos_;
-    size_t off = 0;
-    while (off < avail && *tmp != delim) {
-      off++;
-      tmp++;
-    }
-
-    // Move pointers
-    bytes_read += off;
-    left -= off;
+    char* start = current->data_ + current->read_pos_;
+    char* tmp = static_cast<char*>(memchr(start, delim, avail));
 
     // Found `delim`
-    if (off != avail) {
-      return bytes_read;
-    }
+    if (tmp != NULL)
+      return bytes_read + (tmp - start);
 
     // Move to next buffer
-    if (current->read_pos_ + avail == kBufferLength) {
-      current = current->next_;
-    }
+    bytes_read += avail;
+    current = current->next_;
   }
   assert(max == bytes_read);
 
@@ -258,64 +358,58 @@ void NodeBIO::Write(const char* data, size_t size) {
   size_t offset = 0;
   size_t left = size;
   while (left > 0) {
-    size_t to_write = left;
-    assert(write_head_->write_pos_ <= kBufferLength);
-    size_t avail = kBufferLength - write_head_->write_pos_;
-
-    if (to_write > avail)
-      to_write = avail;
+    size_t avail;
+    char* out = PeekWritable(&avail);
+    size_t to_write = left > avail ? avail : left;
 
     // Copy data
-    memcpy(write_head_->data_ + write_head_->write_pos_,
-           data + offset,
-           to_write);
+    memcpy(out, data + offset, to_write);
+    Commit(to_write);
 
     // Move pointers
     left -= to_write;
     offset += to_write;
-    length_ += to_write;
-    write_head_->write_pos_ += to_write;
-    assert(write_head_->write_pos_ <= kBufferLength);
-
-    // Go to next buffer if there still are some bytes to write
-    if (left != 0) {
-      if (write_head_->write_pos_ == kBufferLength) {
-        Buffer* next = new Buffer();
-        next->next_ = write_head_->next_;
-        write_head_->next_ = next;
-      }
-      write_head_ = write_head_->next_;
-    }
   }
   assert(left == 0);
 }
 
 
-void NodeBIO::Reset() {
-  while (read_head_->read_pos_ != read_head_->write_pos_) {
-    assert(read_head_->write_pos_ > read_head_->read_pos_);
+char* NodeBIO::PeekWritable(size_t* size) {
+  if (write_head_ == NULL) {
+    read_head_ = NewBuffer();
+    write_head_ = read_head_;
+  } else if (write_head_->write_pos_ == kBufferLength) {
+    // Go to next buffer
+    write_head_->next_ = NewBuffer();
+    write_head_ = write_head_->next_;
+  }
 
-    length_ -= read_head_->write_pos_ - read_head_->read_pos_;
-    read_head_->write_pos_ = 0;
-    read_head_->read_pos_ = 0;
+  assert(write_head_->write_pos_ < kBufferLength);
+  *size = kBufferLength - write_head_->write_pos_;
+  return write_head_->data_ + write_head_->write_pos_;
+}
 
-    read_head_ = read_head_->next_;
-  }
-  write_head_ = read_head_;
-  assert(length_ == 0);
+
+void NodeBIO::Commit(size_t size) {
+  assert(write_head_ != NULL);
+  assert(write_head_->write_pos_ + size <= kBufferLength);
+  write_head_->write_pos_ += size;
+  length_ += size;
+
+  // Nothing was written into the space after all
+  if (length_ == 0)
+    ReleaseBuffers();
 }
 
 
-NodeBIO::~NodeBIO() {
-  Buffer* current = head_.next_;
-  while (current != &head_) {
-    Buffer* next = current->next_;
-    delete current;
-    current = next;
-  }
+void NodeBIO::Reset() {
+  ReleaseBuffers();
+  length_ = 0;
+}
 
-  read_head_ = NULL;
-  write_head_ = NULL;
+
+NodeBIO::~NodeBIO() {
+  ReleaseBuffers();
 }
 
 } // namespace node
@@ -38,30 +38,31 @@ class NodeBIO {
   static int Gets(BIO* bio, char* out, int size);
   static long Ctrl(BIO* bio, int cmd, long num, void* ptr);
 
- protected:
+  // Data is kept in buffers of this size, a region returned by the Peek
+  // methods is never larger.
   static const size_t kBufferLength = 16 * 1024;
 
-  class Buffer {
-   public:
-    Buffer() : read_pos_(0), write_pos_(0), next_(NULL) {
-    }
-
-    size_t read_pos_;
-    size_t write_pos_;
-    Buffer* next_;
-    char data_[kBufferLength];
-  };
-
-  NodeBIO() : length_(0), read_head_(&head_), write_head_(&head_) {
-    // Loop head
-    head_.next_ = &head_;
+  static inline NodeBIO* FromBIO(BIO* bio) {
+    assert(bio->ptr != NULL);
+    return static_cast<NodeBIO*>(bio->ptr);
   }
 
-  ~NodeBIO();
-
   // Read `len` bytes maximum into `out`, return actual number of read bytes
   size_t Read(char* out, size_t size);
 
+  // Return pointer to the first readable bytes, their count goes into
+  // `size`. That's less than Length() if the data spans several buffers.
+  char* Peek(size_t* size);
+
+  // Put up to `*count` readable regions that start `offset` bytes into
+  // the data into `out` and `size`, set `*count` to the number of regions
+  // and return their total length. The regions stay valid until they're
+  // read, skipped or reset; writes only ever append.
+  size_t PeekMultiple(size_t offset, char** out, size_t* size, size_t* count);
+
+  // Discard `size` bytes, i.e. the ones that were peeked and used
+  void Skip(size_t size);
+
   // Find first appearance of `delim` in buffer or `limit` if `delim`
   // wasn't found.
   size_t IndexOf(char delim, size_t limit);
@@ -72,22 +73,56 @@ class NodeBIO {
   // Put `len` bytes from `data` into buffer
   void Write(const char* data, size_t size);
 
+  // Return pointer to at least one writable byte at the end of the data,
+  // the contiguous space that's there goes into `size`. Nothing is
+  // readable until it's committed.
+  char* PeekWritable(size_t* size);
+
+  // Make `size` bytes that were put into PeekWritable()'s space readable
+  void Commit(size_t size);
+
   // Return size of buffer in bytes
   size_t inline Length() {
     return length_;
   }
 
-  static inline NodeBIO* FromBIO(BIO* bio) {
-    assert(bio->ptr != NULL);
-    return static_cast<NodeBIO*>(bio->ptr);
+ protected:
+  // Buffers of all BIOs are recycled through a free list of this many
+  // buffers, connections come and go too quickly to malloc each of them.
+  static const size_t kMaxFreeBuffers = 64;
+
+  class Buffer {
+   public:
+    Buffer() : read_pos_(0), write_pos_(0), next_(NULL) {
+    }
+
+    size_t read_pos_;
+    size_t write_pos_;
+    Buffer* next_;
+    char data_[kBufferLength];
+  };
+
+  // An empty BIO doesn't hold on to any buffers, that keeps idle
+  // connections cheap.
+  NodeBIO() : length_(0), read_head_(NULL), write_head_(NULL) {
   }
 
+  ~NodeBIO();
+
+  // Give all buffers back once everything was read
+  void ReleaseBuffers();
+
+  // Free list, TLS handshakes can run on the thread pool too
+  static Buffer* NewBuffer();
+  static void FreeBuffer(Buffer* buffer);
+
   size_t length_;
-  Buffer head_;
   Buffer* read_head_;
   Buffer* write_head_;
 
   static BIO_METHOD method_;
+  static Buffer* free_list_;
+  static size_t free_count_;
 };
 
 } // namespace node
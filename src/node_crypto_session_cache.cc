@@ -0,0 +1,220 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "node_crypto_session_cache.h"
+
+#include <assert.h>
+#include <stdlib.h>  // abort(), free(), malloc()
+#include <string.h>  // memcmp(), memcpy(), memset()
+
+namespace node {
+namespace crypto {
+
+SessionCache::SessionCache(size_t capacity) {
+  shard_capacity_ = (capacity + kShardCount - 1) / kShardCount;
+  if (shard_capacity_ == 0)
+    shard_capacity_ = 1;
+
+  uint32_t buckets = 1;
+  while (buckets < shard_capacity_ && buckets < (1U << 20))
+    buckets <<= 1;
+
+  for (unsigned int i = 0; i < kShardCount; i++) {
+    Shard* shard = &shards_[i];
+    if (uv_mutex_init(&shard->mutex_))
+      abort();
+    shard->buckets_ = new Entry*[buckets];
+    memset(shard->buckets_, 0, buckets * sizeof(*shard->buckets_));
+    shard->mask_ = buckets - 1;
+    QUEUE_INIT(&shard->lru_);
+    shard->count_ = 0;
+    memset(&shard->stats_, 0, sizeof(shard->stats_));
+  }
+}
+
+
+SessionCache::~SessionCache() {
+  for (unsigned int i = 0; i < kShardCount; i++) {
+    Shard* shard = &shards_[i];
+    while (!QUEUE_EMPTY(&shard->lru_)) {
+      QUEUE* q = static_cast<QUEUE*>(QUEUE_HEAD(&shard->lru_));
+      QUEUE_REMOVE(q);
+      free(QUEUE_DATA(q, Entry, lru_));
+    }
+    delete[] shard->buckets_;
+    shard->buckets_ = NULL;
+    uv_mutex_destroy(&shard->mutex_);
+  }
+}
+
+
+SessionCache::Stats SessionCache::stats() {
+  Stats stats;
+  memset(&stats, 0, sizeof(stats));
+
+  for (unsigned int i = 0; i < kShardCount; i++) {
+    Shard* shard = &shards_[i];
+    uv_mutex_lock(&shard->mutex_);
+    stats.hits += shard->stats_.hits;
+    stats.misses += shard->stats_.misses;
+    stats.expired += shard->stats_.expired;
+    stats.evicted += shard->stats_.evicted;
+    stats.size += shard->count_;
+    uv_mutex_unlock(&shard->mutex_);
+  }
+
+  return stats;
+}
+
+
+// FNV-1a. Session ids come from the server's RNG, there's nothing to
+// gain from anything stronger.
+uint32_t SessionCache::Hash(const unsigned char* id, unsigned int id_len) {
+  uint32_t hash = 2166136261U;
+  for (unsigned int i = 0; i < id_len; i++) {
+    hash ^= id[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+
+SessionCache::Entry** SessionCache::Find(Shard* shard,
+                                         uint32_t hash,
+                                         const unsigned char* id,
+                                         unsigned int id_len) {
+  Entry** link = &shard->buckets_[(hash / kShardCount) & shard->mask_];
+  while (*link != NULL) {
+    Entry* entry = *link;
+    if (entry->hash_ == hash &&
+        entry->id_len_ == id_len &&
+        memcmp(entry->id_, id, id_len) == 0) {
+      break;
+    }
+    link = &entry->next_;
+  }
+  return link;
+}
+
+
+void SessionCache::Unlink(Shard* shard, Entry** link) {
+  Entry* entry = *link;
+  *link = entry->next_;
+  QUEUE_REMOVE(&entry->lru_);
+  shard->count_--;
+  free(entry);
+}
+
+
+void SessionCache::Add(const unsigned char* id,
+                       unsigned int id_len,
+                       const unsigned char* data,
+                       size_t size,
+                       time_t expires) {
+  if (id_len == 0 || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+    return;
+
+  uint32_t hash = Hash(id, id_len);
+  Shard* shard = ShardFor(hash);
+
+  Entry* entry = static_cast<Entry*>(malloc(sizeof(*entry) + size));
+  if (entry == NULL)
+    return;
+
+  uv_mutex_lock(&shard->mutex_);
+
+  Entry** link = Find(shard, hash, id, id_len);
+  if (*link != NULL)
+    Unlink(shard, link);
+
+  if (shard->count_ >= shard_capacity_) {
+    QUEUE* q = static_cast<QUEUE*>(QUEUE_PREV(&shard->lru_));
+    Entry* oldest = QUEUE_DATA(q, Entry, lru_);
+    Unlink(shard, Find(shard, oldest->hash_, oldest->id_, oldest->id_len_));
+    shard->stats_.evicted++;
+  }
+
+  entry->hash_ = hash;
+  entry->expires_ = expires;
+  entry->id_len_ = id_len;
+  memcpy(entry->id_, id, id_len);
+  entry->size_ = size;
+  memcpy(entry + 1, data, size);
+
+  link = &shard->buckets_[(hash / kShardCount) & shard->mask_];
+  entry->next_ = *link;
+  *link = entry;
+  QUEUE_INSERT_HEAD(&shard->lru_, &entry->lru_);
+  shard->count_++;
+
+  uv_mutex_unlock(&shard->mutex_);
+}
+
+
+SSL_SESSION* SessionCache::Get(const unsigned char* id, unsigned int id_len) {
+  uint32_t hash = Hash(id, id_len);
+  Shard* shard = ShardFor(hash);
+  SSL_SESSION* sess = NULL;
+
+  uv_mutex_lock(&shard->mutex_);
+
+  Entry** link = Find(shard, hash, id, id_len);
+  Entry* entry = *link;
+  if (entry == NULL) {
+    shard->stats_.misses++;
+  } else if (entry->expires_ <= time(NULL)) {
+    Unlink(shard, link);
+    shard->stats_.expired++;
+    shard->stats_.misses++;
+  } else {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(entry + 1);
+    sess = d2i_SSL_SESSION(NULL, &p, entry->size_);
+    if (sess == NULL) {
+      Unlink(shard, link);
+      shard->stats_.misses++;
+    } else {
+      QUEUE_REMOVE(&entry->lru_);
+      QUEUE_INSERT_HEAD(&shard->lru_, &entry->lru_);
+      shard->stats_.hits++;
+    }
+  }
+
+  uv_mutex_unlock(&shard->mutex_);
+
+  return sess;
+}
+
+
+void SessionCache::Remove(const unsigned char* id, unsigned int id_len) {
+  uint32_t hash = Hash(id, id_len);
+  Shard* shard = ShardFor(hash);
+
+  uv_mutex_lock(&shard->mutex_);
+
+  Entry** link = Find(shard, hash, id, id_len);
+  if (*link != NULL)
+    Unlink(shard, link);
+
+  uv_mutex_unlock(&shard->mutex_);
+}
+
+}  // namespace crypto
+}  // namespace node
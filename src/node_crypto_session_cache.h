@@ -0,0 +1,113 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SRC_NODE_CRYPTO_SESSION_CACHE_H_
+#define SRC_NODE_CRYPTO_SESSION_CACHE_H_
+
+#include "queue.h"
+#include "uv.h"
+
+#include <openssl/ssl.h>
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint64_t
+#include <time.h>  // time_t
+
+namespace node {
+namespace crypto {
+
+// Server side session cache of a SecureContext. Sessions are kept
+// serialized, at most `capacity` of them, and are dropped once they
+// expire. The cache is split into shards by session id, each with its own
+// fixed size hash table, LRU list and lock, so it never rehashes,
+// evicting only looks at one short list and handshakes on the thread pool
+// rarely wait for each other.
+class SessionCache {
+ public:
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expired;
+    uint64_t evicted;
+    size_t size;
+  };
+
+  explicit SessionCache(size_t capacity);
+  ~SessionCache();
+
+  // Stores a copy of `data`, the DER encoding of the session with id
+  // `id`. Replaces an older session with the same id.
+  void Add(const unsigned char* id,
+           unsigned int id_len,
+           const unsigned char* data,
+           size_t size,
+           time_t expires);
+
+  // Returns a new SSL_SESSION that the caller owns or NULL on a miss.
+  SSL_SESSION* Get(const unsigned char* id, unsigned int id_len);
+
+  void Remove(const unsigned char* id, unsigned int id_len);
+
+  Stats stats();
+
+ private:
+  static const unsigned int kShardCount = 16;
+
+  struct Entry {
+    QUEUE lru_;
+    Entry* next_;
+    uint32_t hash_;
+    time_t expires_;
+    unsigned int id_len_;
+    unsigned char id_[SSL_MAX_SSL_SESSION_ID_LENGTH];
+    size_t size_;
+    // `size_` bytes of session data follow.
+  };
+
+  struct Shard {
+    uv_mutex_t mutex_;
+    Entry** buckets_;
+    uint32_t mask_;
+    QUEUE lru_;  // most recently used first
+    size_t count_;
+    Stats stats_;  // size is count_
+  };
+
+  static uint32_t Hash(const unsigned char* id, unsigned int id_len);
+  inline Shard* ShardFor(uint32_t hash) {
+    return &shards_[hash % kShardCount];
+  }
+
+  // Returns the link that points at the entry or at the NULL that ends
+  // the bucket if there's none.
+  Entry** Find(Shard* shard,
+               uint32_t hash,
+               const unsigned char* id,
+               unsigned int id_len);
+  void Unlink(Shard* shard, Entry** link);
+
+  size_t shard_capacity_;
+  Shard shards_[kShardCount];
+};
+
+}  // namespace crypto
+}  // namespace node
+
+#endif  // SRC_NODE_CRYPTO_SESSION_CACHE_H_
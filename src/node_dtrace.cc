@@ -57,6 +57,11 @@
 #define NODE_GC_DONE(arg0, arg1)
 #endif
 
+#ifndef NODE_THREADPOOL_WORK_DONE
+#define NODE_THREADPOOL_WORK_DONE(arg0, arg1, arg2, arg3)
+#define NODE_THREADPOOL_WORK_DONE_ENABLED() (0)
+#endif
+
 namespace node {
 
 using namespace v8;
@@ -311,6 +316,18 @@ Handle<Value> DTRACE_HTTP_CLIENT_RESPONSE(const Arguments& args) {
   return Undefined(node_isolate);
 }
 
+void DTraceThreadpoolWorkDone(const char* kind,
+                              uint64_t queue,
+                              uint64_t run,
+                              uint64_t done) {
+#ifndef HAVE_SYSTEMTAP
+  if (!NODE_THREADPOOL_WORK_DONE_ENABLED())
+    return;
+#endif
+
+  NODE_THREADPOOL_WORK_DONE(const_cast<char*>(kind), queue, run, done);
+}
+
 #define NODE_PROBE(name) #name, name, Persistent<FunctionTemplate>()
 
 static int dtrace_gc_start(GCType type, GCCallbackFlags flags) {
@@ -76,6 +76,10 @@ typedef struct {
 namespace node {
 
 void InitDTrace(v8::Handle<v8::Object> target);
+void DTraceThreadpoolWorkDone(const char* kind,
+                              uint64_t queue,
+                              uint64_t run,
+                              uint64_t done);
 
 }
 
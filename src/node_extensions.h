@@ -29,6 +29,7 @@ NODE_EXT_LIST_ITEM(node_evals)
 NODE_EXT_LIST_ITEM(node_fs)
 NODE_EXT_LIST_ITEM(node_http_parser)
 NODE_EXT_LIST_ITEM(node_os)
+NODE_EXT_LIST_ITEM(node_threadpool)
 NODE_EXT_LIST_ITEM(node_zlib)
 
 // libuv rewrite
@@ -41,6 +42,9 @@ NODE_EXT_LIST_ITEM(node_tty_wrap)
 NODE_EXT_LIST_ITEM(node_process_wrap)
 NODE_EXT_LIST_ITEM(node_fs_event_wrap)
 NODE_EXT_LIST_ITEM(node_signal_wrap)
+#if HAVE_OPENSSL
+NODE_EXT_LIST_ITEM(node_tls_wrap)
+#endif
 
 NODE_EXT_LIST_END
 
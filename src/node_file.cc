@@ -23,6 +23,7 @@
 #include "node_file.h"
 #include "node_buffer.h"
 #include "node_stat_watcher.h"
+#include "node_threadpool.h"
 #include "req_wrap.h"
 
 #include <fcntl.h>
@@ -81,6 +82,8 @@ static inline int IsInt64(double x) {
 
 
 static void After(uv_fs_t *req) {
+  Threadpool::RecordWork(THREADPOOL_WORK_FS, reinterpret_cast<uv_req_t*>(req));
+
   HandleScope scope(node_isolate);
 
   FSReqWrap* req_wrap = (FSReqWrap*) req->data;
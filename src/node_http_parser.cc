@@ -30,8 +30,13 @@
 #include <strings.h>  /* strcasecmp() */
 #else
 #define strcasecmp _stricmp
+#define strncasecmp _strnicmp
 #endif
-#include <stdlib.h>  /* free() */
+#include <stdlib.h>  /* free(), abort() */
+#include <math.h>  /* ceil() */
+#include <stddef.h>  /* offsetof() */
+#include <stdio.h>  /* snprintf() */
+#include <time.h>  /* time(), gmtime() */
 
 // This is a binding to http_parser (https://github.com/joyent/http-parser)
 // The goal is to decouple sockets from parsing for more javascript-level
@@ -53,6 +58,7 @@ static Persistent<String> on_headers_sym;
 static Persistent<String> on_headers_complete_sym;
 static Persistent<String> on_body_sym;
 static Persistent<String> on_message_complete_sym;
+static Persistent<String> on_batch_sym;
 
 static Persistent<String> method_sym;
 static Persistent<String> status_code_sym;
@@ -63,6 +69,8 @@ static Persistent<String> should_keep_alive_sym;
 static Persistent<String> upgrade_sym;
 static Persistent<String> headers_sym;
 static Persistent<String> url_sym;
+static Persistent<String> max_header_pairs_sym;
+static Persistent<String> header_separator_sym;
 
 static Persistent<String> unknown_method_sym;
 
@@ -73,6 +81,108 @@ HTTP_METHOD_MAP(X)
 static struct http_parser_settings settings;
 
 
+// How IncomingMessage.prototype._addHeaderLine() in lib/_http_incoming.js
+// treats a header that occurs more than once. x-* headers that aren't in
+// the table below are joined as well.
+enum HeaderKind {
+  kHeaderFirst,  // the first value wins
+  kHeaderJoin,   // the values are joined with ", "
+  kHeaderArray   // the values are collected in an array
+};
+
+// Header names that are interned as symbols, lowercase.
+#define HEADER_NAME_MAP(X)                                                    \
+  X("accept", kHeaderJoin)                                                    \
+  X("accept-charset", kHeaderJoin)                                            \
+  X("accept-encoding", kHeaderJoin)                                           \
+  X("accept-language", kHeaderJoin)                                           \
+  X("accept-ranges", kHeaderFirst)                                            \
+  X("age", kHeaderFirst)                                                      \
+  X("authorization", kHeaderFirst)                                            \
+  X("cache-control", kHeaderFirst)                                            \
+  X("connection", kHeaderJoin)                                                \
+  X("content-encoding", kHeaderFirst)                                         \
+  X("content-language", kHeaderFirst)                                         \
+  X("content-length", kHeaderFirst)                                           \
+  X("content-type", kHeaderFirst)                                             \
+  X("cookie", kHeaderJoin)                                                    \
+  X("date", kHeaderFirst)                                                     \
+  X("dnt", kHeaderFirst)                                                      \
+  X("etag", kHeaderFirst)                                                     \
+  X("expect", kHeaderFirst)                                                   \
+  X("expires", kHeaderFirst)                                                  \
+  X("host", kHeaderFirst)                                                     \
+  X("if-match", kHeaderFirst)                                                 \
+  X("if-modified-since", kHeaderFirst)                                        \
+  X("if-none-match", kHeaderFirst)                                            \
+  X("if-range", kHeaderFirst)                                                 \
+  X("if-unmodified-since", kHeaderFirst)                                      \
+  X("keep-alive", kHeaderFirst)                                               \
+  X("last-modified", kHeaderFirst)                                            \
+  X("link", kHeaderJoin)                                                      \
+  X("location", kHeaderFirst)                                                 \
+  X("origin", kHeaderFirst)                                                   \
+  X("pragma", kHeaderJoin)                                                    \
+  X("proxy-authenticate", kHeaderJoin)                                        \
+  X("proxy-authorization", kHeaderFirst)                                      \
+  X("range", kHeaderFirst)                                                    \
+  X("referer", kHeaderFirst)                                                  \
+  X("sec-websocket-extensions", kHeaderJoin)                                  \
+  X("sec-websocket-key", kHeaderFirst)                                        \
+  X("sec-websocket-protocol", kHeaderJoin)                                    \
+  X("sec-websocket-version", kHeaderFirst)                                    \
+  X("server", kHeaderFirst)                                                   \
+  X("set-cookie", kHeaderArray)                                               \
+  X("te", kHeaderFirst)                                                       \
+  X("transfer-encoding", kHeaderFirst)                                        \
+  X("upgrade", kHeaderFirst)                                                  \
+  X("user-agent", kHeaderFirst)                                               \
+  X("vary", kHeaderFirst)                                                     \
+  X("via", kHeaderFirst)                                                      \
+  X("www-authenticate", kHeaderJoin)                                          \
+  X("x-forwarded-for", kHeaderJoin)                                           \
+  X("x-forwarded-proto", kHeaderJoin)                                         \
+  X("x-requested-with", kHeaderJoin)
+
+static const struct {
+  const char* name;
+  size_t len;
+  HeaderKind kind;
+} header_names[] = {
+#define X(name, kind) { name, sizeof(name) - 1, kind },
+  HEADER_NAME_MAP(X)
+#undef X
+};
+
+static Persistent<String> header_name_syms[ARRAY_SIZE(header_names)];
+
+
+// Returns the index of `name` in header_names, ignoring case, or -1.
+static inline int FindHeaderName(const char* name, size_t len) {
+  for (size_t i = 0; i < ARRAY_SIZE(header_names); i++) {
+    if (header_names[i].len == len &&
+        strncasecmp(header_names[i].name, name, len) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+static inline char ToLower(char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+
+// What the entries in an onBatch array are, each followed by the arguments
+// that the matching callback would have gotten.
+enum BatchEntry {
+  kOnHeadersComplete,  // info
+  kOnBody,             // start, length (the buffer is onBatch's first arg)
+  kOnMessageComplete
+};
+
+
 // This is a hack to get the current_buffer to the callbacks with the least
 // amount of overhead. Nothing else will run while http_parser_execute()
 // runs, therefore this pointer can be set and used for the execution.
@@ -108,59 +218,134 @@ method_to_str(unsigned short m) {
 }
 
 
-// helper class for the Parser
-struct StringPtr {
-  StringPtr() {
-    on_heap_ = false;
-    Reset();
+// Memory for the URL and header fields and values that arrive in more than
+// one piece, so they survive until the parser is done with them. Bump
+// allocation out of blocks that are freed all at once in Reset().
+class Arena {
+ public:
+  Arena() : head_(NULL) {
   }
 
 
-  ~StringPtr() {
+  ~Arena() {
+    Free(head_);
+  }
+
+
+  char* Alloc(size_t size) {
+    if (head_ == NULL || head_->size_ - head_->used_ < size) {
+      size_t block_size = kBlockSize;
+      while (block_size < 2 * size)
+        block_size *= 2;
+
+      Block* block = static_cast<Block*>(
+          malloc(offsetof(Block, data_) + block_size));
+      if (block == NULL)
+        abort();
+
+      block->next_ = head_;
+      block->size_ = block_size;
+      block->used_ = 0;
+      head_ = block;
+    }
+
+    char* p = head_->data_ + head_->used_;
+    head_->used_ += size;
+    return p;
+  }
+
+
+  // Grows the most recent allocation, `str` of `size` bytes, by `extra`
+  // bytes if there's room for that in its block.
+  bool Extend(const char* str, size_t size, size_t extra) {
+    if (head_ == NULL || str + size != head_->data_ + head_->used_)
+      return false;
+    if (head_->size_ - head_->used_ < extra)
+      return false;
+    head_->used_ += extra;
+    return true;
+  }
+
+
+  // Everything that was allocated goes. A block of the default size is
+  // kept for the next message, bigger ones are not.
+  void Reset() {
+    if (head_ == NULL)
+      return;
+
+    if (head_->size_ == kBlockSize) {
+      Free(head_->next_);
+      head_->next_ = NULL;
+      head_->used_ = 0;
+    } else {
+      Free(head_);
+      head_ = NULL;
+    }
+  }
+
+ private:
+  static const size_t kBlockSize = 4096;
+
+  struct Block {
+    Block* next_;
+    size_t size_;
+    size_t used_;
+    char data_[1];
+  };
+
+  static void Free(Block* block) {
+    while (block != NULL) {
+      Block* next = block->next_;
+      free(block);
+      block = next;
+    }
+  }
+
+  Block* head_;
+};
+
+
+// helper class for the Parser
+struct StringPtr {
+  StringPtr() {
     Reset();
   }
 
 
-  // If str_ does not point to a heap string yet, this function makes it do
+  // If str_ does not point into the arena yet, this function makes it do
   // so. This is called at the end of each http_parser_execute() so as not
   // to leak references. See issue #2438 and test-http-parser-bad-ref.js.
-  void Save() {
-    if (!on_heap_ && size_ > 0) {
-      char* s = new char[size_];
+  void Save(Arena* arena) {
+    if (!in_arena_ && size_ > 0) {
+      char* s = arena->Alloc(size_);
       memcpy(s, str_, size_);
       str_ = s;
-      on_heap_ = true;
+      in_arena_ = true;
     }
   }
 
 
+  // Doesn't give back arena memory, Arena::Reset() does that.
   void Reset() {
-    if (on_heap_) {
-      delete[] str_;
-      on_heap_ = false;
-    }
-
     str_ = NULL;
     size_ = 0;
+    in_arena_ = false;
   }
 
 
-  void Update(const char* str, size_t size) {
-    if (str_ == NULL)
+  void Update(const char* str, size_t size, Arena* arena) {
+    if (str_ == NULL) {
       str_ = str;
-    else if (on_heap_ || str_ + size_ != str) {
-      // Non-consecutive input, make a copy on the heap.
-      // TODO Use slab allocation, O(n) allocs is bad.
-      char* s = new char[size_ + size];
+    } else if (in_arena_ && arena->Extend(str_, size_, size)) {
+      // The last thing in the arena, append in place.
+      memcpy(const_cast<char*>(str_) + size_, str, size);
+    } else if (in_arena_ || str_ + size_ != str) {
+      // Non-consecutive input, make a copy in the arena.
+      char* s = arena->Alloc(size_ + size);
       memcpy(s, str_, size_);
       memcpy(s + size_, str, size);
-
-      if (on_heap_)
-        delete[] str_;
-      else
-        on_heap_ = true;
-
       str_ = s;
+      in_arena_ = true;
     }
     size_ += size;
   }
@@ -175,14 +360,16 @@ struct StringPtr {
 
 
   const char* str_;
-  bool on_heap_;
+  bool in_arena_;
   size_t size_;
 };
 
 
 class Parser : public ObjectWrap {
 public:
-  Parser(enum http_parser_type type) : ObjectWrap() {
+  Parser(enum http_parser_type type, bool headers_object)
+      : ObjectWrap(),
+        headers_object_(headers_object) {
     Init(type);
   }
 
@@ -194,12 +381,13 @@ public:
   HTTP_CB(on_message_begin) {
     num_fields_ = num_values_ = 0;
     url_.Reset();
+    arena_.Reset();
     return 0;
   }
 
 
   HTTP_DATA_CB(on_url) {
-    url_.Update(at, length);
+    url_.Update(at, length, &arena_);
     return 0;
   }
 
@@ -220,7 +408,7 @@ public:
     assert(num_fields_ < (int)ARRAY_SIZE(fields_));
     assert(num_fields_ == num_values_ + 1);
 
-    fields_[num_fields_ - 1].Update(at, length);
+    fields_[num_fields_ - 1].Update(at, length, &arena_);
 
     return 0;
   }
@@ -236,17 +424,20 @@ public:
     assert(num_values_ < (int)ARRAY_SIZE(values_));
     assert(num_values_ == num_fields_);
 
-    values_[num_values_ - 1].Update(at, length);
+    values_[num_values_ - 1].Update(at, length, &arena_);
 
     return 0;
   }
 
 
   HTTP_CB(on_headers_complete) {
-    Local<Value> cb = handle_->Get(on_headers_complete_sym);
+    Local<Value> cb;
 
-    if (!cb->IsFunction())
-      return 0;
+    if (!batching_) {
+      cb = handle_->Get(on_headers_complete_sym);
+      if (!cb->IsFunction())
+        return 0;
+    }
 
     Local<Object> message_info = Object::New();
 
@@ -256,7 +447,10 @@ public:
     }
     else {
       // Fast case, pass headers and URL to JS land.
-      message_info->Set(headers_sym, CreateHeaders());
+      if (headers_object_)
+        message_info->Set(headers_sym, CreateHeadersObject());
+      else
+        message_info->Set(headers_sym, CreateHeaders());
       if (parser_.type == HTTP_REQUEST)
         message_info->Set(url_sym, url_.ToString());
     }
@@ -287,6 +481,12 @@ public:
                       parser_.upgrade ? True(node_isolate)
                                       : False(node_isolate));
 
+    if (batching_) {
+      AddToBatch(kOnHeadersComplete);
+      batch_->Set(batch_length_++, message_info);
+      return 0;
+    }
+
     Local<Value> argv[1] = { message_info };
 
     Local<Value> head_response =
@@ -304,6 +504,14 @@ public:
   HTTP_DATA_CB(on_body) {
     HandleScope scope(node_isolate);
 
+    if (batching_) {
+      AddToBatch(kOnBody);
+      batch_->Set(batch_length_++,
+                  Integer::New(at - current_buffer_data, node_isolate));
+      batch_->Set(batch_length_++, Integer::New(length, node_isolate));
+      return 0;
+    }
+
     Local<Value> cb = handle_->Get(on_body_sym);
     if (!cb->IsFunction())
       return 0;
@@ -331,6 +539,11 @@ public:
     if (num_fields_)
       Flush(); // Flush trailing HTTP headers.
 
+    if (batching_) {
+      AddToBatch(kOnMessageComplete);
+      return 0;
+    }
+
     Local<Value> cb = handle_->Get(on_message_complete_sym);
 
     if (!cb->IsFunction())
@@ -347,6 +560,12 @@ public:
   }
 
 
+  // new HTTPParser(type, [headersObject])
+  //
+  // With `headersObject`, header names are lowercase and onHeadersComplete
+  // gets info.headers as the object that IncomingMessage wants rather than
+  // a flat array of names and values, unless the headers came in pieces
+  // and went through onHeaders already.
   static Handle<Value> New(const Arguments& args) {
     HandleScope scope(node_isolate);
 
@@ -358,7 +577,7 @@ public:
           "Argument must be HTTPParser.REQUEST or HTTPParser.RESPONSE")));
     }
 
-    Parser* parser = new Parser(type);
+    Parser* parser = new Parser(type, args[1]->IsTrue());
     parser->Wrap(args.This());
 
     return args.This();
@@ -366,15 +585,28 @@ public:
 
 
   void Save() {
-    url_.Save();
+    // The string that the next execute() is most likely to continue goes
+    // last, so that it can grow in place in the arena.
+    StringPtr* current = &url_;
+    if (num_fields_ > num_values_)
+      current = &fields_[num_fields_ - 1];
+    else if (num_values_ > 0)
+      current = &values_[num_values_ - 1];
+
+    if (current != &url_)
+      url_.Save(&arena_);
 
     for (int i = 0; i < num_fields_; i++) {
-      fields_[i].Save();
+      if (&fields_[i] != current)
+        fields_[i].Save(&arena_);
     }
 
     for (int i = 0; i < num_values_; i++) {
-      values_[i].Save();
+      if (&values_[i] != current)
+        values_[i].Save(&arena_);
     }
+
+    current->Save(&arena_);
   }
 
 
@@ -421,9 +653,28 @@ public:
     current_buffer_len = buffer_len;
     parser->got_exception_ = false;
 
+    // Request parsers with an onBatch callback collect what happens in this
+    // call and hand it over in one go at the end, instead of calling back
+    // into JS for every message. Response parsers can't do that, their
+    // onHeadersComplete says whether there's a body to read.
+    parser->batching_ = parser->parser_.type == HTTP_REQUEST &&
+                        parser->handle_->Get(on_batch_sym)->IsFunction();
+    if (parser->batching_) {
+      parser->batch_ = Array::New();
+      parser->batch_length_ = 0;
+    }
+
     size_t nparsed =
       http_parser_execute(&parser->parser_, &settings, buffer_data + off, len);
 
+    if (parser->batching_) {
+      // Also after a parse error, the messages before it are good.
+      if (!parser->got_exception_)
+        parser->DeliverBatch();
+      parser->batching_ = false;
+      parser->batch_.Clear();
+    }
+
     parser->Save();
 
     // Unassign the 'buffer_' variable
@@ -503,7 +754,12 @@ private:
     Local<Array> headers = Array::New(2 * num_values_);
 
     for (int i = 0; i < num_values_; ++i) {
-      headers->Set(2 * i, fields_[i].ToString());
+      if (headers_object_) {
+        HeaderKind kind;
+        headers->Set(2 * i, HeaderName(fields_[i], &kind));
+      } else {
+        headers->Set(2 * i, fields_[i].ToString());
+      }
       headers->Set(2 * i + 1, values_[i].ToString());
     }
 
@@ -511,10 +767,110 @@ private:
   }
 
 
+  // Does what parserOnHeadersComplete() in lib/_http_common.js would do
+  // with the array from CreateHeaders(), including the maxHeaderPairs cap.
+  Local<Object> CreateHeadersObject() {
+    Local<Object> headers = Object::New();
+    int n = num_values_;
+
+    double max_pairs = handle_->Get(max_header_pairs_sym)->NumberValue();
+    if (max_pairs > 0 && max_pairs < 2 * n)
+      n = static_cast<int>(ceil(max_pairs / 2));
+
+    for (int i = 0; i < n; ++i) {
+      HeaderKind kind;
+      Handle<String> name = HeaderName(fields_[i], &kind);
+      Local<String> value = values_[i].ToString();
+      Local<Value> prev = headers->Get(name);
+
+      if (prev->IsUndefined()) {
+        if (kind == kHeaderArray) {
+          Local<Array> values = Array::New(1);
+          values->Set(0, value);
+          headers->Set(name, values);
+        } else {
+          headers->Set(name, value);
+        }
+      } else if (kind == kHeaderArray && prev->IsArray()) {
+        Local<Array> values = Local<Array>::Cast(prev);
+        values->Set(values->Length(), value);
+      } else if (kind == kHeaderJoin) {
+        Local<String> joined = String::Concat(prev->ToString(),
+                                              header_separator_sym);
+        headers->Set(name, String::Concat(joined, value));
+      }
+    }
+
+    return headers;
+  }
+
+
+  // The lowercase name of a header field, a symbol if it's a common one.
+  // Stores how duplicates of it are handled in `kind`.
+  Handle<String> HeaderName(const StringPtr& field, HeaderKind* kind) {
+    int i = FindHeaderName(field.str_, field.size_);
+    if (i != -1) {
+      *kind = header_names[i].kind;
+      return header_name_syms[i];
+    }
+
+    char buf[256];
+    char* name = field.size_ > sizeof(buf) ? new char[field.size_] : buf;
+    for (size_t j = 0; j < field.size_; j++)
+      name[j] = ToLower(field.str_[j]);
+
+    if (field.size_ >= 2 && name[0] == 'x' && name[1] == '-')
+      *kind = kHeaderJoin;
+    else
+      *kind = kHeaderFirst;
+
+    Local<String> str = String::New(name, field.size_);
+    if (name != buf)
+      delete[] name;
+
+    return str;
+  }
+
+
+  void AddToBatch(BatchEntry entry) {
+    batch_->Set(batch_length_++, Integer::New(entry, node_isolate));
+  }
+
+
+  // onBatch(buffer, entries, count)
+  //
+  // The array is filled again from the start after that, only the first
+  // `count` entries are from this batch.
+  void DeliverBatch() {
+    if (batch_length_ == 0)
+      return;
+
+    Local<Value> cb = handle_->Get(on_batch_sym);
+    Local<Value> count = Integer::NewFromUnsigned(batch_length_, node_isolate);
+    batch_length_ = 0;
+
+    if (!cb->IsFunction())
+      return;
+
+    Local<Value> argv[3] = { *current_buffer, batch_, count };
+    Local<Value> r = Local<Function>::Cast(cb)->Call(handle_, 3, argv);
+
+    if (r.IsEmpty())
+      got_exception_ = true;
+  }
+
+
   // spill headers and request path to JS land
   void Flush() {
     HandleScope scope(node_isolate);
 
+    // What's in the batch came first.
+    if (batching_) {
+      DeliverBatch();
+      if (got_exception_)
+        return;
+    }
+
     Local<Value> cb = handle_->Get(on_headers_sym);
 
     if (!cb->IsFunction())
@@ -538,10 +894,13 @@ private:
   void Init(enum http_parser_type type) {
     http_parser_init(&parser_, type);
     url_.Reset();
+    arena_.Reset();
     num_fields_ = 0;
     num_values_ = 0;
     have_flushed_ = false;
     got_exception_ = false;
+    batching_ = false;
+    batch_length_ = 0;
   }
 
 
@@ -549,13 +908,288 @@ private:
   StringPtr fields_[32];  // header fields
   StringPtr values_[32];  // header values
   StringPtr url_;
+  Arena arena_;
   int num_fields_;
   int num_values_;
   bool have_flushed_;
   bool got_exception_;
+  bool headers_object_;
+  bool batching_;  // in an execute() call with an onBatch callback
+  Local<Array> batch_;
+  uint32_t batch_length_;
 };
 
 
+// Builds the header block of an outgoing message, what
+// OutgoingMessage#_storeHeader() in lib/_http_outgoing.js does with string
+// concatenation and a handful of regular expressions per header line, in
+// one pass over a scratch buffer. Only ASCII is handled here; for anything
+// else, and for values that aren't primitives, the JS version takes over.
+class HeaderBlock {
+ public:
+  // What writeHeaderBlock() found out about the headers, for the keep-alive
+  // and transfer encoding logic in _storeHeader().
+  enum Flags {
+    kSentConnection = 1 << 0,
+    kSentContentLength = 1 << 1,
+    kSentTransferEncoding = 1 << 2,
+    kSentDate = 1 << 3,
+    kSentExpect = 1 << 4,
+    kSetLast = 1 << 5,  // Connection: close
+    kSetKeepAlive = 1 << 6,  // any other Connection header
+    kSetChunked = 1 << 7  // Transfer-Encoding: chunked
+  };
+
+  // writeHeaderBlock(firstLine, headers, keys, isArray, sendDate, result)
+  //
+  // Returns the header lines, including firstLine and a Date header if
+  // sendDate is set and there's none in `headers`, but without the empty
+  // line at the end. result[0] is set to the Flags. Returns undefined if
+  // the JS version has to do it.
+  static Handle<Value> Write(const Arguments& args) {
+    HandleScope scope(node_isolate);
+
+    Local<Value> first_line = args[0];
+    Local<Value> headers_v = args[1];
+    Local<Value> keys_v = args[2];
+    bool is_array = args[3]->IsTrue();
+    bool send_date = args[4]->IsTrue();
+
+    if (!first_line->IsString() || !keys_v->IsArray() || !args[5]->IsObject())
+      return Undefined(node_isolate);
+
+    length_ = 0;
+    int flags = 0;
+
+    if (!Append(first_line))
+      return Undefined(node_isolate);
+
+    if (headers_v->IsObject()) {
+      Local<Object> headers = headers_v.As<Object>();
+      Local<Array> keys = keys_v.As<Array>();
+
+      for (uint32_t i = 0, n = keys->Length(); i < n; i++) {
+        Local<Value> key = keys->Get(i);
+        Local<Value> field;
+        Local<Value> value;
+
+        if (is_array) {
+          Local<Value> pair = headers->Get(key);
+          if (!pair->IsObject())
+            return Undefined(node_isolate);
+          field = pair.As<Object>()->Get(0);
+          value = pair.As<Object>()->Get(1);
+        } else {
+          field = key;
+          value = headers->Get(key);
+        }
+
+        if (value->IsArray()) {
+          Local<Array> values = value.As<Array>();
+          for (uint32_t j = 0, m = values->Length(); j < m; j++) {
+            if (!AppendLine(field, values->Get(j), &flags))
+              return Undefined(node_isolate);
+          }
+        } else if (!AppendLine(field, value, &flags)) {
+          return Undefined(node_isolate);
+        }
+      }
+    }
+
+    if (send_date && !(flags & kSentDate)) {
+      static const char prefix[] = "Date: ";
+      const char* date = UTCDate();
+      size_t len = strlen(date);
+      Reserve(sizeof(prefix) - 1 + len + 2);
+      AppendRaw(prefix, sizeof(prefix) - 1);
+      AppendRaw(date, len);
+      AppendRaw("\r\n", 2);
+    }
+
+    args[5].As<Object>()->Set(0, Integer::New(flags, node_isolate));
+
+    return scope.Close(String::NewFromOneByte(
+        node_isolate,
+        reinterpret_cast<const uint8_t*>(buffer_),
+        String::kNormalString,
+        length_));
+  }
+
+ private:
+  // One "field: value\r\n" line. Strips CR and LF and the spaces and tabs
+  // after them from the value, there's no response splitting.
+  static bool AppendLine(Local<Value> field, Local<Value> value, int* flags) {
+    size_t field_start = length_;
+    if (!Append(field))
+      return false;
+    size_t field_end = length_;
+
+    Reserve(2);
+    AppendRaw(": ", 2);
+
+    size_t value_start = length_;
+    if (!Append(value))
+      return false;
+    length_ = value_start + StripNewlines(buffer_ + value_start,
+                                          length_ - value_start);
+    size_t value_end = length_;
+
+    Reserve(2);
+    AppendRaw("\r\n", 2);
+
+    // The JS version tests with /Connection/i and so on, so these match
+    // anywhere in the field name, and the first one wins.
+    const char* f = buffer_ + field_start;
+    size_t flen = field_end - field_start;
+    const char* v = buffer_ + value_start;
+    size_t vlen = value_end - value_start;
+
+    if (Contains(f, flen, "connection")) {
+      *flags |= kSentConnection;
+      *flags |= Contains(v, vlen, "close") ? kSetLast : kSetKeepAlive;
+    } else if (Contains(f, flen, "transfer-encoding")) {
+      *flags |= kSentTransferEncoding;
+      if (Contains(v, vlen, "chunk"))
+        *flags |= kSetChunked;
+    } else if (Contains(f, flen, "content-length")) {
+      *flags |= kSentContentLength;
+    } else if (Contains(f, flen, "date")) {
+      *flags |= kSentDate;
+    } else if (Contains(f, flen, "expect")) {
+      *flags |= kSentExpect;
+    }
+
+    return true;
+  }
+
+
+  // Appends what `value + ''` would give in JS, if that's plain ASCII.
+  static bool Append(Local<Value> value) {
+    if (value->IsObject())
+      return false;  // toString() or valueOf() might have side effects
+
+    Local<String> str = value->ToString();
+    int len = str->Length();
+    if (!str->IsOneByte() && str->Utf8Length() != len)
+      return false;
+
+    Reserve(len);
+    str->WriteOneByte(reinterpret_cast<uint8_t*>(buffer_ + length_),
+                      0,
+                      len,
+                      String::NO_NULL_TERMINATION);
+
+    for (int i = 0; i < len; i++) {
+      if (static_cast<unsigned char>(buffer_[length_ + i]) >= 0x80)
+        return false;
+    }
+
+    length_ += len;
+    return true;
+  }
+
+
+  static void AppendRaw(const char* data, size_t len) {
+    memcpy(buffer_ + length_, data, len);
+    length_ += len;
+  }
+
+
+  static void Reserve(size_t len) {
+    if (length_ + len <= capacity_)
+      return;
+
+    size_t capacity = capacity_ ? capacity_ : 1024;
+    while (capacity < length_ + len)
+      capacity *= 2;
+
+    char* buffer = static_cast<char*>(realloc(buffer_, capacity));
+    if (buffer == NULL)
+      abort();
+
+    buffer_ = buffer;
+    capacity_ = capacity;
+  }
+
+
+  // value.replace(/[\r\n]+[ \t]*/g, ''), in place. Returns the new length.
+  static size_t StripNewlines(char* s, size_t len) {
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < len) {
+      if (s[i] == '\r' || s[i] == '\n') {
+        while (i < len && (s[i] == '\r' || s[i] == '\n'))
+          i++;
+        while (i < len && (s[i] == ' ' || s[i] == '\t'))
+          i++;
+      } else {
+        s[j++] = s[i++];
+      }
+    }
+
+    return j;
+  }
+
+
+  // Whether `needle`, lowercase, occurs in s[0..len) ignoring case.
+  static bool Contains(const char* s, size_t len, const char* needle) {
+    size_t n = strlen(needle);
+    if (n > len)
+      return false;
+
+    for (size_t i = 0; i <= len - n; i++) {
+      if (strncasecmp(s + i, needle, n) == 0)
+        return true;
+    }
+
+    return false;
+  }
+
+
+  // The same as `new Date().toUTCString()`, formatted once a second.
+  static const char* UTCDate() {
+    static const char* const days[] = {
+      "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+    };
+    static const char* const months[] = {
+      "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    time_t now = time(NULL);
+    if (now != date_time_) {
+      struct tm* tm = gmtime(&now);
+      snprintf(date_,
+               sizeof(date_),
+               "%s, %02d %s %04d %02d:%02d:%02d GMT",
+               days[tm->tm_wday],
+               tm->tm_mday,
+               months[tm->tm_mon],
+               tm->tm_year + 1900,
+               tm->tm_hour,
+               tm->tm_min,
+               tm->tm_sec);
+      date_time_ = now;
+    }
+
+    return date_;
+  }
+
+  static char* buffer_;
+  static size_t length_;
+  static size_t capacity_;
+  static time_t date_time_;
+  static char date_[64];
+};
+
+char* HeaderBlock::buffer_;
+size_t HeaderBlock::length_;
+size_t HeaderBlock::capacity_;
+time_t HeaderBlock::date_time_ = -1;
+char HeaderBlock::date_[64];
+
+
 void InitHttpParser(Handle<Object> target) {
   HandleScope scope(node_isolate);
 
@@ -570,6 +1204,15 @@ void InitHttpParser(Handle<Object> target) {
   t->Set(String::NewSymbol("RESPONSE"),
          Integer::New(HTTP_RESPONSE, node_isolate),
          attrib);
+  t->Set(String::NewSymbol("kOnHeadersComplete"),
+         Integer::New(kOnHeadersComplete, node_isolate),
+         attrib);
+  t->Set(String::NewSymbol("kOnBody"),
+         Integer::New(kOnBody, node_isolate),
+         attrib);
+  t->Set(String::NewSymbol("kOnMessageComplete"),
+         Integer::New(kOnMessageComplete, node_isolate),
+         attrib);
 
   NODE_SET_PROTOTYPE_METHOD(t, "execute", Parser::Execute);
   NODE_SET_PROTOTYPE_METHOD(t, "finish", Parser::Finish);
@@ -577,10 +1220,27 @@ void InitHttpParser(Handle<Object> target) {
 
   target->Set(String::NewSymbol("HTTPParser"), t->GetFunction());
 
+  NODE_SET_METHOD(target, "writeHeaderBlock", HeaderBlock::Write);
+
+#define X(name)                                                               \
+  target->Set(String::NewSymbol(#name),                                       \
+              Integer::New(HeaderBlock::name, node_isolate),                  \
+              attrib);
+  X(kSentConnection)
+  X(kSentContentLength)
+  X(kSentTransferEncoding)
+  X(kSentDate)
+  X(kSentExpect)
+  X(kSetLast)
+  X(kSetKeepAlive)
+  X(kSetChunked)
+#undef X
+
   on_headers_sym          = NODE_PSYMBOL("onHeaders");
   on_headers_complete_sym = NODE_PSYMBOL("onHeadersComplete");
   on_body_sym             = NODE_PSYMBOL("onBody");
   on_message_complete_sym = NODE_PSYMBOL("onMessageComplete");
+  on_batch_sym            = NODE_PSYMBOL("onBatch");
 
 #define X(num, name, string) name##_sym = NODE_PSYMBOL(#string);
   HTTP_METHOD_MAP(X)
@@ -596,6 +1256,11 @@ void InitHttpParser(Handle<Object> target) {
   upgrade_sym = NODE_PSYMBOL("upgrade");
   headers_sym = NODE_PSYMBOL("headers");
   url_sym = NODE_PSYMBOL("url");
+  max_header_pairs_sym = NODE_PSYMBOL("maxHeaderPairs");
+  header_separator_sym = NODE_PSYMBOL(", ");
+
+  for (size_t i = 0; i < ARRAY_SIZE(header_names); i++)
+    header_name_syms[i] = NODE_PSYMBOL(header_names[i].name);
 
   settings.on_message_begin    = Parser::on_message_begin;
   settings.on_url              = Parser::on_url;
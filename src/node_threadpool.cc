@@ -0,0 +1,267 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "node_threadpool.h"
+#include "node.h"
+#include "node_internals.h"
+#include "uv.h"
+#include "v8.h"
+
+#if defined HAVE_DTRACE || defined HAVE_ETW || defined HAVE_SYSTEMTAP
+# include "node_dtrace.h"
+#endif
+
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+// Bucket i counts samples that took less than 2^i microseconds but not
+// less than 2^(i-1). The last bucket collects everything that's slower.
+static const int kHistogramBuckets = 32;
+
+struct Histogram {
+  uint64_t sum;
+  uint64_t max;
+  uint64_t buckets[kHistogramBuckets];
+};
+
+struct WorkStats {
+  uint64_t count;
+  Histogram queue;  // Submitted to picked up by a thread.
+  Histogram run;    // Picked up to finished by the thread.
+  Histogram done;   // Finished to completion callback on the main thread.
+};
+
+// Indexed by uv_fs_type.
+static const char* const fs_work_names[] = {
+  "fs.custom",
+  "fs.open",
+  "fs.close",
+  "fs.read",
+  "fs.write",
+  "fs.sendfile",
+  "fs.stat",
+  "fs.lstat",
+  "fs.fstat",
+  "fs.ftruncate",
+  "fs.utime",
+  "fs.futime",
+  "fs.chmod",
+  "fs.fchmod",
+  "fs.fsync",
+  "fs.fdatasync",
+  "fs.unlink",
+  "fs.rmdir",
+  "fs.mkdir",
+  "fs.rename",
+  "fs.readdir",
+  "fs.link",
+  "fs.symlink",
+  "fs.readlink",
+  "fs.chown",
+  "fs.fchown"
+};
+
+// Indexed by ThreadpoolWorkKind.
+static const char* const work_names[] = {
+  NULL,  // THREADPOOL_WORK_FS, see fs_work_names.
+  "getaddrinfo",
+  "zlib",
+  "pbkdf2",
+  "randomBytes",
+  "tlsHandshake",
+  "crypto"
+};
+
+static WorkStats fs_work_stats[ARRAY_SIZE(fs_work_names)];
+static WorkStats work_stats[ARRAY_SIZE(work_names)];
+
+static Persistent<String> count_sym;
+static Persistent<String> sum_sym;
+static Persistent<String> max_sym;
+static Persistent<String> buckets_sym;
+static Persistent<String> queue_sym;
+static Persistent<String> run_sym;
+static Persistent<String> done_sym;
+
+
+static void HistogramAdd(Histogram* h, uint64_t nsec) {
+  uint64_t usec = nsec / 1000;
+  int bucket = 0;
+
+  while (usec > 0 && bucket < kHistogramBuckets - 1) {
+    usec >>= 1;
+    bucket++;
+  }
+
+  h->sum += nsec;
+  if (nsec > h->max)
+    h->max = nsec;
+  h->buckets[bucket]++;
+}
+
+
+void Threadpool::RecordWork(ThreadpoolWorkKind kind, uv_req_t* req) {
+  uv_work_times_t times;
+  const char* name;
+  WorkStats* stats;
+
+  if (uv_work_times(req, &times))
+    return;  // Not supported on this platform.
+
+  if (times.started == 0)
+    return;  // Cancelled, never ran.
+
+  if (kind == THREADPOOL_WORK_FS) {
+    int fs_type = reinterpret_cast<uv_fs_t*>(req)->fs_type;
+    if (fs_type < 0 || fs_type >= static_cast<int>(ARRAY_SIZE(fs_work_names)))
+      return;
+    name = fs_work_names[fs_type];
+    stats = &fs_work_stats[fs_type];
+  } else {
+    name = work_names[kind];
+    stats = &work_stats[kind];
+  }
+
+  uint64_t queue = times.started - times.submitted;
+  uint64_t run = times.finished - times.started;
+  uint64_t done = uv_hrtime() - times.finished;
+
+  stats->count++;
+  HistogramAdd(&stats->queue, queue);
+  HistogramAdd(&stats->run, run);
+  HistogramAdd(&stats->done, done);
+
+#if defined HAVE_DTRACE || defined HAVE_ETW || defined HAVE_SYSTEMTAP
+  DTraceThreadpoolWorkDone(name, queue, run, done);
+#else
+  (void) name;
+#endif
+}
+
+
+static Local<Object> HistogramToObject(const Histogram* h) {
+  HandleScope scope(node_isolate);
+
+  // Trailing empty buckets are left out.
+  int nbuckets = kHistogramBuckets;
+  while (nbuckets > 0 && h->buckets[nbuckets - 1] == 0)
+    nbuckets--;
+
+  Local<Array> buckets = Array::New(nbuckets);
+  for (int i = 0; i < nbuckets; i++)
+    buckets->Set(i, Number::New(static_cast<double>(h->buckets[i])));
+
+  Local<Object> obj = Object::New();
+  obj->Set(sum_sym, Number::New(h->sum / 1e3));
+  obj->Set(max_sym, Number::New(h->max / 1e3));
+  obj->Set(buckets_sym, buckets);
+
+  return scope.Close(obj);
+}
+
+
+static void AddStats(Local<Object> target,
+                     const char* name,
+                     const WorkStats* stats) {
+  if (stats->count == 0)
+    return;
+
+  Local<Object> obj = Object::New();
+  obj->Set(count_sym, Number::New(static_cast<double>(stats->count)));
+  obj->Set(queue_sym, HistogramToObject(&stats->queue));
+  obj->Set(run_sym, HistogramToObject(&stats->run));
+  obj->Set(done_sym, HistogramToObject(&stats->done));
+
+  target->Set(String::New(name), obj);
+}
+
+
+// Returns an object keyed by work kind. Times are in microseconds.
+static Handle<Value> GetStats(const Arguments& args) {
+  HandleScope scope(node_isolate);
+  Local<Object> result = Object::New();
+
+  for (size_t i = 0; i < ARRAY_SIZE(fs_work_names); i++)
+    AddStats(result, fs_work_names[i], &fs_work_stats[i]);
+
+  for (size_t i = 0; i < ARRAY_SIZE(work_names); i++)
+    if (work_names[i] != NULL)
+      AddStats(result, work_names[i], &work_stats[i]);
+
+  return scope.Close(result);
+}
+
+
+static Handle<Value> ResetStats(const Arguments& args) {
+  memset(fs_work_stats, 0, sizeof(fs_work_stats));
+  memset(work_stats, 0, sizeof(work_stats));
+  return Undefined(node_isolate);
+}
+
+
+static Handle<Value> GetSize(const Arguments& args) {
+  HandleScope scope(node_isolate);
+  uv_threadpool_lane_t lane =
+      static_cast<uv_threadpool_lane_t>(args[0]->Uint32Value());
+  return scope.Close(Integer::NewFromUnsigned(uv_threadpool_size(lane)));
+}
+
+
+static Handle<Value> SetSize(const Arguments& args) {
+  HandleScope scope(node_isolate);
+  uv_threadpool_lane_t lane =
+      static_cast<uv_threadpool_lane_t>(args[0]->Uint32Value());
+  uv_err_t err = uv_threadpool_resize(lane, args[1]->Uint32Value());
+
+  if (err.code != UV_OK)
+    return ThrowException(UVException(err.code, "uv_threadpool_resize"));
+
+  return Undefined(node_isolate);
+}
+
+
+void Threadpool::Initialize(Handle<Object> target) {
+  HandleScope scope(node_isolate);
+
+  count_sym = NODE_PSYMBOL("count");
+  sum_sym = NODE_PSYMBOL("sum");
+  max_sym = NODE_PSYMBOL("max");
+  buckets_sym = NODE_PSYMBOL("buckets");
+  queue_sym = NODE_PSYMBOL("queue");
+  run_sym = NODE_PSYMBOL("run");
+  done_sym = NODE_PSYMBOL("done");
+
+  NODE_DEFINE_CONSTANT(target, UV_THREADPOOL_IO);
+  NODE_DEFINE_CONSTANT(target, UV_THREADPOOL_CPU);
+
+  NODE_SET_METHOD(target, "getStats", GetStats);
+  NODE_SET_METHOD(target, "resetStats", ResetStats);
+  NODE_SET_METHOD(target, "getSize", GetSize);
+  NODE_SET_METHOD(target, "setSize", SetSize);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_threadpool, node::Threadpool::Initialize)
@@ -19,31 +19,37 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#ifndef SRC_NODE_THREADPOOL_H_
+#define SRC_NODE_THREADPOOL_H_
+
+#include "node.h"
+#include "uv.h"
 #include "v8.h"
 
 namespace node {
 
-class SlabAllocator {
-public:
-  SlabAllocator(unsigned int size = 10485760); // default to 10M
-  ~SlabAllocator();
-
-  // allocate memory from slab, attaches the slice to `obj`
-  char* Allocate(v8::Handle<v8::Object> obj, unsigned int size);
-
-  // return excess memory to the slab, returns a handle to the parent buffer
-  v8::Local<v8::Object> Shrink(v8::Handle<v8::Object> obj,
-                               char* ptr,
-                               unsigned int size);
-
-private:
-  void Initialize();
-  bool initialized_;
-  v8::Persistent<v8::Object> slab_;
-  v8::Persistent<v8::String> slab_sym_;
-  unsigned int offset_;
-  unsigned int size_;
-  char* last_ptr_;
+// Thread pool work that is accounted for separately. File system requests
+// are further broken down by their uv_fs_type.
+enum ThreadpoolWorkKind {
+  THREADPOOL_WORK_FS,
+  THREADPOOL_WORK_GETADDRINFO,
+  THREADPOOL_WORK_ZLIB,
+  THREADPOOL_WORK_PBKDF2,
+  THREADPOOL_WORK_RANDOM_BYTES,
+  THREADPOOL_WORK_TLS_HANDSHAKE,
+  THREADPOOL_WORK_CRYPTO
 };
 
-} // namespace node
+class Threadpool {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  // Adds the queue wait, run time and completion delay of `req` to the
+  // histograms for `kind`. Must be called from the request's completion
+  // callback, on the main thread.
+  static void RecordWork(ThreadpoolWorkKind kind, uv_req_t* req);
+};
+
+}  // namespace node
+
+#endif  // SRC_NODE_THREADPOOL_H_
@@ -29,6 +29,12 @@
 #include "zlib.h"
 #include "node.h"
 #include "node_buffer.h"
+#include "node_threadpool.h"
+
+#if HAVE_BROTLI
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+#endif
 
 
 namespace node {
@@ -37,6 +43,7 @@ using namespace v8;
 
 static Persistent<String> callback_sym;
 static Persistent<String> onerror_sym;
+static Persistent<String> oncomplete_sym;
 
 enum node_zlib_mode {
   NONE,
@@ -46,13 +53,94 @@ enum node_zlib_mode {
   GUNZIP,
   DEFLATERAW,
   INFLATERAW,
-  UNZIP
+  UNZIP,
+  BROTLI_ENCODE,
+  BROTLI_DECODE
 };
 
 
 void InitZlib(v8::Handle<v8::Object> target);
 
 
+/**
+ * Idle z_streams, kept after a ZCtx is closed so that the next ZCtx with
+ * the same parameters can be set up with deflateReset()/inflateReset()
+ * instead of a fresh deflateInit2()/inflateInit2(), which allocates and
+ * clears several hundred kilobytes. Only touched from the main thread.
+ */
+class ZStreamPool {
+ public:
+  // Returns a reset stream for the given parameters, or NULL.
+  static z_stream* Get(node_zlib_mode mode, int level, int windowBits,
+                       int memLevel, int strategy);
+
+  // Resets `strm` and keeps it for later reuse. Returns false, leaving
+  // the stream untouched, if the pool is full or the stream can't be reset.
+  static bool Put(z_stream* strm, node_zlib_mode mode, int level,
+                  int windowBits, int memLevel, int strategy);
+
+ private:
+  static const int kMaxIdle = 16;
+
+  struct Entry {
+    z_stream* strm;
+    node_zlib_mode mode;
+    int level;
+    int windowBits;
+    int memLevel;
+    int strategy;
+  };
+
+  static bool IsDeflate(node_zlib_mode mode) {
+    return mode == DEFLATE || mode == GZIP || mode == DEFLATERAW;
+  }
+
+  static Entry idle_[kMaxIdle];
+  static int idle_count_;
+};
+
+
+ZStreamPool::Entry ZStreamPool::idle_[ZStreamPool::kMaxIdle];
+int ZStreamPool::idle_count_;
+
+
+z_stream* ZStreamPool::Get(node_zlib_mode mode, int level, int windowBits,
+                           int memLevel, int strategy) {
+  // The most recently returned stream is the most likely to be warm.
+  for (int i = idle_count_ - 1; i >= 0; i--) {
+    Entry* e = &idle_[i];
+    if (e->mode != mode || e->windowBits != windowBits) continue;
+    if (IsDeflate(mode) && (e->level != level ||
+                            e->memLevel != memLevel ||
+                            e->strategy != strategy)) {
+      continue;
+    }
+    z_stream* strm = e->strm;
+    *e = idle_[--idle_count_];
+    return strm;
+  }
+  return NULL;
+}
+
+
+bool ZStreamPool::Put(z_stream* strm, node_zlib_mode mode, int level,
+                      int windowBits, int memLevel, int strategy) {
+  if (idle_count_ == kMaxIdle) return false;
+
+  int err = IsDeflate(mode) ? deflateReset(strm) : inflateReset(strm);
+  if (err != Z_OK) return false;
+
+  Entry* e = &idle_[idle_count_++];
+  e->strm = strm;
+  e->mode = mode;
+  e->level = level;
+  e->windowBits = windowBits;
+  e->memLevel = memLevel;
+  e->strategy = strategy;
+  return true;
+}
+
+
 /**
  * Deflate/Inflate
  */
@@ -62,6 +150,7 @@ class ZCtx : public ObjectWrap {
   ZCtx(node_zlib_mode mode)
     : ObjectWrap()
     , init_done_(false)
+    , strm_(NULL)
     , level_(0)
     , windowBits_(0)
     , memLevel_(0)
@@ -72,7 +161,16 @@ class ZCtx : public ObjectWrap {
     , flush_(0)
     , chunk_size_(0)
     , write_in_progress_(false)
+    , write_sync_(false)
     , mode_(mode)
+#if HAVE_BROTLI
+    , brotli_encoder_(NULL)
+    , brotli_decoder_(NULL)
+    , brotli_quality_(0)
+    , brotli_lgwin_(0)
+    , brotli_mode_(0)
+    , brotli_error_(NULL)
+#endif
   {
   }
 
@@ -85,16 +183,32 @@ class ZCtx : public ObjectWrap {
   void Close() {
     assert(!write_in_progress_ && "write in progress");
     assert(init_done_ && "close before init");
-    assert(mode_ <= UNZIP);
+    assert(mode_ <= BROTLI_DECODE);
+
+#if HAVE_BROTLI
+    if (mode_ == BROTLI_ENCODE || mode_ == BROTLI_DECODE) {
+      CloseBrotli();
+      delete strm_;
+      strm_ = NULL;
+      mode_ = NONE;
+      return;
+    }
+#endif
 
-    if (mode_ == DEFLATE || mode_ == GZIP || mode_ == DEFLATERAW) {
-      (void)deflateEnd(&strm_);
-      node_isolate->AdjustAmountOfExternalAllocatedMemory(-kDeflateContextSize);
-    } else if (mode_ == INFLATE || mode_ == GUNZIP || mode_ == INFLATERAW ||
-               mode_ == UNZIP) {
-      (void)inflateEnd(&strm_);
-      node_isolate->AdjustAmountOfExternalAllocatedMemory(-kInflateContextSize);
+    if (mode_ != NONE && !ZStreamPool::Put(strm_, mode_, level_, windowBits_,
+                                           memLevel_, strategy_)) {
+      if (mode_ == DEFLATE || mode_ == GZIP || mode_ == DEFLATERAW) {
+        (void)deflateEnd(strm_);
+        node_isolate->
+                    AdjustAmountOfExternalAllocatedMemory(-kDeflateContextSize);
+      } else {
+        (void)inflateEnd(strm_);
+        node_isolate->
+                    AdjustAmountOfExternalAllocatedMemory(-kInflateContextSize);
+      }
+      delete strm_;
     }
+    strm_ = NULL;
     mode_ = NONE;
 
     if (dictionary_ != NULL) {
@@ -118,6 +232,50 @@ class ZCtx : public ObjectWrap {
     assert(args.Length() == 7);
 
     ZCtx *ctx = ObjectWrap::Unwrap<ZCtx>(args.This());
+    SetupWrite(ctx, args);
+
+    uv_queue_work(uv_default_loop(),
+                  &ctx->work_req_,
+                  ZCtx::Process,
+                  ZCtx::After);
+
+    return ctx->handle_;
+  }
+
+
+  // writeSync(flush, in, in_off, in_len, out, out_off, out_len, result)
+  // Same as write(), but does the work on the main thread. Meant for small
+  // chunks, where handing them to the thread pool costs more than zlib
+  // itself does. Stores avail_in and avail_out in result[0] and result[1]
+  // and returns true, or calls onerror and returns false.
+  static Handle<Value> WriteSync(const Arguments& args) {
+    HandleScope scope(node_isolate);
+    assert(args.Length() == 8 && args[7]->IsArray());
+
+    ZCtx *ctx = ObjectWrap::Unwrap<ZCtx>(args.This());
+    SetupWrite(ctx, args);
+
+    Process(&ctx->work_req_);
+
+    ctx->write_sync_ = true;
+    bool ok = CheckError(ctx);
+    ctx->write_sync_ = false;
+    if (!ok) return scope.Close(False(node_isolate));
+
+    Local<Object> result = args[7].As<Object>();
+    result->Set(0, Integer::NewFromUnsigned(ctx->strm_->avail_in,
+                                            node_isolate));
+    result->Set(1, Integer::NewFromUnsigned(ctx->strm_->avail_out,
+                                            node_isolate));
+
+    ctx->write_in_progress_ = false;
+    ctx->Unref();
+
+    return scope.Close(True(node_isolate));
+  }
+
+
+  static void SetupWrite(ZCtx* ctx, const Arguments& args) {
     assert(ctx->init_done_ && "write before init");
     assert(ctx->mode_ != NONE && "already finalized");
 
@@ -166,24 +324,14 @@ class ZCtx : public ObjectWrap {
     assert(out_off + out_len <= Buffer::Length(out_buf));
     out = reinterpret_cast<Bytef *>(Buffer::Data(out_buf) + out_off);
 
-    // build up the work request
-    uv_work_t* work_req = &(ctx->work_req_);
-
-    ctx->strm_.avail_in = in_len;
-    ctx->strm_.next_in = in;
-    ctx->strm_.avail_out = out_len;
-    ctx->strm_.next_out = out;
+    ctx->strm_->avail_in = in_len;
+    ctx->strm_->next_in = in;
+    ctx->strm_->avail_out = out_len;
+    ctx->strm_->next_out = out;
     ctx->flush_ = flush;
 
     // set this so that later on, I can easily tell how much was written.
     ctx->chunk_size_ = out_len;
-
-    uv_queue_work(uv_default_loop(),
-                  work_req,
-                  ZCtx::Process,
-                  ZCtx::After);
-
-    return ctx->handle_;
   }
 
 
@@ -201,25 +349,25 @@ class ZCtx : public ObjectWrap {
       case DEFLATE:
       case GZIP:
       case DEFLATERAW:
-        ctx->err_ = deflate(&ctx->strm_, ctx->flush_);
+        ctx->err_ = deflate(ctx->strm_, ctx->flush_);
         break;
       case UNZIP:
       case INFLATE:
       case GUNZIP:
       case INFLATERAW:
-        ctx->err_ = inflate(&ctx->strm_, ctx->flush_);
+        ctx->err_ = inflate(ctx->strm_, ctx->flush_);
 
         // If data was encoded with dictionary
         if (ctx->err_ == Z_NEED_DICT && ctx->dictionary_ != NULL) {
 
           // Load it
-          ctx->err_ = inflateSetDictionary(&ctx->strm_,
+          ctx->err_ = inflateSetDictionary(ctx->strm_,
                                            ctx->dictionary_,
                                            ctx->dictionary_len_);
           if (ctx->err_ == Z_OK) {
 
             // And try to decode again
-            ctx->err_ = inflate(&ctx->strm_, ctx->flush_);
+            ctx->err_ = inflate(ctx->strm_, ctx->flush_);
           } else if (ctx->err_ == Z_DATA_ERROR) {
 
             // Both inflateSetDictionary() and inflate() return Z_DATA_ERROR.
@@ -229,6 +377,12 @@ class ZCtx : public ObjectWrap {
           }
         }
         break;
+#if HAVE_BROTLI
+      case BROTLI_ENCODE:
+      case BROTLI_DECODE:
+        ProcessBrotli(ctx);
+        break;
+#endif
       default:
         assert(0 && "wtf?");
     }
@@ -244,47 +398,60 @@ class ZCtx : public ObjectWrap {
   static void After(uv_work_t* work_req, int status) {
     assert(status == 0);
 
+    Threadpool::RecordWork(THREADPOOL_WORK_ZLIB,
+                           reinterpret_cast<uv_req_t*>(work_req));
+
     HandleScope scope(node_isolate);
     ZCtx *ctx = container_of(work_req, ZCtx, work_req_);
 
-    // Acceptable error states depend on the type of zlib stream.
+    if (!CheckError(ctx)) return;
+
+    Local<Integer> avail_out = Integer::New(ctx->strm_->avail_out,
+                                            node_isolate);
+    Local<Integer> avail_in = Integer::New(ctx->strm_->avail_in, node_isolate);
+
+    ctx->write_in_progress_ = false;
+
+    // call the write() cb
+    assert(ctx->handle_->Get(callback_sym)->IsFunction() &&
+           "Invalid callback");
+    Local<Value> args[2] = { avail_in, avail_out };
+    MakeCallback(ctx->handle_, callback_sym, ARRAY_SIZE(args), args);
+
+    ctx->Unref();
+  }
+
+  // Acceptable error states depend on the type of zlib stream.
+  // Returns false after reporting the error if it is fatal.
+  static bool CheckError(ZCtx* ctx) {
     switch (ctx->err_) {
       case Z_OK:
       case Z_STREAM_END:
       case Z_BUF_ERROR:
         // normal statuses, not fatal
-        break;
+        return true;
       case Z_NEED_DICT:
         if (ctx->dictionary_ == NULL) {
           ZCtx::Error(ctx, "Missing dictionary");
         } else {
           ZCtx::Error(ctx, "Bad dictionary");
         }
-        return;
+        return false;
       default:
         // something else.
         ZCtx::Error(ctx, "Zlib error");
-        return;
+        return false;
     }
-
-    Local<Integer> avail_out = Integer::New(ctx->strm_.avail_out, node_isolate);
-    Local<Integer> avail_in = Integer::New(ctx->strm_.avail_in, node_isolate);
-
-    ctx->write_in_progress_ = false;
-
-    // call the write() cb
-    assert(ctx->handle_->Get(callback_sym)->IsFunction() &&
-           "Invalid callback");
-    Local<Value> args[2] = { avail_in, avail_out };
-    MakeCallback(ctx->handle_, callback_sym, ARRAY_SIZE(args), args);
-
-    ctx->Unref();
   }
 
   static void Error(ZCtx *ctx, const char *msg_) {
     const char *msg;
-    if (ctx->strm_.msg != NULL) {
-      msg = ctx->strm_.msg;
+    if (ctx->strm_ != NULL && ctx->strm_->msg != NULL) {
+      msg = ctx->strm_->msg;
+#if HAVE_BROTLI
+    } else if (ctx->brotli_error_ != NULL) {
+      msg = ctx->brotli_error_;
+#endif
     } else {
       msg = msg_;
     }
@@ -295,7 +462,14 @@ class ZCtx : public ObjectWrap {
     Local<Value> args[2] = { String::New(msg),
                              Local<Value>::New(node_isolate,
                                                Number::New(ctx->err_)) };
-    MakeCallback(ctx->handle_, onerror_sym, ARRAY_SIZE(args), args);
+    if (ctx->write_sync_) {
+      // We're inside a call from JS, let any exception propagate to it
+      // and leave the tick queue alone.
+      Local<Function> onerror = ctx->handle_->Get(onerror_sym).As<Function>();
+      onerror->Call(ctx->handle_, ARRAY_SIZE(args), args);
+    } else {
+      MakeCallback(ctx->handle_, onerror_sym, ARRAY_SIZE(args), args);
+    }
 
     // no hope of rescue.
     ctx->write_in_progress_ = false;
@@ -309,9 +483,15 @@ class ZCtx : public ObjectWrap {
     }
     node_zlib_mode mode = (node_zlib_mode) args[0]->Int32Value();
 
-    if (mode < DEFLATE || mode > UNZIP) {
+    if (mode < DEFLATE || mode > BROTLI_DECODE) {
+      return ThrowException(Exception::TypeError(String::New("Bad argument")));
+    }
+
+#if !HAVE_BROTLI
+    if (mode == BROTLI_ENCODE || mode == BROTLI_DECODE) {
       return ThrowException(Exception::TypeError(String::New("Bad argument")));
     }
+#endif
 
     ZCtx *ctx = new ZCtx(mode);
     ctx->Wrap(args.This());
@@ -377,10 +557,6 @@ class ZCtx : public ObjectWrap {
     ctx->memLevel_ = memLevel;
     ctx->strategy_ = strategy;
 
-    ctx->strm_.zalloc = Z_NULL;
-    ctx->strm_.zfree = Z_NULL;
-    ctx->strm_.opaque = Z_NULL;
-
     ctx->flush_ = Z_NO_FLUSH;
 
     ctx->err_ = Z_OK;
@@ -397,11 +573,37 @@ class ZCtx : public ObjectWrap {
       ctx->windowBits_ *= -1;
     }
 
+    ctx->strm_ = ZStreamPool::Get(ctx->mode_,
+                                  ctx->level_,
+                                  ctx->windowBits_,
+                                  ctx->memLevel_,
+                                  ctx->strategy_);
+    if (ctx->strm_ == NULL) {
+      ctx->strm_ = new z_stream;
+      ctx->strm_->zalloc = Z_NULL;
+      ctx->strm_->zfree = Z_NULL;
+      ctx->strm_->opaque = Z_NULL;
+      InitStream(ctx);
+    }
+
+    if (ctx->err_ != Z_OK) {
+      ZCtx::Error(ctx, "Init error");
+    }
+
+
+    ctx->dictionary_ = reinterpret_cast<Bytef *>(dictionary);
+    ctx->dictionary_len_ = dictionary_len;
+
+    ctx->write_in_progress_ = false;
+    ctx->init_done_ = true;
+  }
+
+  static void InitStream(ZCtx* ctx) {
     switch (ctx->mode_) {
       case DEFLATE:
       case GZIP:
       case DEFLATERAW:
-        ctx->err_ = deflateInit2(&ctx->strm_,
+        ctx->err_ = deflateInit2(ctx->strm_,
                                  ctx->level_,
                                  Z_DEFLATED,
                                  ctx->windowBits_,
@@ -414,24 +616,13 @@ class ZCtx : public ObjectWrap {
       case GUNZIP:
       case INFLATERAW:
       case UNZIP:
-        ctx->err_ = inflateInit2(&ctx->strm_, ctx->windowBits_);
+        ctx->err_ = inflateInit2(ctx->strm_, ctx->windowBits_);
         node_isolate->
                     AdjustAmountOfExternalAllocatedMemory(kInflateContextSize);
         break;
       default:
         assert(0 && "wtf?");
     }
-
-    if (ctx->err_ != Z_OK) {
-      ZCtx::Error(ctx, "Init error");
-    }
-
-
-    ctx->dictionary_ = reinterpret_cast<Bytef *>(dictionary);
-    ctx->dictionary_len_ = dictionary_len;
-
-    ctx->write_in_progress_ = false;
-    ctx->init_done_ = true;
   }
 
   static void SetDictionary(ZCtx* ctx) {
@@ -442,7 +633,7 @@ class ZCtx : public ObjectWrap {
     switch (ctx->mode_) {
       case DEFLATE:
       case DEFLATERAW:
-        ctx->err_ = deflateSetDictionary(&ctx->strm_,
+        ctx->err_ = deflateSetDictionary(ctx->strm_,
                                          ctx->dictionary_,
                                          ctx->dictionary_len_);
         break;
@@ -461,12 +652,20 @@ class ZCtx : public ObjectWrap {
     switch (ctx->mode_) {
       case DEFLATE:
       case DEFLATERAW:
-        ctx->err_ = deflateReset(&ctx->strm_);
+        ctx->err_ = deflateReset(ctx->strm_);
         break;
       case INFLATE:
       case INFLATERAW:
-        ctx->err_ = inflateReset(&ctx->strm_);
+        ctx->err_ = inflateReset(ctx->strm_);
+        break;
+#if HAVE_BROTLI
+      case BROTLI_ENCODE:
+      case BROTLI_DECODE:
+        // brotli has no reset, start over with a new instance.
+        ctx->CloseBrotli();
+        ctx->err_ = ctx->InitBrotli();
         break;
+#endif
       default:
         break;
     }
@@ -476,13 +675,150 @@ class ZCtx : public ObjectWrap {
     }
   }
 
- private:
+#if HAVE_BROTLI
+  // initBrotli(quality, lgwin, mode)
+  static Handle<Value> InitBrotli(const Arguments& args) {
+    HandleScope scope(node_isolate);
+
+    assert(args.Length() == 3 && "initBrotli(quality, lgwin, mode)");
+
+    ZCtx *ctx = ObjectWrap::Unwrap<ZCtx>(args.This());
+    assert(ctx->mode_ == BROTLI_ENCODE || ctx->mode_ == BROTLI_DECODE);
+
+    ctx->brotli_quality_ = args[0]->Uint32Value();
+    assert(ctx->brotli_quality_ >= BROTLI_MIN_QUALITY &&
+           ctx->brotli_quality_ <= BROTLI_MAX_QUALITY &&
+           "invalid quality");
+
+    ctx->brotli_lgwin_ = args[1]->Uint32Value();
+    assert(ctx->brotli_lgwin_ >= BROTLI_MIN_WINDOW_BITS &&
+           ctx->brotli_lgwin_ <= BROTLI_MAX_WINDOW_BITS &&
+           "invalid lgwin");
+
+    ctx->brotli_mode_ = args[2]->Uint32Value();
+    assert((ctx->brotli_mode_ == BROTLI_MODE_GENERIC ||
+            ctx->brotli_mode_ == BROTLI_MODE_TEXT ||
+            ctx->brotli_mode_ == BROTLI_MODE_FONT) && "invalid mode");
+
+    // Only the buffer pointers of the z_stream are used, they make
+    // Write() and After() work the same for every mode.
+    ctx->strm_ = new z_stream;
+    memset(ctx->strm_, 0, sizeof(*ctx->strm_));
+
+    ctx->flush_ = Z_NO_FLUSH;
+    ctx->err_ = ctx->InitBrotli();
+    if (ctx->err_ != Z_OK) {
+      ZCtx::Error(ctx, "Init error");
+    }
+
+    ctx->write_in_progress_ = false;
+    ctx->init_done_ = true;
+    return Undefined(node_isolate);
+  }
+
+  int InitBrotli() {
+    brotli_error_ = NULL;
+
+    if (mode_ == BROTLI_DECODE) {
+      brotli_decoder_ = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+      return brotli_decoder_ == NULL ? Z_MEM_ERROR : Z_OK;
+    }
+
+    brotli_encoder_ = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    if (brotli_encoder_ == NULL) return Z_MEM_ERROR;
+    BrotliEncoderSetParameter(brotli_encoder_,
+                              BROTLI_PARAM_QUALITY,
+                              brotli_quality_);
+    BrotliEncoderSetParameter(brotli_encoder_,
+                              BROTLI_PARAM_LGWIN,
+                              brotli_lgwin_);
+    BrotliEncoderSetParameter(brotli_encoder_,
+                              BROTLI_PARAM_MODE,
+                              brotli_mode_);
+    return Z_OK;
+  }
+
+  void CloseBrotli() {
+    if (brotli_encoder_ != NULL) {
+      BrotliEncoderDestroyInstance(brotli_encoder_);
+      brotli_encoder_ = NULL;
+    }
+    if (brotli_decoder_ != NULL) {
+      BrotliDecoderDestroyInstance(brotli_decoder_);
+      brotli_decoder_ = NULL;
+    }
+  }
+
+  // Same contract as deflate()/inflate(): consume from next_in, produce
+  // into next_out and leave a zlib status in err_.
+  static void ProcessBrotli(ZCtx* ctx) {
+    z_stream* strm = ctx->strm_;
+    size_t avail_in = strm->avail_in;
+    size_t avail_out = strm->avail_out;
+    const uint8_t* next_in = strm->next_in;
+    uint8_t* next_out = strm->next_out;
+
+    if (ctx->mode_ == BROTLI_ENCODE) {
+      BrotliEncoderOperation op;
+      switch (ctx->flush_) {
+        case Z_NO_FLUSH:
+          op = BROTLI_OPERATION_PROCESS;
+          break;
+        case Z_FINISH:
+          op = BROTLI_OPERATION_FINISH;
+          break;
+        default:
+          op = BROTLI_OPERATION_FLUSH;
+          break;
+      }
+
+      if (!BrotliEncoderCompressStream(ctx->brotli_encoder_,
+                                       op,
+                                       &avail_in,
+                                       &next_in,
+                                       &avail_out,
+                                       &next_out,
+                                       NULL)) {
+        ctx->err_ = Z_DATA_ERROR;
+        ctx->brotli_error_ = "Compression failed";
+      } else if (BrotliEncoderIsFinished(ctx->brotli_encoder_)) {
+        ctx->err_ = Z_STREAM_END;
+      } else {
+        ctx->err_ = Z_OK;
+      }
+    } else {
+      BrotliDecoderResult result =
+          BrotliDecoderDecompressStream(ctx->brotli_decoder_,
+                                        &avail_in,
+                                        &next_in,
+                                        &avail_out,
+                                        &next_out,
+                                        NULL);
+      if (result == BROTLI_DECODER_RESULT_ERROR) {
+        ctx->err_ = Z_DATA_ERROR;
+        ctx->brotli_error_ = BrotliDecoderErrorString(
+            BrotliDecoderGetErrorCode(ctx->brotli_decoder_));
+      } else if (result == BROTLI_DECODER_RESULT_SUCCESS) {
+        ctx->err_ = Z_STREAM_END;
+      } else {
+        ctx->err_ = Z_OK;
+      }
+    }
+
+    strm->avail_in = avail_in;
+    strm->next_in = const_cast<Bytef*>(next_in);
+    strm->avail_out = avail_out;
+    strm->next_out = next_out;
+  }
+#endif  // HAVE_BROTLI
+
   static const int kDeflateContextSize = 16384; // approximate
   static const int kInflateContextSize = 10240; // approximate
 
+ private:
   bool init_done_;
 
-  z_stream strm_;
+  z_stream* strm_;
   int level_;
   int windowBits_;
   int memLevel_;
@@ -498,12 +834,230 @@ class ZCtx : public ObjectWrap {
   int chunk_size_;
 
   bool write_in_progress_;
+  bool write_sync_;
 
   uv_work_t work_req_;
   node_zlib_mode mode_;
+
+#if HAVE_BROTLI
+  BrotliEncoderState* brotli_encoder_;
+  BrotliDecoderState* brotli_decoder_;
+  int brotli_quality_;
+  int brotli_lgwin_;
+  int brotli_mode_;
+  const char* brotli_error_;
+#endif
 };
 
 
+/**
+ * Parallel gzip
+ *
+ * Compresses one block of a larger stream on the thread pool, so that
+ * lib/zlib.js can have several blocks of the same stream in flight. Each
+ * block is raw deflate, primed with the tail of the previous block as the
+ * dictionary and ended with a sync flush (or Z_FINISH for the last one),
+ * so the outputs concatenate into a single deflate stream. The caller
+ * adds the gzip header and trailer, using the per-block CRCs.
+ */
+struct DeflateBlockReq {
+  uv_work_t work_req;
+  Persistent<Object> obj;
+  z_stream* strm;
+  int level;
+  int memLevel;
+  int strategy;
+  Bytef* in;
+  size_t in_len;
+  Bytef* dictionary;
+  size_t dictionary_len;
+  bool last;
+  char* out;
+  size_t out_len;
+  uLong crc;
+  int err;
+};
+
+
+static void DeflateBlockFree(char* data, void* hint) {
+  free(data);
+}
+
+
+static void DeflateBlockWork(uv_work_t* work_req) {
+  DeflateBlockReq* req = container_of(work_req, DeflateBlockReq, work_req);
+  z_stream* strm = req->strm;
+  int flush = req->last ? Z_FINISH : Z_SYNC_FLUSH;
+
+  req->crc = crc32(crc32(0L, Z_NULL, 0), req->in, req->in_len);
+
+  if (req->dictionary_len > 0) {
+    req->err = deflateSetDictionary(strm,
+                                    req->dictionary,
+                                    req->dictionary_len);
+    if (req->err != Z_OK) return;
+  }
+
+  // Room for the whole block in one go, plus the sync flush marker.
+  size_t out_size = deflateBound(strm, req->in_len) + 16;
+  req->out = static_cast<char*>(malloc(out_size));
+  req->out_len = 0;
+  if (req->out == NULL) {
+    req->err = Z_MEM_ERROR;
+    return;
+  }
+
+  strm->next_in = req->in;
+  strm->avail_in = req->in_len;
+
+  for (;;) {
+    strm->next_out = reinterpret_cast<Bytef*>(req->out + req->out_len);
+    strm->avail_out = out_size - req->out_len;
+
+    req->err = deflate(strm, flush);
+    req->out_len = out_size - strm->avail_out;
+
+    if (req->err == Z_STREAM_END) {
+      req->err = Z_OK;
+      break;
+    }
+    if (req->err != Z_OK && req->err != Z_BUF_ERROR) break;
+    if (strm->avail_out != 0) {
+      // Room to spare means the flush is complete. Z_FINISH should have
+      // returned Z_STREAM_END in that case.
+      req->err = req->last ? Z_BUF_ERROR : Z_OK;
+      break;
+    }
+
+    // deflateBound() was too optimistic, grow the output.
+    out_size *= 2;
+    char* out = static_cast<char*>(realloc(req->out, out_size));
+    if (out == NULL) {
+      req->err = Z_MEM_ERROR;
+      break;
+    }
+    req->out = out;
+  }
+}
+
+
+static void DeflateBlockAfter(uv_work_t* work_req, int status) {
+  assert(status == 0);
+
+  Threadpool::RecordWork(THREADPOOL_WORK_ZLIB,
+                         reinterpret_cast<uv_req_t*>(work_req));
+
+  HandleScope scope(node_isolate);
+  DeflateBlockReq* req = container_of(work_req, DeflateBlockReq, work_req);
+
+  if (!ZStreamPool::Put(req->strm, DEFLATERAW, req->level, -15,
+                        req->memLevel, req->strategy)) {
+    (void)deflateEnd(req->strm);
+    node_isolate->
+        AdjustAmountOfExternalAllocatedMemory(-ZCtx::kDeflateContextSize);
+    delete req->strm;
+  }
+
+  Local<Value> argv[3];
+  if (req->err == Z_OK) {
+    argv[0] = Local<Value>::New(node_isolate, Null(node_isolate));
+    argv[1] = Local<Object>::New(node_isolate,
+                                 Buffer::New(req->out,
+                                             req->out_len,
+                                             DeflateBlockFree,
+                                             NULL)->handle_);
+    argv[2] = Integer::NewFromUnsigned(req->crc, node_isolate);
+  } else {
+    free(req->out);
+    argv[0] = Integer::New(req->err, node_isolate);
+    argv[1] = Local<Value>::New(node_isolate, Undefined(node_isolate));
+    argv[2] = Local<Value>::New(node_isolate, Undefined(node_isolate));
+  }
+
+  Persistent<Object> obj = req->obj;
+  delete req;
+  MakeCallback(obj, oncomplete_sym, ARRAY_SIZE(argv), argv);
+  obj.Dispose(node_isolate);
+}
+
+
+// deflateBlock(input, dictionary, level, memLevel, strategy, last, cb)
+// cb(errno, output, crc32) is called with errno set to null on success.
+static Handle<Value> DeflateBlock(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  assert(args.Length() == 7 && "deflateBlock(input, dictionary, level, "
+                                "memLevel, strategy, last, cb)");
+  assert(Buffer::HasInstance(args[0]));
+  assert(args[1]->IsNull() || Buffer::HasInstance(args[1]));
+  assert(args[6]->IsFunction());
+
+  DeflateBlockReq* req = new DeflateBlockReq;
+  req->level = args[2]->Int32Value();
+  req->memLevel = args[3]->Int32Value();
+  req->strategy = args[4]->Int32Value();
+  req->last = args[5]->IsTrue();
+  req->in = reinterpret_cast<Bytef*>(Buffer::Data(args[0]));
+  req->in_len = Buffer::Length(args[0]);
+  req->dictionary = NULL;
+  req->dictionary_len = 0;
+  if (!args[1]->IsNull()) {
+    req->dictionary = reinterpret_cast<Bytef*>(Buffer::Data(args[1]));
+    req->dictionary_len = Buffer::Length(args[1]);
+  }
+  req->out = NULL;
+  req->out_len = 0;
+  req->crc = 0;
+  req->err = Z_OK;
+
+  req->strm = ZStreamPool::Get(DEFLATERAW, req->level, -15,
+                               req->memLevel, req->strategy);
+  if (req->strm == NULL) {
+    req->strm = new z_stream;
+    req->strm->zalloc = Z_NULL;
+    req->strm->zfree = Z_NULL;
+    req->strm->opaque = Z_NULL;
+    int err = deflateInit2(req->strm,
+                           req->level,
+                           Z_DEFLATED,
+                           -15,
+                           req->memLevel,
+                           req->strategy);
+    if (err != Z_OK) {
+      delete req->strm;
+      delete req;
+      return ThrowException(Exception::Error(String::New("Init error")));
+    }
+    node_isolate->
+        AdjustAmountOfExternalAllocatedMemory(ZCtx::kDeflateContextSize);
+  }
+
+  // Keep the buffers alive while the thread pool reads from them.
+  req->obj = Persistent<Object>::New(node_isolate, Object::New());
+  req->obj->Set(oncomplete_sym, args[6]);
+  req->obj->Set(0, args[0]);
+  req->obj->Set(1, args[1]);
+
+  uv_queue_work(uv_default_loop(),
+                &req->work_req,
+                DeflateBlockWork,
+                DeflateBlockAfter);
+
+  return Undefined(node_isolate);
+}
+
+
+// crc32Combine(crc1, crc2, len2)
+static Handle<Value> Crc32Combine(const Arguments& args) {
+  HandleScope scope(node_isolate);
+  uLong crc1 = args[0]->Uint32Value();
+  uLong crc2 = args[1]->Uint32Value();
+  z_off_t len2 = args[2]->IntegerValue();
+  uLong crc = crc32_combine(crc1, crc2, len2);
+  return scope.Close(Integer::NewFromUnsigned(crc, node_isolate));
+}
+
+
 void InitZlib(Handle<Object> target) {
   HandleScope scope(node_isolate);
 
@@ -512,7 +1066,11 @@ void InitZlib(Handle<Object> target) {
   z->InstanceTemplate()->SetInternalFieldCount(1);
 
   NODE_SET_PROTOTYPE_METHOD(z, "write", ZCtx::Write);
+  NODE_SET_PROTOTYPE_METHOD(z, "writeSync", ZCtx::WriteSync);
   NODE_SET_PROTOTYPE_METHOD(z, "init", ZCtx::Init);
+#if HAVE_BROTLI
+  NODE_SET_PROTOTYPE_METHOD(z, "initBrotli", ZCtx::InitBrotli);
+#endif
   NODE_SET_PROTOTYPE_METHOD(z, "close", ZCtx::Close);
   NODE_SET_PROTOTYPE_METHOD(z, "reset", ZCtx::Reset);
 
@@ -521,6 +1079,10 @@ void InitZlib(Handle<Object> target) {
 
   callback_sym = NODE_PSYMBOL("callback");
   onerror_sym = NODE_PSYMBOL("onerror");
+  oncomplete_sym = NODE_PSYMBOL("oncomplete");
+
+  NODE_SET_METHOD(target, "deflateBlock", DeflateBlock);
+  NODE_SET_METHOD(target, "crc32Combine", Crc32Combine);
 
   // valid flush values.
   NODE_DEFINE_CONSTANT(target, Z_NO_FLUSH);
@@ -560,6 +1122,20 @@ void InitZlib(Handle<Object> target) {
   NODE_DEFINE_CONSTANT(target, INFLATERAW);
   NODE_DEFINE_CONSTANT(target, UNZIP);
 
+#if HAVE_BROTLI
+  NODE_DEFINE_CONSTANT(target, BROTLI_ENCODE);
+  NODE_DEFINE_CONSTANT(target, BROTLI_DECODE);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MODE_GENERIC);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MODE_TEXT);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MODE_FONT);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MIN_QUALITY);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MAX_QUALITY);
+  NODE_DEFINE_CONSTANT(target, BROTLI_DEFAULT_QUALITY);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MIN_WINDOW_BITS);
+  NODE_DEFINE_CONSTANT(target, BROTLI_MAX_WINDOW_BITS);
+  NODE_DEFINE_CONSTANT(target, BROTLI_DEFAULT_WINDOW);
+#endif
+
   target->Set(String::NewSymbol("ZLIB_VERSION"), String::New(ZLIB_VERSION));
 }
 
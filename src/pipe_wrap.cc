@@ -98,7 +98,11 @@ void PipeWrap::Initialize(Handle<Object> target) {
 
   NODE_SET_PROTOTYPE_METHOD(t, "readStart", StreamWrap::ReadStart);
   NODE_SET_PROTOTYPE_METHOD(t, "readStop", StreamWrap::ReadStop);
+  NODE_SET_PROTOTYPE_METHOD(t, "setReadBuffer", StreamWrap::SetReadBuffer);
   NODE_SET_PROTOTYPE_METHOD(t, "shutdown", StreamWrap::Shutdown);
+  NODE_SET_PROTOTYPE_METHOD(t, "splice", StreamWrap::Splice);
+  NODE_SET_PROTOTYPE_METHOD(t, "spliceStop", StreamWrap::SpliceStop);
+  NODE_SET_PROTOTYPE_METHOD(t, "sendFile", StreamWrap::SendFile);
 
   NODE_SET_PROTOTYPE_METHOD(t, "writeBuffer", StreamWrap::WriteBuffer);
   NODE_SET_PROTOTYPE_METHOD(t, "writeAsciiString", StreamWrap::WriteAsciiString);
@@ -51,6 +51,7 @@ class ReqWrap {
       }
     }
 
+    data_ = NULL;
     QUEUE_INSERT_TAIL(&req_wrap_queue, &req_wrap_queue_);
   }
 
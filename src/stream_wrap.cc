@@ -22,7 +22,7 @@
 #include "node.h"
 #include "node_buffer.h"
 #include "handle_wrap.h"
-#include "slab_allocator.h"
+#include "buffer_pool.h"
 #include "stream_wrap.h"
 #include "pipe_wrap.h"
 #include "tcp_wrap.h"
@@ -33,7 +33,8 @@
 #include <stdlib.h> // abort()
 #include <limits.h> // INT_MAX
 
-#define SLAB_SIZE (1024 * 1024)
+// Reads into a JS supplied buffer wrap around once less than this is left.
+#define MIN_READ_INTO_BUFFER 4096
 
 
 namespace node {
@@ -56,22 +57,7 @@ using v8::String;
 using v8::TryCatch;
 using v8::Value;
 
-typedef class ReqWrap<uv_shutdown_t> ShutdownWrap;
-
-class WriteWrap: public ReqWrap<uv_write_t> {
- public:
-  void* operator new(size_t size, char* storage) { return storage; }
-
-  // This is just to keep the compiler happy. It should never be called, since
-  // we don't use exceptions in node.
-  void operator delete(void* ptr, char* storage) { assert(0); }
-
- protected:
-  // People should not be using the non-placement new and delete operator on a
-  // WriteWrap. Ensure this never happens.
-  void* operator new (size_t size) { assert(0); };
-  void operator delete(void* ptr) { assert(0); };
-};
+typedef class ReqWrap<uv_splice_t> SpliceWrap;
 
 
 static Persistent<String> buffer_sym;
@@ -80,23 +66,13 @@ static Persistent<String> write_queue_size_sym;
 static Persistent<String> onread_sym;
 static Persistent<String> oncomplete_sym;
 static Persistent<String> handle_sym;
-static SlabAllocator* slab_allocator;
 static bool initialized;
 
 
-static void DeleteSlabAllocator(void*) {
-  delete slab_allocator;
-  slab_allocator = NULL;
-}
-
-
 void StreamWrap::Initialize(Handle<Object> target) {
   if (initialized) return;
   initialized = true;
 
-  slab_allocator = new SlabAllocator(SLAB_SIZE);
-  AtExit(DeleteSlabAllocator, NULL);
-
   HandleScope scope(node_isolate);
 
   HandleWrap::Initialize(target);
@@ -110,11 +86,29 @@ void StreamWrap::Initialize(Handle<Object> target) {
 
 
 StreamWrap::StreamWrap(Handle<Object> object, uv_stream_t* stream)
-    : HandleWrap(object, reinterpret_cast<uv_handle_t*>(stream)) {
+    : HandleWrap(object, reinterpret_cast<uv_handle_t*>(stream)),
+      splice_(NULL),
+      read_offset_(0),
+      read_into_buffer_(false),
+      default_callbacks_(this),
+      callbacks_(&default_callbacks_) {
   stream_ = stream;
 }
 
 
+StreamWrap::~StreamWrap() {
+  if (callbacks_ != &default_callbacks_) {
+    callbacks_->Release();
+    callbacks_ = NULL;
+  }
+
+  if (!read_buffer_.IsEmpty()) {
+    read_buffer_.Dispose(node_isolate);
+    read_buffer_.Clear();
+  }
+}
+
+
 Handle<Value> StreamWrap::GetFD(Local<String>, const AccessorInfo& args) {
 #if defined(_WIN32)
   return v8::Null(node_isolate);
@@ -150,7 +144,10 @@ Handle<Value> StreamWrap::ReadStart(const Arguments& args) {
   }
 
   // Error starting the tcp.
-  if (r) SetErrno(uv_last_error(uv_default_loop()));
+  if (r)
+    SetErrno(uv_last_error(uv_default_loop()));
+  else
+    wrap->callbacks_->AfterReadStart();
 
   return scope.Close(Integer::New(r, node_isolate));
 }
@@ -164,17 +161,47 @@ Handle<Value> StreamWrap::ReadStop(const Arguments& args) {
   int r = uv_read_stop(wrap->stream_);
 
   // Error starting the tcp.
-  if (r) SetErrno(uv_last_error(uv_default_loop()));
+  if (r)
+    SetErrno(uv_last_error(uv_default_loop()));
+  else
+    wrap->callbacks_->AfterReadStop();
 
   return scope.Close(Integer::New(r, node_isolate));
 }
 
 
+// Makes reads go straight into the Buffer that's passed in instead of into
+// memory from the pool. onread then gets that Buffer with the offset and
+// length of the data, the data stays valid until the ring wraps around to
+// it. Pass null to go back to pool buffers.
+Handle<Value> StreamWrap::SetReadBuffer(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  UNWRAP(StreamWrap)
+
+  if (!args[0]->IsNull() && !Buffer::HasInstance(args[0]))
+    return ThrowTypeError("Argument must be a Buffer or null");
+
+  if (!wrap->read_buffer_.IsEmpty()) {
+    wrap->read_buffer_.Dispose(node_isolate);
+    wrap->read_buffer_.Clear();
+  }
+
+  if (!args[0]->IsNull() && Buffer::Length(args[0]) > 0) {
+    wrap->read_buffer_ = Persistent<Object>::New(node_isolate,
+                                                 args[0]->ToObject());
+  }
+  wrap->read_offset_ = 0;
+
+  return Undefined(node_isolate);
+}
+
+
 uv_buf_t StreamWrap::OnAlloc(uv_handle_t* handle, size_t suggested_size) {
   StreamWrap* wrap = static_cast<StreamWrap*>(handle->data);
   assert(wrap->stream_ == reinterpret_cast<uv_stream_t*>(handle));
-  char* buf = slab_allocator->Allocate(wrap->object_, suggested_size);
-  return uv_buf_init(buf, suggested_size);
+  wrap->read_into_buffer_ = false;
+  return wrap->callbacks_->DoAlloc(handle, suggested_size);
 }
 
 
@@ -210,12 +237,45 @@ void StreamWrap::OnReadCommon(uv_stream_t* handle, ssize_t nread,
   // uv_close() on the handle.
   assert(wrap->object_.IsEmpty() == false);
 
+  wrap->callbacks_->DoRead(handle, nread, buf, pending);
+}
+
+
+uv_buf_t StreamWrapCallbacks::DoAlloc(uv_handle_t* handle,
+                                      size_t suggested_size) {
+  StreamWrap* wrap = wrap_;
+
+  if (!wrap->read_buffer_.IsEmpty()) {
+    char* data = Buffer::Data(wrap->read_buffer_);
+    size_t length = Buffer::Length(wrap->read_buffer_);
+
+    // Start over at the front rather than doing lots of tiny reads.
+    if (length - wrap->read_offset_ < MIN_READ_INTO_BUFFER)
+      wrap->read_offset_ = 0;
+
+    wrap->read_into_buffer_ = true;
+    return uv_buf_init(data + wrap->read_offset_,
+                       length - wrap->read_offset_);
+  }
+
+  char* buf = BufferPool::Default()->Allocate(suggested_size);
+  return uv_buf_init(buf, suggested_size);
+}
+
+
+void StreamWrapCallbacks::DoRead(uv_stream_t* handle,
+                                 ssize_t nread,
+                                 uv_buf_t buf,
+                                 uv_handle_type pending) {
+  HandleScope scope(node_isolate);
+
+  StreamWrap* wrap = wrap_;
+
   if (nread < 0)  {
     // If libuv reports an error or EOF it *may* give us a buffer back. In that
-    // case, return the space to the slab.
-    if (buf.base != NULL) {
-      slab_allocator->Shrink(wrap->object_, buf.base, 0);
-    }
+    // case, return it to the pool.
+    if (!wrap->read_into_buffer_)
+      BufferPool::Default()->Release(buf.base);
 
     SetErrno(uv_last_error(uv_default_loop()));
     MakeCallback(wrap->object_, onread_sym, 0, NULL);
@@ -223,17 +283,25 @@ void StreamWrap::OnReadCommon(uv_stream_t* handle, ssize_t nread,
   }
 
   assert(buf.base != NULL);
-  Local<Object> slab = slab_allocator->Shrink(wrap->object_,
-                                              buf.base,
-                                              nread);
-
-  if (nread == 0) return;
   assert(static_cast<size_t>(nread) <= buf.len);
 
+  Local<Object> buffer;
+  size_t offset = 0;
+
+  if (wrap->read_into_buffer_) {
+    if (nread == 0) return;
+    buffer = Local<Object>::New(node_isolate, wrap->read_buffer_);
+    offset = buf.base - Buffer::Data(buffer);
+    wrap->read_offset_ = offset + nread;
+  } else {
+    buffer = BufferPool::Default()->Shrink(buf.base, nread);
+    if (nread == 0) return;
+  }
+
   int argc = 3;
   Local<Value> argv[4] = {
-    slab,
-    Integer::NewFromUnsigned(buf.base - Buffer::Data(slab), node_isolate),
+    buffer,
+    Integer::NewFromUnsigned(offset, node_isolate),
     Integer::NewFromUnsigned(nread, node_isolate)
   };
 
@@ -301,11 +369,11 @@ Handle<Value> StreamWrap::WriteBuffer(const Arguments& args) {
   uv_buf_t buf;
   WriteBuffer(args[0], &buf);
 
-  int r = uv_write(&req_wrap->req_,
-                   wrap->stream_,
-                   &buf,
-                   1,
-                   StreamWrap::AfterWrite);
+  int r = wrap->callbacks_->DoWrite(req_wrap,
+                                    &buf,
+                                    1,
+                                    NULL,
+                                    StreamWrap::AfterWrite);
 
   req_wrap->Dispatched();
   req_wrap->object_->Set(bytes_sym,
@@ -378,11 +446,11 @@ Handle<Value> StreamWrap::WriteStringImpl(const Arguments& args) {
                   reinterpret_cast<uv_pipe_t*>(wrap->stream_)->ipc;
 
   if (!ipc_pipe) {
-    r = uv_write(&req_wrap->req_,
-                 wrap->stream_,
-                 &buf,
-                 1,
-                 StreamWrap::AfterWrite);
+    r = wrap->callbacks_->DoWrite(req_wrap,
+                                  &buf,
+                                  1,
+                                  NULL,
+                                  StreamWrap::AfterWrite);
 
   } else {
     uv_handle_t* send_handle = NULL;
@@ -403,12 +471,11 @@ Handle<Value> StreamWrap::WriteStringImpl(const Arguments& args) {
       req_wrap->object_->Set(handle_sym, send_handle_obj);
     }
 
-    r = uv_write2(&req_wrap->req_,
-                  wrap->stream_,
-                  &buf,
-                  1,
-                  reinterpret_cast<uv_stream_t*>(send_handle),
-                  StreamWrap::AfterWrite);
+    r = wrap->callbacks_->DoWrite(req_wrap,
+                                  &buf,
+                                  1,
+                                  reinterpret_cast<uv_stream_t*>(send_handle),
+                                  StreamWrap::AfterWrite);
   }
 
   req_wrap->Dispatched();
@@ -513,11 +580,11 @@ Handle<Value> StreamWrap::Writev(const Arguments& args) {
     bytes += str_size;
   }
 
-  int r = uv_write(&req_wrap->req_,
-                   wrap->stream_,
-                   bufs,
-                   count,
-                   StreamWrap::AfterWrite);
+  int r = wrap->callbacks_->DoWrite(req_wrap,
+                                    bufs,
+                                    count,
+                                    NULL,
+                                    StreamWrap::AfterWrite);
 
   // Deallocate space
   if (bufs != bufs_)
@@ -579,6 +646,7 @@ void StreamWrap::AfterWrite(uv_write_t* req, int status) {
     SetErrno(uv_last_error(uv_default_loop()));
   }
 
+  wrap->callbacks_->AfterWrite(req_wrap);
   wrap->UpdateWriteQueueSize();
 
   Local<Value> argv[] = {
@@ -601,7 +669,7 @@ Handle<Value> StreamWrap::Shutdown(const Arguments& args) {
 
   ShutdownWrap* req_wrap = new ShutdownWrap();
 
-  int r = uv_shutdown(&req_wrap->req_, wrap->stream_, AfterShutdown);
+  int r = wrap->callbacks_->DoShutdown(req_wrap, AfterShutdown);
 
   req_wrap->Dispatched();
 
@@ -641,4 +709,181 @@ void StreamWrap::AfterShutdown(uv_shutdown_t* req, int status) {
 }
 
 
+// Moves everything that's read from this stream to the stream in args[0]
+// inside the kernel. Calls oncomplete when this stream reaches EOF or
+// spliceStop() was called, the number of bytes moved is in req.bytes.
+Handle<Value> StreamWrap::Splice(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  UNWRAP(StreamWrap)
+
+  assert(args[0]->IsObject());
+  Local<Object> dest_obj = args[0]->ToObject();
+  assert(dest_obj->InternalFieldCount() > 0);
+  StreamWrap* dest_wrap = static_cast<StreamWrap*>(
+      dest_obj->GetAlignedPointerFromInternalField(0));
+
+  if (dest_wrap == NULL || dest_wrap->stream_ == NULL) {
+    uv_err_t err;
+    err.code = UV_EBADF;
+    err.sys_errno_ = 0;
+    SetErrno(err);
+    return scope.Close(v8::Null(node_isolate));
+  }
+
+  // Data that's transformed on the way in or out can't bypass userland.
+  if (!wrap->HasDefaultCallbacks() || !dest_wrap->HasDefaultCallbacks()) {
+    uv_err_t err;
+    err.code = UV_EINVAL;
+    err.sys_errno_ = 0;
+    SetErrno(err);
+    return scope.Close(v8::Null(node_isolate));
+  }
+
+  SpliceWrap* req_wrap = new SpliceWrap();
+
+  // Keep the destination alive until AfterSplice is called.
+  if (handle_sym.IsEmpty()) {
+    handle_sym = NODE_PSYMBOL("handle");
+  }
+  req_wrap->object_->Set(handle_sym, dest_obj);
+
+  int r = uv_splice_start(&req_wrap->req_,
+                          wrap->stream_,
+                          dest_wrap->stream_,
+                          AfterSplice);
+
+  req_wrap->Dispatched();
+
+  if (r) {
+    SetErrno(uv_last_error(uv_default_loop()));
+    delete req_wrap;
+    return scope.Close(v8::Null(node_isolate));
+  }
+
+  wrap->splice_ = &req_wrap->req_;
+  return scope.Close(req_wrap->object_);
+}
+
+
+// Sends args[2] bytes of the file args[0] starting at args[1] to this
+// stream with sendfile(). A negative length sends up to the end of the
+// file. Calls oncomplete like Splice() does.
+Handle<Value> StreamWrap::SendFile(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  UNWRAP(StreamWrap)
+
+  assert(args[0]->IsInt32());
+  assert(args[1]->IsNumber());
+  assert(args[2]->IsNumber());
+
+  int fd = args[0]->Int32Value();
+  int64_t offset = args[1]->IntegerValue();
+  int64_t length = args[2]->IntegerValue();
+
+  if (!wrap->HasDefaultCallbacks()) {
+    uv_err_t err;
+    err.code = UV_EINVAL;
+    err.sys_errno_ = 0;
+    SetErrno(err);
+    return scope.Close(v8::Null(node_isolate));
+  }
+
+  SpliceWrap* req_wrap = new SpliceWrap();
+
+  int r = uv_splice_file(&req_wrap->req_,
+                         fd,
+                         offset,
+                         length,
+                         wrap->stream_,
+                         AfterSplice);
+
+  req_wrap->Dispatched();
+
+  if (r) {
+    SetErrno(uv_last_error(uv_default_loop()));
+    delete req_wrap;
+    return scope.Close(v8::Null(node_isolate));
+  }
+
+  return scope.Close(req_wrap->object_);
+}
+
+
+Handle<Value> StreamWrap::SpliceStop(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  UNWRAP(StreamWrap)
+
+  int r = 0;
+  if (wrap->splice_ != NULL)
+    r = uv_splice_stop(wrap->splice_);
+
+  if (r) SetErrno(uv_last_error(uv_default_loop()));
+
+  return scope.Close(Integer::New(r, node_isolate));
+}
+
+
+void StreamWrap::AfterSplice(uv_splice_t* req, int status) {
+  SpliceWrap* req_wrap = (SpliceWrap*) req->data;
+  StreamWrap* wrap;
+
+  // Files are sent with a NULL source, report back to the destination.
+  if (req->src != NULL) {
+    wrap = (StreamWrap*) req->src->data;
+    wrap->splice_ = NULL;
+  } else {
+    wrap = (StreamWrap*) req->dst->data;
+  }
+
+  // The wrap and request objects should still be there.
+  assert(req_wrap->object_.IsEmpty() == false);
+  assert(wrap->object_.IsEmpty() == false);
+
+  HandleScope scope(node_isolate);
+
+  if (status) {
+    SetErrno(uv_last_error(uv_default_loop()));
+  }
+
+  if (!handle_sym.IsEmpty())
+    req_wrap->object_->Delete(handle_sym);
+  req_wrap->object_->Set(bytes_sym,
+                         Number::New(static_cast<double>(req->nwritten)));
+
+  Local<Value> argv[3] = {
+    Integer::New(status, node_isolate),
+    Local<Value>::New(node_isolate, wrap->object_),
+    Local<Value>::New(node_isolate, req_wrap->object_)
+  };
+
+  MakeCallback(req_wrap->object_, oncomplete_sym, ARRAY_SIZE(argv), argv);
+
+  delete req_wrap;
+}
+
+
+int StreamWrapCallbacks::DoWrite(WriteWrap* w,
+                                 uv_buf_t* bufs,
+                                 size_t count,
+                                 uv_stream_t* send_handle,
+                                 uv_write_cb cb) {
+  if (send_handle == NULL)
+    return uv_write(&w->req_, wrap_->stream_, bufs, count, cb);
+
+  return uv_write2(&w->req_, wrap_->stream_, bufs, count, send_handle, cb);
+}
+
+
+void StreamWrapCallbacks::AfterWrite(WriteWrap* w) {
+}
+
+
+int StreamWrapCallbacks::DoShutdown(ShutdownWrap* req_wrap, uv_shutdown_cb cb) {
+  return uv_shutdown(&req_wrap->req_, wrap_->stream_, cb);
+}
+
+
 }
@@ -25,18 +25,92 @@
 #include "v8.h"
 #include "node.h"
 #include "handle_wrap.h"
+#include "req_wrap.h"
 #include "string_bytes.h"
 
 namespace node {
 
 // Forward declaration
-class WriteWrap;
+class StreamWrap;
+
+typedef class ReqWrap<uv_shutdown_t> ShutdownWrap;
+
+class WriteWrap: public ReqWrap<uv_write_t> {
+ public:
+  void* operator new(size_t size, char* storage) { return storage; }
+
+  // This is just to keep the compiler happy. It should never be called, since
+  // we don't use exceptions in node.
+  void operator delete(void* ptr, char* storage) { assert(0); }
+
+ protected:
+  // People should not be using the non-placement new and delete operator on a
+  // WriteWrap. Ensure this never happens.
+  void* operator new (size_t size) { assert(0); };
+  void operator delete(void* ptr) { assert(0); };
+};
+
+// Overridable behaviour of a StreamWrap. The default implementation talks
+// to the uv_stream_t directly, a stream that's layered on top of another
+// one (like TLS) replaces it with StreamWrap::OverrideCallbacks() and
+// passes the transformed data on to the default one when it's done.
+class StreamWrapCallbacks {
+ public:
+  explicit StreamWrapCallbacks(StreamWrap* wrap) : wrap_(wrap) {
+  }
+
+  explicit StreamWrapCallbacks(StreamWrapCallbacks* old) : wrap_(old->wrap_) {
+  }
+
+  virtual ~StreamWrapCallbacks() {
+  }
+
+  // The StreamWrap is done with these callbacks. Layers that still have
+  // work in flight can put off deleting themselves until it's back.
+  virtual void Release() {
+    delete this;
+  }
+
+  virtual int DoWrite(WriteWrap* w,
+                      uv_buf_t* bufs,
+                      size_t count,
+                      uv_stream_t* send_handle,
+                      uv_write_cb cb);
+  virtual void AfterWrite(WriteWrap* w);
+  virtual uv_buf_t DoAlloc(uv_handle_t* handle, size_t suggested_size);
+  virtual void DoRead(uv_stream_t* handle,
+                      ssize_t nread,
+                      uv_buf_t buf,
+                      uv_handle_type pending);
+  virtual int DoShutdown(ShutdownWrap* req_wrap, uv_shutdown_cb cb);
+
+  // JS started or stopped reading. Layers that buffer data hold it back
+  // while reading is stopped.
+  virtual void AfterReadStart() {
+  }
+
+  virtual void AfterReadStop() {
+  }
+
+ protected:
+  StreamWrap* wrap_;
+};
 
 
 class StreamWrap : public HandleWrap {
  public:
   uv_stream_t* GetStream() { return stream_; }
 
+  // Takes ownership of `callbacks`, the ones that were set before are
+  // released unless they're the defaults.
+  void OverrideCallbacks(StreamWrapCallbacks* callbacks) {
+    StreamWrapCallbacks* old = callbacks_;
+    callbacks_ = callbacks;
+    if (old != &default_callbacks_) old->Release();
+  }
+
+  StreamWrapCallbacks* GetCallbacks() { return callbacks_; }
+
   static void Initialize(v8::Handle<v8::Object> target);
 
   static v8::Handle<v8::Value> GetFD(v8::Local<v8::String>,
@@ -45,7 +119,11 @@ class StreamWrap : public HandleWrap {
   // JavaScript functions
   static v8::Handle<v8::Value> ReadStart(const v8::Arguments& args);
   static v8::Handle<v8::Value> ReadStop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetReadBuffer(const v8::Arguments& args);
   static v8::Handle<v8::Value> Shutdown(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Splice(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SpliceStop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SendFile(const v8::Arguments& args);
 
   static v8::Handle<v8::Value> Writev(const v8::Arguments& args);
   static v8::Handle<v8::Value> WriteBuffer(const v8::Arguments& args);
@@ -57,6 +135,7 @@ class StreamWrap : public HandleWrap {
   static size_t WriteBuffer(v8::Handle<v8::Value> val, uv_buf_t* buf);
 
   StreamWrap(v8::Handle<v8::Object> object, uv_stream_t* stream);
+  ~StreamWrap();
   void StateChange() { }
   void UpdateWriteQueueSize();
 
@@ -67,6 +146,7 @@ class StreamWrap : public HandleWrap {
   static void AfterWrite(uv_write_t* req, int status);
   static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size);
   static void AfterShutdown(uv_shutdown_t* req, int status);
+  static void AfterSplice(uv_splice_t* req, int status);
 
   static void OnRead(uv_stream_t* handle, ssize_t nread, uv_buf_t buf);
   static void OnRead2(uv_pipe_t* handle, ssize_t nread, uv_buf_t buf,
@@ -77,8 +157,22 @@ class StreamWrap : public HandleWrap {
   template <enum encoding encoding>
   static v8::Handle<v8::Value> WriteStringImpl(const v8::Arguments& args);
 
+  bool HasDefaultCallbacks() { return callbacks_ == &default_callbacks_; }
+
   size_t slab_offset_;
   uv_stream_t* stream_;
+  uv_splice_t* splice_;  // pending splice with this stream as the source
+
+  // Buffer supplied by JS that reads go into, used as a ring. Reads start
+  // at read_offset_ and wrap around when there's too little space left.
+  v8::Persistent<v8::Object> read_buffer_;
+  size_t read_offset_;
+  bool read_into_buffer_;  // the pending read uses read_buffer_
+
+  StreamWrapCallbacks default_callbacks_;
+  StreamWrapCallbacks* callbacks_;  // Overridable callbacks
+
+  friend class StreamWrapCallbacks;
 };
 
 
@@ -20,6 +20,7 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "string_bytes.h"
+#include "string_bytes_simd.h"
 
 #include <assert.h>
 #include <string.h>  // memcpy
@@ -107,6 +108,13 @@ static inline size_t base64_decode(char *buf,
   const char* srcEnd = src + srcLen;
 
   while (src < srcEnd && dst < dstEnd) {
+    // Whole blocks without whitespace or padding in them.
+    size_t n = base64_decode_simd(src, srcEnd - src, dst, dstEnd - dst);
+    src += n;
+    dst += n / 4 * 3;
+    if (src == srcEnd || dst == dstEnd)
+      break;
+
     int remaining = srcEnd - src;
 
     while (unbase64(*src) < 0 && src < srcEnd) src++, remaining--;
@@ -152,8 +160,8 @@ static inline size_t hex_decode(char *buf,
                                 size_t len,
                                 const char *src,
                                 const size_t srcLen) {
-  size_t i;
-  for (i = 0; i < len && i * 2 + 1 < srcLen; ++i) {
+  size_t i = hex_decode_simd(src, srcLen, buf, len);
+  for (; i < len && i * 2 + 1 < srcLen; ++i) {
     unsigned a = hex2bin(src[i * 2 + 0]);
     unsigned b = hex2bin(src[i * 2 + 1]);
     if (!~a || !~b) return i;
@@ -477,8 +485,8 @@ static size_t base64_encode(const char* src,
                               "abcdefghijklmnopqrstuvwxyz"
                               "0123456789+/";
 
-  i = 0;
-  k = 0;
+  i = base64_encode_simd(src, slen, dst);
+  k = i / 3 * 4;
   n = slen / 3 * 3;
 
   while (i < n) {
@@ -526,7 +534,8 @@ static size_t hex_encode(const char* src, size_t slen, char* dst, size_t dlen) {
       "not enough space provided for hex encode");
 
   dlen = slen * 2;
-  for (uint32_t i = 0, k = 0; k < dlen; i += 1, k += 2) {
+  uint32_t i = hex_encode_simd(src, slen, dst);
+  for (uint32_t k = i * 2; k < dlen; i += 1, k += 2) {
     static const char hex[] = "0123456789abcdef";
     uint8_t val = static_cast<uint8_t>(src[i]);
     dst[k + 0] = hex[val >> 4];
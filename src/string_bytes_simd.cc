@@ -0,0 +1,540 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "string_bytes_simd.h"
+
+// Functions get compiled for SSSE3 and AVX2 with target attributes, the
+// rest of node doesn't have to be built with -mssse3 or -mavx2 for that.
+#if (defined(__x86_64__) || defined(__i386__)) &&                             \
+    ((defined(__GNUC__) && !defined(__clang__) &&                             \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) ||            \
+     (defined(__clang__) &&                                                   \
+      (__clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+# define NODE_HAVE_SIMD_CODECS 1
+#endif
+
+#if NODE_HAVE_SIMD_CODECS
+# include <cpuid.h>
+# include <immintrin.h>
+# include <stdint.h>
+# include <string.h>  // memcpy
+# define TARGET_SSSE3 __attribute__((target("ssse3")))
+# define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace node {
+
+#if NODE_HAVE_SIMD_CODECS
+
+enum SimdLevel {
+  SIMD_NONE,
+  SIMD_SSSE3,
+  SIMD_AVX2
+};
+
+
+static SimdLevel detect_simd_level() {
+  unsigned eax, ebx, ecx, edx;
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return SIMD_NONE;
+
+  const bool ssse3 = (ecx & (1 << 9)) != 0;
+  const bool osxsave = (ecx & (1 << 27)) != 0;
+  const bool avx = (ecx & (1 << 28)) != 0;
+
+  if (!ssse3)
+    return SIMD_NONE;
+
+  if (!osxsave || !avx || __get_cpuid_max(0, NULL) < 7)
+    return SIMD_SSSE3;
+
+  // The OS has to save the YMM registers on context switches.
+  unsigned xcr0_lo, xcr0_hi;
+  __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"  // xgetbv
+                       : "=a" (xcr0_lo), "=d" (xcr0_hi)
+                       : "c" (0));
+  if ((xcr0_lo & 6) != 6)
+    return SIMD_SSSE3;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if ((ebx & (1 << 5)) == 0)
+    return SIMD_SSSE3;
+
+  return SIMD_AVX2;
+}
+
+
+// Worst case two threads race to store the same value.
+static SimdLevel simd_level() {
+  static int level = -1;
+  if (level == -1)
+    level = detect_simd_level();
+  return static_cast<SimdLevel>(level);
+}
+
+
+//// Base 64 ////
+
+// Turns 6 bit values into the characters of the regular alphabet.
+TARGET_SSSE3
+static inline __m128i base64_lookup_ssse3(__m128i idx) {
+  const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                      '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                      '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                      '/' - 63, 'A', 0, 0);
+  // 0-25 map to 13, 26-51 to 0, 52-61 to 1-10, 62 to 11 and 63 to 12.
+  __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+  const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+  r = _mm_or_si128(r, _mm_and_si128(less, _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(shift, r), idx);
+}
+
+
+// Spreads 12 bytes out to 16 6 bit values, one per byte.
+TARGET_SSSE3
+static inline __m128i base64_split_ssse3(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+
+TARGET_SSSE3
+static size_t base64_encode_ssse3(const char* src, size_t slen, char* dst) {
+  size_t i = 0;
+
+  // Reads 16 bytes to use 12.
+  while (slen - i >= 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i out = base64_lookup_ssse3(base64_split_ssse3(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+    i += 12;
+    dst += 16;
+  }
+
+  return i;
+}
+
+
+TARGET_AVX2
+static size_t base64_encode_avx2(const char* src, size_t slen, char* dst) {
+  size_t i = 0;
+
+  const __m256i split_shuffle = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shift = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0);
+
+  // Reads 28 bytes to use 24, 12 for each 128 bit lane.
+  while (slen - i >= 28) {
+    const __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12));
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+    in = _mm256_shuffle_epi8(in, split_shuffle);
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i idx = _mm256_or_si256(t1, t3);
+
+    __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+    r = _mm256_or_si256(r, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    r = _mm256_add_epi8(_mm256_shuffle_epi8(shift, r), idx);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), r);
+    i += 24;
+    dst += 32;
+  }
+
+  return i + base64_encode_ssse3(src + i, slen - i, dst);
+}
+
+
+// Bytes between lo and hi. Compares are signed, bytes >= 0x80 never match.
+#define IN_RANGE_128(in, lo, hi)                                              \
+  _mm_and_si128(_mm_cmpgt_epi8((in), _mm_set1_epi8((lo) - 1)),                \
+                _mm_cmplt_epi8((in), _mm_set1_epi8((hi) + 1)))
+
+#define IN_RANGE_256(in, lo, hi)                                              \
+  _mm256_and_si256(_mm256_cmpgt_epi8((in), _mm256_set1_epi8((lo) - 1)),       \
+                   _mm256_cmpgt_epi8(_mm256_set1_epi8((hi) + 1), (in)))
+
+
+// Turns characters of either alphabet into 6 bit values. Returns false if
+// any of them isn't part of an alphabet.
+TARGET_SSSE3
+static inline bool base64_unlookup_ssse3(__m128i in, __m128i* out) {
+  const __m128i upper = IN_RANGE_128(in, 'A', 'Z');
+  const __m128i lower = IN_RANGE_128(in, 'a', 'z');
+  const __m128i digit = IN_RANGE_128(in, '0', '9');
+  const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+  const __m128i minus = _mm_cmpeq_epi8(in, _mm_set1_epi8('-'));
+  const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  const __m128i under = _mm_cmpeq_epi8(in, _mm_set1_epi8('_'));
+
+  const __m128i valid =
+      _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower),
+                                _mm_or_si128(digit, plus)),
+                   _mm_or_si128(_mm_or_si128(minus, slash), under));
+  if (_mm_movemask_epi8(valid) != 0xffff)
+    return false;
+
+  __m128i delta = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+  delta = _mm_or_si128(delta, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+  delta = _mm_or_si128(delta, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+  delta = _mm_or_si128(delta, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+  delta = _mm_or_si128(delta, _mm_and_si128(minus, _mm_set1_epi8(62 - '-')));
+  delta = _mm_or_si128(delta, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+  delta = _mm_or_si128(delta, _mm_and_si128(under, _mm_set1_epi8(63 - '_')));
+
+  *out = _mm_add_epi8(in, delta);
+  return true;
+}
+
+
+TARGET_SSSE3
+static size_t base64_decode_ssse3(const char* src,
+                                  size_t slen,
+                                  char* dst,
+                                  size_t dlen) {
+  size_t i = 0;
+  size_t k = 0;
+
+  // Stores exactly the 12 bytes it produces. The scalar tail may decode
+  // fewer than that after the last step, bytes past them aren't ours.
+  while (slen - i >= 16 && dlen - k >= 12) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i values;
+    if (!base64_unlookup_ssse3(in, &values))
+      break;
+
+    // Packs pairs of 6 bit values to 12 bits, then pairs of those to 24.
+    const __m128i merged =
+        _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i packed =
+        _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    const __m128i out =
+        _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                               8, 14, 13, 12, -1, -1, -1, -1));
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + k), out);
+    const int32_t rest = _mm_cvtsi128_si32(_mm_srli_si128(out, 8));
+    memcpy(dst + k + 8, &rest, sizeof(rest));
+    i += 16;
+    k += 12;
+  }
+
+  return i;
+}
+
+
+TARGET_AVX2
+static size_t base64_decode_avx2(const char* src,
+                                 size_t slen,
+                                 char* dst,
+                                 size_t dlen) {
+  size_t i = 0;
+  size_t k = 0;
+
+  const __m256i compact = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  // Stores exactly the 24 bytes it produces, like the SSSE3 version.
+  while (slen - i >= 32 && dlen - k >= 24) {
+    __m256i in =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+
+    const __m256i upper = IN_RANGE_256(in, 'A', 'Z');
+    const __m256i lower = IN_RANGE_256(in, 'a', 'z');
+    const __m256i digit = IN_RANGE_256(in, '0', '9');
+    const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+    const __m256i minus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-'));
+    const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+    const __m256i under = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_'));
+
+    const __m256i valid =
+        _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower),
+                                        _mm256_or_si256(digit, plus)),
+                        _mm256_or_si256(_mm256_or_si256(minus, slash), under));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff)
+      break;
+
+    __m256i d = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    d = _mm256_or_si256(d, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    d = _mm256_or_si256(d, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    d = _mm256_or_si256(d, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+    d = _mm256_or_si256(d, _mm256_and_si256(minus, _mm256_set1_epi8(62 - '-')));
+    d = _mm256_or_si256(d, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+    d = _mm256_or_si256(d, _mm256_and_si256(under, _mm256_set1_epi8(63 - '_')));
+    const __m256i values = _mm256_add_epi8(in, d);
+
+    const __m256i merged =
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i packed =
+        _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    __m256i out = _mm256_shuffle_epi8(packed, compact);
+    // 12 bytes at the bottom of each lane, move them next to each other.
+    const __m256i order = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    out = _mm256_permutevar8x32_epi32(out, order);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + k),
+                     _mm256_castsi256_si128(out));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + k + 16),
+                     _mm256_extracti128_si256(out, 1));
+    i += 32;
+    k += 24;
+  }
+
+  return i + base64_decode_ssse3(src + i, slen - i, dst + k, dlen - k);
+}
+
+
+//// HEX ////
+
+TARGET_SSSE3
+static size_t hex_encode_ssse3(const char* src, size_t slen, char* dst) {
+  const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+
+  while (slen - i >= 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibble);
+    __m128i lo = _mm_and_si128(in, nibble);
+    hi = _mm_shuffle_epi8(digits, hi);
+    lo = _mm_shuffle_epi8(digits, lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i),
+                     _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16),
+                     _mm_unpackhi_epi8(hi, lo));
+    i += 16;
+  }
+
+  return i;
+}
+
+
+TARGET_AVX2
+static size_t hex_encode_avx2(const char* src, size_t slen, char* dst) {
+  const __m256i digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+
+  while (slen - i >= 32) {
+    __m256i in =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble);
+    __m256i lo = _mm256_and_si256(in, nibble);
+    hi = _mm256_shuffle_epi8(digits, hi);
+    lo = _mm256_shuffle_epi8(digits, lo);
+    // Unpacking works within 128 bit lanes, put the halves back in order.
+    const __m256i a = _mm256_unpacklo_epi8(hi, lo);
+    const __m256i b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+    i += 32;
+  }
+
+  return i + hex_encode_ssse3(src + i, slen - i, dst + 2 * i);
+}
+
+
+// Turns 16 hex characters into 8 bytes in the low half of each 16 bit lane.
+// Returns false if any of them isn't a hex digit.
+TARGET_SSSE3
+static inline bool hex_unlookup_ssse3(__m128i in, __m128i* out) {
+  const __m128i digit = IN_RANGE_128(in, '0', '9');
+  const __m128i upper = IN_RANGE_128(in, 'A', 'F');
+  const __m128i lower = IN_RANGE_128(in, 'a', 'f');
+
+  const __m128i valid = _mm_or_si128(_mm_or_si128(digit, upper), lower);
+  if (_mm_movemask_epi8(valid) != 0xffff)
+    return false;
+
+  __m128i delta = _mm_and_si128(digit, _mm_set1_epi8(-'0'));
+  delta = _mm_or_si128(delta, _mm_and_si128(upper, _mm_set1_epi8(10 - 'A')));
+  delta = _mm_or_si128(delta, _mm_and_si128(lower, _mm_set1_epi8(10 - 'a')));
+  const __m128i values = _mm_add_epi8(in, delta);
+
+  // The first character of a pair is the high nibble.
+  *out = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));
+  return true;
+}
+
+
+TARGET_SSSE3
+static size_t hex_decode_ssse3(const char* src,
+                               size_t slen,
+                               char* dst,
+                               size_t dlen) {
+  size_t i = 0;
+
+  while (slen - 2 * i >= 32 && dlen - i >= 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+    if (!hex_unlookup_ssse3(a, &a) || !hex_unlookup_ssse3(b, &b))
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(a, b));
+    i += 16;
+  }
+
+  return i;
+}
+
+
+TARGET_AVX2
+static inline bool hex_unlookup_avx2(__m256i in, __m256i* out) {
+  const __m256i digit = IN_RANGE_256(in, '0', '9');
+  const __m256i upper = IN_RANGE_256(in, 'A', 'F');
+  const __m256i lower = IN_RANGE_256(in, 'a', 'f');
+
+  const __m256i valid = _mm256_or_si256(_mm256_or_si256(digit, upper), lower);
+  if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff)
+    return false;
+
+  __m256i d = _mm256_and_si256(digit, _mm256_set1_epi8(-'0'));
+  d = _mm256_or_si256(d, _mm256_and_si256(upper, _mm256_set1_epi8(10 - 'A')));
+  d = _mm256_or_si256(d, _mm256_and_si256(lower, _mm256_set1_epi8(10 - 'a')));
+  const __m256i values = _mm256_add_epi8(in, d);
+
+  *out = _mm256_maddubs_epi16(values, _mm256_set1_epi16(0x0110));
+  return true;
+}
+
+
+TARGET_AVX2
+static size_t hex_decode_avx2(const char* src,
+                              size_t slen,
+                              char* dst,
+                              size_t dlen) {
+  size_t i = 0;
+
+  while (slen - 2 * i >= 64 && dlen - i >= 32) {
+    __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32));
+    if (!hex_unlookup_avx2(a, &a) || !hex_unlookup_avx2(b, &b))
+      break;
+    // Packing works within 128 bit lanes, put the quarters back in order.
+    __m256i out = _mm256_packus_epi16(a, b);
+    out = _mm256_permute4x64_epi64(out, 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    i += 32;
+  }
+
+  return i + hex_decode_ssse3(src + 2 * i, slen - 2 * i, dst + i, dlen - i);
+}
+
+#undef IN_RANGE_128
+#undef IN_RANGE_256
+
+
+size_t base64_encode_simd(const char* src, size_t slen, char* dst) {
+  switch (simd_level()) {
+    case SIMD_AVX2: return base64_encode_avx2(src, slen, dst);
+    case SIMD_SSSE3: return base64_encode_ssse3(src, slen, dst);
+    default: return 0;
+  }
+}
+
+
+size_t base64_decode_simd(const char* src,
+                          size_t slen,
+                          char* dst,
+                          size_t dlen) {
+  switch (simd_level()) {
+    case SIMD_AVX2: return base64_decode_avx2(src, slen, dst, dlen);
+    case SIMD_SSSE3: return base64_decode_ssse3(src, slen, dst, dlen);
+    default: return 0;
+  }
+}
+
+
+size_t hex_encode_simd(const char* src, size_t slen, char* dst) {
+  switch (simd_level()) {
+    case SIMD_AVX2: return hex_encode_avx2(src, slen, dst);
+    case SIMD_SSSE3: return hex_encode_ssse3(src, slen, dst);
+    default: return 0;
+  }
+}
+
+
+size_t hex_decode_simd(const char* src, size_t slen, char* dst, size_t dlen) {
+  switch (simd_level()) {
+    case SIMD_AVX2: return hex_decode_avx2(src, slen, dst, dlen);
+    case SIMD_SSSE3: return hex_decode_ssse3(src, slen, dst, dlen);
+    default: return 0;
+  }
+}
+
+#else  // !NODE_HAVE_SIMD_CODECS
+
+size_t base64_encode_simd(const char* src, size_t slen, char* dst) {
+  return 0;
+}
+
+
+size_t base64_decode_simd(const char* src,
+                          size_t slen,
+                          char* dst,
+                          size_t dlen) {
+  return 0;
+}
+
+
+size_t hex_encode_simd(const char* src, size_t slen, char* dst) {
+  return 0;
+}
+
+
+size_t hex_decode_simd(const char* src, size_t slen, char* dst, size_t dlen) {
+  return 0;
+}
+
+#endif  // NODE_HAVE_SIMD_CODECS
+
+}  // namespace node
@@ -0,0 +1,56 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SRC_STRING_BYTES_SIMD_H_
+#define SRC_STRING_BYTES_SIMD_H_
+
+// SSSE3 and AVX2 kernels for the base64 and hex codecs in string_bytes.cc,
+// picked at runtime based on what the CPU supports.
+//
+// The kernels only handle whole blocks of input and return how much of it
+// they consumed, the caller does the rest with its scalar code. They stop
+// at the first block that isn't plain base64 or hex (whitespace, padding,
+// invalid characters) so the scalar code sees it exactly like before.
+// They return 0 when the CPU or compiler doesn't support them.
+
+#include <stddef.h>  // size_t
+
+namespace node {
+
+// Consumes a multiple of 3 bytes and writes 4 characters for every 3.
+size_t base64_encode_simd(const char* src, size_t slen, char* dst);
+
+// Consumes a multiple of 4 characters and writes 3 bytes for every 4.
+// Understands both the regular and the URL-safe alphabet.
+size_t base64_decode_simd(const char* src,
+                          size_t slen,
+                          char* dst,
+                          size_t dlen);
+
+// Consumes bytes and writes 2 characters for every one.
+size_t hex_encode_simd(const char* src, size_t slen, char* dst);
+
+// Consumes a multiple of 2 characters and writes a byte for every 2.
+size_t hex_decode_simd(const char* src, size_t slen, char* dst, size_t dlen);
+
+}  // namespace node
+
+#endif  // SRC_STRING_BYTES_SIMD_H_
@@ -0,0 +1,983 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "tls_wrap.h"
+#include "node_buffer.h"
+#include "node_crypto_bio.h"
+#include "node_threadpool.h"
+#include "buffer_pool.h"
+#include "stream_wrap.h"
+
+#include <stdlib.h>  // abort(), malloc(), free()
+#include <string.h>  // memcpy(), memchr()
+
+namespace node {
+
+using crypto::ClientHelloParser;
+using crypto::SecureContext;
+using crypto::SSLWrap;
+using v8::Arguments;
+using v8::Exception;
+using v8::Function;
+using v8::FunctionTemplate;
+using v8::Handle;
+using v8::HandleScope;
+using v8::Local;
+using v8::Null;
+using v8::Object;
+using v8::Persistent;
+using v8::String;
+using v8::Value;
+
+static Persistent<String> onhandshakestart_sym;
+static Persistent<String> onhandshakedone_sym;
+static Persistent<String> onerror_sym;
+
+static Persistent<Function> tlsWrapConstructor;
+
+
+// StreamWrap reports the loop's last error to JS after a failed write and
+// with a negative nread, errors that come from OpenSSL go the same way.
+static void SetLastError(uv_err_code code) {
+  uv_err_t err;
+  err.code = code;
+  err.sys_errno_ = 0;
+  uv_default_loop()->last_err = err;
+}
+
+
+// Whether SSL_get_error() says that something went wrong, as opposed to
+// OpenSSL waiting for data or the peer having closed the connection.
+static bool IsSSLError(int err) {
+  return err != SSL_ERROR_NONE &&
+         err != SSL_ERROR_WANT_READ &&
+         err != SSL_ERROR_WANT_WRITE &&
+         err != SSL_ERROR_ZERO_RETURN;
+}
+
+
+enum ServernameResult {
+  kServernameNeedMore,
+  kServernameNone,
+  kServernameFound,
+  kServernameUnknown  // not a ClientHello that fits into one TLS record
+};
+
+// Looks for the host_name in the ClientHello at the start of `data`, the
+// same one that OpenSSL's servername callback would get.
+static ServernameResult FindServername(const uint8_t* data,
+                                       size_t len,
+                                       char* name,
+                                       size_t name_size) {
+  if (len < 5) return kServernameNeedMore;
+  if (data[0] != ClientHelloParser::kHandshake || data[1] != 3)
+    return kServernameUnknown;
+
+  size_t frame_len = (data[3] << 8) + data[4];
+  if (len < 5 + frame_len) return kServernameNeedMore;
+
+  const uint8_t* p = data + 5;
+  const uint8_t* end = p + frame_len;
+
+  // Hello header
+  if (end - p < 4 || p[0] != ClientHelloParser::kClientHello)
+    return kServernameUnknown;
+  size_t hello_len = (p[1] << 16) + (p[2] << 8) + p[3];
+  p += 4;
+  if (static_cast<size_t>(end - p) < hello_len) return kServernameUnknown;
+  end = p + hello_len;
+
+  // Protocol version, random data and session id
+  if (end - p < 2 + 32 + 1) return kServernameUnknown;
+  p += 2 + 32;
+  if (end - p < 1 + p[0]) return kServernameUnknown;
+  p += 1 + p[0];
+
+  // Cipher suites and compression methods
+  if (end - p < 2) return kServernameUnknown;
+  size_t ciphers_len = (p[0] << 8) + p[1];
+  if (static_cast<size_t>(end - p) < 2 + ciphers_len) return kServernameUnknown;
+  p += 2 + ciphers_len;
+  if (end - p < 1 || end - p < 1 + p[0]) return kServernameUnknown;
+  p += 1 + p[0];
+
+  // No extensions at all
+  if (p == end) return kServernameNone;
+
+  if (end - p < 2) return kServernameUnknown;
+  size_t ext_len = (p[0] << 8) + p[1];
+  p += 2;
+  if (static_cast<size_t>(end - p) < ext_len) return kServernameUnknown;
+  end = p + ext_len;
+
+  while (end - p >= 4) {
+    int type = (p[0] << 8) + p[1];
+    size_t size = (p[2] << 8) + p[3];
+    p += 4;
+    if (static_cast<size_t>(end - p) < size) return kServernameUnknown;
+
+    if (type == TLSEXT_TYPE_server_name) {
+      // List length, then entries of type, length and name
+      const uint8_t* q = p + 2;
+      const uint8_t* q_end = p + size;
+      if (q > q_end) return kServernameUnknown;
+
+      while (q_end - q >= 3) {
+        size_t name_len = (q[1] << 8) + q[2];
+        if (static_cast<size_t>(q_end - q - 3) < name_len)
+          return kServernameUnknown;
+
+        if (q[0] == TLSEXT_NAMETYPE_host_name) {
+          // OpenSSL turns these down, let it do so.
+          if (name_len >= name_size || memchr(q + 3, 0, name_len) != NULL)
+            return kServernameUnknown;
+          memcpy(name, q + 3, name_len);
+          name[name_len] = '\0';
+          return kServernameFound;
+        }
+        q += 3 + name_len;
+      }
+      return kServernameNone;
+    }
+
+    p += size;
+  }
+
+  return kServernameNone;
+}
+
+
+TLSCallbacks::TLSCallbacks(StreamWrap* wrap,
+                           SecureContext* sc,
+                           bool is_server,
+                           Handle<Object> object)
+    : StreamWrapCallbacks(wrap->GetCallbacks()),
+      enc_in_(NULL),
+      enc_out_(NULL),
+      enc_out_pending_(0),
+      enc_in_side_(NULL),
+      enc_out_written_(0),
+      handshake_work_(NULL),
+      started_(false),
+      established_(false),
+      shutdown_(false),
+      eof_(false),
+      paused_(false),
+      handshake_start_pending_(false),
+      handshake_done_pending_(false),
+      offload_(is_server && sc->offload_handshake()),
+      servername_selected_(false) {
+  HandleScope scope(node_isolate);
+
+  object_ = Persistent<Object>::New(node_isolate, object);
+  object_->SetAlignedPointerInInternalField(0, this);
+
+  QUEUE_INIT(&write_queue_);
+
+  idle_ = new uv_idle_t;
+  uv_idle_init(uv_default_loop(), idle_);
+  idle_->data = this;
+
+  NewSSL(sc, is_server);
+
+  enc_in_ = BIO_new(NodeBIO::GetMethod());
+  enc_out_ = BIO_new(NodeBIO::GetMethod());
+  SSL_set_bio(ssl_, enc_in_, enc_out_);
+
+  // Clients want to know when the handshake is done too.
+  SSL_set_info_callback(ssl_, SSLInfoCallback);
+
+  // Writes that OpenSSL wants to retry come from a copy of the data.
+  long mode = SSL_get_mode(ssl_);
+  SSL_set_mode(ssl_, mode | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+}
+
+
+TLSCallbacks::~TLSCallbacks() {
+  // Release() made sure that the thread pool is done with ssl_, a step
+  // that it cancelled only has to be freed by AfterHandshakeWorkCb().
+  if (handshake_work_ != NULL) {
+    handshake_work_->callbacks_ = NULL;
+    handshake_work_ = NULL;
+    in_threadpool_ = false;
+  }
+
+  if (enc_in_side_ != NULL) {
+    BIO_free_all(enc_in_side_);
+    enc_in_side_ = NULL;
+  }
+
+  // The BIOs belong to ssl_, ~SSLWrap() frees them.
+  enc_in_ = NULL;
+  enc_out_ = NULL;
+
+  while (!QUEUE_EMPTY(&write_queue_)) {
+    QUEUE* q = static_cast<QUEUE*>(QUEUE_HEAD(&write_queue_));
+    QUEUE_REMOVE(q);
+
+    PendingWrite* p = QUEUE_DATA(q, PendingWrite, member_);
+    p->w_->~WriteWrap();
+    delete[] reinterpret_cast<char*>(p->w_);
+    delete[] p->data_;
+    delete p;
+  }
+
+  // The idle handle outlives this until it's closed.
+  idle_->data = NULL;
+  uv_close(reinterpret_cast<uv_handle_t*>(idle_), OnIdleClose);
+  idle_ = NULL;
+
+  object_->SetAlignedPointerInInternalField(0, NULL);
+  object_.Dispose(node_isolate);
+  object_.Clear();
+}
+
+
+void TLSCallbacks::Release() {
+  if (handshake_work_ != NULL &&
+      uv_cancel(reinterpret_cast<uv_req_t*>(&handshake_work_->req_)) != 0) {
+    // A thread pool thread has ssl_ and OpenSSL's callbacks use this, so
+    // AfterHandshakeWorkCb() deletes it. JS and the idle handle lose it now.
+    handshake_work_->released_ = true;
+    idle_->data = NULL;
+    object_->SetAlignedPointerInInternalField(0, NULL);
+    return;
+  }
+
+  delete this;
+}
+
+
+void TLSCallbacks::OnIdleClose(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_idle_t*>(handle);
+}
+
+
+void TLSCallbacks::OnIdle(uv_idle_t* handle, int status) {
+  uv_idle_stop(handle);
+
+  TLSCallbacks* callbacks = static_cast<TLSCallbacks*>(handle->data);
+  if (callbacks != NULL) callbacks->Cycle();
+}
+
+
+void TLSCallbacks::AfterReadStart() {
+  paused_ = false;
+
+  // Data that was decrypted already doesn't come with another read, and
+  // JS doesn't expect onread from inside readStart().
+  if (started_) uv_idle_start(idle_, OnIdle);
+}
+
+
+void TLSCallbacks::AfterReadStop() {
+  paused_ = true;
+}
+
+
+TLSCallbacks* TLSCallbacks::Unwrap(const Arguments& args) {
+  assert(!args.This().IsEmpty());
+  assert(args.This()->InternalFieldCount() > 0);
+  return static_cast<TLSCallbacks*>(
+      args.This()->GetAlignedPointerFromInternalField(0));
+}
+
+
+void TLSCallbacks::OnHandshakeStart() {
+  // Called from inside SSL_read(), JS runs once that has returned.
+  handshake_start_pending_ = true;
+}
+
+
+void TLSCallbacks::OnHandshakeDone() {
+  established_ = true;
+  handshake_done_pending_ = true;
+}
+
+
+void TLSCallbacks::InvokeQueued() {
+  HandleScope scope(node_isolate);
+
+  if (handshake_start_pending_) {
+    handshake_start_pending_ = false;
+    MakeCallback(object_, onhandshakestart_sym, 0, NULL);
+  }
+
+  if (handshake_done_pending_) {
+    handshake_done_pending_ = false;
+    MakeCallback(object_, onhandshakedone_sym, 0, NULL);
+  }
+}
+
+
+void TLSCallbacks::EmitError(Handle<Value> err) {
+  HandleScope scope(node_isolate);
+  Local<Value> argv[] = { Local<Value>::New(node_isolate, err) };
+  MakeCallback(object_, onerror_sym, ARRAY_SIZE(argv), argv);
+}
+
+
+bool TLSCallbacks::HandleError(int n) {
+  int err = SSL_get_error(ssl_, n);
+  if (!IsSSLError(err)) return false;
+
+  BIO* bio = BIO_new(BIO_s_mem());
+  ERR_print_errors(bio);
+  ERR_clear_error();
+  BUF_MEM* mem;
+  BIO_get_mem_ptr(bio, &mem);
+  EmitSSLError(err, mem->data, mem->length);
+  BIO_free_all(bio);
+
+  return true;
+}
+
+
+// `msg` is what ERR_print_errors() had to say about `err`, if anything.
+void TLSCallbacks::EmitSSLError(int err, const char* msg, size_t len) {
+  HandleScope scope(node_isolate);
+  Local<Value> e;
+
+  if (len > 0) {
+    e = Exception::Error(String::New(msg, len));
+  } else if (err == SSL_ERROR_SYSCALL) {
+    // Nothing in the queue, the transport went away mid-record.
+    e = Exception::Error(String::New("socket hang up"));
+  } else {
+    e = Exception::Error(String::New("SSL error"));
+  }
+
+  EmitError(e);
+}
+
+
+void TLSCallbacks::Cycle() {
+  // ssl_ belongs to the thread pool until AfterHandshakeWork().
+  if (handshake_work_ != NULL) return;
+
+  HandleScope scope(node_isolate);
+
+  if (offload_ && started_ && !established_ && StartHandshakeWork())
+    return;
+
+  ClearOut();
+  ClearIn();
+  EncOut();
+  InvokeQueued();
+}
+
+
+// Picks the SNI context before the handshake leaves for the thread pool,
+// the callback that does so synchronously can't call into JS there.
+// Returns false until the whole ClientHello is in, and clears offload_ if
+// it doesn't look like one that can be handled up front.
+bool TLSCallbacks::SelectServername() {
+  NodeBIO* bio = NodeBIO::FromBIO(enc_in_);
+
+  // A record is no larger than this.
+  size_t len = bio->Length();
+  if (len > 5 + 0xffff) len = 5 + 0xffff;
+
+  size_t count = len / NodeBIO::kBufferLength + 2;
+  char** data = new char*[count];
+  size_t* sizes = new size_t[count];
+  bio->PeekMultiple(0, data, sizes, &count);
+
+  uint8_t* hello = new uint8_t[len];
+  size_t offset = 0;
+  for (size_t i = 0; i < count && offset < len; i++) {
+    size_t size = sizes[i] < len - offset ? sizes[i] : len - offset;
+    memcpy(hello + offset, data[i], size);
+    offset += size;
+  }
+
+  delete[] data;
+  delete[] sizes;
+
+  char name[TLSEXT_MAXLEN_host_name + 1];
+  ServernameResult r = FindServername(hello, len, name, sizeof(name));
+  delete[] hello;
+
+  if (r == kServernameNeedMore) return false;
+  servername_selected_ = true;
+
+  if (r == kServernameUnknown) {
+    offload_ = false;
+    return false;
+  }
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  if (r == kServernameFound) SelectSNIContext(name);
+#endif  // SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+
+  return true;
+}
+
+
+bool TLSCallbacks::StartHandshakeWork() {
+  // onselect or a handshake callback may have closed the stream.
+  if (wrap_->GetHandle() == NULL) return true;
+
+  // Nothing to do until the client's next flight.
+  if (BIO_pending(enc_in_) == 0) return true;
+
+  if (!servername_selected_ && !SelectServername()) return offload_;
+  if (wrap_->GetHandle() == NULL) return true;
+
+  if (enc_in_side_ == NULL) enc_in_side_ = BIO_new(NodeBIO::GetMethod());
+
+  HandshakeWork* work = new HandshakeWork;
+  work->callbacks_ = this;
+  work->ssl_ = ssl_;
+  work->err_ = SSL_ERROR_NONE;
+  work->error_ = NULL;
+  work->error_len_ = 0;
+  work->released_ = false;
+
+  handshake_work_ = work;
+  in_threadpool_ = true;
+
+  uv_queue_work(uv_default_loop(),
+                &work->req_,
+                HandshakeWorkCb,
+                AfterHandshakeWorkCb);
+
+  return true;
+}
+
+
+// Runs on the thread pool. The callbacks that OpenSSL makes from here see
+// in_threadpool_ and keep away from V8.
+void TLSCallbacks::HandshakeWorkCb(uv_work_t* req) {
+  HandshakeWork* work = container_of(req, HandshakeWork, req_);
+
+  int n = SSL_do_handshake(work->ssl_);
+  int err = SSL_get_error(work->ssl_, n);
+
+  if (IsSSLError(err)) {
+    BIO* bio = BIO_new(BIO_s_mem());
+    ERR_print_errors(bio);
+    BUF_MEM* mem;
+    BIO_get_mem_ptr(bio, &mem);
+    if (mem->length > 0) {
+      work->error_ = static_cast<char*>(malloc(mem->length));
+      if (work->error_ == NULL) abort();
+      memcpy(work->error_, mem->data, mem->length);
+      work->error_len_ = mem->length;
+    }
+    BIO_free_all(bio);
+  }
+
+  // The error queue belongs to this thread, the next job starts clean.
+  ERR_clear_error();
+
+  work->err_ = err;
+}
+
+
+// `status` is -1 with UV_ECANCELED if Release() cancelled the step, the
+// callbacks are gone then.
+void TLSCallbacks::AfterHandshakeWorkCb(uv_work_t* req, int status) {
+  Threadpool::RecordWork(THREADPOOL_WORK_TLS_HANDSHAKE,
+                         reinterpret_cast<uv_req_t*>(req));
+
+  HandshakeWork* work = container_of(req, HandshakeWork, req_);
+  TLSCallbacks* callbacks = work->callbacks_;
+  if (callbacks != NULL) {
+    if (work->released_)
+      delete callbacks;
+    else
+      callbacks->AfterHandshakeWork(work);
+  }
+  FreeHandshakeWork(work);
+}
+
+
+void TLSCallbacks::FreeHandshakeWork(HandshakeWork* work) {
+  free(work->error_);
+  delete work;
+}
+
+
+void TLSCallbacks::AfterHandshakeWork(HandshakeWork* work) {
+  HandleScope scope(node_isolate);
+
+  handshake_work_ = NULL;
+  in_threadpool_ = false;
+
+  // Catch up on what the stream did in the meantime.
+  NodeBIO* side = NodeBIO::FromBIO(enc_in_side_);
+  NodeBIO* in = NodeBIO::FromBIO(enc_in_);
+  while (side->Length() > 0) {
+    size_t size;
+    char* data = side->Peek(&size);
+    in->Write(data, size);
+    side->Skip(size);
+  }
+
+  if (enc_out_written_ > 0) {
+    NodeBIO::FromBIO(enc_out_)->Skip(enc_out_written_);
+    enc_out_written_ = 0;
+  }
+
+  RunDeferredCallbacks();
+
+  bool failed = IsSSLError(work->err_);
+  if (failed) {
+    // The handshake is over, anything else happens synchronously.
+    offload_ = false;
+    if (wrap_->GetHandle() != NULL)
+      EmitSSLError(work->err_, work->error_, work->error_len_);
+  }
+
+  // The next flight for the client, or the alert.
+  EncOut();
+  InvokeQueued();
+
+  if (!failed) Cycle();
+}
+
+
+void TLSCallbacks::ClearOut() {
+  if (!started_ || eof_) return;
+
+  for (;;) {
+    // onread or a handshake callback may have closed the stream.
+    if (wrap_->GetHandle() == NULL) return;
+
+    // JS has enough for now, the rest stays in OpenSSL until it reads
+    // again.
+    if (paused_) return;
+
+    char* out = BufferPool::Default()->Allocate(kClearOutChunkSize);
+    int n = SSL_read(ssl_, out, kClearOutChunkSize);
+
+    if (n > 0) {
+      // Let JS see the handshake finish before it sees the data.
+      InvokeQueued();
+
+      if (wrap_->GetHandle() == NULL) {
+        BufferPool::Default()->Release(out);
+        return;
+      }
+
+      StreamWrapCallbacks::DoRead(wrap_->GetStream(),
+                                  n,
+                                  uv_buf_init(out, kClearOutChunkSize),
+                                  UV_UNKNOWN_HANDLE);
+      continue;
+    }
+
+    BufferPool::Default()->Release(out);
+
+    if (SSL_get_error(ssl_, n) == SSL_ERROR_ZERO_RETURN) {
+      // The peer sent close_notify, that's the end of the cleartext.
+      eof_ = true;
+      SetLastError(UV_EOF);
+      StreamWrapCallbacks::DoRead(wrap_->GetStream(),
+                                  -1,
+                                  uv_buf_init(NULL, 0),
+                                  UV_UNKNOWN_HANDLE);
+      return;
+    }
+
+    HandleError(n);
+    return;
+  }
+}
+
+
+void TLSCallbacks::ClearIn() {
+  if (!established_) return;
+
+  while (!QUEUE_EMPTY(&write_queue_)) {
+    if (wrap_->GetHandle() == NULL) return;
+
+    QUEUE* q = static_cast<QUEUE*>(QUEUE_HEAD(&write_queue_));
+    PendingWrite* p = QUEUE_DATA(q, PendingWrite, member_);
+
+    if (p->size_ > 0) {
+      int n = SSL_write(ssl_, p->data_, p->size_);
+      if (n <= 0) {
+        // Still renegotiating, the next read moves things along.
+        HandleError(n);
+        return;
+      }
+    }
+
+    QUEUE_REMOVE(q);
+
+    if (WriteEncrypted(p->w_, p->cb_)) {
+      HandleScope scope(node_isolate);
+      uv_err_t err = uv_last_error(uv_default_loop());
+      p->w_->~WriteWrap();
+      delete[] reinterpret_cast<char*>(p->w_);
+      EmitError(UVException(err.code, "write"));
+    }
+
+    delete[] p->data_;
+    delete p;
+  }
+}
+
+
+void TLSCallbacks::EncOut() {
+  if (wrap_->GetHandle() == NULL) return;
+
+  // Everything is on its way already.
+  if (NodeBIO::FromBIO(enc_out_)->Length() == enc_out_pending_) return;
+
+  EncWrite* ew = new EncWrite();
+  ew->callbacks_ = this;
+  if (WriteEncrypted(&ew->req_, EncOutCb, &ew->size_)) {
+    // The stream is broken, the read side reports why.
+    delete ew;
+  }
+}
+
+
+void TLSCallbacks::EncOutCb(uv_write_t* req, int status) {
+  EncWrite* ew = reinterpret_cast<EncWrite*>(req);
+  ew->callbacks_->EncWritten(ew->size_);
+  delete ew;
+}
+
+
+int TLSCallbacks::Encrypt(uv_buf_t* bufs, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (bufs[i].len == 0) continue;
+
+    int n = SSL_write(ssl_, bufs[i].base, bufs[i].len);
+    if (n > 0) continue;
+
+    int err = SSL_get_error(ssl_, n);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+      return i;
+
+    ERR_clear_error();
+    return -1;
+  }
+
+  return count;
+}
+
+
+int TLSCallbacks::WriteEncrypted(uv_write_t* req,
+                                 uv_write_cb cb,
+                                 size_t* size) {
+  static const size_t kStackRegions = 16;
+  char* stack_data[kStackRegions];
+  size_t stack_sizes[kStackRegions];
+  uv_buf_t stack_bufs[kStackRegions];
+
+  NodeBIO* bio = NodeBIO::FromBIO(enc_out_);
+  size_t length = bio->Length() - enc_out_pending_;
+
+  // A region ends with each of the BIO's buffers.
+  size_t count = length / NodeBIO::kBufferLength + 2;
+  char** data = stack_data;
+  size_t* sizes = stack_sizes;
+  uv_buf_t* bufs = stack_bufs;
+  if (count > kStackRegions) {
+    data = new char*[count];
+    sizes = new size_t[count];
+    bufs = new uv_buf_t[count];
+  }
+
+  size_t r = bio->PeekMultiple(enc_out_pending_, data, sizes, &count);
+  assert(r == length);
+
+  for (size_t i = 0; i < count; i++)
+    bufs[i] = uv_buf_init(data[i], sizes[i]);
+
+  // Writing nothing is fine, cb still runs after the writes before it.
+  if (count == 0)
+    bufs[count++] = uv_buf_init(NULL, 0);
+
+  // uv_write() keeps a copy of `bufs`, not of the data.
+  int err = uv_write(req, wrap_->GetStream(), bufs, count, cb);
+
+  if (data != stack_data) {
+    delete[] data;
+    delete[] sizes;
+    delete[] bufs;
+  }
+
+  if (err) return err;
+
+  enc_out_pending_ += length;
+  *size = length;
+  return 0;
+}
+
+
+int TLSCallbacks::WriteEncrypted(WriteWrap* w, uv_write_cb cb) {
+  size_t size;
+  int err = WriteEncrypted(&w->req_, cb, &size);
+
+  // The WriteWrap has no other use for data_, AfterWrite() gets the size
+  // from there.
+  if (err == 0)
+    w->data_ = reinterpret_cast<void*>(size);
+
+  return err;
+}
+
+
+void TLSCallbacks::EncWritten(size_t size) {
+  // Writes finish in order, these are the oldest bytes.
+  assert(size <= enc_out_pending_);
+  enc_out_pending_ -= size;
+
+  // The thread pool may be writing to enc_out_, AfterHandshakeWork() skips
+  // them.
+  if (handshake_work_ != NULL) {
+    enc_out_written_ += size;
+    return;
+  }
+
+  NodeBIO::FromBIO(enc_out_)->Skip(size);
+}
+
+
+void TLSCallbacks::QueueWrite(WriteWrap* w,
+                              uv_write_cb cb,
+                              uv_buf_t* bufs,
+                              size_t count) {
+  size_t size = 0;
+  for (size_t i = 0; i < count; i++)
+    size += bufs[i].len;
+
+  PendingWrite* p = new PendingWrite();
+  p->w_ = w;
+  p->cb_ = cb;
+  p->data_ = new char[size];
+  p->size_ = size;
+
+  size_t offset = 0;
+  for (size_t i = 0; i < count; i++) {
+    memcpy(p->data_ + offset, bufs[i].base, bufs[i].len);
+    offset += bufs[i].len;
+  }
+
+  QUEUE_INSERT_TAIL(&write_queue_, &p->member_);
+}
+
+
+int TLSCallbacks::DoWrite(WriteWrap* w,
+                          uv_buf_t* bufs,
+                          size_t count,
+                          uv_stream_t* send_handle,
+                          uv_write_cb cb) {
+  // There's no passing handles over TLS.
+  assert(send_handle == NULL);
+
+  if (shutdown_) {
+    SetLastError(UV_EPIPE);
+    return -1;
+  }
+
+  // Keep the order of writes that are still waiting.
+  if (handshake_work_ != NULL ||
+      !established_ ||
+      !QUEUE_EMPTY(&write_queue_)) {
+    QueueWrite(w, cb, bufs, count);
+    return 0;
+  }
+
+  int n = Encrypt(bufs, count);
+  if (n < 0) {
+    SetLastError(UV_EPROTO);
+    return -1;
+  }
+
+  // What was encrypted already goes out with the rest of this write.
+  if (static_cast<size_t>(n) < count) {
+    QueueWrite(w, cb, bufs + n, count - n);
+    return 0;
+  }
+
+  return WriteEncrypted(w, cb);
+}
+
+
+void TLSCallbacks::AfterWrite(WriteWrap* w) {
+  EncWritten(reinterpret_cast<uintptr_t>(w->data_));
+  w->data_ = NULL;
+}
+
+
+uv_buf_t TLSCallbacks::DoAlloc(uv_handle_t* handle, size_t suggested_size) {
+  // Ciphertext never reaches JS, it's read right into enc_in_. A buffer
+  // supplied with setReadBuffer() is for the cleartext. enc_in_side_
+  // takes it while the thread pool reads from enc_in_.
+  BIO* bio = handshake_work_ != NULL ? enc_in_side_ : enc_in_;
+  size_t size;
+  char* data = NodeBIO::FromBIO(bio)->PeekWritable(&size);
+  return uv_buf_init(data, size);
+}
+
+
+void TLSCallbacks::DoRead(uv_stream_t* handle,
+                          ssize_t nread,
+                          uv_buf_t buf,
+                          uv_handle_type pending) {
+  // Committing nothing gives back the space that DoAlloc() handed out.
+  BIO* bio = handshake_work_ != NULL ? enc_in_side_ : enc_in_;
+  if (buf.base != NULL)
+    NodeBIO::FromBIO(bio)->Commit(nread > 0 ? nread : 0);
+
+  if (nread < 0) {
+    // After close_notify JS has seen the end of the stream already.
+    if (eof_) return;
+
+    StreamWrapCallbacks::DoRead(handle, nread, uv_buf_init(NULL, 0), pending);
+    return;
+  }
+
+  Cycle();
+}
+
+
+int TLSCallbacks::DoShutdown(ShutdownWrap* req_wrap, uv_shutdown_cb cb) {
+  if (handshake_work_ == NULL && established_ && !shutdown_) {
+    // Sends close_notify, the peer's answer isn't waited for.
+    SSL_shutdown(ssl_);
+    ERR_clear_error();
+    EncOut();
+  }
+  shutdown_ = true;
+
+  return StreamWrapCallbacks::DoShutdown(req_wrap, cb);
+}
+
+
+// wrap(handle, context, isServer) puts TLS on top of a TCP or pipe
+// handle and returns the TLSWrap object for it.
+Handle<Value> TLSCallbacks::Wrap(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  if (args.Length() < 2 || !args[0]->IsObject() || !args[1]->IsObject())
+    return ThrowTypeError("Bad arguments, expected handle and context");
+
+  Local<Object> stream_obj = args[0]->ToObject();
+  assert(stream_obj->InternalFieldCount() > 0);
+  StreamWrap* stream = static_cast<StreamWrap*>(
+      stream_obj->GetAlignedPointerFromInternalField(0));
+
+  if (stream == NULL || stream->GetHandle() == NULL)
+    return ThrowError("Handle is closed");
+
+  SecureContext* sc = ObjectWrap::Unwrap<SecureContext>(args[1]->ToObject());
+  bool is_server = args[2]->BooleanValue();
+
+  Local<Object> obj = tlsWrapConstructor->NewInstance();
+  TLSCallbacks* callbacks = new TLSCallbacks(stream, sc, is_server, obj);
+  stream->OverrideCallbacks(callbacks);
+
+  return scope.Close(obj);
+}
+
+
+// Starts the handshake. Clients send their hello right away, servers
+// wait for the client's.
+Handle<Value> TLSCallbacks::Start(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  TLSCallbacks* wrap = Unwrap(args);
+  if (wrap == NULL) return ThrowError("Handle is closed");
+
+  if (wrap->started_) return ThrowError("Already started");
+  wrap->started_ = true;
+
+  wrap->Cycle();
+
+  return Undefined(node_isolate);
+}
+
+
+Handle<Value> TLSCallbacks::SetVerifyMode(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  TLSCallbacks* wrap = Unwrap(args);
+  if (wrap == NULL) return ThrowError("Handle is closed");
+
+  wrap->SSLWrap::SetVerifyMode(args[0]->BooleanValue(),
+                               args[1]->BooleanValue());
+
+  return Undefined(node_isolate);
+}
+
+
+Handle<Value> TLSCallbacks::SetServername(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  TLSCallbacks* wrap = Unwrap(args);
+  if (wrap == NULL) return ThrowError("Handle is closed");
+
+  if (args.Length() < 1 || !args[0]->IsString())
+    return ThrowTypeError("First argument should be a string");
+
+  if (wrap->started_) return ThrowError("Already started");
+  if (wrap->is_server_) return ThrowError("Only clients send a servername");
+
+#ifdef SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+  String::Utf8Value servername(args[0]);
+  SSL_set_tlsext_host_name(wrap->ssl_, *servername);
+#endif  // SSL_CTRL_SET_TLSEXT_SERVERNAME_CB
+
+  return Undefined(node_isolate);
+}
+
+
+static Handle<Value> NewTLSWrap(const Arguments& args) {
+  // Only wrap() makes these.
+  assert(args.IsConstructCall());
+  return args.This();
+}
+
+
+void TLSCallbacks::Initialize(Handle<Object> target) {
+  HandleScope scope(node_isolate);
+
+  NODE_SET_METHOD(target, "wrap", TLSCallbacks::Wrap);
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(NewTLSWrap);
+  t->SetClassName(String::NewSymbol("TLSWrap"));
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  NODE_SET_PROTOTYPE_METHOD(t, "start", Start);
+  NODE_SET_PROTOTYPE_METHOD(t, "setVerifyMode", SetVerifyMode);
+  NODE_SET_PROTOTYPE_METHOD(t, "setServername", SetServername);
+
+  SSLWrap::AddMethods<TLSCallbacks>(t);
+
+  tlsWrapConstructor = Persistent<Function>::New(node_isolate,
+                                                 t->GetFunction());
+
+  onhandshakestart_sym = NODE_PSYMBOL("onhandshakestart");
+  onhandshakedone_sym = NODE_PSYMBOL("onhandshakedone");
+  onerror_sym = NODE_PSYMBOL("onerror");
+}
+
+}  // namespace node
+
+NODE_MODULE(node_tls_wrap, node::TLSCallbacks::Initialize)
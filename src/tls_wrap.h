@@ -0,0 +1,179 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TLS_WRAP_H_
+#define TLS_WRAP_H_
+
+#include "node.h"
+#include "node_crypto.h"
+#include "queue.h"
+#include "stream_wrap.h"
+#include "v8.h"
+
+#include <openssl/ssl.h>
+
+namespace node {
+
+// TLS on top of a StreamWrap. Encrypted data goes between OpenSSL and the
+// uv_stream_t without surfacing in JS; onread of the stream's handle gets
+// the cleartext and its write methods take cleartext. The JS object that
+// wrap() returns ("TLSWrap") has the SSL specific methods and gets the
+// onhandshakestart, onhandshakedone, onnewsession and onerror callbacks.
+class TLSCallbacks : public crypto::SSLWrap, public StreamWrapCallbacks {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  int DoWrite(WriteWrap* w,
+              uv_buf_t* bufs,
+              size_t count,
+              uv_stream_t* send_handle,
+              uv_write_cb cb);
+  void AfterWrite(WriteWrap* w);
+  uv_buf_t DoAlloc(uv_handle_t* handle, size_t suggested_size);
+  void DoRead(uv_stream_t* handle,
+              ssize_t nread,
+              uv_buf_t buf,
+              uv_handle_type pending);
+  int DoShutdown(ShutdownWrap* req_wrap, uv_shutdown_cb cb);
+  void AfterReadStart();
+  void AfterReadStop();
+  void Release();
+
+  v8::Handle<v8::Object> GetObject() { return object_; }
+
+  // Returns NULL once the stream that this was wrapped around is gone.
+  static TLSCallbacks* Unwrap(const v8::Arguments& args);
+
+ protected:
+  // Cleartext that was written before the handshake finished, or while
+  // OpenSSL wanted to read first. Sent in order once that's over.
+  struct PendingWrite {
+    WriteWrap* w_;
+    uv_write_cb cb_;
+    char* data_;
+    size_t size_;
+    QUEUE member_;
+  };
+
+  // Encrypted data that OpenSSL produced on its own, i.e. handshake
+  // messages and alerts.
+  struct EncWrite {
+    uv_write_t req_;
+    TLSCallbacks* callbacks_;
+    size_t size_;
+  };
+
+  // A server handshake step on the thread pool. It owns ssl_ until the
+  // main thread gets it back in AfterHandshakeWork(). If the stream goes
+  // away in the meantime, Release() cancels it or, when it's running
+  // already, leaves deleting the callbacks to AfterHandshakeWorkCb().
+  struct HandshakeWork {
+    uv_work_t req_;
+    TLSCallbacks* callbacks_;
+    SSL* ssl_;
+    int err_;  // SSL_get_error()
+    char* error_;  // what ERR_print_errors() had to say, malloc'd
+    size_t error_len_;
+    bool released_;  // the StreamWrap is gone, delete callbacks_
+  };
+
+  // Cleartext is handed to JS in blocks of at most this size.
+  static const size_t kClearOutChunkSize = 16 * 1024;
+
+  TLSCallbacks(StreamWrap* wrap,
+               crypto::SecureContext* sc,
+               bool is_server,
+               v8::Handle<v8::Object> object);
+  ~TLSCallbacks();
+
+  // Runs OpenSSL after data came in or went out and passes on whatever
+  // that produced.
+  void Cycle();
+  void ClearOut();
+  void ClearIn();
+  void EncOut();
+  void InvokeQueued();
+
+  // Encrypts `count` buffers, returns the number of buffers that were
+  // fully encrypted or -1 on error.
+  int Encrypt(uv_buf_t* bufs, size_t count);
+
+  // Sends what's in enc_out_ and isn't on its way yet with `req`, straight
+  // out of the BIO's buffers. The number of bytes goes into `size`, they
+  // have to stay in enc_out_ until EncWritten() after `req` is done.
+  int WriteEncrypted(uv_write_t* req, uv_write_cb cb, size_t* size);
+  int WriteEncrypted(WriteWrap* w, uv_write_cb cb);
+  void EncWritten(size_t size);
+
+  // Queues the unencrypted part of a write.
+  void QueueWrite(WriteWrap* w, uv_write_cb cb, uv_buf_t* bufs, size_t count);
+
+  // Hands an error from OpenSSL to onerror, returns false if `n` and
+  // the error queue say there wasn't one.
+  bool HandleError(int n);
+  void EmitSSLError(int err, const char* msg, size_t len);
+  void EmitError(v8::Handle<v8::Value> err);
+
+  // Runs the next step of a server handshake on the thread pool. Returns
+  // false if it has to happen synchronously after all.
+  bool StartHandshakeWork();
+  void AfterHandshakeWork(HandshakeWork* work);
+  bool SelectServername();
+
+  static void HandshakeWorkCb(uv_work_t* req);
+  static void AfterHandshakeWorkCb(uv_work_t* req, int status);
+  static void FreeHandshakeWork(HandshakeWork* work);
+
+  void OnHandshakeStart();
+  void OnHandshakeDone();
+
+  static void EncOutCb(uv_write_t* req, int status);
+  static void OnIdle(uv_idle_t* handle, int status);
+  static void OnIdleClose(uv_handle_t* handle);
+
+  static v8::Handle<v8::Value> Wrap(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Start(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetVerifyMode(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetServername(const v8::Arguments& args);
+
+  v8::Persistent<v8::Object> object_;
+  BIO* enc_in_;
+  BIO* enc_out_;
+  size_t enc_out_pending_;  // bytes in enc_out_ that uv_write has
+  BIO* enc_in_side_;  // ciphertext that arrives during handshake work
+  size_t enc_out_written_;  // bytes written during handshake work
+  HandshakeWork* handshake_work_;
+  QUEUE write_queue_;
+  uv_idle_t* idle_;  // passes on what was held back when reading resumes
+  bool started_;
+  bool established_;
+  bool shutdown_;
+  bool eof_;
+  bool paused_;
+  bool handshake_start_pending_;
+  bool handshake_done_pending_;
+  bool offload_;
+  bool servername_selected_;
+};
+
+}  // namespace node
+
+#endif  // TLS_WRAP_H_
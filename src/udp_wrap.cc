@@ -21,19 +21,23 @@
 
 #include "node.h"
 #include "node_buffer.h"
-#include "slab_allocator.h"
+#include "buffer_pool.h"
 #include "req_wrap.h"
 #include "handle_wrap.h"
 #include "udp_wrap.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-#define SLAB_SIZE (1024 * 1024)
+
+// libuv doesn't do more than this per recvmmsg() call either.
+#define MAX_RECV_BATCH 64
 
 
 namespace node {
 
 using v8::AccessorInfo;
+using v8::Array;
 using v8::Arguments;
 using v8::Function;
 using v8::FunctionTemplate;
@@ -49,6 +53,16 @@ using v8::Value;
 
 typedef ReqWrap<uv_udp_send_t> SendWrap;
 
+// The first datagram of a sendMany() call goes out with SendWrap::req_, the
+// others with the requests in here. Hangs off SendWrap::data_. The JS
+// callback runs when the last datagram completes.
+struct SendManyState {
+  unsigned int pending;
+  int status;
+  uv_err_t error;
+  uv_udp_send_t* reqs;
+};
+
 // see tcp_wrap.cc
 Local<Object> AddressToJS(const sockaddr* addr);
 
@@ -56,37 +70,33 @@ static Persistent<Function> constructor;
 static Persistent<String> buffer_sym;
 static Persistent<String> oncomplete_sym;
 static Persistent<String> onmessage_sym;
-static SlabAllocator* slab_allocator;
-
-
-static void DeleteSlabAllocator(void*) {
-  delete slab_allocator;
-  slab_allocator = NULL;
-}
+static Persistent<String> onmessages_sym;
 
 
 UDPWrap::UDPWrap(Handle<Object> object)
-    : HandleWrap(object, reinterpret_cast<uv_handle_t*>(&handle_)) {
+    : HandleWrap(object, reinterpret_cast<uv_handle_t*>(&handle_)),
+      batch_(NULL),
+      batch_length_(0),
+      batch_capacity_(0) {
   int r = uv_udp_init(uv_default_loop(), &handle_);
   assert(r == 0); // can't fail anyway
 }
 
 
 UDPWrap::~UDPWrap() {
+  delete[] batch_;
 }
 
 
 void UDPWrap::Initialize(Handle<Object> target) {
   HandleWrap::Initialize(target);
 
-  slab_allocator = new SlabAllocator(SLAB_SIZE);
-  AtExit(DeleteSlabAllocator, NULL);
-
   HandleScope scope(node_isolate);
 
   buffer_sym = NODE_PSYMBOL("buffer");
   oncomplete_sym = NODE_PSYMBOL("oncomplete");
   onmessage_sym = NODE_PSYMBOL("onmessage");
+  onmessages_sym = NODE_PSYMBOL("onmessages");
 
   Local<FunctionTemplate> t = FunctionTemplate::New(New);
   t->InstanceTemplate()->SetInternalFieldCount(1);
@@ -105,9 +115,12 @@ void UDPWrap::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(t, "send", Send);
   NODE_SET_PROTOTYPE_METHOD(t, "bind6", Bind6);
   NODE_SET_PROTOTYPE_METHOD(t, "send6", Send6);
+  NODE_SET_PROTOTYPE_METHOD(t, "sendMany", SendMany);
+  NODE_SET_PROTOTYPE_METHOD(t, "sendMany6", SendMany6);
   NODE_SET_PROTOTYPE_METHOD(t, "close", Close);
   NODE_SET_PROTOTYPE_METHOD(t, "recvStart", RecvStart);
   NODE_SET_PROTOTYPE_METHOD(t, "recvStop", RecvStop);
+  NODE_SET_PROTOTYPE_METHOD(t, "setRecvBatch", SetRecvBatch);
   NODE_SET_PROTOTYPE_METHOD(t, "getsockname", GetSockName);
   NODE_SET_PROTOTYPE_METHOD(t, "addMembership", AddMembership);
   NODE_SET_PROTOTYPE_METHOD(t, "dropMembership", DropMembership);
@@ -306,6 +319,97 @@ Handle<Value> UDPWrap::Send6(const Arguments& args) {
 }
 
 
+Handle<Value> UDPWrap::DoSendMany(const Arguments& args, int family) {
+  HandleScope scope(node_isolate);
+  int r;
+
+  // sendMany(buffers, port, address)
+  assert(args.Length() == 3);
+
+  UNWRAP(UDPWrap)
+
+  assert(args[0]->IsArray());
+  Local<Array> buffers = Local<Array>::Cast(args[0]);
+  const unsigned int count = buffers->Length();
+  assert(count > 0);
+
+  const unsigned short port = args[1]->Uint32Value();
+  String::Utf8Value address(args[2]);
+
+  struct sockaddr_in addr4;
+  struct sockaddr_in6 addr6;
+
+  switch (family) {
+  case AF_INET:
+    addr4 = uv_ip4_addr(*address, port);
+    break;
+  case AF_INET6:
+    addr6 = uv_ip6_addr(*address, port);
+    break;
+  default:
+    assert(0 && "unexpected address family");
+    abort();
+  }
+
+  SendWrap* req_wrap = new SendWrap();
+  req_wrap->object_->SetHiddenValue(buffer_sym, buffers);
+  req_wrap->Dispatched();
+
+  SendManyState* state = new SendManyState;
+  state->pending = count;
+  state->status = 0;
+  state->reqs = new uv_udp_send_t[count - 1];
+  req_wrap->data_ = state;
+
+  for (unsigned int i = 0; i < count; i++) {
+    Local<Value> buffer_v = buffers->Get(i);
+    assert(Buffer::HasInstance(buffer_v));
+    Local<Object> buffer_obj = buffer_v->ToObject();
+
+    uv_buf_t buf = uv_buf_init(Buffer::Data(buffer_obj),
+                               Buffer::Length(buffer_obj));
+
+    uv_udp_send_t* req = (i == 0) ? &req_wrap->req_ : &state->reqs[i - 1];
+    req->data = req_wrap;
+
+    if (family == AF_INET)
+      r = uv_udp_send(req, &wrap->handle_, &buf, 1, addr4, OnSendMany);
+    else
+      r = uv_udp_send6(req, &wrap->handle_, &buf, 1, addr6, OnSendMany);
+
+    if (r == 0)
+      continue;
+
+    if (i == 0) {
+      SetErrno(uv_last_error(uv_default_loop()));
+      delete[] state->reqs;
+      delete state;
+      delete req_wrap;
+      return Null(node_isolate);
+    }
+
+    // The datagrams that made it into the queue report the error when
+    // they're done.
+    state->pending = i;
+    state->status = r;
+    state->error = uv_last_error(uv_default_loop());
+    break;
+  }
+
+  return scope.Close(req_wrap->object_);
+}
+
+
+Handle<Value> UDPWrap::SendMany(const Arguments& args) {
+  return DoSendMany(args, AF_INET);
+}
+
+
+Handle<Value> UDPWrap::SendMany6(const Arguments& args) {
+  return DoSendMany(args, AF_INET6);
+}
+
+
 Handle<Value> UDPWrap::RecvStart(const Arguments& args) {
   HandleScope scope(node_isolate);
 
@@ -333,6 +437,41 @@ Handle<Value> UDPWrap::RecvStop(const Arguments& args) {
 }
 
 
+Handle<Value> UDPWrap::SetRecvBatch(const Arguments& args) {
+  HandleScope scope(node_isolate);
+
+  UNWRAP(UDPWrap)
+
+  // setRecvBatch(count, size)
+  assert(args.Length() == 2);
+
+  unsigned int count = args[0]->Uint32Value();
+  size_t size = args[1]->Uint32Value();
+
+  if (count > MAX_RECV_BATCH)
+    count = MAX_RECV_BATCH;
+
+  int r = uv_udp_set_recv_batch(&wrap->handle_, count, size);
+  if (r) {
+    SetErrno(uv_last_error(uv_default_loop()));
+    return scope.Close(Integer::New(r, node_isolate));
+  }
+
+  // Not while a batch is pending, JS can't run then anyway.
+  assert(wrap->batch_length_ == 0);
+  delete[] wrap->batch_;
+  wrap->batch_ = NULL;
+  wrap->batch_capacity_ = 0;
+
+  if (count > 1) {
+    wrap->batch_ = new BatchEntry[count];
+    wrap->batch_capacity_ = count;
+  }
+
+  return scope.Close(Integer::New(0, node_isolate));
+}
+
+
 Handle<Value> UDPWrap::GetSockName(const Arguments& args) {
   HandleScope scope(node_isolate);
   struct sockaddr_storage address;
@@ -382,9 +521,49 @@ void UDPWrap::OnSend(uv_udp_send_t* req, int status) {
 }
 
 
+void UDPWrap::OnSendMany(uv_udp_send_t* req, int status) {
+  assert(req != NULL);
+
+  SendWrap* req_wrap = reinterpret_cast<SendWrap*>(req->data);
+  SendManyState* state = static_cast<SendManyState*>(req_wrap->data_);
+
+  if (status && state->status == 0) {
+    state->status = status;
+    state->error = uv_last_error(uv_default_loop());
+  }
+
+  assert(state->pending > 0);
+  if (--state->pending > 0)
+    return;
+
+  HandleScope scope(node_isolate);
+  UDPWrap* wrap = reinterpret_cast<UDPWrap*>(req->handle->data);
+
+  assert(req_wrap->object_.IsEmpty() == false);
+  assert(wrap->object_.IsEmpty() == false);
+
+  status = state->status;
+  if (status) {
+    SetErrno(state->error);
+  }
+
+  delete[] state->reqs;
+  delete state;
+
+  Local<Value> argv[4] = {
+    Integer::New(status, node_isolate),
+    Local<Value>::New(node_isolate, wrap->object_),
+    Local<Value>::New(node_isolate, req_wrap->object_),
+    req_wrap->object_->GetHiddenValue(buffer_sym),
+  };
+
+  MakeCallback(req_wrap->object_, oncomplete_sym, ARRAY_SIZE(argv), argv);
+  delete req_wrap;
+}
+
+
 uv_buf_t UDPWrap::OnAlloc(uv_handle_t* handle, size_t suggested_size) {
-  UDPWrap* wrap = static_cast<UDPWrap*>(handle->data);
-  char* buf = slab_allocator->Allocate(wrap->object_, suggested_size);
+  char* buf = BufferPool::Default()->Allocate(suggested_size);
   return uv_buf_init(buf, suggested_size);
 }
 
@@ -394,15 +573,26 @@ void UDPWrap::OnRecv(uv_udp_t* handle,
                      uv_buf_t buf,
                      struct sockaddr* addr,
                      unsigned flags) {
+  UDPWrap* wrap = reinterpret_cast<UDPWrap*>(handle->data);
+
+  // Datagrams of a recvmmsg() batch share one pool block. They're
+  // handed to JS in one go once libuv is done with the buffer.
+  if (flags & UV_UDP_MMSG_CHUNK) {
+    wrap->OnRecvChunk(nread, buf, addr);
+    return;
+  }
+
+  if (flags & UV_UDP_MMSG_FREE) {
+    wrap->OnRecvBatch(buf);
+    return;
+  }
+
   HandleScope scope(node_isolate);
 
-  UDPWrap* wrap = reinterpret_cast<UDPWrap*>(handle->data);
-  Local<Object> slab = slab_allocator->Shrink(wrap->object_,
-                                              buf.base,
-                                              nread < 0 ? 0 : nread);
-  if (nread == 0) return;
+  if (nread <= 0) {
+    BufferPool::Default()->Release(buf.base);
+    if (nread == 0) return;
 
-  if (nread < 0) {
     Local<Value> argv[] = { Local<Object>::New(node_isolate, wrap->object_) };
     SetErrno(uv_last_error(uv_default_loop()));
     MakeCallback(wrap->object_, onmessage_sym, ARRAY_SIZE(argv), argv);
@@ -411,8 +601,8 @@ void UDPWrap::OnRecv(uv_udp_t* handle,
 
   Local<Value> argv[] = {
     Local<Object>::New(node_isolate, wrap->object_),
-    slab,
-    Integer::NewFromUnsigned(buf.base - Buffer::Data(slab), node_isolate),
+    BufferPool::Default()->Shrink(buf.base, nread),
+    Integer::NewFromUnsigned(0, node_isolate),
     Integer::NewFromUnsigned(nread, node_isolate),
     AddressToJS(addr)
   };
@@ -420,6 +610,59 @@ void UDPWrap::OnRecv(uv_udp_t* handle,
 }
 
 
+void UDPWrap::OnRecvChunk(ssize_t nread, uv_buf_t buf, struct sockaddr* addr) {
+  // Can't happen unless libuv batches more than it was asked to.
+  assert(batch_length_ < batch_capacity_);
+
+  BatchEntry* entry = &batch_[batch_length_++];
+  entry->data = buf.base;
+  entry->length = nread;
+
+  if (addr->sa_family == AF_INET6)
+    memcpy(&entry->address, addr, sizeof(struct sockaddr_in6));
+  else
+    memcpy(&entry->address, addr, sizeof(struct sockaddr_in));
+}
+
+
+void UDPWrap::OnRecvBatch(uv_buf_t buf) {
+  HandleScope scope(node_isolate);
+
+  // The used part of the block is moved as a whole, offsets are relative
+  // to its start.
+  const char* base = buf.base;
+  Local<Object> buffer = BufferPool::Default()->Shrink(buf.base, buf.len);
+
+  // offsets is [start0, length0, start1, length1, ...]
+  const unsigned int count = batch_length_;
+  Local<Array> offsets = Array::New(count * 2);
+  Local<Array> addresses = Array::New(count);
+
+  for (unsigned int i = 0; i < count; i++) {
+    BatchEntry* entry = &batch_[i];
+    offsets->Set(i * 2,
+                 Integer::NewFromUnsigned(entry->data - base, node_isolate));
+    offsets->Set(i * 2 + 1,
+                 Integer::NewFromUnsigned(entry->length, node_isolate));
+    addresses->Set(i, AddressToJS(
+        reinterpret_cast<const sockaddr*>(&entry->address)));
+  }
+
+  batch_length_ = 0;
+
+  if (count == 0)
+    return;
+
+  Local<Value> argv[] = {
+    Local<Object>::New(node_isolate, object_),
+    buffer,
+    offsets,
+    addresses
+  };
+  MakeCallback(object_, onmessages_sym, ARRAY_SIZE(argv), argv);
+}
+
+
 UDPWrap* UDPWrap::Unwrap(Local<Object> obj) {
   assert(!obj.IsEmpty());
   assert(obj->InternalFieldCount() > 0);
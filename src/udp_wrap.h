@@ -17,8 +17,11 @@ class UDPWrap: public HandleWrap {
   static v8::Handle<v8::Value> Send(const v8::Arguments& args);
   static v8::Handle<v8::Value> Bind6(const v8::Arguments& args);
   static v8::Handle<v8::Value> Send6(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SendMany(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SendMany6(const v8::Arguments& args);
   static v8::Handle<v8::Value> RecvStart(const v8::Arguments& args);
   static v8::Handle<v8::Value> RecvStop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetRecvBatch(const v8::Arguments& args);
   static v8::Handle<v8::Value> GetSockName(const v8::Arguments& args);
   static v8::Handle<v8::Value> AddMembership(const v8::Arguments& args);
   static v8::Handle<v8::Value> DropMembership(const v8::Arguments& args);
@@ -37,18 +40,34 @@ class UDPWrap: public HandleWrap {
 
   static v8::Handle<v8::Value> DoBind(const v8::Arguments& args, int family);
   static v8::Handle<v8::Value> DoSend(const v8::Arguments& args, int family);
+  static v8::Handle<v8::Value> DoSendMany(const v8::Arguments& args,
+                                          int family);
   static v8::Handle<v8::Value> SetMembership(const v8::Arguments& args,
                                              uv_membership membership);
 
   static uv_buf_t OnAlloc(uv_handle_t* handle, size_t suggested_size);
   static void OnSend(uv_udp_send_t* req, int status);
+  static void OnSendMany(uv_udp_send_t* req, int status);
   static void OnRecv(uv_udp_t* handle,
                      ssize_t nread,
                      uv_buf_t buf,
                      struct sockaddr* addr,
                      unsigned flags);
 
+  void OnRecvChunk(ssize_t nread, uv_buf_t buf, struct sockaddr* addr);
+  void OnRecvBatch(uv_buf_t buf);
+
+  // Datagrams of a recvmmsg() batch, collected until the batch is complete.
+  struct BatchEntry {
+    char* data;
+    size_t length;
+    struct sockaddr_storage address;
+  };
+
   uv_udp_t handle_;
+  BatchEntry* batch_;
+  unsigned int batch_length_;
+  unsigned int batch_capacity_;
 };
 
 } // namespace node
@@ -0,0 +1,124 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+// Inputs long enough for the vectorized base64 and hex code, with the
+// things that make it fall back to the byte at a time code in between.
+
+var common = require('../common');
+var assert = require('assert');
+
+var alphabet = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz' +
+               '0123456789+/';
+
+function data(len) {
+  var b = new Buffer(len);
+  for (var i = 0; i < len; i++)
+    b[i] = (i * 7 + (i >> 8)) & 0xff;
+  return b;
+}
+
+// Reference encoder, 3 bytes at a time.
+function base64(b) {
+  var s = '';
+  for (var i = 0; i < b.length; i += 3) {
+    var n = (b[i] << 16) | ((b[i + 1] || 0) << 8) | (b[i + 2] || 0);
+    s += alphabet[n >> 18] + alphabet[(n >> 12) & 63];
+    s += i + 1 < b.length ? alphabet[(n >> 6) & 63] : '=';
+    s += i + 2 < b.length ? alphabet[n & 63] : '=';
+  }
+  return s;
+}
+
+function hex(b) {
+  var s = '';
+  for (var i = 0; i < b.length; i++)
+    s += (b[i] < 16 ? '0' : '') + b[i].toString(16);
+  return s;
+}
+
+[0, 1, 2, 3, 11, 12, 13, 15, 16, 17, 23, 24, 25, 27, 28, 31, 32, 33, 47, 48,
+ 63, 64, 65, 95, 96, 97, 255, 256, 1000, 4095, 65537].forEach(function(len) {
+  var b = data(len);
+  var b64 = base64(b);
+  var h = hex(b);
+
+  assert.equal(b.toString('base64'), b64, 'base64 encode ' + len);
+  assert.equal(b.toString('hex'), h, 'hex encode ' + len);
+
+  assert.deepEqual(new Buffer(b64, 'base64'), b, 'base64 decode ' + len);
+  assert.deepEqual(new Buffer(h, 'hex'), b, 'hex decode ' + len);
+  assert.deepEqual(new Buffer(h.toUpperCase(), 'hex'), b,
+                   'hex decode upper case ' + len);
+
+  // URL-safe alphabet.
+  var url = b64.replace(/\+/g, '-').replace(/\//g, '_').replace(/=/g, '');
+  assert.deepEqual(new Buffer(url, 'base64'), b, 'base64url decode ' + len);
+
+  // Line breaks every 76 characters like MIME does, and stray whitespace.
+  var mime = b64.replace(/.{76}/g, '$&\r\n');
+  assert.deepEqual(new Buffer(mime, 'base64'), b, 'base64 mime ' + len);
+  var spaced = b64.slice(0, 40) + ' \t' + b64.slice(40);
+  assert.deepEqual(new Buffer(spaced, 'base64'), b, 'base64 spaces ' + len);
+});
+
+// Decoding hex stops at the first invalid character pair.
+var h = hex(data(200));
+var bad = h.slice(0, 101) + 'x' + h.slice(102);
+assert.deepEqual(new Buffer(bad, 'hex'), data(50));
+
+// Characters outside of the alphabet are skipped when decoding base64,
+// decoding stops at padding.
+var b64 = base64(data(300));
+var junk = b64.slice(0, 100) + '*' + b64.slice(100, 200) + '#' +
+           b64.slice(200);
+assert.deepEqual(new Buffer(junk, 'base64'), data(300));
+var padded = b64.slice(0, 200) + '=' + b64.slice(200);
+assert.deepEqual(new Buffer(padded, 'base64'), data(150));
+
+// Decoding into a buffer that's too small.
+var small = new Buffer(100);
+small.fill(0);
+assert.equal(small.write(base64(data(300)), 'base64'), 100);
+assert.deepEqual(small, data(100));
+assert.equal(small.write(hex(data(300)), 'hex'), 100);
+assert.deepEqual(small, data(100));
+
+// Bytes past what was decoded stay untouched, even when the input ends in
+// padding or junk right after a vectorized block.
+[1, 2, 3, 4, 5, 11, 12, 13, 23, 24, 25].forEach(function(len) {
+  var enc = base64(data(len));
+  [enc + '            ', enc + '********************************'].forEach(
+    function(s) {
+      var target = new Buffer(len + 40);
+      target.fill(0xff);
+      assert.equal(target.write(s, 'base64'), len);
+      assert.deepEqual(target.slice(0, len), data(len));
+      for (var i = len; i < target.length; i++)
+        assert.equal(target[i], 0xff, 'byte ' + i + ' after ' + len);
+    });
+});
+
+var target = new Buffer(20);
+target.fill(0xff);
+assert.equal(target.write('QUFBQUFBQUFBQUFBQQ==            ', 'base64'), 13);
+for (var i = 13; i < target.length; i++)
+  assert.equal(target[i], 0xff);
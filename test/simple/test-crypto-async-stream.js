@@ -0,0 +1,107 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Hash, cipher and sign large chunks on the thread pool and compare the
+// results with the synchronous ones.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+
+try {
+  var crypto = require('crypto');
+} catch (e) {
+  console.log('Not compiled with OPENSSL support.');
+  process.exit();
+}
+
+var chunks = [];
+for (var i = 0; i < 10; i++) {
+  var chunk = new Buffer(crypto.ASYNC_THRESHOLD + i);
+  chunk.fill(i);
+  chunks.push(chunk);
+}
+var data = Buffer.concat(chunks);
+
+function readAll(stream, cb) {
+  var buffers = [];
+  stream.on('readable', function() {
+    var chunk;
+    while (null !== (chunk = stream.read()))
+      buffers.push(chunk);
+  });
+  stream.on('end', function() {
+    cb(Buffer.concat(buffers));
+  });
+}
+
+function writeAll(stream) {
+  chunks.forEach(function(chunk) {
+    stream.write(chunk);
+  });
+  stream.end();
+}
+
+// Hash
+var hash = crypto.createHash('sha256', { async: true });
+readAll(hash, common.mustCall(function(digest) {
+  var expected = crypto.createHash('sha256').update(data).digest('hex');
+  assert.equal(digest.toString('hex'), expected);
+}));
+writeAll(hash);
+
+// The updates are in flight, the synchronous methods have to wait.
+assert.throws(function() {
+  hash.update('x');
+}, /Asynchronous operation in progress/);
+
+// Hmac
+var hmac = crypto.createHmac('sha1', 'secret', { async: true });
+readAll(hmac, common.mustCall(function(digest) {
+  var expected = crypto.createHmac('sha1', 'secret').update(data).digest();
+  assert.equal(digest.toString('hex'), expected.toString('hex'));
+}));
+writeAll(hmac);
+
+// Cipher and back
+var cipher = crypto.createCipher('aes256', 'password', { async: true });
+var decipher = crypto.createDecipher('aes256', 'password', { async: true });
+readAll(decipher, common.mustCall(function(plaintext) {
+  assert.equal(plaintext.length, data.length);
+  assert.ok(plaintext.toString('hex') === data.toString('hex'));
+}));
+cipher.pipe(decipher);
+writeAll(cipher);
+
+// Sign
+var key = fs.readFileSync(common.fixturesDir + '/test_rsa_privkey.pem');
+var pub = fs.readFileSync(common.fixturesDir + '/test_rsa_pubkey.pem');
+
+var sign = crypto.createSign('RSA-SHA256', { async: true });
+sign.on('finish', common.mustCall(function() {
+  sign.sign(key, 'hex', common.mustCall(function(err, signature) {
+    assert.ifError(err);
+    var verify = crypto.createVerify('RSA-SHA256');
+    verify.update(data);
+    assert.ok(verify.verify(pub, signature, 'hex'));
+  }));
+}));
+writeAll(sign);
@@ -0,0 +1,63 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// crypto.hash() and crypto.hmac() give the same digests as the objects.
+
+var common = require('../common');
+var assert = require('assert');
+
+try {
+  var crypto = require('crypto');
+} catch (e) {
+  console.log('Not compiled with OPENSSL support.');
+  process.exit();
+}
+
+var long = new Array(2000).join('ü');
+
+['md5', 'sha1', 'sha256', 'sha512'].forEach(function(algo) {
+  [['Test123', 'binary'], [long, 'utf8'], [new Buffer('Test123')]].forEach(
+      function(input) {
+    ['hex', 'base64', 'binary', 'buffer'].forEach(function(out) {
+      var expected = crypto.createHash(algo)
+                           .update(input[0], input[1])
+                           .digest(out);
+      assert.deepEqual(crypto.hash(algo, input[0], input[1], out), expected);
+
+      expected = crypto.createHmac(algo, 'key')
+                       .update(input[0], input[1])
+                       .digest(out);
+      assert.deepEqual(crypto.hmac(algo, 'key', input[0], input[1], out),
+                       expected);
+    });
+  });
+});
+
+// An empty key must not fall back to the one from the call before.
+assert.equal(crypto.hmac('sha1', '', 'data', null, 'hex'),
+             crypto.createHmac('sha1', '').update('data').digest('hex'));
+
+// Buffers by default.
+assert.ok(Buffer.isBuffer(crypto.hash('sha1', 'Test123')));
+
+assert.throws(function() {
+  crypto.hash('no such digest', 'Test123');
+}, /Digest method not supported/);
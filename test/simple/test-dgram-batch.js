@@ -0,0 +1,98 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var dgram = require('dgram');
+
+var COUNT = 50;
+
+var buffers = [];
+for (var i = 0; i < COUNT; i++)
+  buffers.push(new Buffer('message ' + i));
+
+var received = [];
+var batches = 0;
+var sendManyCalled = false;
+
+var server = dgram.createSocket('udp4');
+
+assert.throws(function() {
+  server.setRecvBatch('16');
+}, TypeError);
+
+server.setRecvBatch(16, 64);
+
+server.on('messages', function(buf, offsets, rinfos) {
+  assert.ok(Buffer.isBuffer(buf));
+  assert.equal(offsets.length, rinfos.length * 2);
+  batches++;
+
+  for (var i = 0; i < rinfos.length; i++) {
+    var start = offsets[i * 2];
+    var len = offsets[i * 2 + 1];
+    assert.equal(rinfos[i].address, '127.0.0.1');
+    assert.equal(rinfos[i].size, len);
+    received.push(buf.slice(start, start + len).toString());
+  }
+
+  if (received.length === COUNT) {
+    server.close();
+    client.close();
+  }
+});
+
+// Platforms without batched receives fall back to 'message'.
+server.on('message', function(msg, rinfo) {
+  assert.equal(rinfo.address, '127.0.0.1');
+  received.push(msg.toString());
+
+  if (received.length === COUNT) {
+    server.close();
+    client.close();
+  }
+});
+
+var client = dgram.createSocket('udp4');
+
+assert.throws(function() {
+  client.sendMany([], common.PORT, '127.0.0.1');
+}, TypeError);
+
+assert.throws(function() {
+  client.sendMany(['not a buffer'], common.PORT, '127.0.0.1');
+}, TypeError);
+
+server.bind(common.PORT, function() {
+  client.sendMany(buffers, common.PORT, '127.0.0.1', function(err, sent) {
+    assert.ifError(err);
+    assert.equal(sent, COUNT);
+    sendManyCalled = true;
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(sendManyCalled);
+  assert.equal(received.length, COUNT);
+  assert.deepEqual(received.sort(), buffers.map(String).sort());
+  if (process.platform === 'linux')
+    assert.ok(batches > 0);
+});
@@ -0,0 +1,70 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A client that goes away while a file is being sent to it with sendfile
+// must not take the server down: the source has no 'error' listener, same
+// as the usual fs.createReadStream(file).pipe(res).
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var http = require('http');
+var path = require('path');
+
+var SIZE = 16 * 1024 * 1024;
+
+var file = path.join(common.tmpDir, 'read-stream-sendfile-hangup.bin');
+fs.writeFileSync(file, new Buffer(SIZE));
+
+var piped = false;
+var sourceClosed = false;
+var responseClosed = false;
+
+var server = http.createServer(function(req, res) {
+  res.on('pipe', function() {
+    piped = true;
+  });
+  res.on('close', function() {
+    responseClosed = true;
+  });
+
+  var stream = fs.createReadStream(file);
+  stream.on('close', function() {
+    sourceClosed = true;
+    server.close();
+  });
+  stream.pipe(res);
+});
+
+server.listen(common.PORT, function() {
+  http.get({ port: common.PORT, path: '/' }, function(res) {
+    res.once('data', function() {
+      res.socket.destroy();
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert(piped);
+  assert(sourceClosed);
+  assert(responseClosed);
+  fs.unlinkSync(file);
+});
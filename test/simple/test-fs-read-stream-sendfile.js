@@ -0,0 +1,119 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var http = require('http');
+var net = require('net');
+var path = require('path');
+
+var SIZE = 1024 * 1024;
+var START = 1000;
+var END = SIZE - 1001;
+
+var file = path.join(common.tmpDir, 'read-stream-sendfile.bin');
+var data = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++)
+  data[i] = i % 251;
+fs.writeFileSync(file, data);
+
+var tcpReceived = null;
+var rangeReceived = null;
+var httpReceived = null;
+
+function collect(stream, cb) {
+  var chunks = [];
+  stream.on('data', function(chunk) {
+    chunks.push(chunk);
+  });
+  stream.on('end', function() {
+    cb(Buffer.concat(chunks));
+  });
+}
+
+// Whole file and a byte range to a socket.
+var server = net.createServer(function(socket) {
+  socket.once('data', function(what) {
+    var options = what.toString() === 'range' ? { start: START, end: END } : {};
+    var stream = fs.createReadStream(file, options);
+    stream.on('data', assert.fail);
+    stream.pipe(socket);
+  });
+});
+
+server.listen(common.PORT, function() {
+  var whole = net.connect(common.PORT, function() {
+    whole.write('whole');
+  });
+  collect(whole, function(received) {
+    tcpReceived = received;
+
+    var range = net.connect(common.PORT, function() {
+      range.write('range');
+    });
+    collect(range, function(received) {
+      rangeReceived = received;
+      server.close();
+      testHttp();
+    });
+  });
+});
+
+// A response with a Content-Length, followed by a second one on the same
+// connection to see that it's still in a good state afterwards.
+function testHttp() {
+  var httpServer = http.createServer(function(req, res) {
+    if (req.url === '/file') {
+      res.writeHead(200, { 'Content-Length': SIZE });
+      fs.createReadStream(file).pipe(res);
+    } else {
+      res.end('after');
+    }
+  });
+
+  httpServer.listen(common.PORT, function() {
+    // One socket, the second request waits for the first response.
+    var agent = new http.Agent({ maxSockets: 1 });
+
+    http.get({ port: common.PORT, path: '/file', agent: agent }, function(res) {
+      collect(res, function(received) {
+        httpReceived = received;
+      });
+    });
+
+    http.get({ port: common.PORT, path: '/after', agent: agent },
+             function(res) {
+      collect(res, function(received) {
+        assert.equal(received.toString(), 'after');
+        httpServer.close();
+      });
+    });
+  });
+}
+
+process.on('exit', function() {
+  assert.deepEqual(tcpReceived, data);
+  assert.deepEqual(rangeReceived, data.slice(START, END + 1));
+  assert.deepEqual(httpReceived, data);
+  fs.unlinkSync(file);
+});
@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var binding = process.binding('http_parser');
+var writeHeaderBlock = binding.writeHeaderBlock;
+
+var firstLine = 'HTTP/1.1 200 OK\r\n';
+var result = [0];
+
+function write(headers, sendDate) {
+  var keys = headers ? Object.keys(headers) : [];
+  return writeHeaderBlock(firstLine, headers, keys, Array.isArray(headers),
+                          !!sendDate, result);
+}
+
+// Plain headers, values of any primitive type.
+assert.equal(write({ 'Content-Type': 'text/plain', 'X-Count': 42,
+                     'X-Undefined': undefined }),
+             firstLine +
+             'Content-Type: text/plain\r\n' +
+             'X-Count: 42\r\n' +
+             'X-Undefined: undefined\r\n');
+assert.equal(result[0], 0);
+
+// Arrays of values and arrays of pairs.
+assert.equal(write({ 'Set-Cookie': ['a=1', 'b=2'] }),
+             firstLine + 'Set-Cookie: a=1\r\nSet-Cookie: b=2\r\n');
+assert.equal(write([['Set-Cookie', 'a=1'], ['Set-Cookie', 'b=2']]),
+             firstLine + 'Set-Cookie: a=1\r\nSet-Cookie: b=2\r\n');
+
+// No response splitting.
+assert.equal(write({ 'X-Evil': 'a\r\n \tSet-Cookie: evil=1\nb' }),
+             firstLine + 'X-Evil: aSet-Cookie: evil=1b\r\n');
+
+// Flags, matched anywhere in the name like the regular expressions in
+// lib/_http_outgoing.js.
+write({ 'connection': 'Close' });
+assert.equal(result[0], binding.kSentConnection | binding.kSetLast);
+write({ 'Proxy-Connection': 'keep-alive' });
+assert.equal(result[0], binding.kSentConnection | binding.kSetKeepAlive);
+write({ 'Transfer-Encoding': 'chunked', 'Content-Length': 0 });
+assert.equal(result[0], binding.kSentTransferEncoding | binding.kSetChunked |
+                        binding.kSentContentLength);
+write({ 'Last-Updated': 'yesterday', 'Expect': '100-continue' });
+assert.equal(result[0], binding.kSentDate | binding.kSentExpect);
+
+// Date header, unless there is one already.
+var block = write({}, true);
+var m = /^Date: (.*)\r\n$/.exec(block.slice(firstLine.length));
+assert(m);
+var now = Date.now();
+assert(Math.abs(Date.parse(m[1]) - now) < 2000);
+assert.equal(new Date(Date.parse(m[1])).toUTCString(), m[1]);
+assert.equal(write({ 'Date': 'then' }, true),
+             firstLine + 'Date: then\r\n');
+
+// Left to the JS version: non-ASCII and objects.
+assert.strictEqual(write({ 'X-Name': 'café' }), undefined);
+assert.strictEqual(write({ 'X-Name': '☃' }), undefined);
+assert.strictEqual(write({ 'X-Object': { toString: function() {
+  return 'x';
+} } }), undefined);
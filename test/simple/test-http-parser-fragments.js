@@ -0,0 +1,116 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Feeds requests to the parser in random-sized fragments and checks that
+// the URL, headers and body come out the same as when the request is
+// parsed in one piece.
+
+var common = require('../common');
+var assert = require('assert');
+
+var HTTPParser = process.binding('http_parser').HTTPParser;
+
+var CRLF = '\r\n';
+var ITERATIONS = 500;
+
+function randomString(len) {
+  var chars = 'abcdefghijklmnopqrstuvwxyz0123456789-';
+  var s = '';
+  for (var i = 0; i < len; i++)
+    s += chars[Math.floor(Math.random() * chars.length)];
+  return s;
+}
+
+function randomRequest() {
+  // More than 32 headers sometimes, so that onHeaders gets called
+  // in the middle of them.
+  var nheaders = Math.floor(Math.random() * 48);
+  var lines = ['POST /' + randomString(Math.random() * 200) + ' HTTP/1.1'];
+  for (var i = 0; i < nheaders; i++) {
+    lines.push('X-' + randomString(1 + Math.random() * 30) + ': ' +
+               randomString(Math.random() * 100));
+  }
+  lines.push('Content-Length: 5');
+  return new Buffer(lines.join(CRLF) + CRLF + CRLF + 'hello');
+}
+
+function parse(buf, fragments, headersObject) {
+  var parser = new HTTPParser(HTTPParser.REQUEST, headersObject);
+  var result = { url: '', headers: [], body: '' };
+
+  parser.onHeaders = function(headers, url) {
+    result.headers = result.headers.concat(headers);
+    result.url += url;
+  };
+
+  parser.onHeadersComplete = function(info) {
+    if (info.url)
+      result.url = info.url;
+    if (info.headers)
+      result.headers = info.headers;
+  };
+
+  parser.onBody = function(b, start, len) {
+    result.body += b.toString('utf8', start, start + len);
+  };
+
+  var off = 0;
+  fragments.forEach(function(len) {
+    // A copy, so that nothing can point into a buffer after the call.
+    var chunk = new Buffer(len);
+    buf.copy(chunk, 0, off, off + len);
+    var ret = parser.execute(chunk, 0, len);
+    assert.equal(ret, len);
+    chunk.fill(0);
+    off += len;
+  });
+
+  return result;
+}
+
+function randomFragments(len) {
+  var fragments = [];
+  while (len > 0) {
+    var n = 1 + Math.floor(Math.random() * Math.min(len, 64));
+    fragments.push(n);
+    len -= n;
+  }
+  return fragments;
+}
+
+for (var i = 0; i < ITERATIONS; i++) {
+  var buf = randomRequest();
+  var fragments = randomFragments(buf.length);
+  var headersObject = i % 2 === 0;
+
+  var expected = parse(buf, [buf.length], headersObject);
+  var actual = parse(buf, fragments, headersObject);
+
+  assert.deepEqual(actual, expected,
+                   'fragments ' + JSON.stringify(fragments) + ' of ' + buf);
+}
+
+// A byte at a time.
+var buf = randomRequest();
+var ones = [];
+for (var i = 0; i < buf.length; i++)
+  ones.push(1);
+assert.deepEqual(parse(buf, ones, false), parse(buf, [buf.length], false));
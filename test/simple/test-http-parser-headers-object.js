@@ -0,0 +1,133 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+
+var HTTPParser = process.binding('http_parser').HTTPParser;
+
+var CRLF = '\r\n';
+
+function parse(request, maxHeaderPairs) {
+  var parser = new HTTPParser(HTTPParser.REQUEST, true);
+  var result = null;
+
+  parser.maxHeaderPairs = maxHeaderPairs;
+  parser.onHeadersComplete = function(info) {
+    result = info.headers;
+  };
+
+  var buf = new Buffer(request.join(CRLF) + CRLF + CRLF);
+  assert.equal(parser.execute(buf, 0, buf.length), buf.length);
+  return result;
+}
+
+var request = [
+  'GET / HTTP/1.1',
+  'Host: example.com',
+  'ACCEPT: text/html',
+  'Accept: text/plain',
+  'Set-Cookie: a=1',
+  'set-cookie: b=2',
+  'X-Custom-Thing: 1',
+  'x-custom-thing: 2',
+  'Content-Type: text/plain',
+  'content-type: text/html',
+  'Some-Other-Header: yes'
+];
+
+// Lowercase names, merged the way IncomingMessage#_addHeaderLine does it.
+var expected = {
+  'host': 'example.com',
+  'accept': 'text/html, text/plain',
+  'set-cookie': ['a=1', 'b=2'],
+  'x-custom-thing': '1, 2',
+  'content-type': 'text/plain',
+  'some-other-header': 'yes'
+};
+
+var headers = parse(request, 2000);
+assert(!Array.isArray(headers));
+assert.deepEqual(headers, expected);
+
+// Unlimited.
+assert.deepEqual(parse(request, 0), expected);
+
+// maxHeaderPairs counts names and values, like parserOnHeadersComplete.
+assert.deepEqual(parse(request, 4), {
+  'host': 'example.com',
+  'accept': 'text/html'
+});
+assert.deepEqual(parse(request, 5), {
+  'host': 'example.com',
+  'accept': 'text/html, text/plain'
+});
+
+// Without headersObject the parser still hands out names and values as
+// they came in.
+var parser = new HTTPParser(HTTPParser.REQUEST);
+parser.onHeadersComplete = function(info) {
+  assert.deepEqual(info.headers, ['Host', 'example.com', 'ACCEPT', 'a']);
+};
+var buf = new Buffer(['GET / HTTP/1.1', 'Host: example.com', 'ACCEPT: a']
+                     .join(CRLF) + CRLF + CRLF);
+parser.execute(buf, 0, buf.length);
+
+// And the same through http, in one piece and split up so that the headers
+// take the onHeaders path.
+var server = http.createServer(function(req, res) {
+  assert.deepEqual(req.headers, expected);
+  res.end();
+});
+
+var requests = 0;
+
+server.listen(common.PORT, function() {
+  var raw = request.join(CRLF) + CRLF + CRLF;
+  send([raw], function() {
+    var half = raw.length >> 1;
+    send([raw.slice(0, half), raw.slice(half)], function() {
+      server.close();
+    });
+  });
+});
+
+function send(chunks, cb) {
+  var socket = require('net').connect(common.PORT, function() {
+    chunks.forEach(function(chunk, i) {
+      setTimeout(function() {
+        socket.write(chunk);
+      }, i * 50);
+    });
+  });
+  socket.setEncoding('utf8');
+  socket.on('data', function(data) {
+    assert(/^HTTP\/1\.1 200/.test(data));
+    requests++;
+    socket.end();
+    cb();
+  });
+}
+
+process.on('exit', function() {
+  assert.equal(requests, 2);
+});
@@ -0,0 +1,144 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var HTTPParser = process.binding('http_parser').HTTPParser;
+
+var CRLF = '\r\n';
+
+// Binding: one onBatch call for everything in the buffer, nothing else.
+(function() {
+  var raw = 'GET /a HTTP/1.1' + CRLF + CRLF +
+            'POST /b HTTP/1.1' + CRLF +
+            'Content-Length: 5' + CRLF + CRLF +
+            'hello' +
+            'GET /c HTTP/1.1' + CRLF;
+  var buf = new Buffer(raw);
+  var parser = new HTTPParser(HTTPParser.REQUEST);
+  var calls = 0;
+
+  function unexpected() {
+    assert(false, 'Only onBatch should be called');
+  }
+  parser.onHeadersComplete = unexpected;
+  parser.onBody = unexpected;
+  parser.onMessageComplete = unexpected;
+
+  parser.onBatch = function(b, entries, count) {
+    calls++;
+    assert.strictEqual(b, buf);
+    assert.equal(count, 9);
+    entries = entries.slice(0, count);
+
+    assert.equal(entries[0], HTTPParser.kOnHeadersComplete);
+    assert.equal(entries[1].url, '/a');
+    assert.equal(entries[2], HTTPParser.kOnMessageComplete);
+    assert.equal(entries[3], HTTPParser.kOnHeadersComplete);
+    assert.equal(entries[4].url, '/b');
+    assert.equal(entries[5], HTTPParser.kOnBody);
+    assert.equal(b.toString('ascii', entries[6], entries[6] + entries[7]),
+                 'hello');
+    assert.equal(entries[8], HTTPParser.kOnMessageComplete);
+  };
+
+  assert.equal(parser.execute(buf, 0, buf.length), buf.length);
+  assert.equal(calls, 1);
+
+  // The rest of the third request.
+  parser.onBatch = function(b, entries, count) {
+    calls++;
+    assert.equal(count, 3);
+    assert.equal(entries[0], HTTPParser.kOnHeadersComplete);
+    assert.equal(entries[1].url, '/c');
+    assert.equal(entries[2], HTTPParser.kOnMessageComplete);
+  };
+  buf = new Buffer(CRLF);
+  assert.equal(parser.execute(buf, 0, buf.length), buf.length);
+  assert.equal(calls, 2);
+
+  // Response parsers ignore onBatch.
+  parser = new HTTPParser(HTTPParser.RESPONSE);
+  parser.onBatch = unexpected;
+  parser.onHeadersComplete = function() {
+    calls++;
+  };
+  buf = new Buffer('HTTP/1.1 200 OK' + CRLF + CRLF);
+  parser.execute(buf, 0, buf.length);
+  assert.equal(calls, 3);
+})();
+
+// Server: pipelined requests with bodies, answered in order.
+var N = 20;
+var received = [];
+
+var server = http.createServer(function(req, res) {
+  var body = '';
+  req.setEncoding('utf8');
+  req.on('data', function(chunk) {
+    body += chunk;
+  });
+  req.on('end', function() {
+    received.push(req.url);
+    res.end(req.url + ':' + body);
+  });
+});
+
+server.listen(common.PORT, function() {
+  var raw = '';
+  for (var i = 0; i < N; i++) {
+    if (i % 2) {
+      raw += 'POST /' + i + ' HTTP/1.1' + CRLF +
+             'Content-Length: ' + String(i).length + CRLF + CRLF + i;
+    } else {
+      raw += 'POST /' + i + ' HTTP/1.1' + CRLF +
+             'Transfer-Encoding: chunked' + CRLF + CRLF +
+             String(i).length.toString(16) + CRLF + i + CRLF +
+             '0' + CRLF + CRLF;
+    }
+  }
+  raw += 'GET /last HTTP/1.1' + CRLF + 'Connection: close' + CRLF + CRLF;
+
+  var response = '';
+  var socket = net.connect(common.PORT, function() {
+    socket.write(raw);
+  });
+  socket.setEncoding('utf8');
+  socket.on('data', function(chunk) {
+    response += chunk;
+  });
+  socket.on('end', function() {
+    var bodies = response.match(/\/\w+:\w*/g);
+    var expected = [];
+    for (var i = 0; i < N; i++)
+      expected.push('/' + i + ':' + i);
+    expected.push('/last:');
+    assert.deepEqual(bodies, expected);
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(received.length, N + 1);
+});
@@ -0,0 +1,62 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Returning false from the setReadBuffer() callback stops reading, and
+// socket.read(0) starts it again.
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var ring = new Buffer(8192);
+var received = '';
+var pauses = 0;
+var expected = new Array(64 * 1024 + 1).join('x');
+
+var server = net.createServer(function(socket) {
+  socket.setReadBuffer(ring, function(offset, length) {
+    received += ring.toString('ascii', offset, offset + length);
+    pauses++;
+    setTimeout(function() {
+      socket.read(0);
+    }, 1);
+    return false;
+  });
+
+  socket.on('end', function() {
+    socket.end();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.connect(common.PORT, function() {
+    client.end(expected);
+  });
+
+  client.on('end', function() {
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(received, expected);
+  assert.ok(pauses > 1);
+});
@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose_gc
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var getPoolStats = process.binding('buffer').getPoolStats;
+
+var COUNT = 20;
+var chunks = [];
+var before = getPoolStats();
+
+var server = net.createServer(function(socket) {
+  socket.on('data', function(chunk) {
+    chunks.push(chunk);
+    if (chunks.join('').length === COUNT * 5)
+      socket.end();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.connect(common.PORT, function() {
+    // One write per tick so the server sees a bunch of small reads.
+    var n = 0;
+    (function write() {
+      client.write('hello');
+      if (++n < COUNT)
+        setImmediate(write);
+    })();
+  });
+
+  client.on('end', function() {
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(chunks.join(''), new Array(COUNT + 1).join('hello'));
+
+  var stats = getPoolStats();
+
+  // Small reads are moved out of the 64 kB read buffers.
+  assert.ok(stats.copied - before.copied >= COUNT * 5);
+  assert.ok(stats.pinned > before.pinned);
+  assert.ok(stats.waste < stats.pinned);
+  assert.ok(stats.pinned < COUNT * 64 * 1024);
+  assert.equal(stats.reading, 0);
+
+  chunks = null;
+  gc();
+
+  // The blocks went back to the pool when the buffers were collected.
+  var after = getPoolStats();
+  assert.ok(after.pinned < stats.pinned);
+  assert.ok(after.retained >= stats.retained);
+});
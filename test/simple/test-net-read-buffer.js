@@ -0,0 +1,82 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var COUNT = 100;
+var ring = new Buffer(8192);
+var received = [];
+var reads = 0;
+var dataEvents = 0;
+
+var server = net.createServer(function(socket) {
+  socket.setReadBuffer(ring, function(offset, length) {
+    assert.ok(offset + length <= ring.length);
+    received.push(ring.toString('utf8', offset, offset + length));
+    reads++;
+  });
+
+  socket.on('data', function() {
+    dataEvents++;
+  });
+
+  socket.on('end', function() {
+    socket.end();
+  });
+});
+
+server.listen(common.PORT, function() {
+  var client = net.connect(common.PORT, function() {
+    var n = 0;
+    (function write() {
+      client.write(new Array(101).join(String(n % 10)));
+      if (++n < COUNT)
+        setImmediate(write);
+      else
+        client.end();
+    })();
+  });
+
+  client.on('end', function() {
+    server.close();
+  });
+});
+
+assert.throws(function() {
+  new net.Socket().setReadBuffer('not a buffer', function() {});
+}, TypeError);
+
+assert.throws(function() {
+  new net.Socket().setReadBuffer(ring);
+}, TypeError);
+
+process.on('exit', function() {
+  var expected = '';
+  for (var i = 0; i < COUNT; i++)
+    expected += new Array(101).join(String(i % 10));
+
+  assert.equal(received.join(''), expected);
+  assert.ok(reads > 0);
+  assert.equal(dataEvents, 0);
+});
@@ -0,0 +1,138 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+var common = require('../common');
+var assert = require('assert');
+var net = require('net');
+
+var SIZE = 4 * 1024 * 1024;
+var BACKEND_PORT = common.PORT + 1;
+
+var payload = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++)
+  payload[i] = i % 251;
+
+var spliced = [];
+var received = [];
+var receivedBytes = 0;
+
+// Echoes everything back.
+var backend = net.createServer({ allowHalfOpen: true }, function(socket) {
+  socket.pipe(socket);
+});
+
+// Proxies between the client and the backend without reading the data.
+var proxy = net.createServer(function(socket) {
+  var upstream = net.connect(BACKEND_PORT);
+
+  socket.on('data', assert.fail);
+  upstream.on('data', assert.fail);
+
+  socket.splice(upstream, function(err, bytes) {
+    assert.ifError(err);
+    spliced.push(bytes);
+  });
+
+  upstream.splice(socket, function(err, bytes) {
+    assert.ifError(err);
+    spliced.push(bytes);
+  });
+});
+
+backend.listen(BACKEND_PORT, function() {
+  proxy.listen(common.PORT, function() {
+    var client = net.connect(common.PORT, function() {
+      client.end(payload);
+    });
+
+    client.on('data', function(chunk) {
+      received.push(chunk);
+      receivedBytes += chunk.length;
+    });
+
+    client.on('end', function() {
+      proxy.close();
+      backend.close();
+    });
+  });
+});
+
+assert.throws(function() {
+  new net.Socket().splice({});
+}, TypeError);
+
+assert.throws(function() {
+  new net.Socket().splice(new net.Socket(), 'not a function');
+}, TypeError);
+
+// After unsplice() the source is read from JS again.
+var SINK_PORT = common.PORT + 2;
+var UNSPLICE_PORT = common.PORT + 3;
+var unspliceClient = null;
+var unspliceSource = null;
+var unspliced = null;
+var afterUnsplice = '';
+
+var sink = net.createServer(function(socket) {
+  var seen = '';
+  socket.on('data', function(chunk) {
+    seen += chunk;
+    if (seen === 'spliced') unspliceSource.unsplice();
+  });
+});
+
+var unspliceServer = net.createServer(function(socket) {
+  unspliceSource = socket;
+  var upstream = net.connect(SINK_PORT, function() {
+    socket.splice(upstream, function(err, bytes) {
+      assert.ifError(err);
+      unspliced = bytes;
+      unspliceClient.end('read');
+    });
+    unspliceClient.write('spliced');
+  });
+
+  socket.on('data', function(chunk) {
+    assert.notEqual(unspliced, null);
+    afterUnsplice += chunk;
+  });
+
+  socket.on('end', function() {
+    upstream.end();
+    sink.close();
+    unspliceServer.close();
+  });
+});
+
+sink.listen(SINK_PORT, function() {
+  unspliceServer.listen(UNSPLICE_PORT, function() {
+    unspliceClient = net.connect(UNSPLICE_PORT);
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(unspliced, 'spliced'.length);
+  assert.equal(afterUnsplice, 'read');
+  assert.equal(receivedBytes, SIZE);
+  assert.deepEqual(Buffer.concat(received, receivedBytes), payload);
+  assert.deepEqual(spliced, [SIZE, SIZE]);
+});
@@ -0,0 +1,69 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var zlib = require('zlib');
+
+var binding = process.binding('threadpool');
+
+binding.resetStats();
+assert.deepEqual(binding.getStats(), {});
+
+assert.ok(binding.getSize(binding.UV_THREADPOOL_IO) > 0);
+assert.ok(binding.getSize(binding.UV_THREADPOOL_CPU) > 0);
+
+binding.setSize(binding.UV_THREADPOOL_CPU, 2);
+assert.equal(binding.getSize(binding.UV_THREADPOOL_CPU), 2);
+
+assert.throws(function() {
+  binding.setSize(binding.UV_THREADPOOL_CPU, 0);
+}, /EINVAL/);
+
+function checkHistogram(h, count) {
+  assert.equal(typeof h.sum, 'number');
+  assert.equal(typeof h.max, 'number');
+  assert.ok(h.max <= h.sum);
+  assert.equal(h.buckets.reduce(function(a, b) { return a + b; }), count);
+}
+
+fs.stat(__filename, function(err) {
+  assert.ifError(err);
+
+  zlib.deflate(new Buffer('hello world'), function(err) {
+    assert.ifError(err);
+
+    var stats = binding.getStats();
+    assert.equal(stats['fs.stat'].count, 1);
+    assert.ok(stats.zlib.count >= 1);
+
+    ['fs.stat', 'zlib'].forEach(function(kind) {
+      var s = stats[kind];
+      checkHistogram(s.queue, s.count);
+      checkHistogram(s.run, s.count);
+      checkHistogram(s.done, s.count);
+    });
+
+    binding.resetStats();
+    assert.deepEqual(binding.getStats(), {});
+  });
+});
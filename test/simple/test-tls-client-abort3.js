@@ -26,6 +26,7 @@ if (!process.versions.openssl) {
 
 var common = require('../common');
 var common = require('../common');
+var net = require('net');
 var tls = require('tls');
 var fs = require('fs');
 var assert = require('assert');
@@ -49,7 +50,11 @@ var server = tls.createServer(options, function(c) {
     server.close();
   });
 }).listen(common.PORT, function() {
-  var c = tls.connect(common.PORT, { rejectUnauthorized: false }, function() {
+  // Given a socket tls.connect() uses a SecurePair, which this is about.
+  var c = tls.connect({
+    socket: net.connect(common.PORT),
+    rejectUnauthorized: false
+  }, function() {
     connected++;
     c.pair.ssl.shutdown();
     c.write('123');
@@ -0,0 +1,102 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+// Connections without a SecurePair: the data is encrypted underneath the
+// net.Socket and only cleartext reaches JS.
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var net = require('net');
+var fs = require('fs');
+
+var options = {
+  key: fs.readFileSync(common.fixturesDir + '/keys/agent1-key.pem'),
+  cert: fs.readFileSync(common.fixturesDir + '/keys/agent1-cert.pem')
+};
+
+// Big enough to need several TLS records and several reads.
+var payload = new Buffer(1024 * 1024);
+for (var i = 0; i < payload.length; i++)
+  payload[i] = i % 251;
+
+var serverConnected = 0;
+var serverReceived = 0;
+var clientReceived = 0;
+var clientClosed = false;
+
+var server = tls.createServer(options, function(socket) {
+  serverConnected++;
+  assert(socket instanceof tls.TLSSocket);
+  assert(socket instanceof net.Socket);
+  assert.equal(socket.authorized, false);
+  assert(socket.getCipher().name);
+
+  // Echo everything back.
+  socket.on('data', function(chunk) {
+    serverReceived += chunk.length;
+  });
+  socket.pipe(socket);
+});
+
+server.listen(common.PORT, function() {
+  var chunks = [];
+
+  var client = tls.connect({
+    port: common.PORT,
+    rejectUnauthorized: false
+  }, function() {
+    assert(client.getPeerCertificate().subject);
+    assert.equal(client.isSessionReused(), false);
+    assert(client.getSession());
+
+    // The rest goes out after the handshake.
+    client.end(payload.slice(1024));
+  });
+
+  assert(client instanceof tls.TLSSocket);
+
+  // Written before the connection is even made.
+  client.write(payload.slice(0, 1024));
+
+  client.on('data', function(chunk) {
+    clientReceived += chunk.length;
+    chunks.push(chunk);
+  });
+
+  client.on('close', function() {
+    clientClosed = true;
+    assert.deepEqual(Buffer.concat(chunks), payload);
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(serverConnected, 1);
+  assert.equal(serverReceived, payload.length);
+  assert.equal(clientReceived, payload.length);
+  assert(clientClosed);
+});
@@ -0,0 +1,105 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Handshakes on the thread pool: the SNI context is picked up front, the
+// session resumes from the cache and data goes both ways afterwards.
+
+if (!process.features.tls_sni) {
+  console.error('Skipping because node compiled without OpenSSL or ' +
+                'with old OpenSSL version.');
+  process.exit(0);
+}
+
+var common = require('../common');
+var assert = require('assert');
+var crypto = require('crypto');
+var fs = require('fs');
+var tls = require('tls');
+
+function loadPEM(n) {
+  return fs.readFileSync(common.fixturesDir + '/keys/' + n + '.pem');
+}
+
+var sniContext = crypto.createCredentials({
+  key: loadPEM('agent1-key'),
+  cert: loadPEM('agent1-cert')
+}).context;
+
+var servernames = [];
+var received = [];
+
+var server = tls.createServer({
+  key: loadPEM('agent2-key'),
+  cert: loadPEM('agent2-cert'),
+  offloadHandshake: true,
+  SNICallback: function(servername) {
+    servernames.push(servername);
+    if (servername === 'a.example.com') return sniContext;
+  }
+}, function(socket) {
+  socket.setEncoding('utf8');
+  socket.on('data', function(data) {
+    socket.end(data.toUpperCase());
+  });
+});
+
+function connect(options, cb) {
+  options.port = common.PORT;
+  options.rejectUnauthorized = false;
+
+  var client = tls.connect(options, function() {
+    client.cn = client.getPeerCertificate().subject.CN;
+    client.reused = client.isSessionReused();
+    client.session = client.getSession();
+    client.write('hello');
+  });
+
+  client.setEncoding('utf8');
+  client.on('data', function(data) {
+    received.push(data);
+  });
+  client.on('close', function() {
+    cb(client);
+  });
+}
+
+server.listen(common.PORT, function() {
+  connect({ servername: 'a.example.com' }, function(client1) {
+    assert.equal(client1.cn, 'agent1');
+    var session = client1.session;
+
+    connect({ servername: 'b.example.com' }, function(client2) {
+      assert.equal(client2.cn, 'agent2');
+
+      connect({ servername: 'a.example.com', session: session },
+              function(client3) {
+        assert.ok(client3.reused);
+        server.close();
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.deepEqual(servernames,
+                   ['a.example.com', 'b.example.com', 'a.example.com']);
+  assert.deepEqual(received, ['HELLO', 'HELLO', 'HELLO']);
+});
@@ -0,0 +1,98 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Resume a session from the server's built-in cache and another one from
+// a session ticket, check that getSessionStats() counts both.
+
+if (!process.versions.openssl) {
+  console.error('Skipping because node compiled without OpenSSL.');
+  process.exit(0);
+}
+
+var common = require('../common');
+var assert = require('assert');
+var tls = require('tls');
+var fs = require('fs');
+var constants = require('constants');
+
+var key = fs.readFileSync(common.fixturesDir + '/keys/agent2-key.pem');
+var cert = fs.readFileSync(common.fixturesDir + '/keys/agent2-cert.pem');
+
+function resume(options, cb) {
+  var server = tls.createServer(options, function(socket) {
+    socket.end('Goodbye');
+  });
+
+  server.listen(common.PORT, function() {
+    var client1 = tls.connect({
+      port: common.PORT,
+      rejectUnauthorized: false
+    }, function() {
+      assert.ok(!client1.isSessionReused());
+      var session = client1.getSession();
+
+      client1.on('close', function() {
+        var client2 = tls.connect({
+          port: common.PORT,
+          rejectUnauthorized: false,
+          session: session
+        }, function() {
+          assert.ok(client2.isSessionReused());
+        });
+
+        client2.on('close', function() {
+          server.close();
+          cb(server.getSessionStats());
+        });
+      });
+    });
+  });
+}
+
+var done = 0;
+
+// Session ids only.
+resume({
+  key: key,
+  cert: cert,
+  secureOptions: constants.SSL_OP_NO_TICKET
+}, function(stats) {
+  assert.equal(stats.size, 1);
+  assert.equal(stats.hits, 1);
+  assert.equal(stats.misses, 0);
+  assert.equal(stats.ticketHits, 0);
+
+  // Tickets with keys that the server rotates itself.
+  resume({
+    key: key,
+    cert: cert,
+    ticketKeyRotation: 60 * 1000
+  }, function(stats) {
+    assert.equal(stats.ticketHits, 1);
+    assert.equal(stats.ticketMisses, 0);
+    assert.equal(stats.hits, 0);
+    done++;
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(done, 1);
+});
@@ -0,0 +1,119 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// brotli round trips through the one-shot and stream APIs, option
+// validation and errors on corrupt input.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+
+// The brotli options don't concern the other streams, with or without
+// brotli compiled in.
+var unrelated = { mode: 'text', quality: 99, lgwin: 1 };
+zlib.createDeflate(unrelated);
+zlib.createInflate(unrelated);
+zlib.createGunzip(unrelated);
+var gzipped = [];
+var gzip = zlib.createGzip(unrelated);
+gzip.on('data', function(c) {
+  gzipped.push(c);
+});
+gzip.on('end', function() {
+  zlib.gunzip(Buffer.concat(gzipped), function(err, data) {
+    if (err) throw err;
+    assert.equal(data.toString(), 'not brotli');
+  });
+});
+gzip.end('not brotli');
+
+if (zlib.BROTLI_ENCODE === undefined) {
+  assert.throws(function() {
+    zlib.createBrotliCompress();
+  }, /brotli support not compiled in/);
+  console.error('Skipping because node compiled without brotli.');
+  process.exit(0);
+}
+
+var input = new Buffer(new Array(2000).join('brotli compresses text well. '));
+
+assert.throws(function() {
+  zlib.createBrotliCompress({ quality: zlib.BROTLI_MAX_QUALITY + 1 });
+}, /Invalid quality/);
+
+assert.throws(function() {
+  zlib.createBrotliCompress({ lgwin: zlib.BROTLI_MAX_WINDOW_BITS + 1 });
+}, /Invalid lgwin/);
+
+var roundTrips = 0;
+var corruptErrors = 0;
+var streamed = false;
+
+// one-shot, at a couple of qualities and modes.
+[
+  { quality: 0 },
+  { quality: 5, mode: zlib.BROTLI_MODE_TEXT },
+  {}
+].forEach(function(opts) {
+  zlib.brotliCompress(input, opts, function(err, compressed) {
+    if (err) throw err;
+    assert(compressed.length < input.length / 10);
+    zlib.brotliDecompress(compressed, function(err, output) {
+      if (err) throw err;
+      assert.equal(output.toString(), input.toString());
+      roundTrips++;
+    });
+  });
+});
+
+// streaming, in small writes with a flush in between.
+var compress = zlib.createBrotliCompress({ quality: 4 });
+var decompress = zlib.createBrotliDecompress();
+var out = [];
+
+compress.pipe(decompress);
+decompress.on('data', function(chunk) {
+  out.push(chunk);
+});
+decompress.on('end', function() {
+  assert.equal(Buffer.concat(out).toString(), input.toString());
+  streamed = true;
+});
+
+compress.write(input.slice(0, 100));
+compress.flush(function() {
+  for (var i = 100; i < input.length; i += 1000)
+    compress.write(input.slice(i, i + 1000));
+  compress.end();
+});
+
+// corrupt input is reported as an error.
+zlib.brotliDecompress(new Buffer('this is not brotli'), function(err) {
+  assert(err);
+  assert.equal(err.code, 'Z_DATA_ERROR');
+  corruptErrors++;
+});
+
+process.on('exit', function() {
+  assert.equal(roundTrips, 3);
+  assert.equal(corruptErrors, 1);
+  assert(streamed);
+});
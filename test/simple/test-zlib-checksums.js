@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The CRC-32 (gzip) and Adler-32 (deflate) of the data are checked on the
+// way back in. Use lengths and offsets on both sides of the block sizes of
+// the SIMD checksum code.
+
+var common = require('../common.js');
+var assert = require('assert');
+var zlib = require('zlib');
+
+var input = new Buffer(128 * 1024 + 100);
+for (var i = 0; i < input.length; i++)
+  input[i] = i % 5 ? (i * 131) & 0xff : 0xff;
+
+var lengths = [0, 1, 15, 16, 31, 32, 33, 63, 64, 65, 127, 128, 129,
+               5552, 5553, 65536, input.length - 3];
+var offsets = [0, 1, 3];
+var pending = 0;
+
+lengths.forEach(function(len) {
+  offsets.forEach(function(off) {
+    var data = input.slice(off, off + len);
+    ['gzip', 'deflate'].forEach(function(method) {
+      var inverse = method === 'gzip' ? 'gunzip' : 'inflate';
+      pending++;
+      zlib[method](data, function(err, compressed) {
+        if (err) throw err;
+        zlib[inverse](compressed, function(err, result) {
+          if (err) throw err;
+          assert.equal(result.toString('hex'), data.toString('hex'));
+
+          // flip one bit of the checksum, which trails the data.
+          var bad = new Buffer(compressed);
+          bad[bad.length - (method === 'gzip' ? 8 : 1)] ^= 1;
+          zlib[inverse](bad, function(err) {
+            assert(err, method + ' checksum not checked, length ' + len);
+            pending--;
+          });
+        });
+      });
+    });
+  });
+});
+
+process.on('exit', function() {
+  assert.equal(pending, 0);
+});
@@ -0,0 +1,113 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Small chunks are compressed on the main thread, and closed streams hand
+// their z_stream back for reuse. Neither should be observable.
+
+var common = require('../common.js');
+var assert = require('assert');
+var zlib = require('zlib');
+
+assert.equal(zlib.Z_DEFAULT_INLINE_THRESHOLD, 1024);
+
+assert.throws(function() {
+  zlib.createGzip({ inlineThreshold: -1 });
+}, /Invalid inlineThreshold/);
+
+assert.throws(function() {
+  zlib.createGzip({ inlineThreshold: '1024' });
+}, /Invalid inlineThreshold/);
+
+var input = new Buffer(70 * 1024);
+for (var i = 0; i < input.length; i++)
+  input[i] = (i * 7) % 61 + 32;
+
+var sizes = [0, 1, 300, 1023, 1024, 1025, 16 * 1024, input.length];
+var thresholds = [0, 1024, Infinity];
+var levels = [1, 9];
+
+var pending = 0;
+var checked = 0;
+
+sizes.forEach(function(size) {
+  var data = input.slice(0, size);
+  thresholds.forEach(function(threshold) {
+    levels.forEach(function(level) {
+      var opts = { level: level, inlineThreshold: threshold };
+      // compress twice so that the second one runs on a recycled context,
+      // it has to come out byte for byte the same.
+      gzip(data, opts, function(first) {
+        gzip(data, opts, function(second) {
+          assert.equal(first.toString('hex'), second.toString('hex'));
+          pending++;
+          zlib.gunzip(first, opts, function(err, result) {
+            if (err) throw err;
+            assert.equal(result.toString(), data.toString());
+            checked++;
+          });
+        });
+      });
+    });
+  });
+});
+
+function gzip(data, opts, cb) {
+  zlib.gzip(data, opts, function(err, result) {
+    if (err) throw err;
+    cb(result);
+  });
+}
+
+// Output bigger than chunkSize has to be drained over several inline
+// writes within the same chunk.
+zlib.deflate(input, function(err, compressed) {
+  if (err) throw err;
+  assert(compressed.length <= 1024);
+  var inflate = zlib.createInflate({ chunkSize: 64 });
+  var out = [];
+  inflate.on('data', function(c) {
+    assert(c.length <= 64);
+    out.push(c);
+  });
+  inflate.on('end', function() {
+    assert.equal(Buffer.concat(out).toString(), input.toString());
+    checked++;
+  });
+  inflate.end(compressed);
+});
+
+// An inline write that fails must not throw at the caller, the error is
+// emitted afterwards.
+var hadError = false;
+var gunzip = zlib.createGunzip();
+assert.doesNotThrow(function() {
+  gunzip.write(new Buffer('this is not gzip data'));
+});
+gunzip.on('error', function(er) {
+  assert.equal(er.code, 'Z_DATA_ERROR');
+  hadError = true;
+});
+
+process.on('exit', function() {
+  assert.equal(checked, pending + 1);
+  assert.equal(pending, sizes.length * thresholds.length * levels.length);
+  assert(hadError);
+});
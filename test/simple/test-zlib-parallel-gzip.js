@@ -0,0 +1,134 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// ParallelGzip output has to be a single plain gzip member.
+
+var common = require('../common.js');
+var assert = require('assert');
+var zlib = require('zlib');
+
+assert.throws(function() {
+  zlib.createParallelGzip({ blockSize: 1024 });
+}, /Invalid block size/);
+
+assert.throws(function() {
+  zlib.createParallelGzip({ level: 10 });
+}, /Invalid compression level/);
+
+// compressible, but not trivially so.
+var input = new Buffer(1024 * 1024);
+for (var i = 0; i < input.length; i++) {
+  if (i % 1000 < 500)
+    input[i] = 97 + Math.floor(Math.random() * 10);
+  else
+    input[i] = input[i - 700];
+}
+
+var blockSize = 64 * 1024;
+var sizes = [0, 1, 1000, blockSize, blockSize + 1, 5 * blockSize - 3,
+             input.length];
+var checked = 0;
+
+sizes.forEach(function(size) {
+  var data = input.slice(0, size);
+  var gzip = zlib.createParallelGzip({ blockSize: blockSize, parallel: 3 });
+  var gunzip = zlib.createGunzip();
+  var out = [];
+
+  gzip.pipe(gunzip);
+  gunzip.on('data', function(c) {
+    out.push(c);
+  });
+  gunzip.on('end', function() {
+    var result = Buffer.concat(out);
+    assert.equal(result.length, size);
+    assert.equal(result.toString('hex'), data.toString('hex'));
+    checked++;
+  });
+
+  // odd sized writes so blocks don't line up with them.
+  for (var off = 0; off < size; off += 10007)
+    gzip.write(data.slice(off, off + 10007));
+  gzip.end();
+});
+
+// one big write doesn't put more than `parallel` blocks in flight. The
+// other streams run at the same time, this one is told apart by its level.
+var binding = process.binding('zlib');
+var deflateBlock = binding.deflateBlock;
+var inFlight = 0;
+var maxInFlight = 0;
+binding.deflateBlock = function(block, dictionary, level) {
+  var args = Array.prototype.slice.call(arguments);
+  if (level !== 1)
+    return deflateBlock.apply(this, args);
+
+  var oncomplete = args.pop();
+  inFlight++;
+  maxInFlight = Math.max(maxInFlight, inFlight);
+  args.push(function() {
+    inFlight--;
+    return oncomplete.apply(this, arguments);
+  });
+  return deflateBlock.apply(this, args);
+};
+
+var limited = zlib.createParallelGzip({ blockSize: blockSize,
+                                        parallel: 2,
+                                        level: 1 });
+var limitedOut = [];
+limited.on('data', function(c) {
+  limitedOut.push(c);
+});
+limited.on('end', function() {
+  binding.deflateBlock = deflateBlock;
+  assert.equal(maxInFlight, 2);
+  zlib.gunzip(Buffer.concat(limitedOut), function(err, data) {
+    if (err) throw err;
+    assert.equal(data.toString('hex'), input.toString('hex'));
+    checked++;
+  });
+});
+limited.end(input);
+
+// header and trailer: one member with the right length.
+var gzip = zlib.createParallelGzip({ level: 9 });
+var out = [];
+gzip.on('data', function(c) {
+  out.push(c);
+});
+gzip.on('end', function() {
+  var result = Buffer.concat(out);
+  assert.equal(result[0], 0x1f);
+  assert.equal(result[1], 0x8b);
+  assert.equal(result[8], 2);
+  assert.equal(result.readUInt32LE(result.length - 4), input.length);
+  zlib.gunzip(result, function(err, data) {
+    if (err) throw err;
+    assert.equal(data.toString('hex'), input.toString('hex'));
+    checked++;
+  });
+});
+gzip.end(input);
+
+process.on('exit', function() {
+  assert.equal(checked, sizes.length + 2);
+});